@@ -1,5 +1,11 @@
 #include <Bitfinex/Client.h>
-#include <cpr/api.h>
+#include <Bitfinex/OrderMessages.h>
+#include <Bitfinex/ResponseDecoder.h>
+#include <charconv>
+#include <cpr/session.h>
+#include <format>
+#include <future>
+#include <span>
 #include <iostream>
 #include <openssl/crypto.h>
 #include <openssl/evp.h>
@@ -11,139 +17,454 @@ using json = nlohmann::json;
 
 namespace Bitfinex {
 
-OrderResponse Client::submit_order(Order const& order)
+// Sessions for the public endpoints, shared by every client since get_ticker is static
+static ConnectionPool& public_connection_pool()
 {
-    const std::string endpoint = "/v2/auth/w/order/submit";
-    const std::string current_timestamp = get_current_timestamp_as_string();
+    static ConnectionPool connection_pool;
+    return connection_pool;
+}
 
-    // Positive means buy, negative means sell
-    const double amount = (order.side == OrderSide::SELL) ? (order.amount * -1) : order.amount;
+static ClientMetrics& public_client_metrics()
+{
+    static ClientMetrics metrics;
+    return metrics;
+}
 
-    const std::string body = std::format(R"({{ "symbol": "{}", "type": "{}", "amount": "{}", "price": "{}" }})", order.symbol, order_type_to_string(order.type), amount, order.price);
-    const std::string signature = hex_hmac_sha384(this->m_config.SECRET_KEY, "/api" + endpoint + current_timestamp + body);
-    cpr::Response res = cpr::Post(cpr::Url { this->m_config.BASE_ENDPOINT + endpoint }, cpr::Body { body }, cpr::Header { { "Content-type", "application/json" }, {"accept", "application/json"}, { "bfx-nonce", current_timestamp },
-                                    { "bfx-apikey", this->m_config.API_KEY }, { "bfx-signature", signature } });
+ClientMetrics const& Client::public_metrics()
+{
+    return public_client_metrics();
+}
 
-    OrderResponse order_response;
-    order_response.http_status = res.status_code;
-    if (order_response.http_status != 200)
-        return order_response;
-    json json_response = json::parse(res.text);
-    order_response.message = json_response[6];
-    if (order_response.message != "SUCCESS")
-        return order_response;
-    const double order_amount = json_response[4][0][6];
-    order_response.order_id = json_response[4][0][0];
-    order_response.symbol = json_response[4][0][3];
-    order_response.amount = (order_amount < 0) ? (order_amount * -1) : order_amount;
-    order_response.side = (order_amount < 0) ? OrderSide::SELL : OrderSide::BUY;
-    order_response.type = json_response[4][0][8];
-    order_response.price = json_response[4][0][16];
-    return order_response;
+std::optional<std::vector<ApiKey>> parse_api_keys(std::string_view text)
+{
+    std::vector<ApiKey> keys;
+    while (!text.empty()) {
+        const size_t comma = text.find(',');
+        const std::string_view pair = text.substr(0, comma);
+        const size_t colon = pair.find(':');
+        if (colon == 0 || colon == std::string_view::npos || colon + 1 == pair.size())
+            return {};
+        keys.push_back(ApiKey { .API_KEY = std::string(pair.substr(0, colon)), .SECRET_KEY = std::string(pair.substr(colon + 1)) });
+        if (comma == std::string_view::npos)
+            break;
+        text.remove_prefix(comma + 1);
+        // A trailing comma leaves nothing to read, still a malformed pair
+        if (text.empty())
+            return {};
+    }
+    return keys;
 }
 
-OrderResponse Client::update_order(std::string const& order_id, double price)
+Client::SigningKey::SigningKey(ApiKey const& key)
+    : api_key(key.API_KEY)
+    , signer(key.SECRET_KEY)
+    , nonces(key.API_KEY)
 {
-    const std::string endpoint = "/v2/auth/w/order/update";
-    const std::string current_timestamp = get_current_timestamp_as_string();
-    const std::string body = std::format(R"({{ "id": "{}", "price": "{}" }})", order_id, price);
-    const std::string signature = hex_hmac_sha384(this->m_config.SECRET_KEY, "/api" + endpoint + current_timestamp + body);
-    cpr::Response response = cpr::Post(cpr::Url { this->m_config.BASE_ENDPOINT + endpoint }, cpr::Body { body }, cpr::Header { { "Content-type", "application/json" }, {"accept", "application/json"}, { "bfx-nonce", current_timestamp },
-                                                                                                        { "bfx-apikey", this->m_config.API_KEY }, { "bfx-signature", signature } });
+}
+
+Client::Client(Config const& config, ConnectionPoolOptions const& connection_pool_options, RequestSchedulerOptions const& scheduler_options)
+    : m_config(config)
+    , m_connection_pool(connection_pool_options)
+    , m_event_loop(m_connection_pool)
+    , m_scheduler(scheduler_options, m_metrics)
+{
+    m_keys.emplace_back(ApiKey { .API_KEY = m_config.API_KEY, .SECRET_KEY = m_config.SECRET_KEY });
+    for (ApiKey const& key : m_config.EXTRA_KEYS)
+        m_keys.emplace_back(key);
+    // Taken from the back, API_KEY first
+    for (auto key = m_keys.rbegin(); key != m_keys.rend(); ++key)
+        m_free_keys.push_back(&*key);
+}
+
+Client::~Client()
+{
+    std::deque<SigningTurn> dropped;
+    {
+        std::lock_guard lock(m_signing_mutex);
+        m_closing = true;
+        dropped.swap(m_signing_queue);
+    }
+    for (SigningTurn& turn : dropped)
+        turn.drop();
+}
+
+void Client::take_signing_turn(SigningTurn turn)
+{
+    SigningKey* key = nullptr;
+    {
+        std::lock_guard lock(m_signing_mutex);
+        if (!m_closing && m_free_keys.empty()) {
+            m_signing_queue.push_back(std::move(turn));
+            return;
+        }
+        if (!m_closing) {
+            key = m_free_keys.back();
+            m_free_keys.pop_back();
+        }
+    }
+    if (key)
+        turn.start(*key);
+    else
+        turn.drop();
+}
+
+Client::SigningKey* Client::wait_signing_turn()
+{
+    std::promise<SigningKey*> turn;
+    std::future<SigningKey*> key = turn.get_future();
+    take_signing_turn(SigningTurn { .start = [&turn](SigningKey& free_key) { turn.set_value(&free_key); },
+        .drop = [&turn] { turn.set_value(nullptr); } });
+    return key.get();
+}
+
+void Client::release_signing_turn(SigningKey& key)
+{
+    SigningTurn next;
+    {
+        std::lock_guard lock(m_signing_mutex);
+        if (m_signing_queue.empty()) {
+            m_free_keys.push_back(&key);
+            return;
+        }
+        // Handed over without going free, nothing can slip in between
+        next = std::move(m_signing_queue.front());
+        m_signing_queue.pop_front();
+    }
+    next.start(key);
+}
+
+ConnectionPool::Lease Client::prepare_signed_post(SigningKey& key, Endpoint endpoint, std::string const& path, std::string const& body, uint64_t& journal_sequence)
+{
+    const uint64_t sign_start = metrics_clock();
+    // Shared with every client and trading session of the API key in the process. Only one signed
+    // request of the key is in flight at a time (see take_signing_turn), so they also reach the
+    // exchange in nonce order whatever connection they take.
+    const std::string nonce = std::to_string(key.nonces.next());
+    const Signature signature = key.signer.sign({ "/api", path, nonce, body });
+    m_metrics.record(endpoint, Phase::SIGN, metrics_clock() - sign_start);
+    journal_sequence = 0;
+    if (m_journal) {
+        journal_sequence = m_journal->next_sequence();
+        m_journal->record_request(endpoint, journal_sequence, path, body);
+    }
+
+    ConnectionPool::Lease session = m_connection_pool.acquire(m_config.BASE_ENDPOINT);
+    session->SetUrl(cpr::Url { this->m_config.BASE_ENDPOINT + path });
+    session->SetBody(cpr::Body { body });
+    session->SetHeader(cpr::Header { { "Content-type", "application/json" }, {"accept", "application/json"}, { "bfx-nonce", nonce },
+                                    { "bfx-apikey", key.api_key }, { "bfx-signature", signature.str() } });
+    return session;
+}
+
+cpr::Response Client::signed_post(Endpoint endpoint, Lane lane, std::string const& path, std::string const& body)
+{
+    if (m_event_loop.on_loop_thread() || !m_scheduler.wait_turn(rate_limit_family(endpoint), lane))
+        return {};
+    SigningKey* key = wait_signing_turn();
+    if (!key)
+        return {};
+    uint64_t journal_sequence;
+    ConnectionPool::Lease session = prepare_signed_post(*key, endpoint, path, body, journal_sequence);
+    cpr::Response response = session->Post();
+    release_signing_turn(*key);
+    if (m_journal)
+        m_journal->record_response(endpoint, journal_sequence, static_cast<uint16_t>(response.status_code), response.text);
+    m_metrics.record_transfer(endpoint, response.status_code, m_connection_pool.record_transfer(*session));
+    return response;
+}
+
+cpr::Response Client::signed_post(Endpoint endpoint, std::string const& path, std::string const& body, RecordStream& response_body)
+{
+    if (m_event_loop.on_loop_thread() || !m_scheduler.wait_turn(rate_limit_family(endpoint), Lane::NORMAL))
+        return {};
+    SigningKey* key = wait_signing_turn();
+    if (!key)
+        return {};
+    uint64_t journal_sequence;
+    ConnectionPool::Lease session = prepare_signed_post(*key, endpoint, path, body, journal_sequence);
+    // The body is decoded chunk by chunk as it arrives instead of being buffered into the response,
+    // parsing then overlaps the transfer and is timed chunk by chunk too. It is only kept when
+    // it goes to the journal.
+    uint64_t parse_time = 0;
+    std::string journaled_body;
+    session->SetWriteCallback(cpr::WriteCallback { [this, &response_body, &parse_time, &journaled_body](auto const& data, intptr_t) {
+        if (m_journal)
+            journaled_body.append(data);
+        const uint64_t parse_start = metrics_clock();
+        response_body.feed(data);
+        parse_time += metrics_clock() - parse_start;
+        return true;
+    } });
+    cpr::Response response = session->Post();
+    release_signing_turn(*key);
+    // Back to buffering for the next user of the pooled session
+    session->SetWriteCallback(cpr::WriteCallback {});
+    if (m_journal)
+        m_journal->record_response(endpoint, journal_sequence, static_cast<uint16_t>(response.status_code), journaled_body);
+    m_metrics.record_transfer(endpoint, response.status_code, m_connection_pool.record_transfer(*session));
+    m_metrics.record(endpoint, Phase::PARSE, parse_time);
+    return response;
+}
 
+void Client::post_order_request(Endpoint endpoint, Lane lane, uint64_t order_id, std::string path, std::string body,
+    OrderResponse (*parse)(cpr::Response const&), OrderCallback callback)
+{
+    // Either the dispatch or the drop runs, never both
+    auto shared_callback = std::make_shared<OrderCallback>(std::move(callback));
+    auto drop = [shared_callback](char const* reason) {
+        OrderResponse order_response;
+        order_response.http_status = 0;
+        order_response.message = reason;
+        (*shared_callback)(std::move(order_response));
+    };
+    auto send = [this, endpoint, parse, shared_callback, path = std::move(path), body = std::move(body)](SigningKey& key) {
+        // Signed only now, a nonce taken before waiting in the queue would be stale by the time it is sent
+        uint64_t journal_sequence;
+        ConnectionPool::Lease session = prepare_signed_post(key, endpoint, path, body, journal_sequence);
+        m_event_loop.post(std::move(session),
+            [this, &key, endpoint, parse, shared_callback, journal_sequence](cpr::Response const& response, TransferTimings const& timings) {
+            // Answered, the next signed request of the key may go
+            release_signing_turn(key);
+            if (m_journal)
+                m_journal->record_response(endpoint, journal_sequence, static_cast<uint16_t>(response.status_code), response.text);
+            m_metrics.record_transfer(endpoint, response.status_code, timings);
+            const uint64_t parse_start = metrics_clock();
+            OrderResponse order_response;
+            try {
+                order_response = parse(response);
+            } catch (std::exception const& error) {
+                order_response.http_status = response.status_code;
+                order_response.message = error.what();
+                m_metrics.count_error(endpoint, ErrorKind::DECODE);
+            }
+            m_metrics.record(endpoint, Phase::PARSE, metrics_clock() - parse_start);
+            (*shared_callback)(std::move(order_response));
+        });
+    };
+    auto dispatch = [this, send = std::move(send), drop] {
+        take_signing_turn(SigningTurn { .start = std::move(send), .drop = [drop] { drop(RequestScheduler::SHUTDOWN); } });
+    };
+    m_scheduler.submit(rate_limit_family(endpoint), lane, order_id, std::move(dispatch), std::move(drop));
+}
+
+static OrderResponse called_from_callback()
+{
     OrderResponse order_response;
-    order_response.http_status = response.status_code;
-    if (order_response.http_status != 200)
-        return order_response;
-    json json_response = json::parse(response.text);
-    order_response.message = json_response[6];
-    if (order_response.message != "SUCCESS")
-        return order_response;
-    const double order_amount = json_response[4][6];
-    order_response.order_id = json_response[4][0];
-    order_response.symbol = json_response[4][3];
-    order_response.amount = (order_amount < 0) ? (order_amount * -1) : order_amount;
-    order_response.side = (order_amount < 0) ? OrderSide::SELL : OrderSide::BUY;
-    order_response.type = json_response[4][8];
-    order_response.price = json_response[4][16];
+    order_response.http_status = 0;
+    order_response.message = Client::CALLED_FROM_CALLBACK;
     return order_response;
 }
 
-OrderResponse Client::cancel_order(std::string const& order_id)
+static std::future<OrderResponse> to_future(std::function<void(Client::OrderCallback)> const& start)
+{
+    auto promise = std::make_shared<std::promise<OrderResponse>>();
+    std::future<OrderResponse> future = promise->get_future();
+    start([promise](OrderResponse order_response) { promise->set_value(std::move(order_response)); });
+    return future;
+}
+
+void Client::warm_up()
+{
+    m_connection_pool.warm_up(m_config.BASE_ENDPOINT);
+}
+
+ConnectionStats Client::connection_stats() const
+{
+    return m_connection_pool.stats();
+}
+
+static OrderResponse parse_submit_order_response(cpr::Response const& response)
+{
+    return read_submit_order_response(response.status_code, response.text);
+}
+
+static OrderResponse parse_update_order_response(cpr::Response const& response)
+{
+    return read_update_order_response(response.status_code, response.text);
+}
+
+static OrderResponse parse_cancel_order_response(cpr::Response const& response)
+{
+    return read_cancel_order_response(response.status_code, response.text);
+}
+
+void Client::submit_order_async(Order const& order, OrderCallback callback)
+{
+    const std::string endpoint = "/v2/auth/w/order/submit";
+    post_order_request(Endpoint::SUBMIT_ORDER, Lane::NORMAL, 0, endpoint, submit_order_body(order), parse_submit_order_response, std::move(callback));
+}
+
+void Client::update_order_async(uint64_t order_id, Decimal price, OrderCallback callback)
+{
+    const std::string endpoint = "/v2/auth/w/order/update";
+    post_order_request(Endpoint::UPDATE_ORDER, Lane::AMEND, order_id, endpoint, update_order_body(order_id, price), parse_update_order_response, std::move(callback));
+}
+
+void Client::cancel_order_async(uint64_t order_id, OrderCallback callback)
 {
     const std::string endpoint = "/v2/auth/w/order/cancel";
-    const std::string current_timestamp = get_current_timestamp_as_string();
-    const std::string body = std::format(R"({{ "id": {} }})", order_id);
-    const std::string signature = hex_hmac_sha384(this->m_config.SECRET_KEY, "/api" + endpoint + current_timestamp + body);
+    post_order_request(Endpoint::CANCEL_ORDER, Lane::CANCEL, order_id, endpoint, cancel_order_body(order_id), parse_cancel_order_response, std::move(callback));
+}
 
-    cpr::Response response = cpr::Post(cpr::Url { this->m_config.BASE_ENDPOINT + endpoint }, cpr::Body { body }, cpr::Header { { "Content-type", "application/json" }, {"accept", "application/json"}, { "bfx-nonce", current_timestamp },
-                                                                                                                     { "bfx-apikey", this->m_config.API_KEY }, { "bfx-signature", signature } });
+std::future<OrderResponse> Client::submit_order_async(Order const& order)
+{
+    return to_future([&](OrderCallback callback) { submit_order_async(order, std::move(callback)); });
+}
 
-    OrderResponse order_response;
-    order_response.http_status = response.status_code;
-    if (order_response.http_status != 200)
-        return order_response;
-    json json_response = json::parse(response.text);
-    order_response.message = json_response[6];
-    order_response.order_id = json_response[4][0];
-    return order_response;
+std::future<OrderResponse> Client::update_order_async(uint64_t order_id, Decimal price)
+{
+    return to_future([&](OrderCallback callback) { update_order_async(order_id, price, std::move(callback)); });
+}
+
+std::future<OrderResponse> Client::cancel_order_async(uint64_t order_id)
+{
+    return to_future([&](OrderCallback callback) { cancel_order_async(order_id, std::move(callback)); });
+}
+
+OrderResponse Client::submit_order(Order const& order)
+{
+    if (m_event_loop.on_loop_thread())
+        return called_from_callback();
+    return submit_order_async(order).get();
+}
+
+OrderResponse Client::update_order(uint64_t order_id, Decimal price)
+{
+    if (m_event_loop.on_loop_thread())
+        return called_from_callback();
+    return update_order_async(order_id, price).get();
+}
+
+OrderResponse Client::cancel_order(uint64_t order_id)
+{
+    if (m_event_loop.on_loop_thread())
+        return called_from_callback();
+    return cancel_order_async(order_id).get();
+}
+
+std::vector<OrderResponse> Client::post_order_multi(Lane lane, std::vector<std::string> const& operations)
+{
+    const std::string endpoint = "/v2/auth/w/order/multi";
+    std::vector<OrderResponse> order_responses(operations.size());
+
+    // Chunks go out one after the other, requests racing each other over separate
+    // connections could reach the exchange with their nonces out of order
+    for (size_t begin = 0; begin < operations.size(); begin += MAX_OPERATIONS_PER_MULTI_REQUEST) {
+        const size_t end = std::min(begin + MAX_OPERATIONS_PER_MULTI_REQUEST, operations.size());
+        std::string body = R"({ "ops": [)";
+        for (size_t i = begin; i < end; i++) {
+            if (i != begin)
+                body += ", ";
+            body += operations[i];
+        }
+        body += "] }";
+
+        std::span<OrderResponse> chunk_responses(order_responses.data() + begin, end - begin);
+        cpr::Response response = signed_post(Endpoint::ORDER_MULTI, lane, endpoint, body);
+        const uint64_t parse_start = metrics_clock();
+        try {
+            if (read_multi_order_response(response.status_code, response.text, chunk_responses) != 0)
+                m_metrics.count_error(Endpoint::ORDER_MULTI, ErrorKind::DECODE);
+        } catch (std::exception const& error) {
+            for (OrderResponse& order_response : chunk_responses)
+                order_response.message = error.what();
+            m_metrics.count_error(Endpoint::ORDER_MULTI, ErrorKind::DECODE);
+        }
+        m_metrics.record(Endpoint::ORDER_MULTI, Phase::PARSE, metrics_clock() - parse_start);
+    }
+    return order_responses;
+}
+
+std::vector<OrderResponse> Client::submit_orders(std::span<Order const> orders)
+{
+    std::vector<std::string> operations;
+    operations.reserve(orders.size());
+    for (Order const& order : orders)
+        operations.push_back(std::format(R"([ "on", {} ])", submit_order_body(order)));
+    return post_order_multi(Lane::NORMAL, operations);
 }
 
-TickerResponse Client::get_ticker(std::string const& symbol)
+std::vector<OrderResponse> Client::update_orders(std::span<OrderPriceUpdate const> updates)
 {
-    const std::string url = "https://api-pub.bitfinex.com";
-    const std::string endpoint = "/v2/ticker/" + symbol;
-    cpr::Response response = cpr::Get(cpr::Url { url + endpoint });
+    std::vector<std::string> operations;
+    operations.reserve(updates.size());
+    for (OrderPriceUpdate const& update : updates)
+        operations.push_back(std::format(R"([ "ou", {} ])", update_order_body(update.order_id, update.price)));
+    return post_order_multi(Lane::AMEND, operations);
+}
+
+std::vector<OrderResponse> Client::cancel_orders(std::span<uint64_t const> order_ids)
+{
+    std::vector<std::string> operations;
+    operations.reserve(order_ids.size());
+    for (uint64_t order_id : order_ids)
+        operations.push_back(std::format(R"([ "oc", {} ])", cancel_order_body(order_id)));
+    return post_order_multi(Lane::CANCEL, operations);
+}
+
+TickerResponse Client::get_ticker(SymbolId symbol, std::string const& public_endpoint)
+{
+    const std::string endpoint = std::format("/v2/ticker/{}", symbol_name(symbol));
+    ConnectionPool& connection_pool = public_connection_pool();
+    ConnectionPool::Lease session = connection_pool.acquire(public_endpoint);
+    session->SetUrl(cpr::Url { public_endpoint + endpoint });
+    cpr::Response response = session->Get();
+    ClientMetrics& metrics = public_client_metrics();
+    metrics.record_transfer(Endpoint::TICKER, response.status_code, connection_pool.record_transfer(*session));
 
     TickerResponse ticker_response;
     ticker_response.http_status = response.status_code;
     if (ticker_response.http_status != 200)
         return ticker_response;
+    const uint64_t parse_start = metrics_clock();
     json json_response = json::parse(response.text);
     ticker_response.bid = json_response[0];
     ticker_response.last_price = json_response[6];
     ticker_response.volume = json_response[7];
+    metrics.record(Endpoint::TICKER, Phase::PARSE, metrics_clock() - parse_start);
     return ticker_response;
 }
 
-std::optional<OrderBook> Client::retrieve_orders(std::string const& symbol)
+std::optional<size_t> Client::load_symbols(std::string const& public_endpoint)
 {
-    const std::string endpoint = "/v2/auth/r/orders/" + symbol;
-    const std::string current_timestamp = get_current_timestamp_as_string();
-    const std::string signature = hex_hmac_sha384(this->m_config.SECRET_KEY, "/api" + endpoint + current_timestamp);
-
-    cpr::Response response = cpr::Post(cpr::Url { this->m_config.BASE_ENDPOINT + endpoint }, cpr::Body {}, cpr::Header { { "Content-type", "application/json" }, {"accept", "application/json"}, { "bfx-nonce", current_timestamp },
-                                            { "bfx-apikey", this->m_config.API_KEY }, { "bfx-signature", signature } });
+    ConnectionPool& connection_pool = public_connection_pool();
+    ConnectionPool::Lease session = connection_pool.acquire(public_endpoint);
+    session->SetUrl(cpr::Url { public_endpoint + "/v2/conf/pub:info:pair" });
+    cpr::Response response = session->Get();
+    ClientMetrics& metrics = public_client_metrics();
+    metrics.record_transfer(Endpoint::PAIR_INFO, response.status_code, connection_pool.record_transfer(*session));
     if (response.status_code != 200)
         return {};
-    json json_response = json::parse(response.text);
-    if (json_response.empty())
-        return OrderBook {};
+    const uint64_t parse_start = metrics_clock();
+    std::optional<size_t> pair_count = Bitfinex::load_symbols(response.text);
+    metrics.record(Endpoint::PAIR_INFO, Phase::PARSE, metrics_clock() - parse_start);
+    if (!pair_count.has_value())
+        metrics.count_error(Endpoint::PAIR_INFO, ErrorKind::DECODE);
+    return pair_count;
+}
+
+std::optional<OrderBook> Client::retrieve_orders(SymbolId symbol)
+{
+    const std::string endpoint = std::format("/v2/auth/r/orders/{}", symbol_name(symbol));
     OrderBook order_book;
-    std::for_each(json_response.cbegin(), json_response.cend(), [&order_book](json const& order_element) {
-        double order_amount = order_element[6];
-        // Positive means buy, negative means sell
-        order_amount = (order_amount < 0) ? order_amount * -1 : order_amount;
-        OrderSide side = (order_element[6] < 0) ? OrderSide::SELL : OrderSide::BUY;
-        ulong order_id = order_element[0];
-        Order order { .order_id = std::to_string(order_id), .side = side, .symbol = order_element[3], .amount = order_amount,
-                        .type = order_type_from_string(order_element[8]), .price = order_element[16], .creation_date = unix_to_iso_utc(order_element[4]) };
-        order_book.append_order(order);
-    });
+    RecordDecoder<Order> decoder = orders_decoder(order_book);
+    cpr::Response response = signed_post(Endpoint::ORDERS, endpoint, "", decoder);
+    if (response.status_code != 200)
+        return {};
+    if (decoder.finish() != DecodeError::NONE) {
+        m_metrics.count_error(Endpoint::ORDERS, ErrorKind::DECODE);
+        return {};
+    }
     return order_book;
 }
 
-IncreasePositionResponse Client::increase_position(PositionSide side, std::string const& symbol, double amount)
+IncreasePositionResponse Client::increase_position(PositionSide side, SymbolId symbol, Decimal amount)
 {
     const std::string endpoint = "/v2/auth/w/position/increase";
-    const std::string current_timestamp = get_current_timestamp_as_string();
     // (positive for long, negative for short)
-    amount = (side == PositionSide::SHORT) ? (amount * -1) : amount;
-    const std::string body = std::format(R"({{ "symbol": "{}", "amount": "{}" }})", symbol, amount);
-    const std::string signature = hex_hmac_sha384(this->m_config.SECRET_KEY, "/api" + endpoint + current_timestamp + body);
-
-    cpr::Response response = cpr::Post(cpr::Url { this->m_config.BASE_ENDPOINT + endpoint }, cpr::Body{ body }, cpr::Header { { "Content-type", "application/json" }, {"accept", "application/json"}, { "bfx-nonce", current_timestamp },
-                                                                                                 { "bfx-apikey", this->m_config.API_KEY }, { "bfx-signature", signature } });
+    amount = (side == PositionSide::SHORT) ? -amount : amount;
+    const std::string body = std::format(R"({{ "symbol": "{}", "amount": "{}" }})", symbol_name(symbol), amount);
+    cpr::Response response = signed_post(Endpoint::INCREASE_POSITION, Lane::NORMAL, endpoint, body);
     IncreasePositionResponse position_response;
     position_response.http_status = response.status_code;
     if (position_response.http_status != 200)
@@ -156,20 +477,15 @@ IncreasePositionResponse Client::increase_position(PositionSide side, std::strin
 std::optional<Positions> Client::retrieve_positions()
 {
     const std::string endpoint = "/v2/auth/r/positions";
-    const std::string current_timestamp = get_current_timestamp_as_string();
-    const std::string signature = hex_hmac_sha384(this->m_config.SECRET_KEY, "/api" + endpoint + current_timestamp);
-    cpr::Response response = cpr::Post(cpr::Url { this->m_config.BASE_ENDPOINT + endpoint }, cpr::Header { { "Content-type", "application/json" }, {"accept", "application/json"}, { "bfx-nonce", current_timestamp },
-                                                                                                                     { "bfx-apikey", this->m_config.API_KEY }, { "bfx-signature", signature } });
+    Positions positions;
+    RecordDecoder<Position> decoder = positions_decoder(positions);
+    cpr::Response response = signed_post(Endpoint::POSITIONS, endpoint, "", decoder);
     if (response.status_code != 200)
         return {};
-    Positions positions;
-    json json_response = json::parse(response.text);
-    if (json_response.empty())
-        return positions;
-    std::for_each(json_response.cbegin(), json_response.cend(), [&positions](json json_position) {
-        Position position { .symbol = json_position[0], .status = json_position[1], .amount = json_position[2], .base_price = json_position[3] };
-        positions.append_position(position);
-    });
+    if (decoder.finish() != DecodeError::NONE) {
+        m_metrics.count_error(Endpoint::POSITIONS, ErrorKind::DECODE);
+        return {};
+    }
     return positions;
 }
 
@@ -180,33 +496,61 @@ std::string get_current_timestamp_as_string()
     return std::to_string(now_ms.time_since_epoch().count());
 }
 
-std::string unix_to_iso_utc(long long milliseconds_unix_time_stamp)
+static void write_digits(unsigned value, int width, char* out)
 {
-    // Convert Unix timestamp from milliseconds to seconds and remaining milliseconds
-    long long seconds = milliseconds_unix_time_stamp / 1000;
-    long long milliseconds = milliseconds_unix_time_stamp % 1000;
-
-    // Convert to time_t
-    std::time_t time = static_cast<time_t>(seconds);
-
-    // Convert to tm struct
-    std::tm* tmUTC = std::gmtime(&time);
-
-    // Create an ostringstream for formatting
-    std::ostringstream oss;
-
-    // Format the time as ISO 8601 UTC
-    oss << std::put_time(tmUTC, "%Y-%m-%dT%H:%M:%S");
+    for (int i = width - 1; i >= 0; i--) {
+        out[i] = static_cast<char>('0' + value % 10);
+        value /= 10;
+    }
+}
 
-    // Always add milliseconds
-    oss << '.' << std::setfill('0') << std::setw(3) << milliseconds;
+void write_iso_utc(long long milliseconds_unix_time_stamp, char* out)
+{
+    // Floor division so timestamps before 1970 land on the right day
+    long long days = milliseconds_unix_time_stamp / 86400000;
+    long long milliseconds_of_day = milliseconds_unix_time_stamp % 86400000;
+    if (milliseconds_of_day < 0) {
+        milliseconds_of_day += 86400000;
+        days--;
+    }
 
-    oss << 'Z';  // UTC designator
+    // Civil date from days since the epoch, https://howardhinnant.github.io/date_algorithms.html#civil_from_days
+    days += 719468;
+    const long long era = (days >= 0 ? days : days - 146096) / 146097;
+    const auto day_of_era = static_cast<unsigned>(days - era * 146097);
+    const unsigned year_of_era = (day_of_era - day_of_era / 1460 + day_of_era / 36524 - day_of_era / 146096) / 365;
+    const unsigned day_of_year = day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+    const unsigned shifted_month = (5 * day_of_year + 2) / 153;
+    const unsigned day = day_of_year - (153 * shifted_month + 2) / 5 + 1;
+    const unsigned month = shifted_month < 10 ? shifted_month + 3 : shifted_month - 9;
+    const auto year = static_cast<unsigned>(static_cast<long long>(year_of_era) + era * 400 + (month <= 2));
+
+    const auto milliseconds = static_cast<unsigned>(milliseconds_of_day);
+    write_digits(year, 4, out);
+    out[4] = '-';
+    write_digits(month, 2, out + 5);
+    out[7] = '-';
+    write_digits(day, 2, out + 8);
+    out[10] = 'T';
+    write_digits(milliseconds / 3600000, 2, out + 11);
+    out[13] = ':';
+    write_digits(milliseconds / 60000 % 60, 2, out + 14);
+    out[16] = ':';
+    write_digits(milliseconds / 1000 % 60, 2, out + 17);
+    out[19] = '.';
+    write_digits(milliseconds % 1000, 3, out + 20);
+    out[23] = 'Z';
+}
 
-    return oss.str();
+std::string unix_to_iso_utc(long long milliseconds_unix_time_stamp)
+{
+    std::string iso(ISO_UTC_LENGTH, '\0');
+    write_iso_utc(milliseconds_unix_time_stamp, iso.data());
+    return iso;
 }
 
 // https://www.okx.com/docs-v5/en/#overview-rest-authentication-signature
+// One-shot variant, Client signs through its Signer which keeps the keyed context around
 std::string hex_hmac_sha384(std::string const& key, std::string const& data)
 {
     unsigned char hash[EVP_MAX_MD_SIZE];
@@ -259,15 +603,17 @@ std::string hex_hmac_sha384(std::string const& key, std::string const& data)
 
 std::ostream& operator<<(std::ostream& cin, Order const& order)
 {
+    char creation_date[ISO_UTC_LENGTH];
+    write_iso_utc(order.creation_time_ms, creation_date);
     cin << "{ order id: " << order.order_id << ", side: " << order_side_to_string(order.side) << ", symbol: "
-        << order.symbol << ", amount: " << order.amount << ", type: " << order_type_to_string(order.type) <<
-        ", price: " << order.price << ", creation date: " << order.creation_date << " }";
+        << symbol_name(order.symbol) << ", amount: " << order.amount << ", type: " << order_type_to_string(order.type) <<
+        ", price: " << order.price << ", creation date: " << std::string_view(creation_date, ISO_UTC_LENGTH) << " }";
     return cin;
 }
 
 std::ostream& operator<<(std::ostream& cin, Position const& position)
 {
-    cin << "{ status: " << position.status << ", symbol: " << position.symbol << ", base price: " << position.base_price
+    cin << "{ status: " << position_status_to_string(position.status) << ", symbol: " << symbol_name(position.symbol) << ", base price: " << position.base_price
         << ", amount: " << position.amount << " }";
     return cin;
 }
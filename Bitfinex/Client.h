@@ -1,20 +1,37 @@
 #pragma once
 
+#include <Bitfinex/ConnectionPool.h>
+#include <Bitfinex/Decimal.h>
+#include <Bitfinex/EventLoop.h>
+#include <Bitfinex/Journal.h>
+#include <Bitfinex/Metrics.h>
 #include <Bitfinex/OrderBook.h>
+#include <Bitfinex/RequestScheduler.h>
 #include <Bitfinex/ENUMS.h>
+#include <Bitfinex/Signer.h>
+#include <Bitfinex/Symbols.h>
 #include <dotenv/dotenv.h>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
 #include <optional>
+#include <span>
 #include <string>
+#include <string_view>
+#include <type_traits>
 #include <utility>
+#include <vector>
 
 namespace Bitfinex {
 
 struct Position {
-    std::string symbol;
-    std::string status;
-    double amount;
-    double base_price;
+    Decimal amount;
+    Decimal base_price;
+    SymbolId symbol;
+    PositionStatus status;
 };
+static_assert(std::is_trivially_copyable_v<Position>);
 
 struct TickerResponse {
     unsigned short http_status;
@@ -28,10 +45,10 @@ struct OrderResponse {
     unsigned short http_status;
     unsigned long order_id;
     std::string message;
-    std::string symbol;
+    SymbolId symbol;
     OrderSide side;
-    double amount;
-    double price;
+    Decimal amount;
+    Decimal price;
 };
 
 struct IncreasePositionResponse {
@@ -40,36 +57,154 @@ struct IncreasePositionResponse {
 };
 
 struct Order {
-    std::string order_id;
+    uint64_t order_id;
+    int64_t creation_time_ms; // Unix time, see unix_to_iso_utc
+    Decimal amount;
+    Decimal price;
+    SymbolId symbol;
     OrderSide side;
-    std::string symbol;
-    double amount;
     OrderType type;
-    double price;
-    std::string creation_date;
+};
+static_assert(std::is_trivially_copyable_v<Order>);
+
+struct OrderPriceUpdate {
+    uint64_t order_id;
+    Decimal price;
+};
+
+struct ApiKey {
+    std::string API_KEY;
+    std::string SECRET_KEY;
 };
 
 struct Config {
     std::string BASE_ENDPOINT;
     std::string API_KEY;
     std::string SECRET_KEY;
+    // More keys of the same account, each adds one signed request in flight, see Client
+    std::vector<ApiKey> EXTRA_KEYS;
 };
 
+// Reads the EXTRA_KEYS of a .env file, "KEY:SECRET" pairs separated by commas. Nothing when a pair
+// is malformed, no keys for an empty text.
+std::optional<std::vector<ApiKey>> parse_api_keys(std::string_view text);
+
 class Client {
 public:
-    explicit Client(Config const& config) : m_config(config) {}
-    static TickerResponse get_ticker(std::string const&);
+    using OrderCallback = std::function<void(OrderResponse)>;
+
+    // Base URL of the unauthenticated endpoints, a simulator serves both on the same address
+    static constexpr char DEFAULT_PUBLIC_ENDPOINT[] = "https://api-pub.bitfinex.com";
+
+    // Answer of a blocking call made from a callback of the async API, see below
+    static constexpr char CALLED_FROM_CALLBACK[] = "CALLED_FROM_CALLBACK";
+
+    // Authenticated requests go through a RequestScheduler, within the exchange's rate limits by
+    // default. The exchange rejects a nonce that is not above the last one it saw for the API key, so
+    // the signed requests of a key go out one at a time in the order they were signed: the next one
+    // is signed once the previous one is answered. The client signs with API_KEY and every key of
+    // EXTRA_KEYS, a request takes the first key that is free, so there are as many requests in
+    // flight as keys. Requests on different keys may reach the exchange in any order.
+    explicit Client(Config const& config, ConnectionPoolOptions const& connection_pool_options = {}, RequestSchedulerOptions const& scheduler_options = {});
+    Client(Client const&) = delete;
+    Client& operator=(Client const&) = delete;
+    // Requests still waiting for their turn are answered with http status 0 and RequestScheduler::SHUTDOWN
+    ~Client();
+    static TickerResponse get_ticker(SymbolId, std::string const& public_endpoint = DEFAULT_PUBLIC_ENDPOINT);
+    // Preloads the symbol table with every trading pair and its order size limits, returns the number of pairs
+    static std::optional<size_t> load_symbols(std::string const& public_endpoint = DEFAULT_PUBLIC_ENDPOINT);
     OrderResponse submit_order(Order const&);
-    OrderResponse update_order(std::string const& order_id, double price);
-    OrderResponse cancel_order(std::string const&);
-    std::optional<OrderBook> retrieve_orders(std::string const&);
-    IncreasePositionResponse increase_position(PositionSide, std::string const& symbol, double amount);
+    OrderResponse update_order(uint64_t order_id, Decimal price);
+    OrderResponse cancel_order(uint64_t order_id);
+
+    // Non-blocking variants, callbacks run on the client's event loop thread. They free the calling
+    // thread but not the keys: at most one request per key is in flight, the rest wait in the
+    // client's queue, so with API_KEY alone they send no faster than the blocking calls. An amend
+    // or cancel that makes a queued amend of the same order pointless answers it with http status 0
+    // and the message RequestScheduler::SUPERSEDED. The loop thread cannot wait for itself: blocking
+    // calls made from a callback fail at once, with http status 0 (and CALLED_FROM_CALLBACK as
+    // message where there is one), chain async calls instead.
+    void submit_order_async(Order const&, OrderCallback);
+    void update_order_async(uint64_t order_id, Decimal price, OrderCallback);
+    void cancel_order_async(uint64_t order_id, OrderCallback);
+    std::future<OrderResponse> submit_order_async(Order const&);
+    std::future<OrderResponse> update_order_async(uint64_t order_id, Decimal price);
+    std::future<OrderResponse> cancel_order_async(uint64_t order_id);
+
+    // Batches through the multi order endpoint, responses are returned in input order
+    static constexpr size_t MAX_OPERATIONS_PER_MULTI_REQUEST = 75;
+    std::vector<OrderResponse> submit_orders(std::span<Order const>);
+    std::vector<OrderResponse> update_orders(std::span<OrderPriceUpdate const>);
+    std::vector<OrderResponse> cancel_orders(std::span<uint64_t const> order_ids);
+
+    std::optional<OrderBook> retrieve_orders(SymbolId);
+    IncreasePositionResponse increase_position(PositionSide, SymbolId, Decimal amount);
     std::optional<Positions> retrieve_positions();
+
+    // Resolves BASE_ENDPOINT and opens a connection to it, so that the first request skips the
+    // handshakes. Costs a round trip, worth it for a long-lived client only.
+    void warm_up();
+
+    [[nodiscard]] ConnectionStats connection_stats() const;
+    [[nodiscard]] ClientMetrics const& metrics() const { return m_metrics; }
+    // Records every signed request and its response from then on, set before the first request.
+    // The journal must outlive the client.
+    void set_journal(Journal* journal) { m_journal = journal; }
+    // Shared by get_ticker and load_symbols, which do not go through a client
+    static ClientMetrics const& public_metrics();
 private:
+    struct SigningKey {
+        explicit SigningKey(ApiKey const&);
+
+        const std::string api_key;
+        const Signer signer;
+        NonceSource nonces;
+    };
+
+    struct SigningTurn {
+        // Signs with the key and sends, the request's answer must then release the key
+        std::function<void(SigningKey&)> start;
+        std::function<void()> drop;
+    };
+
+    // Runs start as soon as a key has no signed request in flight, in arrival order
+    void take_signing_turn(SigningTurn);
+    // Blocks until the calling thread may sign and send, nothing when the client shuts down first
+    SigningKey* wait_signing_turn();
+    void release_signing_turn(SigningKey&);
+    // Journals the request under a new sequence when there is a journal, 0 otherwise
+    ConnectionPool::Lease prepare_signed_post(SigningKey&, Endpoint, std::string const& path, std::string const& body, uint64_t& journal_sequence);
+    // Both wait for the rate limiter, an empty response (http status 0) means the client shut down first
+    cpr::Response signed_post(Endpoint, Lane, std::string const& path, std::string const& body);
+    // Streams the response body into the decoder, the returned response has no text
+    cpr::Response signed_post(Endpoint, std::string const& path, std::string const& body, RecordStream& response_body);
+    std::vector<OrderResponse> post_order_multi(Lane, std::vector<std::string> const& operations);
+    // order_id is the order an amend or cancel applies to, 0 for a new order
+    void post_order_request(Endpoint, Lane, uint64_t order_id, std::string path, std::string body, OrderResponse (*parse)(cpr::Response const&),
+        OrderCallback);
+
     const Config m_config;
+    // A deque, the keys stay where they are
+    std::deque<SigningKey> m_keys;
+    std::mutex m_signing_mutex;
+    // Keys with no signed request in flight
+    std::vector<SigningKey*> m_free_keys;
+    bool m_closing { false };
+    std::deque<SigningTurn> m_signing_queue;
+    ClientMetrics m_metrics;
+    Journal* m_journal { nullptr };
+    ConnectionPool m_connection_pool;
+    // Declared after the pool, in-flight sessions are handed back to it on shutdown
+    EventLoop m_event_loop;
+    // Declared last, requests it still holds are dropped before the loop goes away
+    RequestScheduler m_scheduler;
 };
 
 std::string get_current_timestamp_as_string();
+// Length of "2024-06-10T12:34:56.789Z"
+static constexpr size_t ISO_UTC_LENGTH = 24;
+// Writes exactly ISO_UTC_LENGTH characters, without a terminating null
+void write_iso_utc(long long milliseconds_unix_time_stamp, char* out);
 std::string unix_to_iso_utc(long long milliseconds_unix_time_stamp);
 std::string hex_hmac_sha384(const std::string& key, const std::string& data);
 std::ostream& operator<<(std::ostream& cin, Order const&);
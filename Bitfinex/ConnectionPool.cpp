@@ -0,0 +1,129 @@
+#include <Bitfinex/ConnectionPool.h>
+#include <stdexcept>
+
+namespace Bitfinex {
+
+static void lock_share(CURL*, curl_lock_data data, curl_lock_access, void* user_pointer)
+{
+    auto* locks = static_cast<std::mutex*>(user_pointer);
+    locks[data % 8].lock();
+}
+
+static void unlock_share(CURL*, curl_lock_data data, void* user_pointer)
+{
+    auto* locks = static_cast<std::mutex*>(user_pointer);
+    locks[data % 8].unlock();
+}
+
+ConnectionPool::Lease::~Lease()
+{
+    if (m_session)
+        m_pool->release(m_host, std::move(m_session));
+}
+
+ConnectionPool::ConnectionPool(ConnectionPoolOptions const& options)
+    : m_options(options)
+{
+    m_share = curl_share_init();
+    if (!m_share)
+        throw std::runtime_error("Failed to create curl share handle");
+    curl_share_setopt(m_share, CURLSHOPT_LOCKFUNC, lock_share);
+    curl_share_setopt(m_share, CURLSHOPT_UNLOCKFUNC, unlock_share);
+    curl_share_setopt(m_share, CURLSHOPT_USERDATA, m_share_locks);
+    curl_share_setopt(m_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(m_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+}
+
+ConnectionPool::~ConnectionPool()
+{
+    // Sessions reference the share handle, they have to go first
+    m_idle_sessions.clear();
+    curl_share_cleanup(m_share);
+}
+
+ConnectionPool::Lease ConnectionPool::acquire(std::string const& host)
+{
+    {
+        std::lock_guard lock(m_mutex);
+        auto& idle_sessions = m_idle_sessions[host];
+        if (!idle_sessions.empty()) {
+            std::shared_ptr<cpr::Session> session = std::move(idle_sessions.back());
+            idle_sessions.pop_back();
+            return Lease { *this, host, std::move(session) };
+        }
+    }
+    return Lease { *this, host, create_session() };
+}
+
+void ConnectionPool::release(std::string const& host, std::shared_ptr<cpr::Session> session)
+{
+    std::lock_guard lock(m_mutex);
+    auto& idle_sessions = m_idle_sessions[host];
+    if (idle_sessions.size() < m_options.max_idle_sessions_per_host)
+        idle_sessions.push_back(std::move(session));
+}
+
+void ConnectionPool::warm_up(std::string const& host)
+{
+    Lease session = acquire(host);
+    session->SetUrl(cpr::Url { host + "/" });
+    session->Head();
+    record_transfer(*session);
+}
+
+std::shared_ptr<cpr::Session> ConnectionPool::create_session()
+{
+    auto session = std::make_shared<cpr::Session>();
+    CURL* handle = session->GetCurlHolder()->handle;
+    curl_easy_setopt(handle, CURLOPT_SHARE, m_share);
+    curl_easy_setopt(handle, CURLOPT_TCP_NODELAY, 1L);
+    curl_easy_setopt(handle, CURLOPT_TCP_KEEPALIVE, 1L);
+    curl_easy_setopt(handle, CURLOPT_TCP_KEEPIDLE, static_cast<long>(m_options.keep_alive_idle.count()));
+    curl_easy_setopt(handle, CURLOPT_TCP_KEEPINTVL, static_cast<long>(m_options.keep_alive_interval.count()));
+    curl_easy_setopt(handle, CURLOPT_DNS_CACHE_TIMEOUT, static_cast<long>(m_options.dns_cache_timeout.count()));
+    curl_easy_setopt(handle, CURLOPT_SSL_SESSIONID_CACHE, 1L);
+    if (m_options.http2) {
+        curl_easy_setopt(handle, CURLOPT_HTTP_VERSION, static_cast<long>(CURL_HTTP_VERSION_2TLS));
+        // Prefer waiting for a connection that can multiplex over opening a new one
+        curl_easy_setopt(handle, CURLOPT_PIPEWAIT, 1L);
+    }
+    m_sessions_created.fetch_add(1, std::memory_order_relaxed);
+    return session;
+}
+
+TransferTimings ConnectionPool::record_transfer(cpr::Session& session)
+{
+    CURL* handle = session.GetCurlHolder()->handle;
+    TransferTimings timings;
+    curl_easy_getinfo(handle, CURLINFO_NUM_CONNECTS, &timings.connects);
+    m_requests.fetch_add(1, std::memory_order_relaxed);
+    if (timings.connects == 0)
+        m_reused_connections.fetch_add(1, std::memory_order_relaxed);
+    else
+        m_new_connections.fetch_add(timings.connects, std::memory_order_relaxed);
+
+    if constexpr (METRICS_ENABLED) {
+        curl_off_t time = 0;
+        auto read_time = [&](CURLINFO info, int64_t& out) {
+            if (curl_easy_getinfo(handle, info, &time) == CURLE_OK)
+                out = static_cast<int64_t>(time);
+        };
+        read_time(CURLINFO_NAMELOOKUP_TIME_T, timings.name_lookup);
+        read_time(CURLINFO_CONNECT_TIME_T, timings.connect);
+        read_time(CURLINFO_APPCONNECT_TIME_T, timings.tls_handshake);
+        read_time(CURLINFO_PRETRANSFER_TIME_T, timings.request_sent);
+        read_time(CURLINFO_STARTTRANSFER_TIME_T, timings.first_byte);
+        read_time(CURLINFO_TOTAL_TIME_T, timings.total);
+    }
+    return timings;
+}
+
+ConnectionStats ConnectionPool::stats() const
+{
+    return ConnectionStats { .requests = m_requests.load(std::memory_order_relaxed),
+        .new_connections = m_new_connections.load(std::memory_order_relaxed),
+        .reused_connections = m_reused_connections.load(std::memory_order_relaxed),
+        .sessions_created = m_sessions_created.load(std::memory_order_relaxed) };
+}
+
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <Bitfinex/Metrics.h>
+#include <atomic>
+#include <chrono>
+#include <cpr/session.h>
+#include <cstdint>
+#include <curl/curl.h>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Bitfinex {
+
+struct ConnectionPoolOptions {
+    // Upper bound of idle sessions kept per host, busy sessions are never capped
+    size_t max_idle_sessions_per_host { 8 };
+    bool http2 { false };
+    std::chrono::seconds keep_alive_idle { 30 };
+    std::chrono::seconds keep_alive_interval { 15 };
+    std::chrono::seconds dns_cache_timeout { 600 };
+};
+
+struct ConnectionStats {
+    uint64_t requests;
+    uint64_t new_connections; // Connections opened (DNS + TCP + TLS handshakes)
+    uint64_t reused_connections; // Transfers served on an already open connection
+    uint64_t sessions_created;
+};
+
+// Keeps long-lived cpr sessions per host. All sessions share one curl share handle for the DNS
+// cache and TLS sessions. Open connections are not shared, libcurl does not support sharing its
+// connection cache between threads: each session keeps its own, and so does a multi handle.
+class ConnectionPool {
+public:
+    class Lease {
+    public:
+        Lease(ConnectionPool& pool, std::string host, std::shared_ptr<cpr::Session> session)
+            : m_pool(&pool)
+            , m_host(std::move(host))
+            , m_session(std::move(session))
+        {
+        }
+        Lease(Lease&& other) noexcept = default;
+        Lease& operator=(Lease&&) = delete;
+        Lease(Lease const&) = delete;
+        Lease& operator=(Lease const&) = delete;
+        ~Lease();
+
+        cpr::Session* operator->() const { return m_session.get(); }
+        cpr::Session& operator*() const { return *m_session; }
+        [[nodiscard]] std::shared_ptr<cpr::Session> const& session() const { return m_session; }
+
+    private:
+        ConnectionPool* m_pool;
+        std::string m_host;
+        std::shared_ptr<cpr::Session> m_session;
+    };
+
+    explicit ConnectionPool(ConnectionPoolOptions const& options = {});
+    ConnectionPool(ConnectionPool const&) = delete;
+    ConnectionPool& operator=(ConnectionPool const&) = delete;
+    ~ConnectionPool();
+
+    // host is the scheme and authority part of a url, e.g. https://api.bitfinex.com
+    Lease acquire(std::string const& host);
+    // Resolves the host and opens a connection on an idle session, so the next blocking request to
+    // the host skips the handshakes
+    void warm_up(std::string const& host);
+
+    // Must be called once per completed transfer to keep the reuse counters accurate. The phase
+    // timings are only read from curl when metrics are compiled in.
+    TransferTimings record_transfer(cpr::Session&);
+
+    [[nodiscard]] ConnectionStats stats() const;
+    [[nodiscard]] ConnectionPoolOptions const& options() const { return m_options; }
+
+private:
+    std::shared_ptr<cpr::Session> create_session();
+    void release(std::string const& host, std::shared_ptr<cpr::Session> session);
+
+    ConnectionPoolOptions const m_options;
+    CURLSH* m_share { nullptr };
+    std::mutex m_share_locks[8];
+
+    std::mutex m_mutex;
+    std::unordered_map<std::string, std::vector<std::shared_ptr<cpr::Session>>> m_idle_sessions;
+
+    std::atomic<uint64_t> m_requests { 0 };
+    std::atomic<uint64_t> m_new_connections { 0 };
+    std::atomic<uint64_t> m_reused_connections { 0 };
+    std::atomic<uint64_t> m_sessions_created { 0 };
+};
+
+}
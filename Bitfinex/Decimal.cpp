@@ -0,0 +1,175 @@
+#include <Bitfinex/Decimal.h>
+#include <array>
+#include <charconv>
+#include <cstring>
+
+namespace Bitfinex {
+
+static constexpr std::array<char, 200> make_digit_pairs()
+{
+    std::array<char, 200> pairs {};
+    for (int i = 0; i < 100; i++) {
+        pairs[i * 2] = static_cast<char>('0' + i / 10);
+        pairs[i * 2 + 1] = static_cast<char>('0' + i % 10);
+    }
+    return pairs;
+}
+
+static constexpr std::array<char, 200> digit_pairs = make_digit_pairs();
+
+static constexpr std::array<uint64_t, 20> powers_of_ten = [] {
+    std::array<uint64_t, 20> powers {};
+    powers[0] = 1;
+    for (size_t i = 1; i < powers.size(); i++)
+        powers[i] = powers[i - 1] * 10;
+    return powers;
+}();
+
+// Writes value right aligned so that the last digit lands just before end, returns the first digit
+static char* write_integer_backwards(uint64_t value, char* end)
+{
+    while (value >= 100) {
+        end -= 2;
+        std::memcpy(end, &digit_pairs[(value % 100) * 2], 2);
+        value /= 100;
+    }
+    if (value >= 10) {
+        end -= 2;
+        std::memcpy(end, &digit_pairs[value * 2], 2);
+    } else
+        *--end = static_cast<char>('0' + value);
+    return end;
+}
+
+char* Decimal::write(char* out) const
+{
+    uint64_t magnitude = (m_units < 0) ? 0 - static_cast<uint64_t>(m_units) : static_cast<uint64_t>(m_units);
+    if (m_units < 0)
+        *out++ = '-';
+    const uint64_t integer = magnitude / SCALE;
+    auto fraction = static_cast<uint32_t>(magnitude % SCALE);
+
+    char digits[20];
+    char* first = write_integer_backwards(integer, digits + sizeof(digits));
+    const size_t length = digits + sizeof(digits) - first;
+    std::memcpy(out, first, length);
+    out += length;
+    if (fraction == 0)
+        return out;
+
+    // All eight fraction digits in four pair stores, then the trailing zeros are dropped
+    *out++ = '.';
+    for (int i = 3; i >= 0; i--) {
+        std::memcpy(out + i * 2, &digit_pairs[(fraction % 100) * 2], 2);
+        fraction /= 100;
+    }
+    out += FRACTION_DIGITS;
+    while (out[-1] == '0')
+        out--;
+    return out;
+}
+
+std::string Decimal::to_string() const
+{
+    char text[MAX_LENGTH];
+    return std::string(text, write(text));
+}
+
+std::optional<Decimal> Decimal::parse(std::string_view text)
+{
+    char const* cursor = text.data();
+    char const* end = text.data() + text.size();
+    bool negative = false;
+    if (cursor != end && (*cursor == '-' || *cursor == '+'))
+        negative = *cursor++ == '-';
+
+    // Significant digits go into mantissa, exponent tracks the position of the decimal point
+    uint64_t mantissa = 0;
+    int exponent = 0;
+    int significant_digits = 0;
+    bool any_digit = false;
+    bool dropped_nonzero = false;
+    bool in_fraction = false;
+    for (; cursor != end; cursor++) {
+        if (*cursor == '.' && !in_fraction) {
+            in_fraction = true;
+            continue;
+        }
+        if (*cursor < '0' || *cursor > '9')
+            break;
+        any_digit = true;
+        const int digit = *cursor - '0';
+        if (significant_digits < 19) {
+            if (mantissa != 0 || digit != 0)
+                significant_digits++;
+            mantissa = mantissa * 10 + digit;
+            if (in_fraction)
+                exponent--;
+        } else {
+            // Too many digits to matter above 1e-8 unless they are past the decimal point
+            dropped_nonzero |= digit != 0;
+            if (!in_fraction)
+                exponent++;
+        }
+    }
+    if (!any_digit)
+        return {};
+    if (cursor != end && (*cursor == 'e' || *cursor == 'E')) {
+        cursor++;
+        if (cursor != end && *cursor == '+')
+            cursor++;
+        int written_exponent = 0;
+        auto [exponent_end, error] = std::from_chars(cursor, end, written_exponent);
+        if (error != std::errc() || written_exponent > 100 || written_exponent < -100)
+            return {};
+        exponent += written_exponent;
+        cursor = exponent_end;
+    }
+    if (cursor != end)
+        return {};
+
+    const int shift = exponent + FRACTION_DIGITS;
+    // A negative value goes one unit further, down to INT64_MIN which write() produces
+    const uint64_t limit = static_cast<uint64_t>(INT64_MAX) + (negative ? 1 : 0);
+    uint64_t units = 0;
+    if (mantissa == 0) {
+        units = 0;
+    } else if (shift >= 0) {
+        if (shift >= static_cast<int>(powers_of_ten.size()) || mantissa > limit / powers_of_ten[shift])
+            return {};
+        units = mantissa * powers_of_ten[shift];
+    } else {
+        if (-shift >= static_cast<int>(powers_of_ten.size()) || mantissa % powers_of_ten[-shift] != 0)
+            return {};
+        units = mantissa / powers_of_ten[-shift];
+    }
+    if (dropped_nonzero && shift < 0)
+        return {};
+    if (units > limit)
+        return {};
+    return Decimal(static_cast<int64_t>(negative ? 0 - units : units));
+}
+
+Decimal Decimal::from_double(double value)
+{
+    // The shortest text that reads back as the same double is the text the number was written as
+    char text[32];
+    char* end = std::to_chars(text, text + sizeof(text), value).ptr;
+    if (std::optional<Decimal> decimal = parse(std::string_view(text, end - text)))
+        return decimal.value();
+    // Finer than 1e-8, or out of range which saturates
+    const double units = value * SCALE;
+    if (units >= 9.2e18)
+        return Decimal(INT64_MAX);
+    if (units <= -9.2e18)
+        return Decimal(-INT64_MAX);
+    return Decimal(static_cast<int64_t>(units < 0 ? units - 0.5 : units + 0.5));
+}
+
+std::ostream& operator<<(std::ostream& out, Decimal value)
+{
+    char text[Decimal::MAX_LENGTH];
+    return out.write(text, value.write(text) - text);
+}
+
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <algorithm>
+#include <compare>
+#include <cstdint>
+#include <format>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+namespace Bitfinex {
+
+// Signed fixed point number counting units of 1e-8, the finest amount the exchange accepts.
+// Prices use the same representation and are rounded to their symbol's significant digits.
+class Decimal {
+public:
+    static constexpr int FRACTION_DIGITS = 8;
+    static constexpr int64_t SCALE = 100000000;
+    // Longest text write() produces, "-92233720368.54775808"
+    static constexpr size_t MAX_LENGTH = 21;
+
+    constexpr Decimal() = default;
+
+    static constexpr Decimal from_units(int64_t units) { return Decimal(units); }
+    static constexpr Decimal from_integer(int64_t value) { return Decimal(value * SCALE); }
+    // Exact for decimal text such as "0.1", "-8000", "1.5e-7", nothing when malformed, out of
+    // range or finer than 1e-8
+    static std::optional<Decimal> parse(std::string_view);
+    // The decimal the double was printed from, e.g. a JSON number, rounded to 1e-8
+    static Decimal from_double(double);
+
+    [[nodiscard]] constexpr int64_t units() const { return m_units; }
+    [[nodiscard]] double to_double() const { return static_cast<double>(m_units) / SCALE; }
+    [[nodiscard]] constexpr bool is_zero() const { return m_units == 0; }
+    [[nodiscard]] constexpr bool is_negative() const { return m_units < 0; }
+    [[nodiscard]] constexpr Decimal abs() const { return Decimal(m_units < 0 ? -m_units : m_units); }
+
+    constexpr Decimal operator-() const { return Decimal(-m_units); }
+    constexpr Decimal operator+(Decimal other) const { return Decimal(m_units + other.m_units); }
+    constexpr Decimal operator-(Decimal other) const { return Decimal(m_units - other.m_units); }
+    constexpr Decimal operator*(int64_t factor) const { return Decimal(m_units * factor); }
+    // Rounded half away from zero to 1e-8
+    constexpr Decimal operator*(Decimal other) const
+    {
+        const __int128 product = static_cast<__int128>(m_units) * other.m_units;
+        return Decimal(static_cast<int64_t>(divide_rounded(product, SCALE)));
+    }
+    constexpr Decimal& operator+=(Decimal other) { m_units += other.m_units; return *this; }
+    constexpr Decimal& operator-=(Decimal other) { m_units -= other.m_units; return *this; }
+    constexpr auto operator<=>(Decimal const&) const = default;
+
+    // Nearest multiple of tick, halves away from zero. A zero tick leaves the value as it is. Near
+    // the ends of the range, where that multiple does not fit, the one towards zero is taken.
+    [[nodiscard]] constexpr Decimal round_to_tick(Decimal tick) const
+    {
+        if (tick.m_units == 0)
+            return *this;
+        const __int128 step = (tick.m_units < 0) ? -static_cast<__int128>(tick.m_units) : tick.m_units;
+        __int128 rounded = divide_rounded(m_units, step) * step;
+        if (rounded > INT64_MAX)
+            rounded -= step;
+        else if (rounded < INT64_MIN)
+            rounded += step;
+        return Decimal(static_cast<int64_t>(rounded));
+    }
+    // Keeps the given number of significant digits, the way the exchange rounds prices. digits is
+    // taken between 1 and 18, the most a rounding power of ten can drop without overflowing.
+    [[nodiscard]] constexpr Decimal round_to_significant(int digits) const
+    {
+        digits = std::clamp(digits, 1, 18);
+        int length = 0;
+        for (uint64_t rest = m_units < 0 ? 0 - static_cast<uint64_t>(m_units) : static_cast<uint64_t>(m_units); rest != 0; rest /= 10)
+            length++;
+        if (length <= digits)
+            return *this;
+        int64_t power = 1;
+        for (int i = 0; i < length - digits; i++)
+            power *= 10;
+        return round_to_tick(Decimal(power));
+    }
+
+    // Writes the shortest text of the value, no exponent and no trailing zeros, returns the end
+    char* write(char* out) const;
+    [[nodiscard]] std::string to_string() const;
+
+private:
+    constexpr explicit Decimal(int64_t units)
+        : m_units(units)
+    {
+    }
+
+    static constexpr __int128 divide_rounded(__int128 value, __int128 divisor)
+    {
+        const __int128 half = divisor / 2;
+        return (value < 0) ? (value - half) / divisor : (value + half) / divisor;
+    }
+
+    int64_t m_units { 0 };
+};
+
+std::ostream& operator<<(std::ostream&, Decimal);
+
+}
+
+template<>
+struct std::formatter<Bitfinex::Decimal> : std::formatter<std::string_view> {
+    auto format(Bitfinex::Decimal value, std::format_context& context) const
+    {
+        char text[Bitfinex::Decimal::MAX_LENGTH];
+        return std::formatter<std::string_view>::format(std::string_view(text, value.write(text) - text), context);
+    }
+};
@@ -68,9 +68,14 @@ bool is_valid_order_type(std::string const& str)
 
 OrderType order_type_from_string(std::string const& str)
 {
-    std::string lowercase_str = boost::algorithm::to_lower_copy(str);
-    assert(is_valid_order_type(lowercase_str));
+    // The exchange spells the types with spaces, "EXCHANGE LIMIT"
+    assert(is_valid_order_type(boost::algorithm::replace_all_copy(boost::algorithm::to_lower_copy(str), " ", "_")));
+    return find_order_type(str).value_or(OrderType::EXCHANGE_IOC);
+}
 
+std::optional<OrderType> find_order_type(std::string const& str)
+{
+    std::string lowercase_str = boost::algorithm::to_lower_copy(str);
     if (lowercase_str == "limit") return OrderType::LIMIT;
     if (lowercase_str == "exchange limit" || lowercase_str == "exchange_limit") return OrderType::EXCHANGE_LIMIT;
     if (lowercase_str == "market") return OrderType::MARKET;
@@ -84,8 +89,8 @@ OrderType order_type_from_string(std::string const& str)
     if (lowercase_str == "fill or kill" || lowercase_str == "fill_or_kill" || lowercase_str == "fok") return OrderType::FILL_OR_KILL;
     if (lowercase_str == "exchange fok" || lowercase_str == "exchange_fok") return OrderType::EXCHANGE_FOK;
     if (lowercase_str == "immediate or cancel" || lowercase_str == "immediate_or_cancel" || lowercase_str == "ioc") return OrderType::IMMEDIATE_OR_CANCEL;
-    else
-        return OrderType::EXCHANGE_IOC;
+    if (lowercase_str == "exchange ioc" || lowercase_str == "exchange_ioc") return OrderType::EXCHANGE_IOC;
+    return {};
 }
 
 std::string order_type_to_string(OrderType type)
@@ -137,4 +142,24 @@ PositionSide position_side_from_string(std::string const& side)
         return PositionSide::LONG;
 }
 
+PositionStatus position_status_from_string(std::string const& status)
+{
+    if (boost::algorithm::to_upper_copy(status) == "CLOSED")
+        return PositionStatus::CLOSED;
+    else
+        return PositionStatus::ACTIVE;
+}
+
+std::string position_status_to_string(PositionStatus status)
+{
+    switch (status) {
+    case PositionStatus::ACTIVE:
+        return "ACTIVE";
+    case PositionStatus::CLOSED:
+        return "CLOSED";
+    }
+    // Only reached with a value cast from outside the enum
+    return "UNKNOWN";
+}
+
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstdint>
+#include <optional>
 #include <string>
 
 namespace Bitfinex {
@@ -22,6 +23,11 @@ enum PositionSide : uint8_t {
     LONG
 };
 
+enum PositionStatus : uint8_t {
+    ACTIVE,
+    CLOSED
+};
+
 enum OrderType : uint8_t {
     LIMIT,
     EXCHANGE_LIMIT,
@@ -49,9 +55,14 @@ std::string order_side_to_string(OrderSide);
 
 bool is_valid_order_type(std::string const&);
 OrderType order_type_from_string(std::string const&);
+// Either spelling of any type, "EXCHANGE LIMIT" or "exchange_limit", nothing for an unknown one
+std::optional<OrderType> find_order_type(std::string const&);
 std::string order_type_to_string(OrderType);
 
 bool is_valid_position_side(std::string const&);
 PositionSide position_side_from_string(std::string const&);
 
+PositionStatus position_status_from_string(std::string const&);
+std::string position_status_to_string(PositionStatus);
+
 }
@@ -0,0 +1,95 @@
+#include <Bitfinex/EventLoop.h>
+#include <stdexcept>
+
+namespace Bitfinex {
+
+EventLoop::EventLoop(ConnectionPool& connection_pool)
+    : m_connection_pool(connection_pool)
+{
+    m_multi = curl_multi_init();
+    if (!m_multi)
+        throw std::runtime_error("Failed to create curl multi handle");
+    if (m_connection_pool.options().http2)
+        curl_multi_setopt(m_multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+    m_thread = std::thread([this] { run(); });
+}
+
+EventLoop::~EventLoop()
+{
+    m_stopping.store(true, std::memory_order_release);
+    curl_multi_wakeup(m_multi);
+    m_thread.join();
+
+    // Whatever did not finish is reported with an empty response (http status 0)
+    {
+        std::lock_guard lock(m_mutex);
+        for (Transfer& transfer : m_pending)
+            m_in_flight.emplace(transfer.session->GetCurlHolder()->handle, std::move(transfer));
+        m_pending.clear();
+    }
+    for (auto& [handle, transfer] : m_in_flight) {
+        curl_multi_remove_handle(m_multi, handle);
+        transfer.completion(cpr::Response {}, TransferTimings {});
+    }
+    m_in_flight.clear();
+    curl_multi_cleanup(m_multi);
+}
+
+void EventLoop::post(ConnectionPool::Lease session, Completion completion)
+{
+    {
+        std::lock_guard lock(m_mutex);
+        m_pending.push_back(Transfer { .session = std::move(session), .completion = std::move(completion) });
+    }
+    m_in_flight_count.fetch_add(1, std::memory_order_relaxed);
+    curl_multi_wakeup(m_multi);
+}
+
+void EventLoop::run()
+{
+    while (!m_stopping.load(std::memory_order_acquire)) {
+        start_pending_transfers();
+        int running_transfers = 0;
+        curl_multi_perform(m_multi, &running_transfers);
+        complete_finished_transfers();
+        curl_multi_poll(m_multi, nullptr, 0, 1000, nullptr);
+    }
+}
+
+void EventLoop::start_pending_transfers()
+{
+    std::vector<Transfer> pending;
+    {
+        std::lock_guard lock(m_mutex);
+        pending.swap(m_pending);
+    }
+    for (Transfer& transfer : pending) {
+        transfer.session->PreparePost();
+        CURL* handle = transfer.session->GetCurlHolder()->handle;
+        curl_multi_add_handle(m_multi, handle);
+        m_in_flight.emplace(handle, std::move(transfer));
+    }
+}
+
+void EventLoop::complete_finished_transfers()
+{
+    int messages_left = 0;
+    while (CURLMsg* message = curl_multi_info_read(m_multi, &messages_left)) {
+        if (message->msg != CURLMSG_DONE)
+            continue;
+        CURL* handle = message->easy_handle;
+        const CURLcode result = message->data.result;
+        curl_multi_remove_handle(m_multi, handle);
+
+        auto node = m_in_flight.extract(handle);
+        if (node.empty())
+            continue;
+        Transfer& transfer = node.mapped();
+        cpr::Response response = transfer.session->Complete(result);
+        const TransferTimings timings = m_connection_pool.record_transfer(*transfer.session);
+        m_in_flight_count.fetch_sub(1, std::memory_order_relaxed);
+        transfer.completion(response, timings);
+    }
+}
+
+}
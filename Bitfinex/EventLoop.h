@@ -0,0 +1,57 @@
+#pragma once
+
+#include <Bitfinex/ConnectionPool.h>
+#include <atomic>
+#include <cpr/session.h>
+#include <curl/curl.h>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace Bitfinex {
+
+// Drives any number of concurrent transfers from a single thread through the curl multi
+// interface. Completions are invoked on the loop thread, they should hand work off quickly.
+class EventLoop {
+public:
+    using Completion = std::function<void(cpr::Response const&, TransferTimings const&)>;
+
+    explicit EventLoop(ConnectionPool& connection_pool);
+    EventLoop(EventLoop const&) = delete;
+    EventLoop& operator=(EventLoop const&) = delete;
+    ~EventLoop();
+
+    // The session must already carry the url, body and headers of the request
+    void post(ConnectionPool::Lease session, Completion completion);
+
+    [[nodiscard]] size_t in_flight() const { return m_in_flight_count.load(std::memory_order_relaxed); }
+    // Whether the caller is a completion, which must not wait for another transfer
+    [[nodiscard]] bool on_loop_thread() const { return std::this_thread::get_id() == m_thread.get_id(); }
+
+private:
+    struct Transfer {
+        ConnectionPool::Lease session;
+        Completion completion;
+    };
+
+    void run();
+    void start_pending_transfers();
+    void complete_finished_transfers();
+
+    ConnectionPool& m_connection_pool;
+    CURLM* m_multi { nullptr };
+
+    std::mutex m_mutex;
+    std::vector<Transfer> m_pending;
+
+    // Only touched by the loop thread
+    std::unordered_map<CURL*, Transfer> m_in_flight;
+
+    std::atomic<size_t> m_in_flight_count { 0 };
+    std::atomic<bool> m_stopping { false };
+    std::thread m_thread;
+};
+
+}
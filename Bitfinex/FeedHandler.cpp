@@ -0,0 +1,521 @@
+#include <Bitfinex/FeedHandler.h>
+#include <Bitfinex/ResponseDecoder.h>
+#include <bit>
+#include <charconv>
+#include <format>
+#include <nlohmann/json.hpp>
+#include <optional>
+
+using json = nlohmann::json;
+
+namespace Bitfinex {
+
+// https://docs.bitfinex.com/docs/ws-general#info-messages
+static constexpr int INFO_RECONNECT = 20051;
+static constexpr int INFO_MAINTENANCE_END = 20061;
+// https://docs.bitfinex.com/docs/ws-general#configuration
+static constexpr int CONF_FLAG_CHECKSUM = 131072;
+
+static char const* channel_name(FeedChannel channel)
+{
+    switch (channel) {
+    case FeedChannel::TICKER:
+        return "ticker";
+    case FeedChannel::TRADES:
+        return "trades";
+    case FeedChannel::BOOK:
+    case FeedChannel::RAW_BOOK:
+        return "book";
+    }
+    return "";
+}
+
+// [BID, BID_SIZE, ASK, ASK_SIZE, DAILY_CHANGE, DAILY_CHANGE_RELATIVE, LAST_PRICE, VOLUME, HIGH, LOW]
+static constexpr FieldReader<TickerUpdate> TICKER_FIELDS[] = {
+    { 0, [](JsonToken const& token, TickerUpdate& ticker) { return read_double(token, ticker.bid); } },
+    { 1, [](JsonToken const& token, TickerUpdate& ticker) { return read_double(token, ticker.bid_size); } },
+    { 2, [](JsonToken const& token, TickerUpdate& ticker) { return read_double(token, ticker.ask); } },
+    { 3, [](JsonToken const& token, TickerUpdate& ticker) { return read_double(token, ticker.ask_size); } },
+    { 4, [](JsonToken const& token, TickerUpdate& ticker) { return read_double(token, ticker.daily_change); } },
+    { 5, [](JsonToken const& token, TickerUpdate& ticker) { return read_double(token, ticker.daily_change_relative); } },
+    { 6, [](JsonToken const& token, TickerUpdate& ticker) { return read_double(token, ticker.last_price); } },
+    { 7, [](JsonToken const& token, TickerUpdate& ticker) { return read_double(token, ticker.volume); } },
+    { 8, [](JsonToken const& token, TickerUpdate& ticker) { return read_double(token, ticker.high); } },
+    { 9, [](JsonToken const& token, TickerUpdate& ticker) { return read_double(token, ticker.low); } },
+};
+
+// [ID, MTS, AMOUNT, PRICE]
+static constexpr FieldReader<Trade> TRADE_FIELDS[] = {
+    { 0, [](JsonToken const& token, Trade& trade) { return read_integer(token, trade.trade_id); } },
+    { 1, [](JsonToken const& token, Trade& trade) { return read_integer(token, trade.timestamp_ms); } },
+    { 2, [](JsonToken const& token, Trade& trade) { return read_double(token, trade.amount); } },
+    { 3, [](JsonToken const& token, Trade& trade) { return read_double(token, trade.price); } },
+};
+
+// [PRICE, COUNT, AMOUNT]
+static constexpr FieldReader<BookLevel> BOOK_LEVEL_FIELDS[] = {
+    { 0, [](JsonToken const& token, BookLevel& level) { return read_double(token, level.price); } },
+    { 1, [](JsonToken const& token, BookLevel& level) { return read_integer(token, level.count); } },
+    { 2, [](JsonToken const& token, BookLevel& level) { return read_double(token, level.amount); } },
+};
+
+// [ORDER_ID, PRICE, AMOUNT]
+static constexpr FieldReader<RawBookEntry> RAW_BOOK_ENTRY_FIELDS[] = {
+    { 0, [](JsonToken const& token, RawBookEntry& entry) { return read_integer(token, entry.order_id); } },
+    { 1, [](JsonToken const& token, RawBookEntry& entry) { return read_double(token, entry.price); } },
+    { 2, [](JsonToken const& token, RawBookEntry& entry) { return read_double(token, entry.amount); } },
+};
+
+// Built once, reset for every frame: once the buffers have grown a frame is decoded without allocating
+struct FeedHandler::PayloadDecoders {
+    explicit PayloadDecoders(FeedHandler& handler)
+        : ticker(TICKER_FIELDS, [&handler](TickerUpdate const& update) { handler.m_ticker = update; })
+        , trades(TRADE_FIELDS, [&handler](Trade const& trade) { handler.m_trades.push_back(trade); })
+        , levels(BOOK_LEVEL_FIELDS, [&handler](BookLevel const& level) { handler.m_levels.push_back(level); })
+        , raw_entries(RAW_BOOK_ENTRY_FIELDS, [&handler](RawBookEntry const& entry) { handler.m_raw_entries.push_back(entry); })
+    {
+    }
+
+    RecordDecoder<TickerUpdate> ticker;
+    RecordDecoder<Trade> trades;
+    RecordDecoder<BookLevel> levels;
+    RecordDecoder<RawBookEntry> raw_entries;
+};
+
+static bool is_whitespace(char c)
+{
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+static std::string_view trim(std::string_view text)
+{
+    while (!text.empty() && is_whitespace(text.front()))
+        text.remove_prefix(1);
+    while (!text.empty() && is_whitespace(text.back()))
+        text.remove_suffix(1);
+    return text;
+}
+
+// A data frame, [CHANNEL_ID, PAYLOAD] or [CHANNEL_ID, "TYPE", PAYLOAD] where TYPE is hb, te, tu or cs
+struct DataFrame {
+    int64_t channel_id;
+    std::string_view type; // Empty when there is none
+    std::string_view payload; // As written, empty for a heartbeat
+};
+
+static std::optional<DataFrame> read_data_frame(std::string_view frame)
+{
+    frame = trim(frame);
+    if (frame.size() < 2 || frame.front() != '[' || frame.back() != ']')
+        return {};
+    std::string_view rest = trim(frame.substr(1, frame.size() - 2));
+    DataFrame data {};
+    auto [end, error] = std::from_chars(rest.data(), rest.data() + rest.size(), data.channel_id);
+    if (error != std::errc())
+        return {};
+    rest = trim(rest.substr(static_cast<size_t>(end - rest.data())));
+    if (rest.empty() || rest.front() != ',')
+        return {};
+    rest = trim(rest.substr(1));
+    // The types are plain words, no escapes to look for
+    if (!rest.empty() && rest.front() == '"') {
+        const size_t close = rest.find('"', 1);
+        if (close == std::string_view::npos)
+            return {};
+        data.type = rest.substr(1, close - 1);
+        rest = trim(rest.substr(close + 1));
+        if (!rest.empty() && rest.front() != ',')
+            return {};
+        if (!rest.empty())
+            rest = trim(rest.substr(1));
+    }
+    data.payload = rest;
+    return data;
+}
+
+enum class PayloadShape : uint8_t {
+    EMPTY, // [] or no payload at all
+    RECORD, // [F0, F1, ...]
+    SNAPSHOT, // [[F0, F1, ...], ...]
+    OTHER,
+};
+
+static PayloadShape payload_shape(std::string_view payload)
+{
+    if (payload.empty())
+        return PayloadShape::EMPTY;
+    if (payload.front() != '[')
+        return PayloadShape::OTHER;
+    const std::string_view inside = trim(payload.substr(1));
+    if (inside.starts_with(']'))
+        return PayloadShape::EMPTY;
+    return inside.starts_with('[') ? PayloadShape::SNAPSHOT : PayloadShape::RECORD;
+}
+
+// The decoders read arrays of records, a lone record is fed between brackets of its own
+static bool decode_payload(RecordStream& decoder, std::string_view payload, PayloadShape shape)
+{
+    decoder.reset();
+    if (shape == PayloadShape::RECORD)
+        decoder.feed("[");
+    decoder.feed(payload);
+    if (shape == PayloadShape::RECORD)
+        decoder.feed("]");
+    return decoder.finish() == DecodeError::NONE;
+}
+
+uint64_t DecodeStats::percentile_ns(double percentile) const
+{
+    const auto threshold = static_cast<uint64_t>(static_cast<double>(messages) * percentile / 100.0);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < buckets.size(); i++) {
+        seen += buckets[i];
+        if (seen > threshold)
+            return uint64_t(1) << (i + 1);
+    }
+    return max_ns;
+}
+
+FeedHandler::FeedHandler(FeedOptions options)
+    : m_options(std::move(options))
+    , m_socket(WebSocketOptions { .url = m_options.url, .idle_timeout = m_options.idle_timeout },
+          WebSocket::Handlers {
+              .on_open = [this] { send_subscriptions(); },
+              .on_message = [this](std::string_view frame) { process_frame(frame); },
+              .on_close = [this] {
+                  {
+                      std::lock_guard lock(m_subscriptions_mutex);
+                      m_subscriptions_sent = false;
+                  }
+                  reset_channels();
+              },
+          })
+    , m_decoders(std::make_unique<PayloadDecoders>(*this))
+{
+}
+
+FeedHandler::~FeedHandler()
+{
+    stop();
+}
+
+void FeedHandler::start()
+{
+    m_socket.start();
+}
+
+void FeedHandler::stop()
+{
+    m_socket.stop();
+}
+
+std::string FeedHandler::subscribe_message(Subscription const& subscription)
+{
+    if (subscription.channel == FeedChannel::BOOK || subscription.channel == FeedChannel::RAW_BOOK)
+        return std::format(R"({{ "event": "subscribe", "channel": "book", "symbol": "{}", "prec": "{}", "freq": "F0", "len": "{}" }})",
+            subscription.symbol, subscription.precision, subscription.length);
+    return std::format(R"({{ "event": "subscribe", "channel": "{}", "symbol": "{}" }})", channel_name(subscription.channel), subscription.symbol);
+}
+
+void FeedHandler::subscribe(Subscription subscription)
+{
+    std::string message = subscribe_message(subscription);
+    // Under the lock send_subscriptions takes, each subscription goes out once per connection
+    std::lock_guard lock(m_subscriptions_mutex);
+    m_subscriptions.push_back(std::move(subscription));
+    // Otherwise sent once the connection is up, together with the others
+    if (m_subscriptions_sent)
+        m_socket.send(std::move(message));
+}
+
+void FeedHandler::subscribe_ticker(std::string const& symbol)
+{
+    subscribe(Subscription { .channel = FeedChannel::TICKER, .symbol = symbol, .precision = {}, .length = 0 });
+}
+
+void FeedHandler::subscribe_trades(std::string const& symbol)
+{
+    subscribe(Subscription { .channel = FeedChannel::TRADES, .symbol = symbol, .precision = {}, .length = 0 });
+}
+
+void FeedHandler::subscribe_book(std::string const& symbol, std::string const& precision, unsigned length)
+{
+    subscribe(Subscription { .channel = FeedChannel::BOOK, .symbol = symbol, .precision = precision, .length = length });
+}
+
+void FeedHandler::subscribe_raw_book(std::string const& symbol, unsigned length)
+{
+    subscribe(Subscription { .channel = FeedChannel::RAW_BOOK, .symbol = symbol, .precision = "R0", .length = length });
+}
+
+void FeedHandler::send_subscriptions()
+{
+    if (m_options.book_checksums)
+        m_socket.send(std::format(R"({{ "event": "conf", "flags": {} }})", CONF_FLAG_CHECKSUM));
+    std::lock_guard lock(m_subscriptions_mutex);
+    for (Subscription const& subscription : m_subscriptions)
+        m_socket.send(subscribe_message(subscription));
+    m_subscriptions_sent = true;
+}
+
+void FeedHandler::resubscribe(FeedChannel channel, SymbolId symbol)
+{
+    for (auto const& [channel_id, state] : m_channels) {
+        if (state.channel == channel && state.symbol == symbol) {
+            m_socket.send(std::format(R"({{ "event": "unsubscribe", "chanId": {} }})", channel_id));
+            break;
+        }
+    }
+    std::lock_guard lock(m_subscriptions_mutex);
+    for (Subscription const& subscription : m_subscriptions) {
+        if (subscription.channel == channel && subscription.symbol == symbol_name(symbol)) {
+            m_socket.send(subscribe_message(subscription));
+            break;
+        }
+    }
+}
+
+void FeedHandler::reset_channels()
+{
+    m_channels.clear();
+}
+
+void FeedHandler::on_ticker(std::function<void(TickerUpdate const&)> handler)
+{
+    m_ticker_handlers.push_back(std::move(handler));
+}
+
+void FeedHandler::on_trade(std::function<void(TradeUpdate const&)> handler)
+{
+    m_trade_handlers.push_back(std::move(handler));
+}
+
+void FeedHandler::on_trades_snapshot(std::function<void(TradesSnapshot const&)> handler)
+{
+    m_trades_snapshot_handlers.push_back(std::move(handler));
+}
+
+void FeedHandler::on_book(std::function<void(BookUpdate const&)> handler)
+{
+    m_book_handlers.push_back(std::move(handler));
+}
+
+void FeedHandler::on_book_snapshot(std::function<void(BookSnapshot const&)> handler)
+{
+    m_book_snapshot_handlers.push_back(std::move(handler));
+}
+
+void FeedHandler::on_raw_book(std::function<void(RawBookUpdate const&)> handler)
+{
+    m_raw_book_handlers.push_back(std::move(handler));
+}
+
+void FeedHandler::on_raw_book_snapshot(std::function<void(RawBookSnapshot const&)> handler)
+{
+    m_raw_book_snapshot_handlers.push_back(std::move(handler));
+}
+
+void FeedHandler::on_book_checksum(std::function<void(BookChecksum const&)> handler)
+{
+    m_book_checksum_handlers.push_back(std::move(handler));
+}
+
+void FeedHandler::on_raw_frame(std::function<void(std::string_view)> handler)
+{
+    m_raw_frame_handlers.push_back(std::move(handler));
+}
+
+void FeedHandler::record_decode(std::chrono::steady_clock::duration elapsed)
+{
+    const auto ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+    m_messages.fetch_add(1, std::memory_order_relaxed);
+    m_total_ns.fetch_add(ns, std::memory_order_relaxed);
+    if (ns > m_max_ns.load(std::memory_order_relaxed))
+        m_max_ns.store(ns, std::memory_order_relaxed);
+    const size_t bucket = std::min<size_t>(std::bit_width(ns | 1) - 1, m_buckets.size() - 1);
+    m_buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+DecodeStats FeedHandler::decode_stats() const
+{
+    DecodeStats stats {};
+    stats.messages = m_messages.load(std::memory_order_relaxed);
+    stats.heartbeats = m_heartbeats.load(std::memory_order_relaxed);
+    stats.errors = m_errors.load(std::memory_order_relaxed);
+    stats.total_ns = m_total_ns.load(std::memory_order_relaxed);
+    stats.max_ns = m_max_ns.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < m_buckets.size(); i++)
+        stats.buckets[i] = m_buckets[i].load(std::memory_order_relaxed);
+    return stats;
+}
+
+void FeedHandler::process_frame(std::string_view frame)
+{
+    for (auto const& handler : m_raw_frame_handlers)
+        handler(frame);
+
+    // Every update is decoded in full before any handler sees it, a frame that turns out to
+    // have an unexpected shape is dropped as a whole
+    try {
+        decode_frame(frame);
+    } catch (json::exception const&) {
+        m_errors.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+// Events are rare and carry named fields, they go through the DOM. Data frames are read with the
+// record decoders into the reused buffers.
+void FeedHandler::decode_frame(std::string_view frame)
+{
+    const auto start = std::chrono::steady_clock::now();
+    if (trim(frame).starts_with('{'))
+        return decode_event(frame);
+
+    std::optional<DataFrame> data = read_data_frame(frame);
+    if (!data.has_value()) {
+        m_errors.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    auto channel = m_channels.find(data->channel_id);
+    if (channel == m_channels.end())
+        return;
+    ChannelState const& state = channel->second;
+    const PayloadShape shape = payload_shape(data->payload);
+
+    if (!data->type.empty()) {
+        if (data->type == "hb") {
+            m_heartbeats.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        // "tu" repeats an already published "te" trade
+        if (state.channel == FeedChannel::TRADES && data->type == "te") {
+            m_trades.clear();
+            if (shape != PayloadShape::RECORD || !decode_payload(m_decoders->trades, data->payload, shape)) {
+                m_errors.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            TradeUpdate update { .symbol = state.symbol, .trade = m_trades.front() };
+            record_decode(std::chrono::steady_clock::now() - start);
+            for (auto const& handler : m_trade_handlers)
+                handler(update);
+        } else if (state.channel == FeedChannel::BOOK && data->type == "cs") {
+            BookChecksum checksum { .symbol = state.symbol, .checksum = 0 };
+            auto [end, error] = std::from_chars(data->payload.data(), data->payload.data() + data->payload.size(), checksum.checksum);
+            if (error != std::errc() || end != data->payload.data() + data->payload.size()) {
+                m_errors.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            record_decode(std::chrono::steady_clock::now() - start);
+            for (auto const& handler : m_book_checksum_handlers)
+                handler(checksum);
+        }
+        return;
+    }
+    if (shape == PayloadShape::EMPTY)
+        return;
+    if (shape == PayloadShape::OTHER) {
+        m_errors.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    switch (state.channel) {
+    case FeedChannel::TICKER: {
+        if (shape != PayloadShape::RECORD || !decode_payload(m_decoders->ticker, data->payload, shape)) {
+            m_errors.fetch_add(1, std::memory_order_relaxed);
+            break;
+        }
+        m_ticker.symbol = state.symbol;
+        record_decode(std::chrono::steady_clock::now() - start);
+        for (auto const& handler : m_ticker_handlers)
+            handler(m_ticker);
+        break;
+    }
+    case FeedChannel::TRADES: {
+        // Single trades come as "te" and "tu"
+        if (shape != PayloadShape::SNAPSHOT)
+            break;
+        m_trades.clear();
+        if (!decode_payload(m_decoders->trades, data->payload, shape)) {
+            m_errors.fetch_add(1, std::memory_order_relaxed);
+            break;
+        }
+        record_decode(std::chrono::steady_clock::now() - start);
+        TradesSnapshot snapshot { .symbol = state.symbol, .trades = m_trades };
+        for (auto const& handler : m_trades_snapshot_handlers)
+            handler(snapshot);
+        break;
+    }
+    case FeedChannel::BOOK: {
+        m_levels.clear();
+        if (!decode_payload(m_decoders->levels, data->payload, shape)) {
+            m_errors.fetch_add(1, std::memory_order_relaxed);
+            break;
+        }
+        if (shape == PayloadShape::SNAPSHOT) {
+            record_decode(std::chrono::steady_clock::now() - start);
+            BookSnapshot snapshot { .symbol = state.symbol, .levels = m_levels };
+            for (auto const& handler : m_book_snapshot_handlers)
+                handler(snapshot);
+        } else {
+            BookUpdate update { .symbol = state.symbol, .level = m_levels.front() };
+            record_decode(std::chrono::steady_clock::now() - start);
+            for (auto const& handler : m_book_handlers)
+                handler(update);
+        }
+        break;
+    }
+    case FeedChannel::RAW_BOOK: {
+        m_raw_entries.clear();
+        if (!decode_payload(m_decoders->raw_entries, data->payload, shape)) {
+            m_errors.fetch_add(1, std::memory_order_relaxed);
+            break;
+        }
+        if (shape == PayloadShape::SNAPSHOT) {
+            record_decode(std::chrono::steady_clock::now() - start);
+            RawBookSnapshot snapshot { .symbol = state.symbol, .entries = m_raw_entries };
+            for (auto const& handler : m_raw_book_snapshot_handlers)
+                handler(snapshot);
+        } else {
+            RawBookUpdate update { .symbol = state.symbol, .entry = m_raw_entries.front() };
+            record_decode(std::chrono::steady_clock::now() - start);
+            for (auto const& handler : m_raw_book_handlers)
+                handler(update);
+        }
+        break;
+    }
+    }
+}
+
+void FeedHandler::decode_event(std::string_view frame)
+{
+    json message = json::parse(frame.begin(), frame.end(), nullptr, false);
+    if (message.is_discarded() || !message.is_object()) {
+        m_errors.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    const std::string event = message.value("event", "");
+    if (event == "subscribed") {
+        const std::string channel = message.value("channel", "");
+        const std::string symbol = message.value("symbol", "");
+        std::lock_guard lock(m_subscriptions_mutex);
+        for (Subscription const& subscription : m_subscriptions) {
+            if (channel == channel_name(subscription.channel) && symbol == subscription.symbol
+                && (subscription.precision.empty() || message.value("prec", "") == subscription.precision)) {
+                m_channels[message["chanId"].get<int64_t>()] = ChannelState { .channel = subscription.channel, .symbol = intern_symbol(symbol) };
+                break;
+            }
+        }
+    } else if (event == "unsubscribed") {
+        m_channels.erase(message["chanId"].get<int64_t>());
+    } else if (event == "info" && message.contains("code")) {
+        const int code = message["code"];
+        // The server asks for a fresh connection, subscriptions are replayed on open
+        if (code == INFO_RECONNECT || code == INFO_MAINTENANCE_END)
+            m_socket.reconnect();
+    } else if (event == "error") {
+        m_errors.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+}
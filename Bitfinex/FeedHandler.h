@@ -0,0 +1,213 @@
+#pragma once
+
+#include <Bitfinex/Symbols.h>
+#include <Bitfinex/WebSocket.h>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace Bitfinex {
+
+enum class FeedChannel : uint8_t {
+    TICKER,
+    TRADES,
+    BOOK,
+    RAW_BOOK // Book channel at R0 precision, one entry per order
+};
+
+struct TickerUpdate {
+    SymbolId symbol;
+    double bid;
+    double bid_size;
+    double ask;
+    double ask_size;
+    double daily_change;
+    double daily_change_relative;
+    double last_price;
+    double volume;
+    double high;
+    double low;
+};
+
+struct Trade {
+    uint64_t trade_id;
+    int64_t timestamp_ms;
+    double amount; // Positive for buys, negative for sells
+    double price;
+};
+
+struct TradeUpdate {
+    SymbolId symbol;
+    Trade trade;
+};
+
+struct TradesSnapshot {
+    SymbolId symbol;
+    std::span<Trade const> trades;
+};
+
+struct BookLevel {
+    double price;
+    uint32_t count; // 0 removes the level
+    double amount; // Positive for bids, negative for asks
+};
+
+struct BookUpdate {
+    SymbolId symbol;
+    BookLevel level;
+};
+
+struct BookSnapshot {
+    SymbolId symbol;
+    std::span<BookLevel const> levels;
+};
+
+struct RawBookEntry {
+    uint64_t order_id;
+    double price; // 0 removes the order
+    double amount; // Positive for bids, negative for asks
+};
+
+struct RawBookUpdate {
+    SymbolId symbol;
+    RawBookEntry entry;
+};
+
+struct RawBookSnapshot {
+    SymbolId symbol;
+    std::span<RawBookEntry const> entries;
+};
+
+struct BookChecksum {
+    SymbolId symbol;
+    int32_t checksum; // CRC32 of the top 25 levels, see MarketBook::checksum
+};
+
+// Time spent turning frames into updates, handlers are not included
+struct DecodeStats {
+    uint64_t messages;
+    uint64_t heartbeats;
+    uint64_t errors;
+    uint64_t total_ns;
+    uint64_t max_ns;
+    // buckets[i] counts messages decoded in [2^i, 2^(i+1)) nanoseconds
+    std::array<uint64_t, 40> buckets;
+
+    [[nodiscard]] uint64_t percentile_ns(double percentile) const;
+};
+
+struct FeedOptions {
+    std::string url { "wss://api-pub.bitfinex.com/ws/2" };
+    std::chrono::milliseconds idle_timeout { 30000 };
+    // Asks the exchange for a checksum after every book update
+    bool book_checksums { false };
+};
+
+// Keeps a websocket open to the public v2 feed, (re)subscribes to the requested channels and
+// dispatches decoded updates. Updates reference the handler's buffers, they are only valid for
+// the duration of the callback. Handlers must be registered before start() and run on the feed thread.
+class FeedHandler {
+public:
+    explicit FeedHandler(FeedOptions options = {});
+    FeedHandler(FeedHandler const&) = delete;
+    FeedHandler& operator=(FeedHandler const&) = delete;
+    ~FeedHandler();
+
+    void subscribe_ticker(std::string const& symbol);
+    void subscribe_trades(std::string const& symbol);
+    // precision is one of P0..P4, length one of 1, 25, 100, 250
+    void subscribe_book(std::string const& symbol, std::string const& precision = "P0", unsigned length = 25);
+    // Every order of the book, length is the number of orders per side
+    void subscribe_raw_book(std::string const& symbol, unsigned length = 100);
+
+    void on_ticker(std::function<void(TickerUpdate const&)>);
+    void on_trade(std::function<void(TradeUpdate const&)>);
+    void on_trades_snapshot(std::function<void(TradesSnapshot const&)>);
+    void on_book(std::function<void(BookUpdate const&)>);
+    void on_book_snapshot(std::function<void(BookSnapshot const&)>);
+    void on_raw_book(std::function<void(RawBookUpdate const&)>);
+    void on_raw_book_snapshot(std::function<void(RawBookSnapshot const&)>);
+    void on_book_checksum(std::function<void(BookChecksum const&)>);
+    // Every frame as received, before decoding
+    void on_raw_frame(std::function<void(std::string_view)>);
+
+    void start();
+    void stop();
+
+    // Decodes one frame as if it came from the socket, replays feed recorded frames through here
+    void process_frame(std::string_view frame);
+    // Unsubscribes and subscribes again to get a fresh snapshot, must be called from the feed thread
+    void resubscribe(FeedChannel, SymbolId);
+    // Forgets the channel ids, the exchange hands out new ones on every connection
+    void reset_channels();
+
+    [[nodiscard]] DecodeStats decode_stats() const;
+    [[nodiscard]] bool connected() const { return m_socket.connected(); }
+
+private:
+    struct Subscription {
+        FeedChannel channel;
+        std::string symbol;
+        std::string precision;
+        unsigned length;
+    };
+
+    struct ChannelState {
+        FeedChannel channel;
+        SymbolId symbol;
+    };
+
+    // Record decoders of the channel payloads, writing into the buffers below
+    struct PayloadDecoders;
+
+    static std::string subscribe_message(Subscription const&);
+    void subscribe(Subscription);
+    void send_subscriptions();
+    void decode_frame(std::string_view frame);
+    void decode_event(std::string_view frame);
+    void record_decode(std::chrono::steady_clock::duration);
+
+    FeedOptions const m_options;
+    WebSocket m_socket;
+
+    std::mutex m_subscriptions_mutex;
+    std::vector<Subscription> m_subscriptions;
+    // Whether the connection has been sent the subscriptions, those made after it are sent on their own
+    bool m_subscriptions_sent { false };
+
+    // Only touched from the thread processing frames
+    std::unordered_map<int64_t, ChannelState> m_channels;
+    std::vector<Trade> m_trades;
+    std::vector<BookLevel> m_levels;
+    std::vector<RawBookEntry> m_raw_entries;
+    TickerUpdate m_ticker {};
+    std::unique_ptr<PayloadDecoders> m_decoders;
+
+    std::vector<std::function<void(TickerUpdate const&)>> m_ticker_handlers;
+    std::vector<std::function<void(TradeUpdate const&)>> m_trade_handlers;
+    std::vector<std::function<void(TradesSnapshot const&)>> m_trades_snapshot_handlers;
+    std::vector<std::function<void(BookUpdate const&)>> m_book_handlers;
+    std::vector<std::function<void(BookSnapshot const&)>> m_book_snapshot_handlers;
+    std::vector<std::function<void(RawBookUpdate const&)>> m_raw_book_handlers;
+    std::vector<std::function<void(RawBookSnapshot const&)>> m_raw_book_snapshot_handlers;
+    std::vector<std::function<void(BookChecksum const&)>> m_book_checksum_handlers;
+    std::vector<std::function<void(std::string_view)>> m_raw_frame_handlers;
+
+    std::atomic<uint64_t> m_messages { 0 };
+    std::atomic<uint64_t> m_heartbeats { 0 };
+    std::atomic<uint64_t> m_errors { 0 };
+    std::atomic<uint64_t> m_total_ns { 0 };
+    std::atomic<uint64_t> m_max_ns { 0 };
+    std::array<std::atomic<uint64_t>, 40> m_buckets {};
+};
+
+}
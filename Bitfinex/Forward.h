@@ -5,10 +5,12 @@ namespace Bitfinex {
 struct TickerResponse;
 struct OrderResponse;
 struct Order;
+struct OrderPriceUpdate;
 struct Config;
 class Client;
 class OrderBook;
 struct Position;
 class Positions;
 struct IncreasePositionResponse;
+class RecordStream;
 }
\ No newline at end of file
@@ -0,0 +1,209 @@
+#include <Bitfinex/HistoryDownloader.h>
+#include <Bitfinex/ResponseDecoder.h>
+#include <algorithm>
+#include <cpr/session.h>
+#include <format>
+#include <thread>
+#include <vector>
+
+namespace Bitfinex {
+
+// A 429 on the public endpoints blocks the address for a minute
+static constexpr std::chrono::seconds RATE_LIMITED_PAUSE { 60 };
+static constexpr std::chrono::milliseconds STOP_POLL_INTERVAL { 100 };
+
+static int64_t now_ms()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+HistoryDownloader::HistoryDownloader(HistoryDownloadOptions options)
+    : m_options(std::move(options))
+    , m_rate_limit(m_options.rate_limit.value_or(
+          RateLimit::per_minute(m_options.kind == HistoryKind::TRADES ? TRADES_HISTORY_RATE_LIMIT : CANDLES_HISTORY_RATE_LIMIT)))
+    , m_tokens(m_rate_limit.burst)
+    , m_refilled(std::chrono::steady_clock::now())
+{
+}
+
+HistoryDownloadStats HistoryDownloader::download(std::span<SymbolId const> symbols, int64_t from_ms, int64_t to_ms, Progress progress)
+{
+    struct Day {
+        SymbolId symbol;
+        int64_t start_ms;
+    };
+    std::vector<Day> days;
+    for (SymbolId symbol : symbols) {
+        for (int64_t day = from_ms - from_ms % MILLISECONDS_PER_DAY; day < to_ms; day += MILLISECONDS_PER_DAY)
+            days.push_back(Day { .symbol = symbol, .start_ms = day });
+    }
+
+    std::mutex stats_mutex;
+    HistoryDownloadStats total;
+    std::atomic<size_t> next_day { 0 };
+    auto work = [&] {
+        for (size_t i = next_day++; i < days.size() && !m_stopping.load(std::memory_order_relaxed); i = next_day++) {
+            Day const& day = days[i];
+            const std::string path = history_path(m_options.directory, symbol_name(day.symbol), m_options.kind, m_options.timeframe, day.start_ms);
+            if (std::optional<HistoryFile> existing = HistoryFile::open(path); existing.has_value() && existing->complete()) {
+                {
+                    std::lock_guard lock(stats_mutex);
+                    total.days_skipped++;
+                }
+                if (progress)
+                    progress(day.symbol, day.start_ms, existing->size(), HistoryDayStatus::ALREADY_STORED);
+                continue;
+            }
+
+            HistoryDownloadStats stats;
+            bool missing = false;
+            std::optional<std::string> file = download_day(day.symbol, day.start_ms, stats, missing);
+            HistoryDayStatus status = missing ? HistoryDayStatus::INCOMPLETE : HistoryDayStatus::WRITTEN;
+            if (!file.has_value() && m_stopping.load(std::memory_order_relaxed))
+                status = HistoryDayStatus::STOPPED;
+            else if (!file.has_value() || !write_history_file(path, file.value()))
+                status = HistoryDayStatus::FAILED;
+            {
+                std::lock_guard lock(stats_mutex);
+                total.requests += stats.requests;
+                total.records += stats.records;
+                if (status == HistoryDayStatus::WRITTEN || status == HistoryDayStatus::INCOMPLETE)
+                    total.bytes_written += file->size();
+                if (status == HistoryDayStatus::WRITTEN)
+                    total.days_written++;
+                else if (status == HistoryDayStatus::FAILED || status == HistoryDayStatus::INCOMPLETE)
+                    total.days_failed++;
+            }
+            if (progress)
+                progress(day.symbol, day.start_ms, stats.records, status);
+        }
+    };
+
+    std::vector<std::jthread> workers;
+    const size_t thread_count = std::min<size_t>(std::max(1u, m_options.concurrency), days.size());
+    for (size_t i = 0; i < thread_count; i++)
+        workers.emplace_back(work);
+    workers.clear();
+    return total;
+}
+
+std::optional<std::string> HistoryDownloader::download_day(SymbolId symbol, int64_t day_start_ms, HistoryDownloadStats& stats, bool& missing)
+{
+    const int64_t day_end_ms = day_start_ms + MILLISECONDS_PER_DAY;
+    // A day that is not over yet is fetched again by the next download
+    const bool over = day_end_ms <= now_ms();
+    const std::string_view name = symbol_name(symbol);
+
+    if (m_options.kind == HistoryKind::CANDLES) {
+        std::vector<Candle> candles;
+        for (int64_t start = day_start_ms;;) {
+            std::optional<std::string> body = get(std::format("{}/v2/candles/trade:{}:{}/hist?start={}&end={}&limit={}&sort=1", m_options.public_endpoint,
+                                                      m_options.timeframe, name, start, day_end_ms - 1, m_options.page_size),
+                stats);
+            if (!body.has_value())
+                return {};
+            const size_t before = candles.size();
+            if (decode_candles(body.value(), candles) != DecodeError::NONE) {
+                m_metrics.count_error(Endpoint::CANDLES_HISTORY, ErrorKind::DECODE);
+                return {};
+            }
+            stats.records += candles.size() - before;
+            if (candles.size() - before < m_options.page_size)
+                break;
+            start = candles.back().timestamp_ms + 1;
+        }
+        return encode_candles(candles, day_start_ms, over);
+    }
+
+    std::vector<HistoryTrade> trades;
+    std::vector<HistoryTrade> page;
+    // A page starts at the millisecond the previous one ended on, whose trades may not all have
+    // fit in it. These are the ids of the ones already kept, they come again.
+    std::vector<uint64_t> boundary_ids;
+    for (int64_t start = day_start_ms;;) {
+        std::optional<std::string> body = get(std::format("{}/v2/trades/{}/hist?start={}&end={}&limit={}&sort=1", m_options.public_endpoint, name, start,
+                                                  day_end_ms - 1, m_options.page_size),
+            stats);
+        if (!body.has_value())
+            return {};
+        page.clear();
+        if (decode_trades(body.value(), page) != DecodeError::NONE) {
+            m_metrics.count_error(Endpoint::TRADES_HISTORY, ErrorKind::DECODE);
+            return {};
+        }
+        for (HistoryTrade const& trade : page) {
+            if (trade.timestamp_ms == start && std::find(boundary_ids.begin(), boundary_ids.end(), trade.trade_id) != boundary_ids.end())
+                continue;
+            trades.push_back(trade);
+            stats.records++;
+        }
+        if (page.size() < m_options.page_size)
+            break;
+
+        // A full page within a single millisecond cannot be paged through by time, the trades of
+        // that millisecond past the page are left out and the day stays incomplete
+        if (page.back().timestamp_ms == start) {
+            missing = true;
+            start++;
+        } else {
+            start = page.back().timestamp_ms;
+        }
+        boundary_ids.clear();
+        for (auto kept = trades.rbegin(); kept != trades.rend() && kept->timestamp_ms == start; ++kept)
+            boundary_ids.push_back(kept->trade_id);
+    }
+    return encode_trades(trades, day_start_ms, over && !missing);
+}
+
+std::optional<std::string> HistoryDownloader::get(std::string const& url, HistoryDownloadStats& stats)
+{
+    const Endpoint endpoint = (m_options.kind == HistoryKind::TRADES) ? Endpoint::TRADES_HISTORY : Endpoint::CANDLES_HISTORY;
+    auto pause = [this](std::chrono::steady_clock::duration duration) {
+        for (auto end = std::chrono::steady_clock::now() + duration; std::chrono::steady_clock::now() < end && !m_stopping.load(std::memory_order_relaxed);)
+            std::this_thread::sleep_for(STOP_POLL_INTERVAL);
+    };
+
+    for (unsigned attempt = 0; attempt < std::max(1u, m_options.attempts); attempt++) {
+        if (!wait_for_token())
+            return {};
+        ConnectionPool::Lease session = m_connection_pool.acquire(m_options.public_endpoint);
+        session->SetUrl(cpr::Url { url });
+        cpr::Response response = session->Get();
+        m_metrics.record_transfer(endpoint, response.status_code, m_connection_pool.record_transfer(*session));
+        stats.requests++;
+
+        if (response.status_code == 200)
+            return std::move(response.text);
+        if (response.status_code == 429)
+            pause(RATE_LIMITED_PAUSE);
+        else if (response.status_code == 0 || response.status_code >= 500)
+            pause(std::chrono::seconds(1u << std::min(attempt, 6u)));
+        else
+            return {};
+    }
+    return {};
+}
+
+bool HistoryDownloader::wait_for_token()
+{
+    while (!m_stopping.load(std::memory_order_relaxed)) {
+        std::chrono::steady_clock::duration wait;
+        {
+            std::lock_guard lock(m_bucket_mutex);
+            if (m_rate_limit.per_second == 0)
+                return true;
+            const auto now = std::chrono::steady_clock::now();
+            m_tokens = std::min(m_rate_limit.burst, m_tokens + std::chrono::duration<double>(now - m_refilled).count() * m_rate_limit.per_second);
+            m_refilled = now;
+            if (m_tokens >= 1) {
+                m_tokens -= 1;
+                return true;
+            }
+            wait = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>((1 - m_tokens) / m_rate_limit.per_second));
+        }
+        std::this_thread::sleep_for(std::min<std::chrono::steady_clock::duration>(wait, STOP_POLL_INTERVAL));
+    }
+    return false;
+}
+
+}
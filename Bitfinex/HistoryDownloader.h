@@ -0,0 +1,104 @@
+#pragma once
+
+#include <Bitfinex/Client.h>
+#include <Bitfinex/ConnectionPool.h>
+#include <Bitfinex/HistoryStore.h>
+#include <Bitfinex/Metrics.h>
+#include <Bitfinex/RequestScheduler.h>
+#include <Bitfinex/Symbols.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+
+namespace Bitfinex {
+
+// Requests per minute the exchange allows on the public history endpoints
+static constexpr unsigned TRADES_HISTORY_RATE_LIMIT = 15;
+static constexpr unsigned CANDLES_HISTORY_RATE_LIMIT = 30;
+
+struct HistoryDownloadOptions {
+    std::string public_endpoint { Client::DEFAULT_PUBLIC_ENDPOINT };
+    // Root of the store, see history_path
+    std::string directory { "history" };
+    HistoryKind kind { HistoryKind::TRADES };
+    // Candle interval, 1m, 5m, 1h, 1D...
+    std::string timeframe { "1m" };
+    // Days downloaded at once, the rate limit is shared by all of them
+    unsigned concurrency { 4 };
+    // The exchange's limit of the kind when unset
+    std::optional<RateLimit> rate_limit;
+    // Records per request, the exchange answers at most 10000
+    unsigned page_size { 10000 };
+    // Attempts of a page before its day is given up, a 429 waits a minute before the next one
+    unsigned attempts { 5 };
+};
+
+enum class HistoryDayStatus : uint8_t {
+    WRITTEN,
+    ALREADY_STORED,
+    FAILED,
+    STOPPED,
+    // Written without the trades of a millisecond that held more than a page, counted as failed
+    // and fetched again by the next download
+    INCOMPLETE,
+};
+
+struct HistoryDownloadStats {
+    size_t days_written { 0 };
+    // Complete days already in the store
+    size_t days_skipped { 0 };
+    size_t days_failed { 0 };
+    size_t requests { 0 };
+    size_t records { 0 };
+    size_t bytes_written { 0 };
+};
+
+// Downloads the trades or candles of a range of days into the history store, one file per symbol
+// and day. Days are downloaded concurrently and paged through in time order within each day,
+// every request waiting for a token of a shared bucket. A day's file is written once all of it is
+// in, complete days already in the store are skipped, so a download that was interrupted picks
+// up from the days it had not finished.
+class HistoryDownloader {
+public:
+    // Called after every day, from the thread that downloaded it
+    using Progress = std::function<void(SymbolId, int64_t day_start_ms, size_t records, HistoryDayStatus)>;
+
+    explicit HistoryDownloader(HistoryDownloadOptions options);
+    HistoryDownloader(HistoryDownloader const&) = delete;
+    HistoryDownloader& operator=(HistoryDownloader const&) = delete;
+
+    // Days from the one holding from_ms up to the one holding to_ms - 1
+    HistoryDownloadStats download(std::span<SymbolId const>, int64_t from_ms, int64_t to_ms, Progress = {});
+    // Makes download return once the requests in flight are answered, unfinished days are not
+    // written. Only stores a flag, can be called from a signal handler.
+    void stop() { m_stopping.store(true, std::memory_order_relaxed); }
+
+    [[nodiscard]] ClientMetrics const& metrics() const { return m_metrics; }
+
+private:
+    // Records of one day, nothing when it could not be had or the download stopped. Missing is set
+    // when some records could not be paged through, the file is then not marked complete.
+    std::optional<std::string> download_day(SymbolId, int64_t day_start_ms, HistoryDownloadStats&, bool& missing);
+    // The body of a 200, nothing after the last attempt or once stopping
+    std::optional<std::string> get(std::string const& url, HistoryDownloadStats&);
+    // Blocks until the bucket has a token, false once stopping
+    bool wait_for_token();
+
+    HistoryDownloadOptions const m_options;
+    RateLimit const m_rate_limit;
+    ClientMetrics m_metrics;
+    ConnectionPool m_connection_pool;
+    std::atomic<bool> m_stopping { false };
+
+    std::mutex m_bucket_mutex;
+    double m_tokens;
+    std::chrono::steady_clock::time_point m_refilled;
+};
+
+}
@@ -0,0 +1,368 @@
+#include <Bitfinex/HistoryStore.h>
+#include <array>
+#include <bit>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <numeric>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+namespace Bitfinex {
+
+static_assert(std::endian::native == std::endian::little, "history files are read and written in place");
+
+static constexpr char MAGIC[4] = { 'B', 'F', 'X', 'H' };
+static constexpr uint16_t VERSION = 1;
+static constexpr size_t TRADE_COLUMNS = 4;
+static constexpr size_t CANDLE_COLUMNS = 6;
+
+struct FileHeader {
+    char magic[4];
+    uint16_t version;
+    uint8_t kind;
+    uint8_t complete;
+    uint32_t count;
+    uint32_t column_count;
+    int64_t day_start_ms;
+};
+static_assert(sizeof(FileHeader) == 24);
+
+struct ColumnHeader {
+    // From the start of the file
+    uint64_t offset;
+    uint64_t size;
+    // The first value of a delta column, 0 otherwise
+    int64_t base;
+    // Every stored value is a multiple of it
+    int64_t quantum;
+    uint8_t delta;
+    uint8_t reserved[7];
+};
+static_assert(sizeof(ColumnHeader) == 40);
+
+char const* history_kind_name(HistoryKind kind)
+{
+    switch (kind) {
+    case HistoryKind::TRADES:
+        return "trades";
+    case HistoryKind::CANDLES:
+        return "candles";
+    }
+    return "unknown";
+}
+
+std::string day_name(int64_t timestamp_ms)
+{
+    const auto day = std::chrono::floor<std::chrono::days>(std::chrono::sys_time<std::chrono::milliseconds>(std::chrono::milliseconds(timestamp_ms)));
+    const std::chrono::year_month_day date(day);
+    return std::format("{:04}-{:02}-{:02}", static_cast<int>(date.year()), static_cast<unsigned>(date.month()), static_cast<unsigned>(date.day()));
+}
+
+std::optional<int64_t> parse_day(std::string_view text)
+{
+    int year = 0;
+    unsigned month = 0, day = 0;
+    if (text.size() != 10 || text[4] != '-' || text[7] != '-')
+        return {};
+    if (std::from_chars(text.data(), text.data() + 4, year).ptr != text.data() + 4 || std::from_chars(text.data() + 5, text.data() + 7, month).ptr != text.data() + 7
+        || std::from_chars(text.data() + 8, text.data() + 10, day).ptr != text.data() + 10)
+        return {};
+    const std::chrono::year_month_day date { std::chrono::year(year), std::chrono::month(month), std::chrono::day(day) };
+    if (!date.ok())
+        return {};
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::sys_days(date).time_since_epoch()).count();
+}
+
+std::string history_path(std::string const& directory, std::string_view symbol, HistoryKind kind, std::string_view timeframe, int64_t day_start_ms)
+{
+    if (kind == HistoryKind::CANDLES)
+        return std::format("{}/{}/candles-{}/{}.bfxh", directory, symbol, timeframe, day_name(day_start_ms));
+    return std::format("{}/{}/trades/{}.bfxh", directory, symbol, day_name(day_start_ms));
+}
+
+static uint64_t zigzag(int64_t value)
+{
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+static int64_t unzigzag(uint64_t value)
+{
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+static void write_varint(std::string& out, uint64_t value)
+{
+    while (value >= 0x80) {
+        out += static_cast<char>((value & 0x7f) | 0x80);
+        value >>= 7;
+    }
+    out += static_cast<char>(value);
+}
+
+struct EncodedColumn {
+    ColumnHeader header;
+    std::string data;
+};
+
+static EncodedColumn encode_column(std::span<int64_t const> values, bool delta)
+{
+    EncodedColumn column { .header = { .offset = 0, .size = 0, .base = 0, .quantum = 1, .delta = delta, .reserved = {} }, .data = {} };
+    if (values.empty())
+        return column;
+    column.header.base = delta ? values[0] : 0;
+
+    // The stored steps, before dividing by their common divisor
+    std::vector<int64_t> steps(values.size());
+    int64_t previous = column.header.base;
+    int64_t quantum = 0;
+    for (size_t i = 0; i < values.size(); i++) {
+        steps[i] = delta ? values[i] - previous : values[i];
+        previous = values[i];
+        quantum = std::gcd(quantum, steps[i]);
+    }
+    column.header.quantum = (quantum == 0) ? 1 : quantum;
+
+    column.data.reserve(values.size() * 2);
+    for (int64_t step : steps)
+        write_varint(column.data, zigzag(step / column.header.quantum));
+    return column;
+}
+
+template<size_t ColumnCount>
+static std::string encode_file(HistoryKind kind, std::array<std::vector<int64_t>, ColumnCount> const& values, std::array<bool, ColumnCount> const& delta,
+    int64_t day_start_ms, bool complete)
+{
+    FileHeader header { .magic = {}, .version = VERSION, .kind = static_cast<uint8_t>(kind), .complete = complete,
+        .count = static_cast<uint32_t>(values[0].size()), .column_count = ColumnCount, .day_start_ms = day_start_ms };
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+
+    std::array<EncodedColumn, ColumnCount> columns;
+    uint64_t offset = sizeof(FileHeader) + ColumnCount * sizeof(ColumnHeader);
+    for (size_t i = 0; i < ColumnCount; i++) {
+        columns[i] = encode_column(values[i], delta[i]);
+        columns[i].header.offset = offset;
+        columns[i].header.size = columns[i].data.size();
+        offset += columns[i].data.size();
+    }
+
+    std::string file;
+    file.reserve(offset);
+    file.append(reinterpret_cast<char const*>(&header), sizeof(header));
+    for (EncodedColumn const& column : columns)
+        file.append(reinterpret_cast<char const*>(&column.header), sizeof(column.header));
+    for (EncodedColumn const& column : columns)
+        file += column.data;
+    return file;
+}
+
+std::string encode_trades(std::span<HistoryTrade const> trades, int64_t day_start_ms, bool complete)
+{
+    std::array<std::vector<int64_t>, TRADE_COLUMNS> values;
+    for (std::vector<int64_t>& column : values)
+        column.reserve(trades.size());
+    for (HistoryTrade const& trade : trades) {
+        values[0].push_back(static_cast<int64_t>(trade.trade_id));
+        values[1].push_back(trade.timestamp_ms);
+        values[2].push_back(trade.amount.units());
+        values[3].push_back(trade.price.units());
+    }
+    return encode_file<TRADE_COLUMNS>(HistoryKind::TRADES, values, { true, true, false, true }, day_start_ms, complete);
+}
+
+std::string encode_candles(std::span<Candle const> candles, int64_t day_start_ms, bool complete)
+{
+    std::array<std::vector<int64_t>, CANDLE_COLUMNS> values;
+    for (std::vector<int64_t>& column : values)
+        column.reserve(candles.size());
+    for (Candle const& candle : candles) {
+        values[0].push_back(candle.timestamp_ms);
+        values[1].push_back(candle.open.units());
+        values[2].push_back(candle.close.units());
+        values[3].push_back(candle.high.units());
+        values[4].push_back(candle.low.units());
+        values[5].push_back(candle.volume.units());
+    }
+    return encode_file<CANDLE_COLUMNS>(HistoryKind::CANDLES, values, { true, true, true, true, true, false }, day_start_ms, complete);
+}
+
+bool write_history_file(std::string const& path, std::string_view content)
+{
+    std::error_code error;
+    std::filesystem::create_directories(std::filesystem::path(path).parent_path(), error);
+    const std::string temporary = path + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        if (!file.write(content.data(), static_cast<std::streamsize>(content.size())))
+            return false;
+    }
+    std::filesystem::rename(temporary, path, error);
+    return !error;
+}
+
+std::optional<HistoryFile> HistoryFile::open(std::string const& path)
+{
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return {};
+    struct stat status;
+    if (fstat(fd, &status) != 0 || static_cast<size_t>(status.st_size) < sizeof(FileHeader)) {
+        ::close(fd);
+        return {};
+    }
+    const size_t size = static_cast<size_t>(status.st_size);
+    void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED)
+        return {};
+    // Files are scanned front to back
+    madvise(data, size, MADV_SEQUENTIAL);
+    HistoryFile file(data, size);
+
+    FileHeader const* header = static_cast<FileHeader const*>(data);
+    if (std::memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0 || header->version != VERSION
+        || header->column_count != (header->kind == static_cast<uint8_t>(HistoryKind::TRADES) ? TRADE_COLUMNS : CANDLE_COLUMNS)
+        || size < sizeof(FileHeader) + header->column_count * sizeof(ColumnHeader))
+        return {};
+    ColumnHeader const* columns = reinterpret_cast<ColumnHeader const*>(header + 1);
+    for (size_t i = 0; i < header->column_count; i++) {
+        if (columns[i].offset > size || columns[i].size > size - columns[i].offset)
+            return {};
+    }
+    return file;
+}
+
+HistoryFile::HistoryFile(void const* data, size_t size)
+    : m_data(data)
+    , m_size(size)
+{
+}
+
+HistoryFile::HistoryFile(HistoryFile&& other) noexcept
+    : m_data(std::exchange(other.m_data, nullptr))
+    , m_size(std::exchange(other.m_size, 0))
+{
+}
+
+HistoryFile& HistoryFile::operator=(HistoryFile&& other) noexcept
+{
+    if (this != &other) {
+        if (m_data)
+            munmap(const_cast<void*>(m_data), m_size);
+        m_data = std::exchange(other.m_data, nullptr);
+        m_size = std::exchange(other.m_size, 0);
+    }
+    return *this;
+}
+
+HistoryFile::~HistoryFile()
+{
+    if (m_data)
+        munmap(const_cast<void*>(m_data), m_size);
+}
+
+static FileHeader const& file_header(void const* data)
+{
+    return *static_cast<FileHeader const*>(data);
+}
+
+HistoryKind HistoryFile::kind() const
+{
+    return static_cast<HistoryKind>(file_header(m_data).kind);
+}
+
+bool HistoryFile::complete() const
+{
+    return file_header(m_data).complete != 0;
+}
+
+int64_t HistoryFile::day_start_ms() const
+{
+    return file_header(m_data).day_start_ms;
+}
+
+size_t HistoryFile::size() const
+{
+    return file_header(m_data).count;
+}
+
+size_t HistoryFile::column_count() const
+{
+    return file_header(m_data).column_count;
+}
+
+bool HistoryFile::read_column(size_t column, std::span<int64_t> out) const
+{
+    if (column >= column_count() || out.size() < size())
+        return false;
+    ColumnHeader const& header = reinterpret_cast<ColumnHeader const*>(&file_header(m_data) + 1)[column];
+    uint8_t const* in = static_cast<uint8_t const*>(m_data) + header.offset;
+    uint8_t const* const end = in + header.size;
+
+    int64_t value = header.base;
+    for (size_t i = 0, count = size(); i < count; i++) {
+        uint64_t encoded = 0;
+        // Most steps fit in a byte
+        if (in < end && *in < 0x80) {
+            encoded = *in++;
+        } else {
+            for (int shift = 0;; shift += 7) {
+                if (in == end || shift > 63)
+                    return false;
+                const uint8_t byte = *in++;
+                encoded |= static_cast<uint64_t>(byte & 0x7f) << shift;
+                if (byte < 0x80)
+                    break;
+            }
+        }
+        const int64_t step = unzigzag(encoded) * header.quantum;
+        value = header.delta ? value + step : step;
+        out[i] = value;
+    }
+    return true;
+}
+
+bool HistoryFile::read_trades(std::vector<HistoryTrade>& trades) const
+{
+    if (kind() != HistoryKind::TRADES)
+        return false;
+    const size_t count = size();
+    std::vector<int64_t> values(count * TRADE_COLUMNS);
+    for (size_t column = 0; column < TRADE_COLUMNS; column++) {
+        if (!read_column(column, std::span(values).subspan(column * count, count)))
+            return false;
+    }
+    trades.reserve(trades.size() + count);
+    for (size_t i = 0; i < count; i++) {
+        trades.push_back(HistoryTrade { .trade_id = static_cast<uint64_t>(values[i]), .timestamp_ms = values[count + i],
+            .amount = Decimal::from_units(values[2 * count + i]), .price = Decimal::from_units(values[3 * count + i]) });
+    }
+    return true;
+}
+
+bool HistoryFile::read_candles(std::vector<Candle>& candles) const
+{
+    if (kind() != HistoryKind::CANDLES)
+        return false;
+    const size_t count = size();
+    std::vector<int64_t> values(count * CANDLE_COLUMNS);
+    for (size_t column = 0; column < CANDLE_COLUMNS; column++) {
+        if (!read_column(column, std::span(values).subspan(column * count, count)))
+            return false;
+    }
+    candles.reserve(candles.size() + count);
+    for (size_t i = 0; i < count; i++) {
+        candles.push_back(Candle { .timestamp_ms = values[i], .open = Decimal::from_units(values[count + i]),
+            .close = Decimal::from_units(values[2 * count + i]), .high = Decimal::from_units(values[3 * count + i]),
+            .low = Decimal::from_units(values[4 * count + i]), .volume = Decimal::from_units(values[5 * count + i]) });
+    }
+    return true;
+}
+
+}
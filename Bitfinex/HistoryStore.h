@@ -0,0 +1,99 @@
+#pragma once
+
+#include <Bitfinex/Decimal.h>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Market history is kept as one file per symbol and UTC day, laid out in columns so that a scan
+// only touches the fields it reads. A file is a header, one ColumnHeader per field and the column
+// data. Each column stores its values as zigzag varints, either as they are or as the difference
+// to the previous value (timestamps, ids and prices), divided by the largest integer that divides
+// all of them, e.g. the price tick or the candle interval. Integers are little endian.
+namespace Bitfinex {
+
+enum class HistoryKind : uint8_t {
+    TRADES,
+    CANDLES,
+};
+
+char const* history_kind_name(HistoryKind);
+
+// [ID, MTS, AMOUNT, PRICE] of /v2/trades/SYMBOL/hist, amount is negative for sells
+struct HistoryTrade {
+    uint64_t trade_id;
+    int64_t timestamp_ms;
+    Decimal amount;
+    Decimal price;
+};
+
+// [MTS, OPEN, CLOSE, HIGH, LOW, VOLUME] of /v2/candles/trade:TIMEFRAME:SYMBOL/hist
+struct Candle {
+    int64_t timestamp_ms;
+    Decimal open;
+    Decimal close;
+    Decimal high;
+    Decimal low;
+    Decimal volume;
+};
+
+// Columns of a trades file, for HistoryFile::read_column
+enum TradeColumn : size_t {
+    TRADE_ID_COLUMN,
+    TRADE_TIMESTAMP_COLUMN,
+    TRADE_AMOUNT_COLUMN,
+    TRADE_PRICE_COLUMN,
+};
+
+static constexpr int64_t MILLISECONDS_PER_DAY = 86400000;
+
+// directory/SYMBOL/trades/YYYY-MM-DD.bfxh or directory/SYMBOL/candles-TIMEFRAME/YYYY-MM-DD.bfxh
+std::string history_path(std::string const& directory, std::string_view symbol, HistoryKind, std::string_view timeframe, int64_t day_start_ms);
+// YYYY-MM-DD of the UTC day holding the timestamp
+std::string day_name(int64_t timestamp_ms);
+// Start of the UTC day named YYYY-MM-DD, nothing when malformed
+std::optional<int64_t> parse_day(std::string_view);
+
+// A complete file holds a whole day, a file written while the day was still going on is not
+std::string encode_trades(std::span<HistoryTrade const>, int64_t day_start_ms, bool complete);
+std::string encode_candles(std::span<Candle const>, int64_t day_start_ms, bool complete);
+// Written to a temporary file renamed into place, a reader never sees half a file
+bool write_history_file(std::string const& path, std::string_view content);
+
+// Read only memory mapping of a history file
+class HistoryFile {
+public:
+    // Nothing when the file cannot be mapped or is not a history file
+    static std::optional<HistoryFile> open(std::string const& path);
+    HistoryFile(HistoryFile&&) noexcept;
+    HistoryFile& operator=(HistoryFile&&) noexcept;
+    HistoryFile(HistoryFile const&) = delete;
+    HistoryFile& operator=(HistoryFile const&) = delete;
+    ~HistoryFile();
+
+    [[nodiscard]] HistoryKind kind() const;
+    [[nodiscard]] bool complete() const;
+    [[nodiscard]] int64_t day_start_ms() const;
+    // Records in the file
+    [[nodiscard]] size_t size() const;
+    [[nodiscard]] size_t column_count() const;
+    // Bytes of the mapped file
+    [[nodiscard]] size_t file_size() const { return m_size; }
+
+    // Decodes one column into out, which must hold size() values. Decimal columns decode to units.
+    bool read_column(size_t column, std::span<int64_t> out) const;
+    bool read_trades(std::vector<HistoryTrade>&) const;
+    bool read_candles(std::vector<Candle>&) const;
+
+private:
+    HistoryFile(void const* data, size_t size);
+
+    void const* m_data { nullptr };
+    size_t m_size { 0 };
+};
+
+}
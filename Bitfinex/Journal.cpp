@@ -0,0 +1,393 @@
+#include <Bitfinex/FeedHandler.h>
+#include <Bitfinex/Journal.h>
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <format>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+namespace Bitfinex {
+
+static_assert(std::endian::native == std::endian::little, "journal files are read and written in place");
+
+static constexpr char MAGIC[4] = { 'B', 'F', 'X', 'J' };
+static constexpr uint32_t VERSION = 1;
+static constexpr std::string_view FILE_PREFIX = "journal-";
+static constexpr std::string_view FILE_SUFFIX = ".bfxj";
+
+struct FileHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t index;
+    int64_t created_ns;
+    uint64_t size;
+};
+static_assert(sizeof(FileHeader) == 32);
+
+struct RecordHeader {
+    // Written last, NONE until the record is complete
+    std::atomic<uint8_t> kind;
+    uint8_t endpoint;
+    uint16_t status;
+    uint32_t topic_size;
+    uint32_t body_size;
+    uint32_t reserved;
+    int64_t timestamp_ns;
+    uint64_t sequence;
+};
+static_assert(sizeof(RecordHeader) == 32);
+static_assert(std::atomic<uint8_t>::is_always_lock_free);
+
+// Records start on 8 byte boundaries so that their headers can be read in place
+static constexpr size_t record_size(size_t topic_size, size_t body_size)
+{
+    return (sizeof(RecordHeader) + topic_size + body_size + 7) & ~size_t { 7 };
+}
+
+static int64_t now_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+char const* journal_record_kind_name(JournalRecordKind kind)
+{
+    switch (kind) {
+    case JournalRecordKind::NONE:
+        return "none";
+    case JournalRecordKind::REQUEST:
+        return "request";
+    case JournalRecordKind::RESPONSE:
+        return "response";
+    case JournalRecordKind::FRAME:
+        return "frame";
+    case JournalRecordKind::END:
+        return "end";
+    }
+    return "unknown";
+}
+
+// Index of journal-NNNNNN.bfxj, nothing for any other name
+static std::optional<uint64_t> file_index(std::string_view name)
+{
+    if (!name.starts_with(FILE_PREFIX) || !name.ends_with(FILE_SUFFIX))
+        return {};
+    name = name.substr(FILE_PREFIX.size(), name.size() - FILE_PREFIX.size() - FILE_SUFFIX.size());
+    uint64_t index = 0;
+    auto [end, error] = std::from_chars(name.data(), name.data() + name.size(), index);
+    if (error != std::errc {} || end != name.data() + name.size())
+        return {};
+    return index;
+}
+
+std::vector<std::string> journal_files(std::string const& directory)
+{
+    std::vector<std::pair<uint64_t, std::string>> files;
+    std::error_code error;
+    for (std::filesystem::directory_entry const& entry : std::filesystem::directory_iterator(directory, error)) {
+        if (std::optional<uint64_t> index = file_index(entry.path().filename().string()))
+            files.emplace_back(index.value(), entry.path().string());
+    }
+    std::sort(files.begin(), files.end());
+    std::vector<std::string> paths;
+    for (auto& [index, path] : files)
+        paths.push_back(std::move(path));
+    return paths;
+}
+
+std::unique_ptr<Journal> Journal::open(JournalOptions const& options)
+{
+    std::error_code error;
+    std::filesystem::create_directories(options.directory, error);
+    uint64_t first_index = 1;
+    for (std::string const& path : journal_files(options.directory))
+        first_index = std::max(first_index, file_index(std::filesystem::path(path).filename().string()).value_or(0) + 1);
+
+    std::unique_ptr<Journal> journal(new Journal(options, first_index));
+    if (!journal->m_current.data)
+        return nullptr;
+    return journal;
+}
+
+Journal::Journal(JournalOptions const& options, uint64_t first_index)
+    : m_options(options)
+    , m_next_index(first_index + 1)
+{
+    if (std::optional<Segment> segment = create_segment(first_index)) {
+        m_current = std::move(segment.value());
+        m_files++;
+    }
+    m_thread = std::jthread([this] { prepare(); });
+}
+
+Journal::~Journal()
+{
+    {
+        std::lock_guard lock(m_mutex);
+        m_stopping = true;
+    }
+    m_wake.notify_all();
+    m_thread = {};
+
+    // The background thread is gone, what it left is closed here
+    for (Segment& segment : m_full)
+        close_segment(segment);
+    if (m_spare.has_value()) {
+        ::unlink(m_spare->path.c_str());
+        m_spare->used = 0;
+        close_segment(m_spare.value());
+    }
+    if (m_current.data) {
+        // A reader stops here instead of running past the end of the truncated file
+        reinterpret_cast<RecordHeader*>(m_current.data + m_current.used)->kind.store(static_cast<uint8_t>(JournalRecordKind::END), std::memory_order_release);
+        m_current.used += sizeof(RecordHeader);
+        close_segment(m_current);
+    }
+}
+
+std::optional<Journal::Segment> Journal::create_segment(uint64_t index) const
+{
+    Segment segment;
+    segment.path = std::format("{}/{}{:06}{}", m_options.directory, FILE_PREFIX, index, FILE_SUFFIX);
+    segment.fd = ::open(segment.path.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    if (segment.fd < 0)
+        return {};
+    // Blocks allocated and pages faulted in now, not on the writer's first touch
+    void* data = MAP_FAILED;
+    if (posix_fallocate(segment.fd, 0, static_cast<off_t>(m_options.file_size)) == 0)
+        data = mmap(nullptr, m_options.file_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, segment.fd, 0);
+    if (data == MAP_FAILED) {
+        ::close(segment.fd);
+        ::unlink(segment.path.c_str());
+        return {};
+    }
+    segment.data = static_cast<char*>(data);
+    FileHeader header {};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.index = index;
+    header.created_ns = now_ns();
+    header.size = m_options.file_size;
+    std::memcpy(segment.data, &header, sizeof(header));
+    segment.used = sizeof(FileHeader);
+    return segment;
+}
+
+void Journal::close_segment(Segment& segment) const
+{
+    munmap(segment.data, m_options.file_size);
+    segment.data = nullptr;
+    // The unwritten rest of the file is only zeros
+    if (segment.used > 0)
+        (void)::ftruncate(segment.fd, static_cast<off_t>(segment.used));
+    ::close(segment.fd);
+    segment.fd = -1;
+}
+
+void Journal::record(JournalRecordKind kind, Endpoint endpoint, uint16_t status, uint64_t sequence, std::string_view topic, std::string_view body)
+{
+    const int64_t timestamp_ns = now_ns();
+    const size_t size = record_size(topic.size(), body.size());
+    // Room is always left for the END record
+    if (size > m_options.file_size - sizeof(FileHeader) - sizeof(RecordHeader)) {
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    while (m_lock.test_and_set(std::memory_order_acquire))
+        std::this_thread::yield();
+    if (!m_current.data || m_current.used + size > m_options.file_size - sizeof(RecordHeader))
+        roll();
+    if (!m_current.data) {
+        m_lock.clear(std::memory_order_release);
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    char* at = m_current.data + m_current.used;
+    RecordHeader* header = reinterpret_cast<RecordHeader*>(at);
+    header->endpoint = static_cast<uint8_t>(endpoint);
+    header->status = status;
+    header->topic_size = static_cast<uint32_t>(topic.size());
+    header->body_size = static_cast<uint32_t>(body.size());
+    header->reserved = 0;
+    header->timestamp_ns = timestamp_ns;
+    header->sequence = sequence;
+    std::memcpy(at + sizeof(RecordHeader), topic.data(), topic.size());
+    std::memcpy(at + sizeof(RecordHeader) + topic.size(), body.data(), body.size());
+    header->kind.store(static_cast<uint8_t>(kind), std::memory_order_release);
+    m_current.used += size;
+    m_records++;
+    m_bytes += size;
+    m_lock.clear(std::memory_order_release);
+}
+
+void Journal::roll()
+{
+    std::optional<Segment> next;
+    {
+        std::unique_lock lock(m_mutex);
+        // No current file when the last roll could not create one
+        if (m_current.data) {
+            reinterpret_cast<RecordHeader*>(m_current.data + m_current.used)->kind.store(static_cast<uint8_t>(JournalRecordKind::END), std::memory_order_release);
+            m_current.used += sizeof(RecordHeader);
+            m_full.push_back(std::exchange(m_current, Segment {}));
+        }
+        if (!m_spare.has_value()) {
+            m_stalls++;
+            // The spare being created has the next index, a file created here would come before it
+            m_spare_ready.wait(lock, [this] { return !m_preparing; });
+        }
+        next = std::exchange(m_spare, std::nullopt);
+        if (!next.has_value())
+            next = create_segment(m_next_index++);
+    }
+    m_wake.notify_one();
+    if (next.has_value()) {
+        m_current = std::move(next.value());
+        m_files++;
+    }
+}
+
+void Journal::prepare()
+{
+    std::unique_lock lock(m_mutex);
+    for (;;) {
+        m_wake.wait(lock, [this] { return m_stopping || !m_full.empty() || !m_spare.has_value(); });
+        if (m_stopping)
+            return;
+        std::vector<Segment> full = std::exchange(m_full, {});
+        const bool want_spare = !m_spare.has_value();
+        const uint64_t index = m_next_index;
+        if (want_spare) {
+            m_next_index++;
+            m_preparing = true;
+        }
+        lock.unlock();
+
+        for (Segment& segment : full)
+            close_segment(segment);
+        std::optional<Segment> spare = want_spare ? create_segment(index) : std::nullopt;
+
+        lock.lock();
+        m_preparing = false;
+        const bool created = spare.has_value();
+        if (created)
+            m_spare = std::move(spare);
+        m_spare_ready.notify_all();
+        if (want_spare && !created)
+            // A full disk or a missing directory, the writer tries again itself when it rolls
+            m_wake.wait(lock, [this] { return m_stopping || !m_full.empty(); });
+    }
+}
+
+void Journal::attach(FeedHandler& feed)
+{
+    const uint64_t sequence = m_feeds.fetch_add(1, std::memory_order_relaxed) + 1;
+    feed.on_raw_frame([this, sequence](std::string_view frame) {
+        record(JournalRecordKind::FRAME, Endpoint {}, 0, sequence, {}, frame);
+    });
+}
+
+JournalStats Journal::stats() const
+{
+    while (m_lock.test_and_set(std::memory_order_acquire))
+        std::this_thread::yield();
+    JournalStats stats { .records = m_records, .bytes = m_bytes, .dropped = m_dropped.load(std::memory_order_relaxed), .files = m_files, .stalls = m_stalls };
+    m_lock.clear(std::memory_order_release);
+    return stats;
+}
+
+std::optional<JournalFile> JournalFile::open(std::string const& path)
+{
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return {};
+    struct stat status;
+    if (fstat(fd, &status) != 0 || static_cast<size_t>(status.st_size) < sizeof(FileHeader)) {
+        ::close(fd);
+        return {};
+    }
+    const size_t size = static_cast<size_t>(status.st_size);
+    // Shared, a file still being written shows the records added after it was opened
+    void* data = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED)
+        return {};
+    madvise(data, size, MADV_SEQUENTIAL);
+    JournalFile file(static_cast<char const*>(data), size);
+
+    FileHeader const* header = static_cast<FileHeader const*>(data);
+    if (std::memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0 || header->version != VERSION)
+        return {};
+    return file;
+}
+
+JournalFile::JournalFile(char const* data, size_t size)
+    : m_data(data)
+    , m_size(size)
+{
+}
+
+JournalFile::JournalFile(JournalFile&& other) noexcept
+    : m_data(std::exchange(other.m_data, nullptr))
+    , m_size(std::exchange(other.m_size, 0))
+{
+}
+
+JournalFile& JournalFile::operator=(JournalFile&& other) noexcept
+{
+    if (this != &other) {
+        if (m_data)
+            munmap(const_cast<char*>(m_data), m_size);
+        m_data = std::exchange(other.m_data, nullptr);
+        m_size = std::exchange(other.m_size, 0);
+    }
+    return *this;
+}
+
+JournalFile::~JournalFile()
+{
+    if (m_data)
+        munmap(const_cast<char*>(m_data), m_size);
+}
+
+uint64_t JournalFile::index() const
+{
+    return reinterpret_cast<FileHeader const*>(m_data)->index;
+}
+
+int64_t JournalFile::created_ns() const
+{
+    return reinterpret_cast<FileHeader const*>(m_data)->created_ns;
+}
+
+bool JournalFile::next(size_t& offset, JournalRecord& record) const
+{
+    if (offset == 0)
+        offset = sizeof(FileHeader);
+    if (offset + sizeof(RecordHeader) > m_size)
+        return false;
+    RecordHeader const* header = reinterpret_cast<RecordHeader const*>(m_data + offset);
+    const auto kind = static_cast<JournalRecordKind>(header->kind.load(std::memory_order_acquire));
+    if (kind == JournalRecordKind::NONE || kind == JournalRecordKind::END || kind > JournalRecordKind::END)
+        return false;
+    const size_t size = record_size(header->topic_size, header->body_size);
+    if (size > m_size - offset)
+        return false;
+
+    char const* payload = m_data + offset + sizeof(RecordHeader);
+    record = JournalRecord { .kind = kind, .endpoint = static_cast<Endpoint>(header->endpoint), .status = header->status,
+        .timestamp_ns = header->timestamp_ns, .sequence = header->sequence, .topic = std::string_view(payload, header->topic_size),
+        .body = std::string_view(payload + header->topic_size, header->body_size) };
+    offset += size;
+    return true;
+}
+
+}
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <Bitfinex/Metrics.h>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// Append only record of the messages exchanged with the exchange, kept for looking into latency
+// incidents after the fact. The journal is a directory of numbered files of a fixed size, each
+// one allocated and mapped before the writer needs it. A record is copied into the mapping and
+// published by writing its kind last, so a reader of a file that is still being written only
+// ever sees whole records. Integers are little endian.
+namespace Bitfinex {
+
+class FeedHandler;
+
+enum class JournalRecordKind : uint8_t {
+    NONE, // Space the writer has not reached
+    REQUEST, // Body of a signed request, the topic is its path
+    RESPONSE, // Answer to the request of the same sequence, status is the HTTP status (0 without an answer)
+    FRAME, // Websocket frame as received, the sequence numbers the feeds of a journal
+    END, // The writer moved on to the next file
+};
+
+char const* journal_record_kind_name(JournalRecordKind);
+
+struct JournalRecord {
+    JournalRecordKind kind;
+    // Of requests and responses
+    Endpoint endpoint;
+    uint16_t status;
+    // Unix time, when the message was sent or received
+    int64_t timestamp_ns;
+    uint64_t sequence;
+    std::string_view topic;
+    std::string_view body;
+};
+
+struct JournalOptions {
+    std::string directory { "journal" };
+    // Bytes of each file, a record larger than a file is dropped
+    size_t file_size { 64 << 20 };
+};
+
+struct JournalStats {
+    uint64_t records;
+    uint64_t bytes;
+    uint64_t dropped;
+    uint64_t files;
+    // Rolls that found the next file not ready yet, the writer waited for it or created it itself
+    uint64_t stalls;
+};
+
+// directory/journal-NNNNNN.bfxj, in the order they were written
+std::vector<std::string> journal_files(std::string const& directory);
+
+// Safe to write to from any thread. Writers take a spin lock that a single producer always finds
+// free, the path of a record is then a copy into mapped memory and no system call; moving to the
+// next file and closing the full ones happen on a background thread.
+class Journal {
+public:
+    // Numbering continues after the files already in the directory, nullptr when the directory
+    // or the first file cannot be created
+    static std::unique_ptr<Journal> open(JournalOptions const&);
+    Journal(Journal const&) = delete;
+    Journal& operator=(Journal const&) = delete;
+    // Truncates the last file to what was written
+    ~Journal();
+
+    // Identifies a request and its response
+    uint64_t next_sequence() { return m_sequence.fetch_add(1, std::memory_order_relaxed) + 1; }
+
+    void record(JournalRecordKind, Endpoint, uint16_t status, uint64_t sequence, std::string_view topic, std::string_view body);
+    void record_request(Endpoint endpoint, uint64_t sequence, std::string_view path, std::string_view body)
+    {
+        record(JournalRecordKind::REQUEST, endpoint, 0, sequence, path, body);
+    }
+    void record_response(Endpoint endpoint, uint64_t sequence, uint16_t status, std::string_view body)
+    {
+        record(JournalRecordKind::RESPONSE, endpoint, status, sequence, {}, body);
+    }
+    // Records every frame the feed receives, frames of each attached feed get their own sequence
+    void attach(FeedHandler&);
+
+    [[nodiscard]] JournalStats stats() const;
+    [[nodiscard]] std::string const& directory() const { return m_options.directory; }
+
+private:
+    struct Segment {
+        int fd { -1 };
+        char* data { nullptr };
+        size_t used { 0 };
+        std::string path;
+    };
+
+    explicit Journal(JournalOptions const&, uint64_t first_index);
+    std::optional<Segment> create_segment(uint64_t index) const;
+    void close_segment(Segment&) const;
+    // With the spin lock held
+    void roll();
+    void prepare();
+
+    const JournalOptions m_options;
+    std::atomic<uint64_t> m_sequence { 0 };
+    std::atomic<uint64_t> m_feeds { 0 };
+
+    mutable std::atomic_flag m_lock;
+    Segment m_current;
+    uint64_t m_records { 0 };
+    uint64_t m_bytes { 0 };
+    uint64_t m_files { 0 };
+    uint64_t m_stalls { 0 };
+    std::atomic<uint64_t> m_dropped { 0 };
+
+    // Shared with the background thread
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    uint64_t m_next_index;
+    std::optional<Segment> m_spare;
+    // While the spare is created outside the lock, a roll waits for it to keep the files in order
+    bool m_preparing { false };
+    std::condition_variable m_spare_ready;
+    std::vector<Segment> m_full;
+    bool m_stopping { false };
+    std::jthread m_thread;
+};
+
+// Read only mapping of one journal file
+class JournalFile {
+public:
+    // Nothing when the file cannot be mapped or is not a journal file
+    static std::optional<JournalFile> open(std::string const& path);
+    JournalFile(JournalFile&&) noexcept;
+    JournalFile& operator=(JournalFile&&) noexcept;
+    JournalFile(JournalFile const&) = delete;
+    JournalFile& operator=(JournalFile const&) = delete;
+    ~JournalFile();
+
+    [[nodiscard]] uint64_t index() const;
+    [[nodiscard]] int64_t created_ns() const;
+
+    // Reads the record at offset and moves offset past it, false at the end of what was written.
+    // Start at 0.
+    bool next(size_t& offset, JournalRecord&) const;
+
+private:
+    JournalFile(char const* data, size_t size);
+
+    char const* m_data { nullptr };
+    size_t m_size { 0 };
+};
+
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace Bitfinex {
+
+// 1-based nearest rank of a percentile among count samples, ceil(percentile / 100 * count) and at
+// least 1. The percentile is taken in millionths of the samples so that 99.9 of 1000 is 999
+// exactly, not a float rounded up to 1000.
+[[nodiscard]] inline uint64_t percentile_rank(double percentile, uint64_t count)
+{
+    const auto millionths = static_cast<uint64_t>(std::llround(std::clamp(percentile, 0.0, 100.0) * 10000.0));
+    return std::clamp<uint64_t>((millionths * count + 999999) / 1000000, 1, std::max<uint64_t>(count, 1));
+}
+
+class ConcurrentHistogram;
+
+// Log-linear histogram in the spirit of HdrHistogram: each power of two is split into 64
+// linear buckets, so a recorded value is known to within 1/64 of itself from 1 ns to hours,
+// in a fixed 30 KB whatever the number of samples.
+class LatencyHistogram {
+public:
+    LatencyHistogram()
+        : m_counts(bucket_index(UINT64_MAX) + 1, 0)
+    {
+    }
+
+    void record(uint64_t value)
+    {
+        m_counts[bucket_index(value)]++;
+        m_count++;
+        m_sum += value;
+        m_max = std::max(m_max, value);
+    }
+
+    void merge(LatencyHistogram const& other)
+    {
+        for (size_t i = 0; i < m_counts.size(); i++)
+            m_counts[i] += other.m_counts[i];
+        m_count += other.m_count;
+        m_sum += other.m_sum;
+        m_max = std::max(m_max, other.m_max);
+    }
+
+    [[nodiscard]] uint64_t count() const { return m_count; }
+    [[nodiscard]] uint64_t max() const { return m_max; }
+    [[nodiscard]] double mean() const { return m_count == 0 ? 0 : static_cast<double>(m_sum) / static_cast<double>(m_count); }
+
+    // Nearest rank percentile, reported as the highest value of its bucket so it never understates
+    [[nodiscard]] uint64_t percentile(double percentile) const
+    {
+        if (m_count == 0)
+            return 0;
+        const uint64_t rank = percentile_rank(percentile, m_count);
+        uint64_t seen = 0;
+        for (size_t i = 0; i < m_counts.size(); i++) {
+            seen += m_counts[i];
+            if (seen >= rank)
+                return std::min(highest_in_bucket(i), m_max);
+        }
+        return m_max;
+    }
+
+private:
+    friend class ConcurrentHistogram;
+
+    static constexpr unsigned SUB_BUCKET_BITS = 7;
+    static constexpr uint64_t HALF_SUB_BUCKETS = uint64_t(1) << (SUB_BUCKET_BITS - 1);
+
+    // Values below 128 get a bucket each, above that a bucket spans 1/64 of the power of two
+    static constexpr size_t bucket_index(uint64_t value)
+    {
+        const unsigned shift = std::max<int>(0, std::bit_width(value) - static_cast<int>(SUB_BUCKET_BITS));
+        return shift * HALF_SUB_BUCKETS + (value >> shift);
+    }
+
+    static constexpr uint64_t highest_in_bucket(size_t index)
+    {
+        if (index < 2 * HALF_SUB_BUCKETS)
+            return index;
+        const uint64_t shift = index / HALF_SUB_BUCKETS - 1;
+        const uint64_t sub_bucket = index - shift * HALF_SUB_BUCKETS;
+        return ((sub_bucket + 1) << shift) - 1;
+    }
+
+    std::vector<uint64_t> m_counts;
+    uint64_t m_count { 0 };
+    uint64_t m_sum { 0 };
+    uint64_t m_max { 0 };
+};
+
+}
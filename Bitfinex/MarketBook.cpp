@@ -0,0 +1,231 @@
+#include <Bitfinex/MarketBook.h>
+#include <algorithm>
+#include <charconv>
+#include <cstdlib>
+
+namespace Bitfinex {
+
+// Slicing-by-8: table[k][b] is the CRC of byte b followed by k zero bytes, so eight input bytes
+// are folded with eight independent lookups instead of a chain of eight dependent ones
+static constexpr std::array<std::array<uint32_t, 256>, 8> make_crc32_tables()
+{
+    std::array<std::array<uint32_t, 256>, 8> tables {};
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; bit++)
+            crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320u : crc >> 1;
+        tables[0][i] = crc;
+    }
+    for (size_t k = 1; k < tables.size(); k++) {
+        for (uint32_t i = 0; i < 256; i++)
+            tables[k][i] = (tables[k - 1][i] >> 8) ^ tables[0][tables[k - 1][i] & 0xff];
+    }
+    return tables;
+}
+
+static constexpr std::array<std::array<uint32_t, 256>, 8> crc32_tables = make_crc32_tables();
+
+uint32_t crc32_update(uint32_t crc, std::string_view data)
+{
+    auto const& t = crc32_tables;
+    auto const* bytes = reinterpret_cast<uint8_t const*>(data.data());
+    size_t size = data.size();
+    crc = ~crc;
+    for (; size >= 8; size -= 8, bytes += 8) {
+        const uint32_t low = crc ^ (uint32_t(bytes[0]) | uint32_t(bytes[1]) << 8 | uint32_t(bytes[2]) << 16 | uint32_t(bytes[3]) << 24);
+        crc = t[7][low & 0xff] ^ t[6][(low >> 8) & 0xff] ^ t[5][(low >> 16) & 0xff] ^ t[4][low >> 24]
+            ^ t[3][bytes[4]] ^ t[2][bytes[5]] ^ t[1][bytes[6]] ^ t[0][bytes[7]];
+    }
+    for (; size > 0; size--, bytes++)
+        crc = t[0][(crc ^ *bytes) & 0xff] ^ (crc >> 8);
+    return ~crc;
+}
+
+size_t format_js_number(double value, char* out)
+{
+    if (value == 0) {
+        out[0] = '0';
+        return 1;
+    }
+
+    // Shortest round trip digits, e.g. -1.2345e+04
+    char scientific[32];
+    char const* end = std::to_chars(scientific, scientific + sizeof(scientific), value, std::chars_format::scientific).ptr;
+    char const* cursor = scientific;
+    char* output = out;
+    if (*cursor == '-') {
+        *output++ = '-';
+        cursor++;
+    }
+    char digits[24];
+    int digit_count = 0;
+    char const* exponent_start = std::find(cursor, end, 'e');
+    for (; cursor < exponent_start; cursor++) {
+        if (*cursor != '.')
+            digits[digit_count++] = *cursor;
+    }
+    char const* exponent_digits = exponent_start + 1;
+    if (*exponent_digits == '+')
+        exponent_digits++;
+    int exponent = 0;
+    std::from_chars(exponent_digits, end, exponent);
+
+    // https://tc39.es/ecma262/#sec-numeric-types-number-tostring
+    const int n = exponent + 1;
+    if (digit_count <= n && n <= 21) {
+        output = std::copy(digits, digits + digit_count, output);
+        output = std::fill_n(output, n - digit_count, '0');
+    } else if (0 < n && n <= 21) {
+        output = std::copy(digits, digits + n, output);
+        *output++ = '.';
+        output = std::copy(digits + n, digits + digit_count, output);
+    } else if (-6 < n && n <= 0) {
+        *output++ = '0';
+        *output++ = '.';
+        output = std::fill_n(output, -n, '0');
+        output = std::copy(digits, digits + digit_count, output);
+    } else {
+        *output++ = digits[0];
+        if (digit_count > 1) {
+            *output++ = '.';
+            output = std::copy(digits + 1, digits + digit_count, output);
+        }
+        *output++ = 'e';
+        *output++ = (n - 1 < 0) ? '-' : '+';
+        output = std::to_chars(output, output + 4, std::abs(n - 1)).ptr;
+    }
+    return static_cast<size_t>(output - out);
+}
+
+MarketBook::LevelText MarketBook::format_level(BookLevel const& level)
+{
+    LevelText text;
+    size_t length = format_js_number(level.price, text.text.data());
+    text.text[length++] = ':';
+    length += format_js_number(level.amount, text.text.data() + length);
+    text.length = static_cast<uint8_t>(length);
+    return text;
+}
+
+void MarketBook::set_level(Ladder& ladder, bool bid, BookLevel const& level)
+{
+    // Bids ascend and asks descend, both put the best price last
+    auto position = bid
+        ? std::lower_bound(ladder.levels.begin(), ladder.levels.end(), level.price, [](BookLevel const& existing, double price) { return existing.price < price; })
+        : std::lower_bound(ladder.levels.begin(), ladder.levels.end(), level.price, [](BookLevel const& existing, double price) { return existing.price > price; });
+    const auto index = position - ladder.levels.begin();
+    const bool exists = position != ladder.levels.end() && position->price == level.price;
+
+    if (level.count == 0) {
+        if (exists) {
+            ladder.levels.erase(position);
+            ladder.texts.erase(ladder.texts.begin() + index);
+        }
+        return;
+    }
+    if (exists) {
+        *position = level;
+        ladder.texts[index] = format_level(level);
+    } else {
+        ladder.levels.insert(position, level);
+        ladder.texts.insert(ladder.texts.begin() + index, format_level(level));
+    }
+}
+
+void MarketBook::apply_snapshot(std::span<BookLevel const> levels)
+{
+    clear();
+    for (BookLevel const& level : levels)
+        apply_update(level);
+}
+
+void MarketBook::apply_update(BookLevel const& level)
+{
+    // Positive amounts are bids, negative ones asks, deletions carry 1 or -1
+    if (level.amount > 0)
+        set_level(m_bids, true, level);
+    else
+        set_level(m_asks, false, level);
+    m_checksum.reset();
+}
+
+void MarketBook::clear()
+{
+    m_bids.levels.clear();
+    m_bids.texts.clear();
+    m_asks.levels.clear();
+    m_asks.texts.clear();
+    m_checksum.reset();
+}
+
+std::optional<BookLevel> MarketBook::best_bid() const
+{
+    if (m_bids.levels.empty())
+        return {};
+    return m_bids.levels.back();
+}
+
+std::optional<BookLevel> MarketBook::best_ask() const
+{
+    if (m_asks.levels.empty())
+        return {};
+    return m_asks.levels.back();
+}
+
+int32_t MarketBook::checksum() const
+{
+    if (m_checksum.has_value())
+        return m_checksum.value();
+
+    // "bid price:bid amount:ask price:ask amount:..." for the top 25 levels, checksummed in one pass
+    std::array<char, CHECKSUM_DEPTH * 2 * (sizeof(LevelText::text) + 1)> buffer;
+    size_t length = 0;
+    auto append = [&buffer, &length](LevelText const& text) {
+        if (length != 0)
+            buffer[length++] = ':';
+        std::copy_n(text.text.data(), text.length, buffer.data() + length);
+        length += text.length;
+    };
+    for (size_t depth = 0; depth < CHECKSUM_DEPTH; depth++) {
+        if (depth < m_bids.texts.size())
+            append(m_bids.texts[m_bids.texts.size() - 1 - depth]);
+        if (depth < m_asks.texts.size())
+            append(m_asks.texts[m_asks.texts.size() - 1 - depth]);
+    }
+    const uint32_t crc = crc32_update(0, { buffer.data(), length });
+    m_checksum = static_cast<int32_t>(crc);
+    return m_checksum.value();
+}
+
+MarketBooks::MarketBooks(FeedHandler& feed)
+    : m_feed(feed)
+{
+    m_feed.on_book_snapshot([this](BookSnapshot const& snapshot) {
+        std::optional<MarketBook>& book = m_books[snapshot.symbol];
+        if (!book.has_value())
+            book.emplace();
+        book->apply_snapshot(snapshot.levels);
+    });
+    m_feed.on_book([this](BookUpdate const& update) {
+        std::optional<MarketBook>& book = m_books[update.symbol];
+        if (book.has_value())
+            book->apply_update(update.level);
+    });
+    m_feed.on_book_checksum([this](BookChecksum const& checksum) {
+        std::optional<MarketBook>& book = m_books[checksum.symbol];
+        if (!book.has_value() || book->verify_checksum(checksum.checksum))
+            return;
+        // Out of sync, start over from a fresh snapshot
+        m_checksum_failures++;
+        book->clear();
+        m_feed.resubscribe(FeedChannel::BOOK, checksum.symbol);
+    });
+}
+
+MarketBook const* MarketBooks::book(SymbolId symbol) const
+{
+    std::optional<MarketBook> const* book = m_books.find(symbol);
+    return (book != nullptr && book->has_value()) ? &book->value() : nullptr;
+}
+
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <Bitfinex/FeedHandler.h>
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Bitfinex {
+
+// Aggregated (price level) book of one symbol, as published on the book channel. Each side is a
+// contiguous ladder sorted so that the best price is the last element: reading the top of book is
+// O(1) and the frequent updates near the top only move a few elements.
+class MarketBook {
+public:
+    static constexpr size_t CHECKSUM_DEPTH = 25;
+
+    MarketBook() = default;
+
+    void apply_snapshot(std::span<BookLevel const>);
+    void apply_update(BookLevel const&);
+    void clear();
+
+    [[nodiscard]] std::optional<BookLevel> best_bid() const;
+    [[nodiscard]] std::optional<BookLevel> best_ask() const;
+    // depth 0 is the best level
+    [[nodiscard]] BookLevel const& bid(size_t depth) const { return m_bids.levels[m_bids.levels.size() - 1 - depth]; }
+    [[nodiscard]] BookLevel const& ask(size_t depth) const { return m_asks.levels[m_asks.levels.size() - 1 - depth]; }
+    [[nodiscard]] size_t bid_depth() const { return m_bids.levels.size(); }
+    [[nodiscard]] size_t ask_depth() const { return m_asks.levels.size(); }
+
+    // CRC32 of the top 25 bids and asks the way the exchange computes it, as a signed integer
+    [[nodiscard]] int32_t checksum() const;
+    [[nodiscard]] bool verify_checksum(int32_t expected) const { return checksum() == expected; }
+
+private:
+    // The decimal text of price and amount as the exchange prints them, kept next to the level
+    // so checksums never reformat numbers
+    struct LevelText {
+        std::array<char, 64> text;
+        uint8_t length;
+        [[nodiscard]] std::string_view view() const { return { text.data(), length }; }
+    };
+
+    struct Ladder {
+        std::vector<BookLevel> levels;
+        std::vector<LevelText> texts;
+    };
+
+    static LevelText format_level(BookLevel const&);
+    static void set_level(Ladder&, bool bid, BookLevel const&);
+
+    Ladder m_bids; // Ascending prices
+    Ladder m_asks; // Descending prices
+    mutable std::optional<int32_t> m_checksum;
+};
+
+// Keeps one MarketBook per symbol up to date from a feed's book channels, resubscribing a
+// symbol whenever its book fails the exchange's checksum
+class MarketBooks {
+public:
+    explicit MarketBooks(FeedHandler& feed);
+
+    [[nodiscard]] MarketBook const* book(SymbolId) const;
+    [[nodiscard]] uint64_t checksum_failures() const { return m_checksum_failures; }
+
+private:
+    FeedHandler& m_feed;
+    // Symbols without a book channel stay empty
+    PerSymbol<std::optional<MarketBook>> m_books;
+    uint64_t m_checksum_failures { 0 };
+};
+
+// JavaScript Number.prototype.toString formatting, the representation the exchange checksums
+size_t format_js_number(double value, char* out);
+uint32_t crc32_update(uint32_t crc, std::string_view data);
+
+}
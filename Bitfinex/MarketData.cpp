@@ -0,0 +1,291 @@
+#include <Bitfinex/MarketData.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace Bitfinex {
+
+static_assert(std::endian::native == std::endian::little, "rings are read and written in place");
+
+static constexpr char MAGIC[4] = { 'B', 'F', 'X', 'M' };
+static constexpr uint32_t VERSION = 1;
+static constexpr size_t SYMBOL_LENGTH = 32;
+static constexpr size_t PAYLOAD_WORDS = 4;
+
+// The record as written, in words so that it can be copied with atomic loads and stores
+struct alignas(64) Slot {
+    // 2 * position + 1 while the record at position is being written, 2 * position + 2 once it is
+    std::atomic<uint64_t> mark;
+    std::atomic<int64_t> published_ns;
+    // Kind in the low byte, symbol table index above it
+    std::atomic<uint64_t> header;
+    std::array<std::atomic<uint64_t>, PAYLOAD_WORDS> payload;
+    uint64_t reserved;
+};
+static_assert(sizeof(Slot) == 64);
+static_assert(std::atomic<uint64_t>::is_always_lock_free);
+static_assert(sizeof(TopOfBook) == PAYLOAD_WORDS * 8 && sizeof(Trade) == PAYLOAD_WORDS * 8 && sizeof(MarketTicker) == PAYLOAD_WORDS * 8);
+
+struct MarketDataRing {
+    char magic[4];
+    uint32_t version;
+    uint64_t capacity;
+    std::atomic<uint32_t> closed;
+    // Written by the publisher only, each on its own cache line so that readers polling one do
+    // not slow down writes to the other
+    alignas(64) std::atomic<uint64_t> head;
+    alignas(64) std::atomic<uint32_t> symbol_count;
+    char symbols[MarketDataPublisher::MAX_SYMBOLS][SYMBOL_LENGTH];
+    // Followed by capacity slots
+};
+static_assert(sizeof(MarketDataRing) % alignof(Slot) == 0);
+
+static Slot* slots(MarketDataRing* ring)
+{
+    return reinterpret_cast<Slot*>(ring + 1);
+}
+
+static Slot const* slots(MarketDataRing const* ring)
+{
+    return reinterpret_cast<Slot const*>(ring + 1);
+}
+
+static int64_t steady_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static size_t ring_size(size_t capacity)
+{
+    return sizeof(MarketDataRing) + capacity * sizeof(Slot);
+}
+
+std::unique_ptr<MarketDataPublisher> MarketDataPublisher::create(MarketDataOptions const& options)
+{
+    MarketDataOptions ring_options = options;
+    ring_options.capacity = std::bit_ceil(std::max<size_t>(options.capacity, 64));
+    const size_t size = ring_size(ring_options.capacity);
+
+    // A fresh object rather than the old one reused, its readers would mistake new records for theirs
+    shm_unlink(options.name.c_str());
+    const int fd = shm_open(options.name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0)
+        return nullptr;
+    if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+        ::close(fd);
+        shm_unlink(options.name.c_str());
+        return nullptr;
+    }
+    void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        shm_unlink(options.name.c_str());
+        return nullptr;
+    }
+
+    // Fresh shared memory reads as zeros, every slot is unwritten
+    auto* ring = static_cast<MarketDataRing*>(data);
+    ring->version = VERSION;
+    ring->capacity = ring_options.capacity;
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(ring->magic, MAGIC, sizeof(MAGIC));
+    return std::unique_ptr<MarketDataPublisher>(new MarketDataPublisher(ring_options, ring, size));
+}
+
+MarketDataPublisher::MarketDataPublisher(MarketDataOptions const& options, MarketDataRing* ring, size_t mapped_size)
+    : m_options(options)
+    , m_ring(ring)
+    , m_mapped_size(mapped_size)
+{
+}
+
+MarketDataPublisher::~MarketDataPublisher()
+{
+    m_ring->closed.store(1, std::memory_order_release);
+    munmap(m_ring, m_mapped_size);
+    shm_unlink(m_options.name.c_str());
+}
+
+void MarketDataPublisher::publish(SymbolId symbol, MarketDataKind kind, void const* payload, size_t size)
+{
+    uint32_t& index = m_symbol_indexes[symbol];
+    if (index == 0) {
+        const uint32_t count = m_ring->symbol_count.load(std::memory_order_relaxed);
+        if (count == MAX_SYMBOLS) {
+            m_dropped++;
+            return;
+        }
+        // Written before it is counted, readers only look at counted names
+        const std::string_view name = symbol_name(symbol);
+        std::memset(m_ring->symbols[count], 0, SYMBOL_LENGTH);
+        std::memcpy(m_ring->symbols[count], name.data(), std::min(name.size(), SYMBOL_LENGTH - 1));
+        m_ring->symbol_count.store(count + 1, std::memory_order_release);
+        index = count + 1;
+    }
+
+    std::array<uint64_t, PAYLOAD_WORDS> words {};
+    std::memcpy(words.data(), payload, size);
+
+    const uint64_t position = m_next++;
+    Slot& slot = slots(m_ring)[position & (m_ring->capacity - 1)];
+    slot.mark.store(2 * position + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.published_ns.store(steady_ns(), std::memory_order_relaxed);
+    slot.header.store(static_cast<uint64_t>(kind) | static_cast<uint64_t>(index - 1) << 8, std::memory_order_relaxed);
+    for (size_t i = 0; i < PAYLOAD_WORDS; i++)
+        slot.payload[i].store(words[i], std::memory_order_relaxed);
+    slot.mark.store(2 * position + 2, std::memory_order_release);
+    m_ring->head.store(position + 1, std::memory_order_release);
+}
+
+void MarketDataPublisher::publish(SymbolId symbol, TopOfBook const& top_of_book)
+{
+    publish(symbol, MarketDataKind::TOP_OF_BOOK, &top_of_book, sizeof(top_of_book));
+}
+
+void MarketDataPublisher::publish(SymbolId symbol, Trade const& trade)
+{
+    publish(symbol, MarketDataKind::TRADE, &trade, sizeof(trade));
+}
+
+void MarketDataPublisher::publish(SymbolId symbol, MarketTicker const& ticker)
+{
+    publish(symbol, MarketDataKind::TICKER, &ticker, sizeof(ticker));
+}
+
+void MarketDataPublisher::publish_top_of_book(MarketBooks const& books, SymbolId symbol)
+{
+    MarketBook const* book = books.book(symbol);
+    if (book == nullptr)
+        return;
+    const std::optional<BookLevel> bid = book->best_bid();
+    const std::optional<BookLevel> ask = book->best_ask();
+    const TopOfBook top { .bid = bid.has_value() ? bid->price : 0,
+        .bid_size = bid.has_value() ? bid->amount : 0,
+        .ask = ask.has_value() ? ask->price : 0,
+        .ask_size = ask.has_value() ? -ask->amount : 0 };
+    // Most updates are away from the top
+    TopOfBook& last = m_last_tops[symbol];
+    if (std::memcmp(&top, &last, sizeof(top)) == 0)
+        return;
+    last = top;
+    publish(symbol, top);
+}
+
+void MarketDataPublisher::attach(FeedHandler& feed)
+{
+    // Registered before the handlers below, the book is up to date by the time they run
+    MarketBooks& books = *m_books.emplace_back(std::make_unique<MarketBooks>(feed));
+    feed.on_book_snapshot([this, &books](BookSnapshot const& snapshot) { publish_top_of_book(books, snapshot.symbol); });
+    feed.on_book([this, &books](BookUpdate const& update) { publish_top_of_book(books, update.symbol); });
+    feed.on_trade([this](TradeUpdate const& update) { publish(update.symbol, update.trade); });
+    feed.on_ticker([this](TickerUpdate const& update) {
+        publish(update.symbol, MarketTicker { .bid = update.bid, .ask = update.ask, .last_price = update.last_price, .volume = update.volume });
+    });
+}
+
+std::unique_ptr<MarketDataSubscriber> MarketDataSubscriber::open(std::string const& name)
+{
+    const int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0)
+        return nullptr;
+    struct stat status;
+    if (fstat(fd, &status) != 0 || static_cast<size_t>(status.st_size) < sizeof(MarketDataRing)) {
+        ::close(fd);
+        return nullptr;
+    }
+    const size_t size = static_cast<size_t>(status.st_size);
+    void* data = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED)
+        return nullptr;
+
+    auto const* ring = static_cast<MarketDataRing const*>(data);
+    if (std::memcmp(ring->magic, MAGIC, sizeof(MAGIC)) != 0 || ring->version != VERSION || ring_size(ring->capacity) > size) {
+        munmap(data, size);
+        return nullptr;
+    }
+    return std::unique_ptr<MarketDataSubscriber>(new MarketDataSubscriber(ring, size));
+}
+
+MarketDataSubscriber::MarketDataSubscriber(MarketDataRing const* ring, size_t mapped_size)
+    : m_ring(ring)
+    , m_mapped_size(mapped_size)
+    , m_position(ring->head.load(std::memory_order_acquire))
+{
+}
+
+MarketDataSubscriber::~MarketDataSubscriber()
+{
+    munmap(const_cast<MarketDataRing*>(m_ring), m_mapped_size);
+}
+
+std::optional<SymbolId> MarketDataSubscriber::symbol(uint32_t index)
+{
+    // Names are interned the first time they show up, after that this is an array lookup
+    if (index >= m_symbols.size()) {
+        const uint32_t count = std::min<uint32_t>(m_ring->symbol_count.load(std::memory_order_acquire), MarketDataPublisher::MAX_SYMBOLS);
+        for (size_t i = m_symbols.size(); i < count; i++)
+            m_symbols.push_back(intern_symbol(std::string_view(m_ring->symbols[i], strnlen(m_ring->symbols[i], SYMBOL_LENGTH))));
+    }
+    if (index >= m_symbols.size())
+        return {};
+    return m_symbols[index];
+}
+
+MarketDataStatus MarketDataSubscriber::poll(MarketDataRecord& record)
+{
+    for (;;) {
+        Slot const& slot = slots(m_ring)[m_position & (m_ring->capacity - 1)];
+        const uint64_t expected = 2 * m_position + 2;
+        const uint64_t mark = slot.mark.load(std::memory_order_acquire);
+        if (mark < expected) {
+            // Not written yet, or being written
+            if (m_ring->closed.load(std::memory_order_acquire) && m_ring->head.load(std::memory_order_acquire) <= m_position)
+                return MarketDataStatus::CLOSED;
+            return MarketDataStatus::EMPTY;
+        }
+
+        if (mark == expected) {
+            const int64_t published_ns = slot.published_ns.load(std::memory_order_relaxed);
+            const uint64_t header = slot.header.load(std::memory_order_relaxed);
+            std::array<uint64_t, PAYLOAD_WORDS> words;
+            for (size_t i = 0; i < PAYLOAD_WORDS; i++)
+                words[i] = slot.payload[i].load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            // Unchanged, the copy is the record
+            if (slot.mark.load(std::memory_order_relaxed) == expected) {
+                std::optional<SymbolId> symbol = this->symbol(static_cast<uint32_t>(header >> 8));
+                m_position++;
+                // A symbol the ring's table does not have, the record is skipped
+                if (!symbol.has_value()) {
+                    m_corrupt++;
+                    continue;
+                }
+                record.kind = static_cast<MarketDataKind>(header & 0xff);
+                record.symbol = symbol.value();
+                record.sequence = m_position - 1;
+                record.published_ns = published_ns;
+                std::memcpy(&record.top_of_book, words.data(), sizeof(words));
+                return MarketDataStatus::RECORD;
+            }
+        }
+
+        // Lapped: go on from half a ring behind the writer, which leaves it half a lap before it
+        // catches up again instead of overrunning the reader on its very next record
+        const uint64_t head = m_ring->head.load(std::memory_order_acquire);
+        const uint64_t resume = std::max(m_position + 1, head - std::min(head, m_ring->capacity / 2));
+        m_lost += resume - m_position;
+        m_position = resume;
+        return MarketDataStatus::OVERRUN;
+    }
+}
+
+}
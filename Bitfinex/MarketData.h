@@ -0,0 +1,147 @@
+#pragma once
+
+#include <Bitfinex/FeedHandler.h>
+#include <Bitfinex/MarketBook.h>
+#include <Bitfinex/Symbols.h>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Fan-out of normalized market data to the processes of one host. One process keeps the feed and
+// publishes into a POSIX shared memory ring of fixed size slots, any number of processes map the
+// ring read only and follow it. Each slot is a seqlock: the writer marks it odd, writes the record
+// and marks it even with the record's position, a reader copies the record out and checks that the
+// mark did not move. The writer never waits for readers, a reader that fell a lap behind finds
+// newer marks than it expected and knows it was overrun. Integers are little endian.
+namespace Bitfinex {
+
+enum class MarketDataKind : uint8_t {
+    NONE,
+    TOP_OF_BOOK,
+    TRADE,
+    TICKER,
+};
+
+struct TopOfBook {
+    double bid;
+    double bid_size;
+    double ask;
+    double ask_size; // Positive, unlike in the book
+};
+
+struct MarketTicker {
+    double bid;
+    double ask;
+    double last_price;
+    double volume;
+};
+
+struct MarketDataRecord {
+    MarketDataKind kind;
+    // Of the reading process, names are shared through the ring
+    SymbolId symbol;
+    // Position in the ring's stream of records
+    uint64_t sequence;
+    // steady_clock (CLOCK_MONOTONIC) when published, comparable across processes of the host
+    int64_t published_ns;
+    union {
+        TopOfBook top_of_book;
+        Trade trade;
+        MarketTicker ticker;
+    };
+};
+
+// Layout of the shared memory, see MarketData.cpp
+struct MarketDataRing;
+
+struct MarketDataOptions {
+    // POSIX shared memory object, see shm_open
+    std::string name { "/trader-market-data" };
+    // Slots of 64 bytes, rounded up to a power of two
+    size_t capacity { 65536 };
+};
+
+// Single writer, call from one thread at a time (the feed's when attached)
+class MarketDataPublisher {
+public:
+    static constexpr size_t MAX_SYMBOLS = 1024;
+
+    // Replaces any ring of that name, readers of the old one see it closed. nullptr when the
+    // shared memory cannot be created.
+    static std::unique_ptr<MarketDataPublisher> create(MarketDataOptions const&);
+    MarketDataPublisher(MarketDataPublisher const&) = delete;
+    MarketDataPublisher& operator=(MarketDataPublisher const&) = delete;
+    // Marks the ring closed and removes its name, mapped readers keep what was written
+    ~MarketDataPublisher();
+
+    void publish(SymbolId, TopOfBook const&);
+    void publish(SymbolId, Trade const&);
+    void publish(SymbolId, MarketTicker const&);
+    // Publishes the feed's tickers, trades and the top of its price level books whenever it
+    // changes, call before the feed starts. The feed must outlive the publisher.
+    void attach(FeedHandler&);
+
+    [[nodiscard]] uint64_t published() const { return m_next; }
+    // Records of symbols past MAX_SYMBOLS
+    [[nodiscard]] uint64_t dropped() const { return m_dropped; }
+    [[nodiscard]] std::string const& name() const { return m_options.name; }
+
+private:
+    MarketDataPublisher(MarketDataOptions const&, MarketDataRing*, size_t mapped_size);
+    void publish(SymbolId, MarketDataKind, void const* payload, size_t size);
+    void publish_top_of_book(MarketBooks const&, SymbolId);
+
+    const MarketDataOptions m_options;
+    MarketDataRing* m_ring;
+    const size_t m_mapped_size;
+    uint64_t m_next { 0 };
+    uint64_t m_dropped { 0 };
+    // Index in the ring's symbol table plus one, 0 for symbols not published yet
+    PerSymbol<uint32_t> m_symbol_indexes;
+    PerSymbol<TopOfBook> m_last_tops;
+    std::vector<std::unique_ptr<MarketBooks>> m_books;
+};
+
+enum class MarketDataStatus : uint8_t {
+    RECORD,
+    EMPTY, // Nothing new yet
+    OVERRUN, // The writer went past unread records, reading goes on from newer ones
+    CLOSED, // Everything was read and the publisher is gone
+};
+
+// Follows a ring from the record published after it was opened. Reading takes no lock and makes
+// no system call, the mapping is read only.
+class MarketDataSubscriber {
+public:
+    // nullptr when there is no such ring
+    static std::unique_ptr<MarketDataSubscriber> open(std::string const& name);
+    MarketDataSubscriber(MarketDataSubscriber const&) = delete;
+    MarketDataSubscriber& operator=(MarketDataSubscriber const&) = delete;
+    ~MarketDataSubscriber();
+
+    MarketDataStatus poll(MarketDataRecord&);
+
+    // Records the writer overwrote before they were read
+    [[nodiscard]] uint64_t lost() const { return m_lost; }
+    // Records skipped for naming a symbol the ring does not list
+    [[nodiscard]] uint64_t corrupt() const { return m_corrupt; }
+    [[nodiscard]] uint64_t position() const { return m_position; }
+
+private:
+    MarketDataSubscriber(MarketDataRing const*, size_t mapped_size);
+    // Nothing for an index past the ring's symbol table
+    std::optional<SymbolId> symbol(uint32_t index);
+
+    MarketDataRing const* m_ring;
+    const size_t m_mapped_size;
+    uint64_t m_position;
+    uint64_t m_lost { 0 };
+    uint64_t m_corrupt { 0 };
+    // Ring symbol table index to SymbolId of this process
+    std::vector<SymbolId> m_symbols;
+};
+
+}
@@ -0,0 +1,242 @@
+#include <Bitfinex/Metrics.h>
+#include <cstdio>
+#include <format>
+#include <fstream>
+#include <nlohmann/json.hpp>
+#include <stdexcept>
+
+namespace Bitfinex {
+
+static constexpr double QUANTILES[] = { 0.5, 0.9, 0.99, 0.999 };
+
+char const* endpoint_name(Endpoint endpoint)
+{
+    static constexpr char const* names[] = { "order_submit", "order_update", "order_cancel", "order_multi", "orders", "positions", "position_increase",
+        "ticker", "pair_info", "tickers", "trades_history", "candles_history" };
+    return names[static_cast<size_t>(endpoint)];
+}
+
+char const* phase_name(Phase phase)
+{
+    static constexpr char const* names[] = { "dns", "connect", "tls", "first_byte", "transfer", "total", "parse", "sign" };
+    return names[static_cast<size_t>(phase)];
+}
+
+char const* error_kind_name(ErrorKind kind)
+{
+    static constexpr char const* names[] = { "transport", "client", "rate_limited", "server", "decode" };
+    return names[static_cast<size_t>(kind)];
+}
+
+char const* lane_name(Lane lane)
+{
+    static constexpr char const* names[] = { "cancel", "amend", "normal" };
+    return names[static_cast<size_t>(lane)];
+}
+
+LatencyHistogram ConcurrentHistogram::snapshot() const
+{
+    LatencyHistogram histogram;
+    for (size_t i = 0; i < BUCKET_COUNT; i++) {
+        const uint64_t count = m_counts[i].load(std::memory_order_relaxed);
+        if (count == 0)
+            continue;
+        const uint64_t lowest = i == 0 ? 0 : LatencyHistogram::highest_in_bucket(i - 1) + 1;
+        histogram.m_counts[i] = count;
+        histogram.m_count += count;
+        histogram.m_sum += count * (lowest + LatencyHistogram::highest_in_bucket(i)) / 2;
+    }
+    histogram.m_max = m_max.load(std::memory_order_relaxed);
+    return histogram;
+}
+
+ClientMetrics::ClientMetrics()
+{
+    if constexpr (METRICS_ENABLED)
+        m_storage = std::make_unique<Storage>();
+}
+
+static uint64_t microseconds_to_nanoseconds(int64_t microseconds)
+{
+    return static_cast<uint64_t>(std::max<int64_t>(0, microseconds)) * 1000;
+}
+
+void ClientMetrics::record_transfer_slow(Endpoint endpoint, long status_code, TransferTimings const& timings)
+{
+    EndpointMetrics& metrics = m_storage->endpoints[static_cast<size_t>(endpoint)];
+    metrics.requests.fetch_add(1, std::memory_order_relaxed);
+    if (status_code == 0) {
+        count_error(endpoint, ErrorKind::TRANSPORT);
+        return;
+    }
+    if (status_code == 429)
+        count_error(endpoint, ErrorKind::RATE_LIMITED);
+    else if (status_code >= 500)
+        count_error(endpoint, ErrorKind::SERVER);
+    else if (status_code >= 400)
+        count_error(endpoint, ErrorKind::CLIENT);
+
+    // curl reports each time from the start of the transfer, the phases are the differences
+    if (timings.connects > 0) {
+        record(endpoint, Phase::DNS, microseconds_to_nanoseconds(timings.name_lookup));
+        record(endpoint, Phase::CONNECT, microseconds_to_nanoseconds(timings.connect - timings.name_lookup));
+        if (timings.tls_handshake > 0)
+            record(endpoint, Phase::TLS, microseconds_to_nanoseconds(timings.tls_handshake - timings.connect));
+    }
+    record(endpoint, Phase::FIRST_BYTE, microseconds_to_nanoseconds(timings.first_byte - timings.request_sent));
+    record(endpoint, Phase::TRANSFER, microseconds_to_nanoseconds(timings.total - timings.first_byte));
+    record(endpoint, Phase::TOTAL, microseconds_to_nanoseconds(timings.total));
+}
+
+LatencyHistogram ClientMetrics::histogram(Endpoint endpoint, Phase phase) const
+{
+    if (!m_storage)
+        return {};
+    return m_storage->endpoints[static_cast<size_t>(endpoint)].phases[static_cast<size_t>(phase)].snapshot();
+}
+
+uint64_t ClientMetrics::requests(Endpoint endpoint) const
+{
+    if (!m_storage)
+        return 0;
+    return m_storage->endpoints[static_cast<size_t>(endpoint)].requests.load(std::memory_order_relaxed);
+}
+
+uint64_t ClientMetrics::errors(Endpoint endpoint, ErrorKind kind) const
+{
+    if (!m_storage)
+        return 0;
+    return m_storage->endpoints[static_cast<size_t>(endpoint)].errors[static_cast<size_t>(kind)].load(std::memory_order_relaxed);
+}
+
+LatencyHistogram ClientMetrics::queue_wait(Lane lane) const
+{
+    if (!m_storage)
+        return {};
+    return m_storage->lanes[static_cast<size_t>(lane)].wait.snapshot();
+}
+
+uint64_t ClientMetrics::queue_depth(Lane lane) const
+{
+    if (!m_storage)
+        return 0;
+    return m_storage->lanes[static_cast<size_t>(lane)].depth.load(std::memory_order_relaxed);
+}
+
+uint64_t ClientMetrics::superseded(Lane lane) const
+{
+    if (!m_storage)
+        return 0;
+    return m_storage->lanes[static_cast<size_t>(lane)].superseded.load(std::memory_order_relaxed);
+}
+
+static double seconds(uint64_t nanoseconds)
+{
+    return static_cast<double>(nanoseconds) / 1e9;
+}
+
+static void append_summary(std::string& out, char const* name, std::string const& labels, LatencyHistogram const& latency)
+{
+    for (const double quantile : QUANTILES)
+        out += std::format("{}{{{},quantile=\"{}\"}} {}\n", name, labels, quantile, seconds(latency.percentile(quantile * 100)));
+    out += std::format("{}_sum{{{}}} {}\n", name, labels, latency.mean() * static_cast<double>(latency.count()) / 1e9);
+    out += std::format("{}_count{{{}}} {}\n", name, labels, latency.count());
+}
+
+static nlohmann::json latency_to_json(LatencyHistogram const& latency)
+{
+    return {
+        { "count", latency.count() },
+        { "mean_ns", latency.mean() },
+        { "p50_ns", latency.percentile(50) },
+        { "p90_ns", latency.percentile(90) },
+        { "p99_ns", latency.percentile(99) },
+        { "p99_9_ns", latency.percentile(99.9) },
+        { "max_ns", latency.max() },
+    };
+}
+
+std::string ClientMetrics::to_prometheus() const
+{
+    std::string requests_text = "# HELP bitfinex_client_requests_total Requests that completed, with or without an HTTP response.\n"
+                                "# TYPE bitfinex_client_requests_total counter\n";
+    std::string errors_text = "# HELP bitfinex_client_errors_total Failed requests by kind of failure.\n"
+                              "# TYPE bitfinex_client_errors_total counter\n";
+    std::string phases_text = "# HELP bitfinex_client_phase_seconds Duration of each phase of a request.\n"
+                              "# TYPE bitfinex_client_phase_seconds summary\n";
+    for (size_t i = 0; i < ENDPOINT_COUNT; i++) {
+        const auto endpoint = static_cast<Endpoint>(i);
+        char const* name = endpoint_name(endpoint);
+        if (requests(endpoint) != 0) {
+            requests_text += std::format("bitfinex_client_requests_total{{endpoint=\"{}\"}} {}\n", name, requests(endpoint));
+            for (size_t kind = 0; kind < ERROR_KIND_COUNT; kind++)
+                errors_text += std::format("bitfinex_client_errors_total{{endpoint=\"{}\",kind=\"{}\"}} {}\n", name,
+                    error_kind_name(static_cast<ErrorKind>(kind)), errors(endpoint, static_cast<ErrorKind>(kind)));
+        }
+        for (size_t phase = 0; phase < PHASE_COUNT; phase++) {
+            const LatencyHistogram latency = histogram(endpoint, static_cast<Phase>(phase));
+            if (latency.count() == 0)
+                continue;
+            append_summary(phases_text, "bitfinex_client_phase_seconds", std::format("endpoint=\"{}\",phase=\"{}\"", name, phase_name(static_cast<Phase>(phase))),
+                latency);
+        }
+    }
+
+    std::string depth_text = "# HELP bitfinex_client_queue_depth Requests waiting for the rate limiter.\n"
+                             "# TYPE bitfinex_client_queue_depth gauge\n";
+    std::string superseded_text = "# HELP bitfinex_client_superseded_total Queued requests dropped for a later one on the same order.\n"
+                                  "# TYPE bitfinex_client_superseded_total counter\n";
+    std::string wait_text = "# HELP bitfinex_client_queue_wait_seconds Time spent waiting for the rate limiter.\n"
+                            "# TYPE bitfinex_client_queue_wait_seconds summary\n";
+    for (size_t i = 0; i < LANE_COUNT; i++) {
+        const auto lane = static_cast<Lane>(i);
+        depth_text += std::format("bitfinex_client_queue_depth{{lane=\"{}\"}} {}\n", lane_name(lane), queue_depth(lane));
+        superseded_text += std::format("bitfinex_client_superseded_total{{lane=\"{}\"}} {}\n", lane_name(lane), superseded(lane));
+        const LatencyHistogram wait = queue_wait(lane);
+        if (wait.count() != 0)
+            append_summary(wait_text, "bitfinex_client_queue_wait_seconds", std::format("lane=\"{}\"", lane_name(lane)), wait);
+    }
+    return requests_text + errors_text + phases_text + depth_text + superseded_text + wait_text;
+}
+
+nlohmann::json ClientMetrics::to_json() const
+{
+    nlohmann::json endpoints = nlohmann::json::object();
+    for (size_t i = 0; i < ENDPOINT_COUNT; i++) {
+        const auto endpoint = static_cast<Endpoint>(i);
+        nlohmann::json errors_by_kind = nlohmann::json::object();
+        for (size_t kind = 0; kind < ERROR_KIND_COUNT; kind++)
+            errors_by_kind[error_kind_name(static_cast<ErrorKind>(kind))] = errors(endpoint, static_cast<ErrorKind>(kind));
+        nlohmann::json phases = nlohmann::json::object();
+        for (size_t phase = 0; phase < PHASE_COUNT; phase++) {
+            const LatencyHistogram latency = histogram(endpoint, static_cast<Phase>(phase));
+            if (latency.count() == 0)
+                continue;
+            phases[phase_name(static_cast<Phase>(phase))] = latency_to_json(latency);
+        }
+        if (requests(endpoint) == 0 && phases.empty())
+            continue;
+        endpoints[endpoint_name(endpoint)] = { { "requests", requests(endpoint) }, { "errors", errors_by_kind }, { "phases", phases } };
+    }
+    nlohmann::json lanes = nlohmann::json::object();
+    for (size_t i = 0; i < LANE_COUNT; i++) {
+        const auto lane = static_cast<Lane>(i);
+        lanes[lane_name(lane)] = { { "depth", queue_depth(lane) }, { "superseded", superseded(lane) }, { "wait", latency_to_json(queue_wait(lane)) } };
+    }
+    return { { "endpoints", endpoints }, { "lanes", lanes } };
+}
+
+void ClientMetrics::write(std::string const& path) const
+{
+    const bool json = path.ends_with(".json");
+    const std::string temporary_path = path + ".tmp";
+    {
+        std::ofstream file(temporary_path, std::ios::trunc);
+        if (!(file << (json ? to_json().dump(2) + "\n" : to_prometheus())))
+            throw std::runtime_error("Could not write " + temporary_path);
+    }
+    if (std::rename(temporary_path.c_str(), path.c_str()) != 0)
+        throw std::runtime_error("Could not replace " + path);
+}
+
+}
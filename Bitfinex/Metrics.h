@@ -0,0 +1,196 @@
+#pragma once
+
+#include <Bitfinex/LatencyHistogram.h>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <nlohmann/json_fwd.hpp>
+#include <string>
+
+// Configure with -DBITFINEX_METRICS=OFF to compile every recording call down to nothing
+#ifndef BITFINEX_METRICS
+#define BITFINEX_METRICS 1
+#endif
+
+namespace Bitfinex {
+
+static constexpr bool METRICS_ENABLED = BITFINEX_METRICS != 0;
+
+enum class Endpoint : uint8_t {
+    SUBMIT_ORDER,
+    UPDATE_ORDER,
+    CANCEL_ORDER,
+    ORDER_MULTI,
+    ORDERS,
+    POSITIONS,
+    INCREASE_POSITION,
+    TICKER,
+    PAIR_INFO,
+    TICKERS,
+    TRADES_HISTORY,
+    CANDLES_HISTORY,
+};
+static constexpr size_t ENDPOINT_COUNT = 12;
+
+enum class Phase : uint8_t {
+    DNS, // Only recorded for transfers that opened a connection, like CONNECT and TLS
+    CONNECT,
+    TLS,
+    FIRST_BYTE, // From the request being sent to the first byte of the answer
+    TRANSFER, // From the first byte to the last
+    TOTAL,
+    PARSE,
+    SIGN,
+};
+static constexpr size_t PHASE_COUNT = 8;
+
+enum class ErrorKind : uint8_t {
+    TRANSPORT, // No HTTP response at all
+    CLIENT, // 4xx other than 429
+    RATE_LIMITED, // 429
+    SERVER, // 5xx
+    DECODE, // A 200 whose body could not be read
+};
+static constexpr size_t ERROR_KIND_COUNT = 5;
+
+// Priority lanes of the RequestScheduler, highest first
+enum class Lane : uint8_t {
+    CANCEL,
+    AMEND,
+    NORMAL, // New orders and every other request
+};
+static constexpr size_t LANE_COUNT = 3;
+
+char const* endpoint_name(Endpoint);
+char const* phase_name(Phase);
+char const* error_kind_name(ErrorKind);
+char const* lane_name(Lane);
+
+// What curl measured for one transfer, in microseconds from its start, see ConnectionPool::record_transfer
+struct TransferTimings {
+    long connects { 0 };
+    int64_t name_lookup { 0 };
+    int64_t connect { 0 };
+    int64_t tls_handshake { 0 }; // 0 for plain http
+    int64_t request_sent { 0 };
+    int64_t first_byte { 0 };
+    int64_t total { 0 };
+};
+
+// Same buckets as LatencyHistogram, recorded to with relaxed atomics from any thread. Values above
+// about a minute share the last bucket, which keeps each histogram at 16 KB.
+class ConcurrentHistogram {
+public:
+    void record(uint64_t value)
+    {
+        m_counts[std::min(LatencyHistogram::bucket_index(value), BUCKET_COUNT - 1)].fetch_add(1, std::memory_order_relaxed);
+        uint64_t max = m_max.load(std::memory_order_relaxed);
+        while (value > max && !m_max.compare_exchange_weak(max, value, std::memory_order_relaxed)) { }
+    }
+
+    // Not a consistent cut while recording goes on, each bucket is exact on its own. The sum is
+    // estimated from the middle of the buckets, saving a second atomic add per record.
+    [[nodiscard]] LatencyHistogram snapshot() const;
+
+private:
+    static constexpr size_t BUCKET_COUNT = LatencyHistogram::bucket_index((uint64_t(1) << 36) - 1) + 1;
+
+    std::array<std::atomic<uint64_t>, BUCKET_COUNT> m_counts {};
+    std::atomic<uint64_t> m_max { 0 };
+};
+
+// Monotonic nanoseconds for the phases the client times itself, 0 when metrics are compiled out
+inline uint64_t metrics_clock()
+{
+    if constexpr (METRICS_ENABLED)
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+    else
+        return 0;
+}
+
+// Per endpoint phase latencies (in nanoseconds) and request and error counters of a Client.
+// Recording is lock-free and safe from any thread.
+class ClientMetrics {
+public:
+    ClientMetrics();
+
+    void record(Endpoint endpoint, Phase phase, uint64_t nanoseconds)
+    {
+        if constexpr (METRICS_ENABLED)
+            m_storage->endpoints[static_cast<size_t>(endpoint)].phases[static_cast<size_t>(phase)].record(nanoseconds);
+    }
+
+    void count_error(Endpoint endpoint, ErrorKind kind)
+    {
+        if constexpr (METRICS_ENABLED)
+            m_storage->endpoints[static_cast<size_t>(endpoint)].errors[static_cast<size_t>(kind)].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Time between a request being made and the scheduler letting it go
+    void record_queue_wait(Lane lane, uint64_t nanoseconds)
+    {
+        if constexpr (METRICS_ENABLED)
+            m_storage->lanes[static_cast<size_t>(lane)].wait.record(nanoseconds);
+    }
+
+    void set_queue_depth(Lane lane, uint64_t depth)
+    {
+        if constexpr (METRICS_ENABLED)
+            m_storage->lanes[static_cast<size_t>(lane)].depth.store(depth, std::memory_order_relaxed);
+    }
+
+    // Dropped from the queue because a later request made it pointless
+    void count_superseded(Lane lane)
+    {
+        if constexpr (METRICS_ENABLED)
+            m_storage->lanes[static_cast<size_t>(lane)].superseded.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Counts the request and its HTTP status and records the network phases curl timed
+    void record_transfer(Endpoint endpoint, long status_code, TransferTimings const& timings)
+    {
+        if constexpr (METRICS_ENABLED)
+            record_transfer_slow(endpoint, status_code, timings);
+    }
+
+    [[nodiscard]] LatencyHistogram histogram(Endpoint, Phase) const;
+    [[nodiscard]] uint64_t requests(Endpoint) const;
+    [[nodiscard]] uint64_t errors(Endpoint, ErrorKind) const;
+    [[nodiscard]] LatencyHistogram queue_wait(Lane) const;
+    [[nodiscard]] uint64_t queue_depth(Lane) const;
+    [[nodiscard]] uint64_t superseded(Lane) const;
+
+    // Prometheus text exposition format, phases as summaries in seconds
+    [[nodiscard]] std::string to_prometheus() const;
+    [[nodiscard]] nlohmann::json to_json() const;
+    // JSON when the path ends in .json, Prometheus text otherwise. The file is replaced atomically
+    // so a collector never reads it half written.
+    void write(std::string const& path) const;
+
+private:
+    struct EndpointMetrics {
+        std::atomic<uint64_t> requests { 0 };
+        std::array<std::atomic<uint64_t>, ERROR_KIND_COUNT> errors {};
+        std::array<ConcurrentHistogram, PHASE_COUNT> phases;
+    };
+
+    struct LaneMetrics {
+        ConcurrentHistogram wait;
+        std::atomic<uint64_t> depth { 0 };
+        std::atomic<uint64_t> superseded { 0 };
+    };
+
+    struct Storage {
+        std::array<EndpointMetrics, ENDPOINT_COUNT> endpoints;
+        std::array<LaneMetrics, LANE_COUNT> lanes;
+    };
+
+    void record_transfer_slow(Endpoint, long status_code, TransferTimings const&);
+
+    // About 1 MB, only allocated when metrics are compiled in
+    std::unique_ptr<Storage> m_storage;
+};
+
+}
@@ -0,0 +1,103 @@
+#include <Bitfinex/MetricsExporter.h>
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/detached.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/redirect_error.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/use_awaitable.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <iostream>
+#include <nlohmann/json.hpp>
+
+namespace asio = boost::asio;
+namespace beast = boost::beast;
+namespace http = boost::beast::http;
+
+namespace Bitfinex {
+
+MetricsExporter::MetricsExporter(ClientMetrics const& metrics, MetricsExporterOptions options)
+    : m_metrics(metrics)
+    , m_options(std::move(options))
+    , m_acceptor(m_io)
+{
+    if (!m_options.file.empty())
+        asio::co_spawn(m_io, write_periodically(), asio::detached);
+    if (m_options.port != 0) {
+        const asio::ip::tcp::endpoint endpoint(asio::ip::make_address("127.0.0.1"), m_options.port);
+        m_acceptor.open(endpoint.protocol());
+        m_acceptor.set_option(asio::ip::tcp::acceptor::reuse_address(true));
+        m_acceptor.bind(endpoint);
+        m_acceptor.listen();
+        asio::co_spawn(m_io, serve(), asio::detached);
+    }
+    m_thread = std::thread([this] { m_io.run(); });
+}
+
+MetricsExporter::~MetricsExporter()
+{
+    m_io.stop();
+    m_thread.join();
+    if (m_options.file.empty())
+        return;
+    try {
+        m_metrics.write(m_options.file);
+    } catch (std::exception const& error) {
+        std::cerr << error.what() << std::endl;
+    }
+}
+
+asio::awaitable<void> MetricsExporter::write_periodically()
+{
+    asio::steady_timer timer(m_io);
+    while (true) {
+        try {
+            m_metrics.write(m_options.file);
+        } catch (std::exception const& error) {
+            std::cerr << error.what() << std::endl;
+        }
+        timer.expires_after(m_options.interval);
+        co_await timer.async_wait(asio::use_awaitable);
+    }
+}
+
+// One request per connection is all a scraper needs
+static asio::awaitable<void> answer(asio::ip::tcp::socket socket, ClientMetrics const& metrics)
+{
+    beast::error_code error;
+    beast::flat_buffer buffer;
+    http::request<http::string_body> request;
+    co_await http::async_read(socket, buffer, request, asio::redirect_error(asio::use_awaitable, error));
+    if (error)
+        co_return;
+
+    http::response<http::string_body> response { http::status::ok, request.version() };
+    if (request.method() != http::verb::get) {
+        response.result(http::status::method_not_allowed);
+    } else if (request.target() == "/metrics") {
+        response.set(http::field::content_type, "text/plain; version=0.0.4");
+        response.body() = metrics.to_prometheus();
+    } else if (request.target() == "/metrics.json") {
+        response.set(http::field::content_type, "application/json");
+        response.body() = metrics.to_json().dump();
+    } else {
+        response.result(http::status::not_found);
+    }
+    response.keep_alive(false);
+    response.prepare_payload();
+    co_await http::async_write(socket, response, asio::redirect_error(asio::use_awaitable, error));
+    socket.shutdown(asio::ip::tcp::socket::shutdown_send, error);
+}
+
+asio::awaitable<void> MetricsExporter::serve()
+{
+    while (true) {
+        beast::error_code error;
+        asio::ip::tcp::socket socket = co_await m_acceptor.async_accept(asio::redirect_error(asio::use_awaitable, error));
+        if (error)
+            co_return;
+        asio::co_spawn(m_io, answer(std::move(socket), m_metrics), asio::detached);
+    }
+}
+
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+// Older Boost.Asio uses std::exchange in awaitable.hpp without including <utility>
+#include <utility>
+
+#include <Bitfinex/Metrics.h>
+#include <boost/asio/awaitable.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <chrono>
+#include <string>
+#include <thread>
+
+namespace Bitfinex {
+
+struct MetricsExporterOptions {
+    // Rewritten every interval and once more on shutdown, JSON when it ends in .json. Empty for none.
+    std::string file;
+    std::chrono::milliseconds interval { 1000 };
+    // Serves GET /metrics (Prometheus text) and GET /metrics.json on 127.0.0.1, 0 for no server
+    unsigned short port { 0 };
+};
+
+// Publishes a ClientMetrics from its own thread, the metrics must outlive the exporter.
+// Throws when the port cannot be listened on.
+class MetricsExporter {
+public:
+    MetricsExporter(ClientMetrics const&, MetricsExporterOptions);
+    MetricsExporter(MetricsExporter const&) = delete;
+    MetricsExporter& operator=(MetricsExporter const&) = delete;
+    ~MetricsExporter();
+
+private:
+    boost::asio::awaitable<void> write_periodically();
+    boost::asio::awaitable<void> serve();
+
+    ClientMetrics const& m_metrics;
+    const MetricsExporterOptions m_options;
+    boost::asio::io_context m_io;
+    boost::asio::ip::tcp::acceptor m_acceptor;
+    std::thread m_thread;
+};
+
+}
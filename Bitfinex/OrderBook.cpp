@@ -8,6 +8,11 @@ void OrderBook::append_order(Bitfinex::Order const& order)
     m_order_book.push_back(order);
 }
 
+void OrderBook::reserve(size_t count)
+{
+    m_order_book.reserve(count);
+}
+
 bool OrderBook::empty() const
 {
     return m_order_book.empty();
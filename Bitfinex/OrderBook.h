@@ -1,6 +1,8 @@
 #pragma once
 
 #include <Bitfinex/Forward.h>
+#include <cstddef>
+#include <utility>
 #include <vector>
 #include <ostream>
 
@@ -11,6 +13,10 @@ public:
     OrderBook() = default;
 
     void append_order(Order const&);
+    // Constructs in place, Order is trivially copyable so this is a plain store into the array
+    template<typename... Args>
+    Order& emplace_order(Args&&... args) { return m_order_book.emplace_back(std::forward<Args>(args)...); }
+    void reserve(size_t count);
 
     [[nodiscard]] bool empty() const;
     [[nodiscard]] std::vector<Order> const& order_book() const { return m_order_book; }
@@ -0,0 +1,209 @@
+#include <Bitfinex/OrderMessages.h>
+#include <Bitfinex/Client.h>
+#include <charconv>
+#include <nlohmann/json.hpp>
+#include <stdexcept>
+
+using json = nlohmann::json;
+
+namespace Bitfinex {
+
+// The exchange wants amounts and prices as strings
+static void append_quoted(std::string& body, Decimal value)
+{
+    char text[Decimal::MAX_LENGTH];
+    body += '"';
+    body.append(text, value.write(text));
+    body += '"';
+}
+
+template<typename Integer>
+static void append_integer(std::string& body, Integer value)
+{
+    char text[20];
+    body.append(text, std::to_chars(text, text + sizeof(text), value).ptr);
+}
+
+static std::string submit_body(Order const& order, std::optional<int64_t> client_order_id)
+{
+    // Positive means buy, negative means sell
+    const Decimal amount = (order.side == OrderSide::SELL) ? -order.amount : order.amount;
+
+    std::string body;
+    body.reserve(128);
+    body += "{ ";
+    if (client_order_id.has_value()) {
+        body += R"("cid": )";
+        append_integer(body, client_order_id.value());
+        body += ", ";
+    }
+    body += R"("symbol": ")";
+    body += symbol_name(order.symbol);
+    body += R"(", "type": ")";
+    body += order_type_to_string(order.type);
+    body += R"(", "amount": )";
+    append_quoted(body, amount);
+    body += R"(, "price": )";
+    append_quoted(body, order.price);
+    body += " }";
+    return body;
+}
+
+std::string submit_order_body(Order const& order)
+{
+    return submit_body(order, {});
+}
+
+std::string submit_order_body(Order const& order, int64_t client_order_id)
+{
+    return submit_body(order, client_order_id);
+}
+
+std::string update_order_body(uint64_t order_id, Decimal price)
+{
+    std::string body;
+    body.reserve(64);
+    body += R"({ "id": )";
+    append_integer(body, order_id);
+    body += R"(, "price": )";
+    append_quoted(body, price);
+    body += " }";
+    return body;
+}
+
+std::string cancel_order_body(uint64_t order_id)
+{
+    std::string body = R"({ "id": )";
+    append_integer(body, order_id);
+    body += " }";
+    return body;
+}
+
+std::optional<uint64_t> parse_order_id(std::string_view order_id)
+{
+    uint64_t value = 0;
+    auto [end, error] = std::from_chars(order_id.data(), order_id.data() + order_id.size(), value);
+    if (error != std::errc {} || end != order_id.data() + order_id.size())
+        return {};
+    return value;
+}
+
+std::optional<Decimal> read_decimal(json const& value)
+{
+    if (value.is_null())
+        return Decimal {};
+    if (value.is_number_integer())
+        return Decimal::from_integer(value.get<int64_t>());
+    if (value.is_number())
+        return Decimal::from_double(value.get<double>());
+    if (value.is_string())
+        return Decimal::parse(value.get_ref<std::string const&>());
+    return {};
+}
+
+// Throws like the json accessors do, the order is then not the one the exchange sends
+static Decimal read_order_decimal(json const& value)
+{
+    std::optional<Decimal> decimal = read_decimal(value);
+    if (!decimal.has_value())
+        throw std::invalid_argument("Invalid decimal in order: " + value.dump());
+    return decimal.value();
+}
+
+// Fields are read with at(): a short or malformed order throws instead of reading past the end
+void read_order(json const& order, OrderResponse& order_response)
+{
+    const Decimal order_amount = read_order_decimal(order.at(6));
+    order_response.order_id = order.at(0);
+    order_response.symbol = intern_symbol(order.at(3).get_ref<std::string const&>());
+    order_response.amount = order_amount.abs();
+    order_response.side = order_amount.is_negative() ? OrderSide::SELL : OrderSide::BUY;
+    order_response.type = order.at(8);
+    order_response.price = read_order_decimal(order.at(16));
+}
+
+OrderResponse read_submit_order_response(unsigned short http_status, std::string_view body)
+{
+    OrderResponse order_response;
+    order_response.http_status = http_status;
+    if (order_response.http_status != 200)
+        return order_response;
+    json json_response = json::parse(body);
+    order_response.message = json_response.at(6);
+    if (order_response.message != "SUCCESS")
+        return order_response;
+    read_order(json_response.at(4).at(0), order_response);
+    return order_response;
+}
+
+OrderResponse read_update_order_response(unsigned short http_status, std::string_view body)
+{
+    OrderResponse order_response;
+    order_response.http_status = http_status;
+    if (order_response.http_status != 200)
+        return order_response;
+    json json_response = json::parse(body);
+    order_response.message = json_response.at(6);
+    if (order_response.message != "SUCCESS")
+        return order_response;
+    read_order(json_response.at(4), order_response);
+    return order_response;
+}
+
+OrderResponse read_cancel_order_response(unsigned short http_status, std::string_view body)
+{
+    OrderResponse order_response;
+    order_response.http_status = http_status;
+    if (order_response.http_status != 200)
+        return order_response;
+    json json_response = json::parse(body);
+    order_response.message = json_response.at(6);
+    order_response.order_id = json_response.at(4).at(0);
+    return order_response;
+}
+
+// Results of a /v2/auth/w/order/multi request are one notification per operation, in request order:
+// [MTS, "ox_multi-req", null, null, [[MTS, "on-req", null, null, ORDER, null, STATUS, TEXT], ...], null, STATUS, TEXT]
+size_t read_multi_order_response(unsigned short http_status, std::string_view body, std::span<OrderResponse> order_responses)
+{
+    for (OrderResponse& order_response : order_responses)
+        order_response.http_status = http_status;
+    if (http_status != 200)
+        return 0;
+
+    json json_response = json::parse(body);
+    if (json_response.at(6) != "SUCCESS") {
+        for (OrderResponse& order_response : order_responses)
+            order_response.message = json_response.at(6);
+        return 0;
+    }
+    json const& notifications = json_response.at(4);
+    if (!notifications.is_array())
+        throw std::invalid_argument("Invalid notifications in multi order response: " + notifications.dump());
+    size_t malformed = 0;
+    for (size_t i = 0; i < order_responses.size(); i++) {
+        OrderResponse& order_response = order_responses[i];
+        if (i >= notifications.size()) {
+            order_response.message = "MISSING";
+            continue;
+        }
+        // The other operations went through whatever this one says, a bad notification only fails its own
+        try {
+            json const& notification = notifications.at(i);
+            order_response.message = notification.at(6);
+            if (order_response.message != "SUCCESS")
+                continue;
+            // New orders come wrapped in an array like the submit endpoint, updates and cancels do not
+            json const& order = notification.at(4).at(0).is_array() ? notification.at(4).at(0) : notification.at(4);
+            read_order(order, order_response);
+        } catch (std::exception const& error) {
+            order_response = OrderResponse {};
+            order_response.http_status = http_status;
+            order_response.message = error.what();
+            malformed++;
+        }
+    }
+    return malformed;
+}
+
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <Bitfinex/Decimal.h>
+#include <Bitfinex/Forward.h>
+#include <cstdint>
+#include <nlohmann/json_fwd.hpp>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+
+namespace Bitfinex {
+
+// Order payloads, shared by the REST endpoints and the websocket order entry
+std::string submit_order_body(Order const&);
+std::string submit_order_body(Order const&, int64_t client_order_id);
+std::string update_order_body(uint64_t order_id, Decimal price);
+std::string cancel_order_body(uint64_t order_id);
+// Order ids are decimal integers, nothing when the text is anything else
+std::optional<uint64_t> parse_order_id(std::string_view order_id);
+
+// Fills the order fields from an order array of the exchange, [ID, GID, CID, SYMBOL, ...]
+void read_order(nlohmann::json const& order, OrderResponse&);
+// Amounts and prices come as numbers or strings, null reads as 0. Nothing for any other value or
+// a string that is not a decimal
+std::optional<Decimal> read_decimal(nlohmann::json const&);
+
+// Answers of the order endpoints, the body is only read when the status is 200. Throw when it is
+// not the notification the endpoint sends. Shared by the client and the replay of journals.
+OrderResponse read_submit_order_response(unsigned short http_status, std::string_view body);
+OrderResponse read_update_order_response(unsigned short http_status, std::string_view body);
+OrderResponse read_cancel_order_response(unsigned short http_status, std::string_view body);
+// One result per operation of a /v2/auth/w/order/multi request, in request order. A malformed
+// notification only fails its own operation, its message is the error. Returns the number of
+// those, throws when the body as a whole cannot be read.
+size_t read_multi_order_response(unsigned short http_status, std::string_view body, std::span<OrderResponse>);
+
+}
@@ -8,6 +8,11 @@ void Positions::append_position(Position const& position)
     m_positions.push_back(position);
 }
 
+void Positions::reserve(size_t count)
+{
+    m_positions.reserve(count);
+}
+
 bool Positions::empty() const
 {
     return m_positions.empty();
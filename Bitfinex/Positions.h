@@ -1,6 +1,8 @@
 #pragma once
 
 #include <Bitfinex/Forward.h>
+#include <cstddef>
+#include <utility>
 #include <vector>
 #include <ostream>
 
@@ -11,6 +13,10 @@ public:
     Positions() = default;
 
     void append_position(Position const&);
+    // Constructs in place
+    template<typename... Args>
+    Position& emplace_position(Args&&... args) { return m_positions.emplace_back(std::forward<Args>(args)...); }
+    void reserve(size_t count);
 
     [[nodiscard]] bool empty() const;
     [[nodiscard]] std::vector<Position> const& positions() const { return m_positions; }
@@ -0,0 +1,292 @@
+#include <Bitfinex/RawBook.h>
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+namespace Bitfinex {
+
+static uint64_t mix(uint64_t key)
+{
+    // splitmix64 finalizer, order ids are sequential and prices share their high bits
+    key ^= key >> 30;
+    key *= 0xbf58476d1ce4e5b9ull;
+    key ^= key >> 27;
+    key *= 0x94d049bb133111ebull;
+    return key ^ (key >> 31);
+}
+
+static uint64_t level_key(OrderSide side, double price)
+{
+    // Prices are positive, the sign bit tells the sides apart
+    return std::bit_cast<uint64_t>(price) | (side == SELL ? uint64_t(1) << 63 : 0);
+}
+
+RawBook::Index::Index(size_t expected)
+    : m_buckets(std::bit_ceil(std::max<size_t>(expected * 2, 16)), Bucket { .key = 0, .value = 0 })
+{
+}
+
+size_t RawBook::Index::bucket_of(uint64_t key) const
+{
+    return mix(key) & (m_buckets.size() - 1);
+}
+
+uint32_t RawBook::Index::find(uint64_t key) const
+{
+    for (size_t bucket = bucket_of(key);; bucket = (bucket + 1) & (m_buckets.size() - 1)) {
+        if (m_buckets[bucket].key == key)
+            return m_buckets[bucket].value;
+        if (m_buckets[bucket].key == 0)
+            return NONE;
+    }
+}
+
+void RawBook::Index::insert(uint64_t key, uint32_t value)
+{
+    // Kept at most half full so probe sequences stay short
+    if ((m_size + 1) * 2 > m_buckets.size())
+        grow();
+    size_t bucket = bucket_of(key);
+    while (m_buckets[bucket].key != 0 && m_buckets[bucket].key != key)
+        bucket = (bucket + 1) & (m_buckets.size() - 1);
+    if (m_buckets[bucket].key == 0)
+        m_size++;
+    m_buckets[bucket] = Bucket { .key = key, .value = value };
+}
+
+void RawBook::Index::erase(uint64_t key)
+{
+    const size_t mask = m_buckets.size() - 1;
+    size_t hole = bucket_of(key);
+    while (m_buckets[hole].key != key) {
+        if (m_buckets[hole].key == 0)
+            return;
+        hole = (hole + 1) & mask;
+    }
+    m_size--;
+    // Moves back the following entries that probed past the hole, no tombstones are left behind
+    for (size_t bucket = (hole + 1) & mask; m_buckets[bucket].key != 0; bucket = (bucket + 1) & mask) {
+        const size_t home = bucket_of(m_buckets[bucket].key);
+        if (((bucket - home) & mask) >= ((bucket - hole) & mask)) {
+            m_buckets[hole] = m_buckets[bucket];
+            hole = bucket;
+        }
+    }
+    m_buckets[hole].key = 0;
+}
+
+void RawBook::Index::clear()
+{
+    std::fill(m_buckets.begin(), m_buckets.end(), Bucket { .key = 0, .value = 0 });
+    m_size = 0;
+}
+
+void RawBook::Index::grow()
+{
+    std::vector<Bucket> buckets(m_buckets.size() * 2, Bucket { .key = 0, .value = 0 });
+    std::swap(buckets, m_buckets);
+    m_size = 0;
+    for (Bucket const& bucket : buckets) {
+        if (bucket.key != 0)
+            insert(bucket.key, bucket.value);
+    }
+}
+
+RawBook::RawBook(size_t expected_orders)
+    : m_order_index(expected_orders)
+    , m_level_index(expected_orders / 4)
+{
+    m_orders.reserve(expected_orders);
+    m_levels.reserve(expected_orders / 4);
+}
+
+size_t RawBook::memory_usage() const
+{
+    return m_orders.capacity() * sizeof(OrderNode) + m_levels.capacity() * sizeof(Level) + m_order_index.memory_usage()
+        + m_level_index.memory_usage() + (m_bids.capacity() + m_asks.capacity()) * sizeof(uint32_t);
+}
+
+void RawBook::clear()
+{
+    m_orders.clear();
+    m_free_orders = NONE;
+    m_levels.clear();
+    m_free_levels = NONE;
+    m_order_index.clear();
+    m_level_index.clear();
+    m_bids.clear();
+    m_asks.clear();
+}
+
+uint32_t RawBook::find_or_open_level(OrderSide side, double price)
+{
+    const uint64_t key = level_key(side, price);
+    uint32_t level = m_level_index.find(key);
+    if (level != NONE)
+        return level;
+
+    if (m_free_levels != NONE) {
+        level = m_free_levels;
+        m_free_levels = m_levels[level].head;
+    } else {
+        level = static_cast<uint32_t>(m_levels.size());
+        m_levels.emplace_back();
+    }
+    m_levels[level] = Level { .price = price, .amount = 0, .orders = 0, .head = NONE, .tail = NONE, .side = side };
+    m_level_index.insert(key, level);
+
+    std::vector<uint32_t>& slots = (side == BUY) ? m_bids : m_asks;
+    auto position = (side == BUY)
+        ? std::lower_bound(slots.begin(), slots.end(), price, [this](uint32_t slot, double value) { return m_levels[slot].price < value; })
+        : std::lower_bound(slots.begin(), slots.end(), price, [this](uint32_t slot, double value) { return m_levels[slot].price > value; });
+    slots.insert(position, level);
+    return level;
+}
+
+void RawBook::close_level(uint32_t level)
+{
+    Level const& closed = m_levels[level];
+    std::vector<uint32_t>& slots = (closed.side == BUY) ? m_bids : m_asks;
+    auto position = (closed.side == BUY)
+        ? std::lower_bound(slots.begin(), slots.end(), closed.price, [this](uint32_t slot, double value) { return m_levels[slot].price < value; })
+        : std::lower_bound(slots.begin(), slots.end(), closed.price, [this](uint32_t slot, double value) { return m_levels[slot].price > value; });
+    slots.erase(position);
+    m_level_index.erase(level_key(closed.side, closed.price));
+    m_levels[level].head = m_free_levels;
+    m_free_levels = level;
+}
+
+void RawBook::push_back(uint32_t node, uint32_t level)
+{
+    OrderNode& order = m_orders[node];
+    Level& queue = m_levels[level];
+    order.level = level;
+    order.previous = queue.tail;
+    order.next = NONE;
+    if (queue.tail != NONE)
+        m_orders[queue.tail].next = node;
+    else
+        queue.head = node;
+    queue.tail = node;
+    queue.orders++;
+    queue.amount += order.amount;
+}
+
+void RawBook::unlink(uint32_t node)
+{
+    OrderNode const& order = m_orders[node];
+    Level& queue = m_levels[order.level];
+    if (order.previous != NONE)
+        m_orders[order.previous].next = order.next;
+    else
+        queue.head = order.next;
+    if (order.next != NONE)
+        m_orders[order.next].previous = order.previous;
+    else
+        queue.tail = order.previous;
+    queue.orders--;
+    queue.amount -= order.amount;
+    if (queue.orders == 0)
+        close_level(order.level);
+}
+
+void RawBook::add(RawBookEntry const& entry)
+{
+    uint32_t node;
+    if (m_free_orders != NONE) {
+        node = m_free_orders;
+        m_free_orders = m_orders[node].next;
+    } else {
+        node = static_cast<uint32_t>(m_orders.size());
+        m_orders.emplace_back();
+    }
+    m_orders[node].order_id = entry.order_id;
+    m_orders[node].amount = entry.amount;
+    push_back(node, find_or_open_level(entry.amount > 0 ? BUY : SELL, entry.price));
+    m_order_index.insert(entry.order_id, node);
+}
+
+void RawBook::remove(uint32_t node)
+{
+    unlink(node);
+    m_order_index.erase(m_orders[node].order_id);
+    m_orders[node].next = m_free_orders;
+    m_free_orders = node;
+}
+
+void RawBook::apply_snapshot(std::span<RawBookEntry const> entries)
+{
+    clear();
+    for (RawBookEntry const& entry : entries)
+        apply_update(entry);
+}
+
+void RawBook::apply_update(RawBookEntry const& entry)
+{
+    const uint32_t node = m_order_index.find(entry.order_id);
+    if (entry.price == 0) {
+        if (node != NONE)
+            remove(node);
+        return;
+    }
+    if (node == NONE) {
+        add(entry);
+        return;
+    }
+
+    OrderNode& order = m_orders[node];
+    Level& queue = m_levels[order.level];
+    const OrderSide side = entry.amount > 0 ? BUY : SELL;
+    // A smaller order at the same price keeps its place, anything else goes to the back of the queue
+    if (queue.price == entry.price && queue.side == side && std::abs(entry.amount) <= std::abs(order.amount)) {
+        queue.amount += entry.amount - order.amount;
+        order.amount = entry.amount;
+        return;
+    }
+    unlink(node);
+    order.amount = entry.amount;
+    push_back(node, find_or_open_level(side, entry.price));
+}
+
+std::optional<RawBookEntry> RawBook::order(uint64_t order_id) const
+{
+    const uint32_t node = m_order_index.find(order_id);
+    if (node == NONE)
+        return {};
+    OrderNode const& order = m_orders[node];
+    return RawBookEntry { .order_id = order.order_id, .price = m_levels[order.level].price, .amount = order.amount };
+}
+
+std::optional<QueuePosition> RawBook::queue_position(uint64_t order_id) const
+{
+    const uint32_t node = m_order_index.find(order_id);
+    if (node == NONE)
+        return {};
+    Level const& queue = m_levels[m_orders[node].level];
+    QueuePosition position { .side = queue.side, .price = queue.price, .orders_ahead = 0, .amount_ahead = 0 };
+    for (uint32_t ahead = m_orders[node].previous; ahead != NONE; ahead = m_orders[ahead].previous) {
+        position.orders_ahead++;
+        position.amount_ahead += std::abs(m_orders[ahead].amount);
+    }
+    return position;
+}
+
+RawBookLevel RawBook::view(Level const& level) const
+{
+    return RawBookLevel { .price = level.price, .amount = level.amount, .orders = level.orders };
+}
+
+RawBookLevel RawBook::level(OrderSide side, size_t depth) const
+{
+    std::vector<uint32_t> const& slots = ladder(side);
+    return view(m_levels[slots[slots.size() - 1 - depth]]);
+}
+
+std::optional<RawBookLevel> RawBook::best(OrderSide side) const
+{
+    if (ladder(side).empty())
+        return {};
+    return level(side, 0);
+}
+
+}
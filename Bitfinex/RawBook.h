@@ -0,0 +1,116 @@
+#pragma once
+
+#include <Bitfinex/ENUMS.h>
+#include <Bitfinex/FeedHandler.h>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace Bitfinex {
+
+struct RawBookLevel {
+    double price;
+    double amount; // Sum of the orders' amounts, negative for asks
+    uint32_t orders;
+};
+
+// Where an order stands in its price level's queue
+struct QueuePosition {
+    OrderSide side;
+    double price;
+    uint32_t orders_ahead;
+    double amount_ahead;
+};
+
+// Order level (R0) book of one symbol. Orders live in a pool and are chained into one FIFO per
+// price level, an open-addressed index maps order ids to their pool slot. Adding, modifying and
+// removing an order are O(1), opening or emptying a price level also shifts the sorted ladder of
+// its side like MarketBook does. Pools and indexes only grow, once warmed up no update allocates.
+class RawBook {
+public:
+    explicit RawBook(size_t expected_orders = 4096);
+
+    void apply_snapshot(std::span<RawBookEntry const>);
+    // Adds, moves or removes (price 0) an order
+    void apply_update(RawBookEntry const&);
+    void clear();
+
+    [[nodiscard]] std::optional<RawBookEntry> order(uint64_t order_id) const;
+    [[nodiscard]] std::optional<QueuePosition> queue_position(uint64_t order_id) const;
+
+    // depth 0 is the best level
+    [[nodiscard]] RawBookLevel level(OrderSide, size_t depth) const;
+    [[nodiscard]] std::optional<RawBookLevel> best(OrderSide side) const;
+    [[nodiscard]] size_t depth(OrderSide side) const { return ladder(side).size(); }
+    [[nodiscard]] size_t order_count() const { return m_order_index.size(); }
+    // Bytes reserved by the pools and indexes
+    [[nodiscard]] size_t memory_usage() const;
+
+private:
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    struct OrderNode {
+        uint64_t order_id;
+        double amount;
+        uint32_t level;
+        uint32_t previous; // Towards the front of the queue
+        uint32_t next; // Towards the back of the queue, or the next free node
+    };
+
+    struct Level {
+        double price;
+        double amount;
+        uint32_t orders;
+        uint32_t head;
+        uint32_t tail;
+        OrderSide side;
+    };
+
+    // Linear probing with backward shift deletion, key 0 marks an empty bucket
+    class Index {
+    public:
+        explicit Index(size_t expected);
+
+        [[nodiscard]] uint32_t find(uint64_t key) const;
+        void insert(uint64_t key, uint32_t value);
+        void erase(uint64_t key);
+        void clear();
+        [[nodiscard]] size_t size() const { return m_size; }
+        [[nodiscard]] size_t memory_usage() const { return m_buckets.capacity() * sizeof(Bucket); }
+
+    private:
+        struct Bucket {
+            uint64_t key;
+            uint32_t value;
+        };
+
+        [[nodiscard]] size_t bucket_of(uint64_t key) const;
+        void grow();
+
+        std::vector<Bucket> m_buckets;
+        size_t m_size { 0 };
+    };
+
+    [[nodiscard]] std::vector<uint32_t> const& ladder(OrderSide side) const { return side == BUY ? m_bids : m_asks; }
+    [[nodiscard]] RawBookLevel view(Level const&) const;
+    uint32_t find_or_open_level(OrderSide, double price);
+    void close_level(uint32_t level);
+    void push_back(uint32_t node, uint32_t level);
+    void unlink(uint32_t node);
+    void add(RawBookEntry const&);
+    void remove(uint32_t node);
+
+    std::vector<OrderNode> m_orders;
+    uint32_t m_free_orders { NONE };
+    std::vector<Level> m_levels;
+    uint32_t m_free_levels { NONE };
+
+    Index m_order_index; // Order id to its node
+    Index m_level_index; // Price bits to the level, prices are never 0
+    std::vector<uint32_t> m_bids; // Level slots by ascending price, the best is last
+    std::vector<uint32_t> m_asks; // Level slots by descending price, the best is last
+};
+
+}
@@ -0,0 +1,233 @@
+#include <Bitfinex/RequestScheduler.h>
+#include <future>
+#include <vector>
+
+namespace Bitfinex {
+
+char const* rate_limit_family_name(RateLimitFamily family)
+{
+    static constexpr char const* names[] = { "order_write", "account_read", "position_write" };
+    return names[static_cast<size_t>(family)];
+}
+
+RateLimitFamily rate_limit_family(Endpoint endpoint)
+{
+    switch (endpoint) {
+    case Endpoint::ORDERS:
+    case Endpoint::POSITIONS:
+        return RateLimitFamily::ACCOUNT_READ;
+    case Endpoint::INCREASE_POSITION:
+        return RateLimitFamily::POSITION_WRITE;
+    default:
+        return RateLimitFamily::ORDER_WRITE;
+    }
+}
+
+std::optional<RateLimitFamily> rate_limit_family(std::string_view path)
+{
+    if (path.starts_with("/v2/auth/w/order/"))
+        return RateLimitFamily::ORDER_WRITE;
+    if (path.starts_with("/v2/auth/r/orders") || path == "/v2/auth/r/positions")
+        return RateLimitFamily::ACCOUNT_READ;
+    if (path == "/v2/auth/w/position/increase")
+        return RateLimitFamily::POSITION_WRITE;
+    return {};
+}
+
+RateLimit RateLimit::per_minute(unsigned limit)
+{
+    if (limit == 0)
+        return {};
+    const double burst = std::max(1u, limit / 3);
+    return RateLimit { .per_second = std::max(0.1, (limit - burst) / 60.0), .burst = burst };
+}
+
+bool RequestScheduler::Family::idle() const
+{
+    for (std::list<Request> const& lane : lanes) {
+        if (!lane.empty())
+            return false;
+    }
+    return true;
+}
+
+RequestScheduler::RequestScheduler(RequestSchedulerOptions const& options, ClientMetrics& metrics)
+    : m_coalesce_amends(options.coalesce_amends)
+    , m_metrics(metrics)
+{
+    const Clock::time_point now = Clock::now();
+    for (size_t i = 0; i < RATE_LIMIT_FAMILY_COUNT; i++) {
+        m_families[i].limit = options.limits[i];
+        m_families[i].tokens = options.limits[i].burst;
+        m_families[i].refilled = now;
+    }
+    m_thread = std::thread([this] { run(); });
+}
+
+RequestScheduler::~RequestScheduler()
+{
+    std::vector<Request> dropped;
+    {
+        std::lock_guard lock(m_mutex);
+        m_stopping = true;
+        for (Family& family : m_families) {
+            for (std::list<Request>& lane : family.lanes) {
+                for (Request& request : lane)
+                    dropped.push_back(std::move(request));
+                lane.clear();
+            }
+            family.amends.clear();
+        }
+        m_depths = {};
+        publish_depths();
+    }
+    m_wake.notify_all();
+    m_thread.join();
+    for (Request& request : dropped)
+        request.drop(SHUTDOWN);
+}
+
+void RequestScheduler::refill(Family& family, Clock::time_point now)
+{
+    const double elapsed = std::chrono::duration<double>(now - family.refilled).count();
+    family.tokens = std::min(family.limit.burst, family.tokens + elapsed * family.limit.per_second);
+    family.refilled = now;
+}
+
+void RequestScheduler::remove_amend(Family& family, std::list<Request>::iterator amend)
+{
+    if (amend->order_id != 0)
+        family.amends.erase(amend->order_id);
+    family.lanes[static_cast<size_t>(Lane::AMEND)].erase(amend);
+    m_depths[static_cast<size_t>(Lane::AMEND)]--;
+}
+
+void RequestScheduler::publish_depths()
+{
+    for (size_t i = 0; i < LANE_COUNT; i++)
+        m_metrics.set_queue_depth(static_cast<Lane>(i), m_depths[i]);
+}
+
+void RequestScheduler::submit(RateLimitFamily family_id, Lane lane, uint64_t order_id, Dispatch dispatch, Drop drop)
+{
+    Family& family = m_families[static_cast<size_t>(family_id)];
+    if (family.limit.per_second <= 0) {
+        m_metrics.record_queue_wait(lane, 0);
+        dispatch();
+        return;
+    }
+
+    const Clock::time_point now = Clock::now();
+    std::optional<Request> dropped;
+    char const* drop_reason = SUPERSEDED;
+    {
+        std::lock_guard lock(m_mutex);
+        if (m_stopping) {
+            dropped = Request { .order_id = order_id, .queued = now, .dispatch = {}, .drop = std::move(drop) };
+            drop_reason = SHUTDOWN;
+            dispatch = nullptr;
+        } else {
+            if (m_coalesce_amends && order_id != 0) {
+                auto queued_amend = family.amends.find(order_id);
+                if (queued_amend != family.amends.end() && lane == Lane::AMEND) {
+                    // Keeps the place in line of the amend it replaces
+                    Request& request = *queued_amend->second;
+                    dropped = Request { .order_id = order_id, .queued = request.queued, .dispatch = {}, .drop = std::move(request.drop) };
+                    request.dispatch = std::move(dispatch);
+                    request.drop = std::move(drop);
+                } else if (queued_amend != family.amends.end() && lane == Lane::CANCEL) {
+                    dropped = std::move(*queued_amend->second);
+                    remove_amend(family, queued_amend->second);
+                }
+            }
+
+            refill(family, now);
+            if (lane == Lane::AMEND && dropped.has_value()) {
+                // Replaced a queued amend, nothing new to schedule
+            } else if (family.idle() && family.tokens >= 1) {
+                family.tokens -= 1;
+            } else {
+                std::list<Request>& queue = family.lanes[static_cast<size_t>(lane)];
+                queue.push_back(Request { .order_id = order_id, .queued = now, .dispatch = std::move(dispatch), .drop = std::move(drop) });
+                if (lane == Lane::AMEND && order_id != 0)
+                    family.amends[order_id] = std::prev(queue.end());
+                m_depths[static_cast<size_t>(lane)]++;
+                dispatch = nullptr;
+                m_wake.notify_one();
+            }
+            publish_depths();
+        }
+    }
+
+    if (dropped.has_value()) {
+        if (drop_reason == SUPERSEDED)
+            m_metrics.count_superseded(Lane::AMEND);
+        dropped->drop(drop_reason);
+    }
+    if (dispatch) {
+        m_metrics.record_queue_wait(lane, 0);
+        dispatch();
+    }
+}
+
+bool RequestScheduler::wait_turn(RateLimitFamily family, Lane lane)
+{
+    std::promise<bool> turn;
+    std::future<bool> allowed = turn.get_future();
+    submit(family, lane, 0, [&turn] { turn.set_value(true); }, [&turn](char const*) { turn.set_value(false); });
+    return allowed.get();
+}
+
+size_t RequestScheduler::queue_depth(Lane lane) const
+{
+    std::lock_guard lock(m_mutex);
+    return m_depths[static_cast<size_t>(lane)];
+}
+
+void RequestScheduler::run()
+{
+    std::unique_lock lock(m_mutex);
+    while (!m_stopping) {
+        const Clock::time_point now = Clock::now();
+        std::optional<Clock::time_point> next_token;
+        std::vector<std::pair<Lane, Request>> ready;
+        for (Family& family : m_families) {
+            if (family.idle())
+                continue;
+            refill(family, now);
+            for (size_t lane = 0; lane < LANE_COUNT && family.tokens >= 1; lane++) {
+                std::list<Request>& queue = family.lanes[lane];
+                while (!queue.empty() && family.tokens >= 1) {
+                    family.tokens -= 1;
+                    if (lane == static_cast<size_t>(Lane::AMEND) && queue.front().order_id != 0)
+                        family.amends.erase(queue.front().order_id);
+                    ready.emplace_back(static_cast<Lane>(lane), std::move(queue.front()));
+                    queue.pop_front();
+                    m_depths[lane]--;
+                }
+            }
+            if (!family.idle()) {
+                const auto wait = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>((1 - family.tokens) / family.limit.per_second));
+                next_token = std::min(next_token.value_or(Clock::time_point::max()), now + wait);
+            }
+        }
+
+        if (!ready.empty()) {
+            publish_depths();
+            lock.unlock();
+            const Clock::time_point dispatched = Clock::now();
+            for (auto& [lane, request] : ready) {
+                m_metrics.record_queue_wait(lane, static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(dispatched - request.queued).count()));
+                request.dispatch();
+            }
+            lock.lock();
+            continue;
+        }
+        if (next_token.has_value())
+            m_wake.wait_until(lock, next_token.value());
+        else
+            m_wake.wait(lock);
+    }
+}
+
+}
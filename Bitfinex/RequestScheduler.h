@@ -0,0 +1,121 @@
+#pragma once
+
+#include <Bitfinex/Metrics.h>
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+
+namespace Bitfinex {
+
+// Authenticated endpoints that share a request limit
+enum class RateLimitFamily : uint8_t {
+    ORDER_WRITE, // Submit, update, cancel and multi
+    ACCOUNT_READ, // Orders and positions
+    POSITION_WRITE,
+};
+static constexpr size_t RATE_LIMIT_FAMILY_COUNT = 3;
+
+char const* rate_limit_family_name(RateLimitFamily);
+RateLimitFamily rate_limit_family(Endpoint);
+// Family of an authenticated REST path, for servers that enforce the limits
+std::optional<RateLimitFamily> rate_limit_family(std::string_view path);
+
+// Requests per minute and API key the exchange allows in each family
+static constexpr std::array<unsigned, RATE_LIMIT_FAMILY_COUNT> EXCHANGE_RATE_LIMITS { 90, 90, 90 };
+
+// Token bucket, no limit at all when per_second is 0
+struct RateLimit {
+    double per_second { 0 };
+    double burst { 1 };
+
+    // A bucket that can never let more than limit requests through in a minute: a third of
+    // them can go at once, the rest are spread over the minute
+    static RateLimit per_minute(unsigned limit);
+};
+
+struct RequestSchedulerOptions {
+    std::array<RateLimit, RATE_LIMIT_FAMILY_COUNT> limits {
+        RateLimit::per_minute(EXCHANGE_RATE_LIMITS[0]),
+        RateLimit::per_minute(EXCHANGE_RATE_LIMITS[1]),
+        RateLimit::per_minute(EXCHANGE_RATE_LIMITS[2]),
+    };
+    // A queued amend is replaced by a later amend of the same order and dropped by its cancel
+    bool coalesce_amends { true };
+
+    static RequestSchedulerOptions unlimited() { return { .limits = {}, .coalesce_amends = true }; }
+};
+
+// Holds requests back until their family's bucket has a token. Queued requests go out by lane,
+// cancels first, then amends, then everything else, in arrival order within a lane.
+// A request that finds its family idle and a token available runs on the calling thread,
+// queued ones run on the scheduler's thread. Releasing requests in order does not keep their
+// nonces in order at the exchange, concurrent sends over pooled connections can overtake each
+// other: Client takes care of it by signing and sending one request at a time.
+class RequestScheduler {
+public:
+    // Starts the request, called once the rate limit allows it
+    using Dispatch = std::function<void()>;
+    // Called instead of Dispatch when the request will never go, with the reason
+    using Drop = std::function<void(char const* reason)>;
+
+    static constexpr char SUPERSEDED[] = "SUPERSEDED";
+    static constexpr char SHUTDOWN[] = "SHUTDOWN";
+
+    RequestScheduler(RequestSchedulerOptions const&, ClientMetrics&);
+    RequestScheduler(RequestScheduler const&) = delete;
+    RequestScheduler& operator=(RequestScheduler const&) = delete;
+    // Drops whatever is still queued
+    ~RequestScheduler();
+
+    // order_id identifies the order of an amend or cancel for coalescing, 0 for none
+    void submit(RateLimitFamily, Lane, uint64_t order_id, Dispatch, Drop);
+    // Blocks until the request may go, false when the scheduler shut down first
+    bool wait_turn(RateLimitFamily, Lane);
+
+    [[nodiscard]] size_t queue_depth(Lane) const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Request {
+        uint64_t order_id;
+        Clock::time_point queued;
+        Dispatch dispatch;
+        Drop drop;
+    };
+
+    struct Family {
+        RateLimit limit;
+        double tokens;
+        Clock::time_point refilled;
+        std::array<std::list<Request>, LANE_COUNT> lanes;
+        // Queued amends by order id
+        std::unordered_map<uint64_t, std::list<Request>::iterator> amends;
+
+        [[nodiscard]] bool idle() const;
+    };
+
+    static void refill(Family&, Clock::time_point now);
+    void run();
+    void remove_amend(Family&, std::list<Request>::iterator);
+    void publish_depths();
+
+    const bool m_coalesce_amends;
+    ClientMetrics& m_metrics;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::array<Family, RATE_LIMIT_FAMILY_COUNT> m_families;
+    std::array<size_t, LANE_COUNT> m_depths {};
+    bool m_stopping { false };
+    std::thread m_thread;
+};
+
+}
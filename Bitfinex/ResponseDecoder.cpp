@@ -0,0 +1,490 @@
+#include <Bitfinex/ResponseDecoder.h>
+#include <charconv>
+
+namespace Bitfinex {
+
+// Deeper than any response, keeps a hostile body from growing the stack without bound
+static constexpr size_t MAX_DEPTH = 32;
+
+std::string_view decode_error_to_string(DecodeError error)
+{
+    switch (error) {
+    case DecodeError::NONE: return "none";
+    case DecodeError::MALFORMED: return "malformed JSON";
+    case DecodeError::UNEXPECTED_SHAPE: return "not an array of records";
+    case DecodeError::INVALID_FIELD: return "invalid field";
+    case DecodeError::TRUNCATED: return "truncated body";
+    }
+    return "unknown";
+}
+
+static bool is_whitespace(char c)
+{
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+static bool is_number_character(char c)
+{
+    return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+}
+
+static void append_utf8(std::string& out, uint32_t code_point)
+{
+    if (code_point < 0x80) {
+        out += static_cast<char>(code_point);
+    } else if (code_point < 0x800) {
+        out += static_cast<char>(0xc0 | (code_point >> 6));
+        out += static_cast<char>(0x80 | (code_point & 0x3f));
+    } else if (code_point < 0x10000) {
+        out += static_cast<char>(0xe0 | (code_point >> 12));
+        out += static_cast<char>(0x80 | ((code_point >> 6) & 0x3f));
+        out += static_cast<char>(0x80 | (code_point & 0x3f));
+    } else {
+        out += static_cast<char>(0xf0 | (code_point >> 18));
+        out += static_cast<char>(0x80 | ((code_point >> 12) & 0x3f));
+        out += static_cast<char>(0x80 | ((code_point >> 6) & 0x3f));
+        out += static_cast<char>(0x80 | (code_point & 0x3f));
+    }
+}
+
+static bool read_hex4(std::string_view text, size_t position, uint32_t& value)
+{
+    if (position + 4 > text.size())
+        return false;
+    auto [end, error] = std::from_chars(text.data() + position, text.data() + position + 4, value, 16);
+    return error == std::errc() && end == text.data() + position + 4;
+}
+
+// Content of a string with its escapes, without the quotes
+static bool unescape(std::string_view raw, std::string& out)
+{
+    out.clear();
+    for (size_t i = 0; i < raw.size(); i++) {
+        if (raw[i] != '\\') {
+            out += raw[i];
+            continue;
+        }
+        if (++i == raw.size())
+            return false;
+        switch (raw[i]) {
+        case '"': out += '"'; break;
+        case '\\': out += '\\'; break;
+        case '/': out += '/'; break;
+        case 'b': out += '\b'; break;
+        case 'f': out += '\f'; break;
+        case 'n': out += '\n'; break;
+        case 'r': out += '\r'; break;
+        case 't': out += '\t'; break;
+        case 'u': {
+            uint32_t code_point = 0;
+            if (!read_hex4(raw, i + 1, code_point))
+                return false;
+            i += 4;
+            // Characters outside the basic plane come as a surrogate pair
+            if (code_point >= 0xd800 && code_point < 0xdc00) {
+                uint32_t low = 0;
+                if (i + 2 >= raw.size() || raw[i + 1] != '\\' || raw[i + 2] != 'u' || !read_hex4(raw, i + 3, low) || low < 0xdc00 || low >= 0xe000)
+                    return false;
+                i += 6;
+                code_point = 0x10000 + ((code_point - 0xd800) << 10) + (low - 0xdc00);
+            }
+            append_utf8(out, code_point);
+            break;
+        }
+        default:
+            return false;
+        }
+    }
+    return true;
+}
+
+RecordStream::RecordStream()
+{
+    m_stack.reserve(MAX_DEPTH);
+}
+
+void RecordStream::reset()
+{
+    m_stack.clear();
+    m_token.clear();
+    m_state = State::VALUE;
+    m_key = false;
+    m_escaped = false;
+    m_error = DecodeError::NONE;
+}
+
+bool RecordStream::fail(DecodeError error)
+{
+    if (m_error == DecodeError::NONE)
+        m_error = error;
+    return false;
+}
+
+bool RecordStream::feed(std::string_view chunk)
+{
+    size_t position = 0;
+    while (position < chunk.size() && m_error == DecodeError::NONE) {
+        switch (m_state) {
+        case State::STRING:
+            position = read_string(chunk, position);
+            break;
+        case State::NUMBER:
+            position = read_number(chunk, position);
+            break;
+        case State::LITERAL:
+            position = read_literal(chunk, position);
+            break;
+        default: {
+            const char c = chunk[position];
+            if (is_whitespace(c)) {
+                position++;
+                continue;
+            }
+            const bool expects_value = m_state == State::VALUE || m_state == State::FIRST_VALUE;
+            // Numbers and literals are read from their first character
+            if (expects_value && (c == '-' || (c >= '0' && c <= '9'))) {
+                m_state = State::NUMBER;
+                m_token.clear();
+            } else if (expects_value && (c == 't' || c == 'f' || c == 'n')) {
+                m_state = State::LITERAL;
+                m_token.clear();
+            } else {
+                structural(c);
+                position++;
+            }
+        }
+        }
+    }
+    return m_error == DecodeError::NONE;
+}
+
+DecodeError RecordStream::finish()
+{
+    if (m_error == DecodeError::NONE && m_state != State::DONE)
+        fail(DecodeError::TRUNCATED);
+    return m_error;
+}
+
+bool RecordStream::structural(char c)
+{
+    switch (m_state) {
+    case State::FIRST_VALUE:
+    case State::VALUE:
+        if (c == '[')
+            return open(false);
+        if (c == '{')
+            return open(true);
+        if (c == '"') {
+            m_state = State::STRING;
+            m_key = false;
+            m_token.clear();
+            return true;
+        }
+        if (c == ']' && m_state == State::FIRST_VALUE)
+            return close(false);
+        return fail(DecodeError::MALFORMED);
+    case State::FIRST_KEY:
+    case State::KEY:
+        if (c == '"') {
+            m_state = State::STRING;
+            m_key = true;
+            m_token.clear();
+            return true;
+        }
+        if (c == '}' && m_state == State::FIRST_KEY)
+            return close(true);
+        return fail(DecodeError::MALFORMED);
+    case State::COLON:
+        if (c != ':')
+            return fail(DecodeError::MALFORMED);
+        m_state = State::VALUE;
+        return true;
+    case State::AFTER_VALUE:
+        if (c == ']' || c == '}')
+            return close(c == '}');
+        if (c != ',')
+            return fail(DecodeError::MALFORMED);
+        if (m_stack.back().object) {
+            m_state = State::KEY;
+        } else {
+            m_stack.back().index++;
+            m_state = State::VALUE;
+        }
+        return true;
+    default:
+        return fail(DecodeError::MALFORMED);
+    }
+}
+
+bool RecordStream::open(bool object)
+{
+    // The body is an array, and so is each record in it
+    if (m_stack.size() <= 1 && object)
+        return fail(DecodeError::UNEXPECTED_SHAPE);
+    if (m_stack.size() == MAX_DEPTH)
+        return fail(DecodeError::MALFORMED);
+    if (m_stack.size() == 1)
+        begin_record();
+    m_stack.push_back(Container { .index = 0, .object = object });
+    m_state = object ? State::FIRST_KEY : State::FIRST_VALUE;
+    return true;
+}
+
+bool RecordStream::close(bool object)
+{
+    if (m_stack.empty() || m_stack.back().object != object)
+        return fail(DecodeError::MALFORMED);
+    m_stack.pop_back();
+    m_state = m_stack.empty() ? State::DONE : State::AFTER_VALUE;
+    if (m_stack.size() == 1 && !end_record())
+        return fail(DecodeError::INVALID_FIELD);
+    return true;
+}
+
+bool RecordStream::scalar(JsonToken::Kind kind, std::string_view text)
+{
+    m_state = State::AFTER_VALUE;
+    if (m_stack.size() <= 1)
+        return fail(DecodeError::UNEXPECTED_SHAPE);
+    if (m_stack.size() > 2 || m_stack.back().object)
+        return true;
+    if (!field(m_stack.back().index, JsonToken { .kind = kind, .text = text }))
+        return fail(DecodeError::INVALID_FIELD);
+    return true;
+}
+
+size_t RecordStream::read_string(std::string_view chunk, size_t start)
+{
+    size_t position = start;
+    bool escapes = !m_token.empty() && m_token.find('\\') != std::string::npos;
+    for (; position < chunk.size(); position++) {
+        const char c = chunk[position];
+        if (m_escaped) {
+            m_escaped = false;
+        } else if (c == '\\') {
+            m_escaped = true;
+            escapes = true;
+        } else if (c == '"') {
+            break;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            fail(DecodeError::MALFORMED);
+            return chunk.size();
+        }
+    }
+    if (position == chunk.size()) {
+        m_token.append(chunk.substr(start));
+        return position;
+    }
+
+    std::string_view text = chunk.substr(start, position - start);
+    if (!m_token.empty()) {
+        m_token.append(text);
+        text = m_token;
+    }
+    if (escapes) {
+        if (!unescape(text, m_unescaped)) {
+            fail(DecodeError::MALFORMED);
+            return chunk.size();
+        }
+        text = m_unescaped;
+    }
+    if (m_key)
+        m_state = State::COLON;
+    else
+        scalar(JsonToken::STRING, text);
+    return position + 1;
+}
+
+size_t RecordStream::read_number(std::string_view chunk, size_t start)
+{
+    size_t position = start;
+    while (position < chunk.size() && is_number_character(chunk[position]))
+        position++;
+    if (position == chunk.size()) {
+        m_token.append(chunk.substr(start));
+        return position;
+    }
+
+    std::string_view text = chunk.substr(start, position - start);
+    if (!m_token.empty()) {
+        m_token.append(text);
+        text = m_token;
+    }
+    scalar(JsonToken::NUMBER, text);
+    return position;
+}
+
+size_t RecordStream::read_literal(std::string_view chunk, size_t start)
+{
+    size_t position = start;
+    while (position < chunk.size() && chunk[position] >= 'a' && chunk[position] <= 'z')
+        position++;
+    if (position == chunk.size()) {
+        m_token.append(chunk.substr(start));
+        return position;
+    }
+
+    std::string_view text = chunk.substr(start, position - start);
+    if (!m_token.empty()) {
+        m_token.append(text);
+        text = m_token;
+    }
+    if (text != "true" && text != "false" && text != "null") {
+        fail(DecodeError::MALFORMED);
+        return chunk.size();
+    }
+    scalar(JsonToken::LITERAL, text);
+    return position;
+}
+
+bool read_double(JsonToken const& token, double& value)
+{
+    if (token.kind == JsonToken::LITERAL) {
+        value = 0;
+        return token.text == "null";
+    }
+    if (token.kind != JsonToken::NUMBER)
+        return false;
+    auto [end, error] = std::from_chars(token.text.data(), token.text.data() + token.text.size(), value);
+    return error == std::errc() && end == token.text.data() + token.text.size();
+}
+
+// Amounts and prices come as numbers, sometimes as strings, and null reads as zero
+static bool read_decimal(JsonToken const& token, Decimal& value)
+{
+    if (token.kind == JsonToken::LITERAL) {
+        value = Decimal {};
+        return token.text == "null";
+    }
+    std::optional<Decimal> decimal = Decimal::parse(token.text);
+    if (!decimal.has_value())
+        return false;
+    value = decimal.value();
+    return true;
+}
+
+static bool read_symbol(JsonToken const& token, SymbolId& symbol)
+{
+    if (token.kind != JsonToken::STRING || token.text.empty())
+        return false;
+    symbol = intern_symbol(token.text);
+    return true;
+}
+
+// [ID, GID, CID, SYMBOL, MTS_CREATE, MTS_UPDATE, AMOUNT, AMOUNT_ORIG, ORDER_TYPE, TYPE_PREV, MTS_TIF, _, FLAGS,
+//  ORDER_STATUS, _, _, PRICE, ...]
+static constexpr FieldReader<Order> ORDER_FIELDS[] = {
+    { 0, [](JsonToken const& token, Order& order) { return read_integer(token, order.order_id); } },
+    { 3, [](JsonToken const& token, Order& order) { return read_symbol(token, order.symbol); } },
+    { 4, [](JsonToken const& token, Order& order) { return read_integer(token, order.creation_time_ms); } },
+    { 6, [](JsonToken const& token, Order& order) {
+        Decimal amount;
+        if (!read_decimal(token, amount))
+            return false;
+        // Positive means buy, negative means sell
+        order.side = amount.is_negative() ? OrderSide::SELL : OrderSide::BUY;
+        order.amount = amount.abs();
+        return true;
+    } },
+    { 8, [](JsonToken const& token, Order& order) {
+        if (token.kind != JsonToken::STRING)
+            return false;
+        std::optional<OrderType> type = find_order_type(std::string(token.text));
+        if (!type.has_value())
+            return false;
+        order.type = type.value();
+        return true;
+    } },
+    { 16, [](JsonToken const& token, Order& order) { return read_decimal(token, order.price); } },
+};
+
+// [SYMBOL, STATUS, AMOUNT, BASE_PRICE, ...]
+static constexpr FieldReader<Position> POSITION_FIELDS[] = {
+    { 0, [](JsonToken const& token, Position& position) { return read_symbol(token, position.symbol); } },
+    { 1, [](JsonToken const& token, Position& position) {
+        if (token.kind != JsonToken::STRING)
+            return false;
+        position.status = position_status_from_string(std::string(token.text));
+        return true;
+    } },
+    { 2, [](JsonToken const& token, Position& position) { return read_decimal(token, position.amount); } },
+    { 3, [](JsonToken const& token, Position& position) { return read_decimal(token, position.base_price); } },
+};
+
+// [ID, MTS, AMOUNT, PRICE]
+static constexpr FieldReader<HistoryTrade> TRADE_FIELDS[] = {
+    { 0, [](JsonToken const& token, HistoryTrade& trade) { return read_integer(token, trade.trade_id); } },
+    { 1, [](JsonToken const& token, HistoryTrade& trade) { return read_integer(token, trade.timestamp_ms); } },
+    { 2, [](JsonToken const& token, HistoryTrade& trade) { return read_decimal(token, trade.amount); } },
+    { 3, [](JsonToken const& token, HistoryTrade& trade) { return read_decimal(token, trade.price); } },
+};
+
+// [MTS, OPEN, CLOSE, HIGH, LOW, VOLUME]
+static constexpr FieldReader<Candle> CANDLE_FIELDS[] = {
+    { 0, [](JsonToken const& token, Candle& candle) { return read_integer(token, candle.timestamp_ms); } },
+    { 1, [](JsonToken const& token, Candle& candle) { return read_decimal(token, candle.open); } },
+    { 2, [](JsonToken const& token, Candle& candle) { return read_decimal(token, candle.close); } },
+    { 3, [](JsonToken const& token, Candle& candle) { return read_decimal(token, candle.high); } },
+    { 4, [](JsonToken const& token, Candle& candle) { return read_decimal(token, candle.low); } },
+    { 5, [](JsonToken const& token, Candle& candle) { return read_decimal(token, candle.volume); } },
+};
+
+std::span<FieldReader<Order> const> order_fields()
+{
+    return ORDER_FIELDS;
+}
+
+std::span<FieldReader<Position> const> position_fields()
+{
+    return POSITION_FIELDS;
+}
+
+std::span<FieldReader<HistoryTrade> const> trade_fields()
+{
+    return TRADE_FIELDS;
+}
+
+std::span<FieldReader<Candle> const> candle_fields()
+{
+    return CANDLE_FIELDS;
+}
+
+RecordDecoder<Order> orders_decoder(OrderBook& order_book)
+{
+    return RecordDecoder<Order>(order_fields(), [&order_book](Order const& order) { order_book.emplace_order(order); });
+}
+
+RecordDecoder<Position> positions_decoder(Positions& positions)
+{
+    return RecordDecoder<Position>(position_fields(), [&positions](Position const& position) { positions.emplace_position(position); });
+}
+
+DecodeError decode_orders(std::string_view body, OrderBook& order_book)
+{
+    RecordDecoder<Order> decoder = orders_decoder(order_book);
+    decoder.feed(body);
+    return decoder.finish();
+}
+
+DecodeError decode_positions(std::string_view body, Positions& positions)
+{
+    RecordDecoder<Position> decoder = positions_decoder(positions);
+    decoder.feed(body);
+    return decoder.finish();
+}
+
+DecodeError decode_trades(std::string_view body, std::vector<HistoryTrade>& trades)
+{
+    RecordDecoder<HistoryTrade> decoder(trade_fields(), [&trades](HistoryTrade const& trade) { trades.push_back(trade); });
+    decoder.feed(body);
+    return decoder.finish();
+}
+
+DecodeError decode_candles(std::string_view body, std::vector<Candle>& candles)
+{
+    RecordDecoder<Candle> decoder(candle_fields(), [&candles](Candle const& candle) { candles.push_back(candle); });
+    decoder.feed(body);
+    return decoder.finish();
+}
+
+}
@@ -0,0 +1,184 @@
+#pragma once
+
+#include <Bitfinex/Client.h>
+#include <Bitfinex/HistoryStore.h>
+#include <Bitfinex/OrderBook.h>
+#include <Bitfinex/Positions.h>
+#include <cassert>
+#include <charconv>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Bitfinex {
+
+enum class DecodeError : uint8_t {
+    NONE,
+    MALFORMED, // Not JSON
+    UNEXPECTED_SHAPE, // JSON, but not an array of record arrays, e.g. an error message
+    INVALID_FIELD, // A field of the wrong type or out of range
+    TRUNCATED, // The body ended inside a value
+};
+
+std::string_view decode_error_to_string(DecodeError);
+
+// One scalar of the body: the number as written, the unescaped string, or true, false and null
+struct JsonToken {
+    enum Kind : uint8_t {
+        NUMBER,
+        STRING,
+        LITERAL,
+    };
+    Kind kind;
+    std::string_view text;
+};
+
+// Incremental reader of bodies shaped as an array of records, each record an array of fields, which
+// is how the REST endpoints answer. Chunks can be cut anywhere, only a token crossing a chunk
+// boundary is copied. Errors are kept rather than thrown, feed() ignores input after the first one.
+class RecordStream {
+public:
+    RecordStream();
+    virtual ~RecordStream() = default;
+
+    // Ready for the next body, keeps the buffers it has grown
+    void reset();
+    // False once the body is known to be invalid, see error()
+    bool feed(std::string_view chunk);
+    // End of the body, NONE when it was a complete array of records
+    DecodeError finish();
+    [[nodiscard]] DecodeError error() const { return m_error; }
+
+protected:
+    virtual void begin_record() = 0;
+    // Scalars directly inside a record, nested arrays and objects are skipped
+    virtual bool field(uint32_t index, JsonToken const&) = 0;
+    // False when the record is incomplete, the body is then invalid
+    virtual bool end_record() = 0;
+
+private:
+    enum class State : uint8_t {
+        FIRST_VALUE, // After '[', a value or ']'
+        VALUE,
+        FIRST_KEY, // After '{', a key or '}'
+        KEY,
+        COLON,
+        AFTER_VALUE, // ',' or the end of the container
+        STRING,
+        NUMBER,
+        LITERAL,
+        DONE,
+    };
+    struct Container {
+        uint32_t index;
+        bool object;
+    };
+
+    size_t read_string(std::string_view chunk, size_t start);
+    size_t read_number(std::string_view chunk, size_t start);
+    size_t read_literal(std::string_view chunk, size_t start);
+    bool structural(char);
+    bool open(bool object);
+    bool close(bool object);
+    bool scalar(JsonToken::Kind, std::string_view text);
+    bool fail(DecodeError);
+
+    std::vector<Container> m_stack;
+    // The token crossing a chunk boundary, and the unescaped text of strings with escapes
+    std::string m_token;
+    std::string m_unescaped;
+    State m_state { State::VALUE };
+    bool m_key { false };
+    bool m_escaped { false };
+    DecodeError m_error { DecodeError::NONE };
+};
+
+// Integers are written as plain JSON numbers, false for anything else or a value out of range
+template<typename Integer>
+bool read_integer(JsonToken const& token, Integer& value)
+{
+    if (token.kind != JsonToken::NUMBER)
+        return false;
+    auto [end, error] = std::from_chars(token.text.data(), token.text.data() + token.text.size(), value);
+    return error == std::errc() && end == token.text.data() + token.text.size();
+}
+
+// Numbers, null reads as 0
+bool read_double(JsonToken const&, double&);
+
+// Reads the fields of a record by position and writes them into the record
+template<typename Record>
+struct FieldReader {
+    uint32_t index;
+    bool (*read)(JsonToken const&, Record&);
+};
+
+// Fills one Record per record array following a layout, fields outside the layout are skipped.
+// Every field of the layout is required: a record missing one fails with INVALID_FIELD.
+template<typename Record>
+class RecordDecoder final : public RecordStream {
+public:
+    using Sink = std::function<void(Record const&)>;
+
+    static constexpr size_t MAX_LAYOUT_SIZE = 64;
+
+    RecordDecoder(std::span<FieldReader<Record> const> layout, Sink sink)
+        : m_layout(layout)
+        , m_sink(std::move(sink))
+        , m_complete(layout.size() == MAX_LAYOUT_SIZE ? ~uint64_t { 0 } : (uint64_t { 1 } << layout.size()) - 1)
+    {
+        assert(layout.size() <= MAX_LAYOUT_SIZE);
+    }
+
+private:
+    void begin_record() override
+    {
+        m_record = Record {};
+        m_seen = 0;
+    }
+    bool field(uint32_t index, JsonToken const& token) override
+    {
+        for (size_t i = 0; i < m_layout.size(); i++) {
+            if (m_layout[i].index == index) {
+                m_seen |= uint64_t { 1 } << i;
+                return m_layout[i].read(token, m_record);
+            }
+        }
+        return true;
+    }
+    bool end_record() override
+    {
+        if (m_seen != m_complete)
+            return false;
+        m_sink(m_record);
+        return true;
+    }
+
+    std::span<FieldReader<Record> const> m_layout;
+    Sink m_sink;
+    Record m_record {};
+    // One bit per field of the layout
+    uint64_t m_complete;
+    uint64_t m_seen { 0 };
+};
+
+// Field layouts of /v2/auth/r/orders, /v2/auth/r/positions, /v2/trades/SYMBOL/hist and /v2/candles/KEY/hist
+std::span<FieldReader<Order> const> order_fields();
+std::span<FieldReader<Position> const> position_fields();
+std::span<FieldReader<HistoryTrade> const> trade_fields();
+std::span<FieldReader<Candle> const> candle_fields();
+
+RecordDecoder<Order> orders_decoder(OrderBook&);
+RecordDecoder<Position> positions_decoder(Positions&);
+
+// Decodes a whole body at once
+DecodeError decode_orders(std::string_view body, OrderBook&);
+DecodeError decode_positions(std::string_view body, Positions&);
+// Appends the records of the page
+DecodeError decode_trades(std::string_view body, std::vector<HistoryTrade>&);
+DecodeError decode_candles(std::string_view body, std::vector<Candle>&);
+
+}
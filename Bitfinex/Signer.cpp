@@ -0,0 +1,103 @@
+#include <Bitfinex/Signer.h>
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <openssl/core_names.h>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace Bitfinex {
+
+Signer::Signer(std::string_view key)
+{
+    m_mac = EVP_MAC_fetch(nullptr, "HMAC", nullptr);
+    if (!m_mac)
+        throw std::runtime_error("Failed to fetch HMAC");
+
+    m_keyed_context = EVP_MAC_CTX_new(m_mac);
+    if (!m_keyed_context) {
+        EVP_MAC_free(m_mac);
+        throw std::runtime_error("Failed to create MAC context");
+    }
+
+    OSSL_PARAM params[] = {
+        OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST, const_cast<char*>("SHA384"), 0),
+        OSSL_PARAM_construct_end()
+    };
+
+    if (EVP_MAC_init(m_keyed_context, reinterpret_cast<unsigned char const*>(key.data()), key.size(), params) != 1) {
+        EVP_MAC_CTX_free(m_keyed_context);
+        EVP_MAC_free(m_mac);
+        throw std::runtime_error("Failed to initialize MAC");
+    }
+}
+
+Signer::~Signer()
+{
+    EVP_MAC_CTX_free(m_keyed_context);
+    EVP_MAC_free(m_mac);
+}
+
+Signature Signer::sign(std::initializer_list<std::string_view> parts) const
+{
+    static constexpr char hex_digits[] = "0123456789abcdef";
+
+    EVP_MAC_CTX* ctx = EVP_MAC_CTX_dup(m_keyed_context);
+    if (!ctx)
+        throw std::runtime_error("Failed to duplicate MAC context");
+
+    for (std::string_view part : parts) {
+        if (EVP_MAC_update(ctx, reinterpret_cast<unsigned char const*>(part.data()), part.size()) != 1) {
+            EVP_MAC_CTX_free(ctx);
+            throw std::runtime_error("Failed to update MAC");
+        }
+    }
+
+    unsigned char hash[EVP_MAX_MD_SIZE];
+    size_t hash_len;
+    if (EVP_MAC_final(ctx, hash, &hash_len, sizeof(hash)) != 1) {
+        EVP_MAC_CTX_free(ctx);
+        throw std::runtime_error("Failed to finalize MAC");
+    }
+    EVP_MAC_CTX_free(ctx);
+
+    Signature signature;
+    for (size_t i = 0; i < hash_len; i++) {
+        signature.m_hex[i * 2] = hex_digits[hash[i] >> 4];
+        signature.m_hex[i * 2 + 1] = hex_digits[hash[i] & 0x0f];
+    }
+    signature.m_length = hash_len * 2;
+    return signature;
+}
+
+// Never destroyed, like the keys it is used with they live as long as the process
+static std::atomic<uint64_t>& last_nonce_of(std::string const& api_key)
+{
+    static std::mutex mutex;
+    static auto* last_nonces = new std::unordered_map<std::string, std::unique_ptr<std::atomic<uint64_t>>>;
+    std::lock_guard lock(mutex);
+    std::unique_ptr<std::atomic<uint64_t>>& last_nonce = (*last_nonces)[api_key];
+    if (!last_nonce)
+        last_nonce = std::make_unique<std::atomic<uint64_t>>(0);
+    return *last_nonce;
+}
+
+NonceSource::NonceSource(std::string const& api_key)
+    : m_last_nonce(last_nonce_of(api_key))
+{
+}
+
+uint64_t NonceSource::next()
+{
+    auto now = std::chrono::system_clock::now();
+    auto now_us = static_cast<uint64_t>(std::chrono::time_point_cast<std::chrono::microseconds>(now).time_since_epoch().count());
+    uint64_t last_nonce = m_last_nonce.load(std::memory_order_relaxed);
+    uint64_t nonce;
+    do {
+        nonce = std::max(now_us, last_nonce + 1);
+    } while (!m_last_nonce.compare_exchange_weak(last_nonce, nonce, std::memory_order_relaxed));
+    return nonce;
+}
+
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <initializer_list>
+#include <openssl/evp.h>
+#include <string>
+#include <string_view>
+
+namespace Bitfinex {
+
+// Lower case hex encoded HMAC-SHA384, kept on the stack
+class Signature {
+public:
+    [[nodiscard]] std::string_view view() const { return { m_hex.data(), m_length }; }
+    [[nodiscard]] std::string str() const { return std::string(view()); }
+
+private:
+    friend class Signer;
+
+    std::array<char, EVP_MAX_MD_SIZE * 2> m_hex;
+    size_t m_length { 0 };
+};
+
+// Keys the HMAC-SHA384 context once, every signature starts from a copy of that context
+// so no algorithm fetch, key schedule or parameter parsing happens per request.
+// sign() only reads the prepared context and can be called from several threads.
+class Signer {
+public:
+    explicit Signer(std::string_view key);
+    Signer(Signer const&) = delete;
+    Signer& operator=(Signer const&) = delete;
+    ~Signer();
+
+    // Signs the concatenation of the parts without building it
+    [[nodiscard]] Signature sign(std::initializer_list<std::string_view> parts) const;
+
+private:
+    EVP_MAC* m_mac { nullptr };
+    EVP_MAC_CTX* m_keyed_context { nullptr };
+};
+
+// Nonces of one API key: microseconds, bumped past the last one handed out. The exchange rejects a
+// nonce that is not above the last one it saw for the key, over REST and websocket alike, so every
+// source of the same key in the process shares the last nonce.
+class NonceSource {
+public:
+    explicit NonceSource(std::string const& api_key);
+
+    [[nodiscard]] uint64_t next();
+
+private:
+    std::atomic<uint64_t>& m_last_nonce;
+};
+
+}
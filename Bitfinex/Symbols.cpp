@@ -0,0 +1,188 @@
+#include <Bitfinex/Symbols.h>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <nlohmann/json.hpp>
+#include <stdexcept>
+#include <string>
+
+using json = nlohmann::json;
+
+namespace Bitfinex {
+
+namespace {
+
+constexpr size_t CHUNK_SIZE = 256;
+// Kept at most half full, probes stay short and always end on an empty bucket
+constexpr size_t BUCKET_COUNT = MAX_SYMBOLS * 2;
+
+struct Entry {
+    std::string name;
+    std::atomic<uint8_t> price_precision { DEFAULT_PRICE_PRECISION };
+    // Units of the Decimal limits
+    std::atomic<int64_t> minimum_order_size { 0 };
+    std::atomic<int64_t> maximum_order_size { 0 };
+};
+
+// Entries are allocated in chunks that never move, readers reach them through atomics that
+// are published after the entry is written
+class SymbolTable {
+public:
+    std::optional<SymbolId> find(std::string_view symbol) const
+    {
+        for (size_t bucket = hash(symbol);; bucket = (bucket + 1) % BUCKET_COUNT) {
+            const uint32_t value = m_buckets[bucket].load(std::memory_order_acquire);
+            if (value == 0)
+                return {};
+            if (entry(value - 1).name == symbol)
+                return value - 1;
+        }
+    }
+
+    SymbolId intern(std::string_view symbol)
+    {
+        if (auto id = find(symbol))
+            return id.value();
+
+        std::lock_guard lock(m_mutex);
+        size_t bucket = hash(symbol);
+        for (;; bucket = (bucket + 1) % BUCKET_COUNT) {
+            const uint32_t value = m_buckets[bucket].load(std::memory_order_relaxed);
+            if (value == 0)
+                break;
+            // Registered by another thread since the lookup above
+            if (entry(value - 1).name == symbol)
+                return value - 1;
+        }
+        const auto id = static_cast<SymbolId>(m_count.load(std::memory_order_relaxed));
+        if (id == MAX_SYMBOLS)
+            throw std::runtime_error("symbol table is full");
+        if (id % CHUNK_SIZE == 0)
+            m_chunks[id / CHUNK_SIZE].store(new Entry[CHUNK_SIZE], std::memory_order_release);
+        entry(id).name = symbol;
+        // Counted before it can be found, an id returned by find() is always below count()
+        m_count.store(id + 1, std::memory_order_release);
+        m_buckets[bucket].store(id + 1, std::memory_order_release);
+        return id;
+    }
+
+    Entry& entry(SymbolId id) const
+    {
+        return m_chunks[id / CHUNK_SIZE].load(std::memory_order_acquire)[id % CHUNK_SIZE];
+    }
+
+    size_t count() const { return m_count.load(std::memory_order_acquire); }
+
+private:
+    static size_t hash(std::string_view symbol)
+    {
+        // FNV-1a
+        uint64_t hash = 14695981039346656037ull;
+        for (char c : symbol)
+            hash = (hash ^ static_cast<uint8_t>(c)) * 1099511628211ull;
+        return hash % BUCKET_COUNT;
+    }
+
+    std::mutex m_mutex;
+    std::atomic<size_t> m_count { 0 };
+    std::array<std::atomic<Entry*>, MAX_SYMBOLS / CHUNK_SIZE> m_chunks {};
+    std::array<std::atomic<uint32_t>, BUCKET_COUNT> m_buckets {}; // id + 1, 0 when empty
+};
+
+// Never destroyed, symbol names handed out stay valid during static destruction
+SymbolTable& symbol_table()
+{
+    static SymbolTable* table = new SymbolTable;
+    return *table;
+}
+
+std::atomic<bool> symbol_list_loaded { false };
+
+// Null reads as 0, unknown. Nothing for text that is not a decimal or a value of another type.
+std::optional<Decimal> read_size(json const& size)
+{
+    if (size.is_null())
+        return Decimal {};
+    if (size.is_number_integer())
+        return Decimal::from_integer(size.get<int64_t>());
+    if (size.is_number())
+        return Decimal::from_double(size.get<double>());
+    if (!size.is_string())
+        return {};
+    return Decimal::parse(size.get_ref<std::string const&>());
+}
+
+}
+
+SymbolId intern_symbol(std::string_view symbol)
+{
+    return symbol_table().intern(symbol);
+}
+
+std::optional<SymbolId> find_symbol(std::string_view symbol)
+{
+    return symbol_table().find(symbol);
+}
+
+std::string_view symbol_name(SymbolId id)
+{
+    if (id >= symbol_table().count())
+        return {};
+    return symbol_table().entry(id).name;
+}
+
+SymbolInfo symbol_info(SymbolId id)
+{
+    if (id >= symbol_table().count())
+        return SymbolInfo { .name = {}, .price_precision = DEFAULT_PRICE_PRECISION, .minimum_order_size = {}, .maximum_order_size = {} };
+    Entry const& entry = symbol_table().entry(id);
+    return SymbolInfo { .name = entry.name, .price_precision = entry.price_precision.load(std::memory_order_relaxed),
+        .minimum_order_size = Decimal::from_units(entry.minimum_order_size.load(std::memory_order_relaxed)),
+        .maximum_order_size = Decimal::from_units(entry.maximum_order_size.load(std::memory_order_relaxed)) };
+}
+
+void set_symbol_limits(SymbolId id, uint8_t price_precision, Decimal minimum_order_size, Decimal maximum_order_size)
+{
+    if (id >= symbol_table().count())
+        return;
+    Entry& entry = symbol_table().entry(id);
+    entry.price_precision.store(price_precision, std::memory_order_relaxed);
+    entry.minimum_order_size.store(minimum_order_size.units(), std::memory_order_relaxed);
+    entry.maximum_order_size.store(maximum_order_size.units(), std::memory_order_relaxed);
+}
+
+size_t symbol_count()
+{
+    return symbol_table().count();
+}
+
+std::optional<size_t> load_symbols(std::string_view pair_info)
+{
+    // [[[PAIR, [?, ?, ?, MIN_ORDER_SIZE, MAX_ORDER_SIZE, ...]], ...]]
+    json response = json::parse(pair_info.begin(), pair_info.end(), nullptr, false);
+    if (response.is_discarded() || !response.is_array() || response.empty() || !response[0].is_array())
+        return {};
+    size_t loaded = 0;
+    for (json const& pair : response[0]) {
+        if (!pair.is_array() || pair.size() < 2 || !pair[0].is_string() || !pair[1].is_array() || pair[1].size() < 5)
+            continue;
+        const std::optional<Decimal> minimum_order_size = read_size(pair[1][3]);
+        const std::optional<Decimal> maximum_order_size = read_size(pair[1][4]);
+        if (!minimum_order_size.has_value() || !maximum_order_size.has_value())
+            return {};
+        // Pairs are listed without the trading prefix
+        const SymbolId id = intern_symbol("t" + pair[0].get<std::string>());
+        set_symbol_limits(id, DEFAULT_PRICE_PRECISION, minimum_order_size.value(), maximum_order_size.value());
+        loaded++;
+    }
+    symbol_list_loaded.store(true, std::memory_order_release);
+    return loaded;
+}
+
+bool symbols_loaded()
+{
+    return symbol_list_loaded.load(std::memory_order_acquire);
+}
+
+}
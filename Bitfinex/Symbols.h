@@ -0,0 +1,70 @@
+#pragma once
+
+#include <Bitfinex/Decimal.h>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+namespace Bitfinex {
+
+// Dense id of a trading pair such as tTESTBTC:TESTUSD, ids are never reused within a process
+using SymbolId = uint32_t;
+
+struct SymbolInfo {
+    std::string_view name;
+    // The exchange rounds prices to this many significant digits
+    uint8_t price_precision;
+    // 0 when unknown
+    Decimal minimum_order_size;
+    Decimal maximum_order_size;
+};
+
+// Process wide symbol table. Lookups and reads never lock, registering a new symbol takes a
+// mutex. Up to MAX_SYMBOLS symbols can be registered.
+static constexpr size_t MAX_SYMBOLS = 16384;
+static constexpr uint8_t DEFAULT_PRICE_PRECISION = 5;
+
+// Returns the id of symbol, registering it on first use
+SymbolId intern_symbol(std::string_view symbol);
+[[nodiscard]] std::optional<SymbolId> find_symbol(std::string_view symbol);
+// The interned text, valid for the lifetime of the process. An id that was never handed out reads
+// as an empty name with default limits, and setting its limits does nothing.
+[[nodiscard]] std::string_view symbol_name(SymbolId);
+[[nodiscard]] SymbolInfo symbol_info(SymbolId);
+void set_symbol_limits(SymbolId, uint8_t price_precision, Decimal minimum_order_size, Decimal maximum_order_size);
+// Number of registered symbols, ids are below this
+[[nodiscard]] size_t symbol_count();
+
+// Registers the trading pairs of a /v2/conf/pub:info:pair response along with their order size
+// limits, returns the number of pairs read or nothing if the text is not such a response or has
+// an order size that is not a decimal
+std::optional<size_t> load_symbols(std::string_view pair_info);
+// Whether a symbol list was loaded with load_symbols, the pairs of the exchange are then all known
+[[nodiscard]] bool symbols_loaded();
+
+// Price rounded to the symbol's precision, see SymbolInfo::price_precision
+inline Decimal round_price(SymbolId symbol, Decimal price)
+{
+    return price.round_to_significant(symbol_info(symbol).price_precision);
+}
+
+// Flat array indexed by SymbolId, for per-symbol state owned by a single thread
+template<typename T>
+class PerSymbol {
+public:
+    T& operator[](SymbolId id)
+    {
+        if (id >= m_values.size())
+            m_values.resize(id + 1);
+        return m_values[id];
+    }
+    [[nodiscard]] T const* find(SymbolId id) const { return (id < m_values.size()) ? &m_values[id] : nullptr; }
+    [[nodiscard]] size_t size() const { return m_values.size(); }
+
+private:
+    std::vector<T> m_values;
+};
+
+}
@@ -0,0 +1,147 @@
+#include <Bitfinex/TickerService.h>
+#include <cpr/session.h>
+#include <limits>
+
+namespace Bitfinex {
+
+// Records whose symbol is not a trading pair, dropped by the sink
+static constexpr SymbolId SKIPPED_SYMBOL = std::numeric_limits<SymbolId>::max();
+
+// [SYMBOL, BID, BID_SIZE, ASK, ASK_SIZE, DAILY_CHANGE, DAILY_CHANGE_RELATIVE, LAST_PRICE, VOLUME, HIGH, LOW]
+static constexpr FieldReader<TickerUpdate> TICKER_FIELDS[] = {
+    { 0, [](JsonToken const& token, TickerUpdate& ticker) {
+        if (token.kind != JsonToken::STRING || token.text.empty())
+            return false;
+        // Funding tickers (fUSD) have a different layout
+        ticker.symbol = (token.text[0] == 't') ? intern_symbol(token.text) : SKIPPED_SYMBOL;
+        return true;
+    } },
+    { 1, [](JsonToken const& token, TickerUpdate& ticker) { return read_double(token, ticker.bid); } },
+    { 2, [](JsonToken const& token, TickerUpdate& ticker) { return read_double(token, ticker.bid_size); } },
+    { 3, [](JsonToken const& token, TickerUpdate& ticker) { return read_double(token, ticker.ask); } },
+    { 4, [](JsonToken const& token, TickerUpdate& ticker) { return read_double(token, ticker.ask_size); } },
+    { 5, [](JsonToken const& token, TickerUpdate& ticker) { return read_double(token, ticker.daily_change); } },
+    { 6, [](JsonToken const& token, TickerUpdate& ticker) { return read_double(token, ticker.daily_change_relative); } },
+    { 7, [](JsonToken const& token, TickerUpdate& ticker) { return read_double(token, ticker.last_price); } },
+    { 8, [](JsonToken const& token, TickerUpdate& ticker) { return read_double(token, ticker.volume); } },
+    { 9, [](JsonToken const& token, TickerUpdate& ticker) { return read_double(token, ticker.high); } },
+    { 10, [](JsonToken const& token, TickerUpdate& ticker) { return read_double(token, ticker.low); } },
+};
+
+DecodeError decode_tickers(std::string_view body, std::vector<TickerUpdate>& tickers)
+{
+    RecordDecoder<TickerUpdate> decoder(TICKER_FIELDS, [&tickers](TickerUpdate const& ticker) {
+        if (ticker.symbol != SKIPPED_SYMBOL)
+            tickers.push_back(ticker);
+    });
+    decoder.feed(body);
+    return decoder.finish();
+}
+
+TickerService::TickerService(TickerServiceOptions options)
+    : m_options(std::move(options))
+{
+}
+
+std::optional<std::vector<TickerUpdate>> TickerService::fetch(std::span<SymbolId const> symbols)
+{
+    std::string url = m_options.public_endpoint + "/v2/tickers?symbols=";
+    if (symbols.empty())
+        url += "ALL";
+    for (SymbolId symbol : symbols) {
+        if (url.back() != '=')
+            url += ',';
+        url += symbol_name(symbol);
+    }
+
+    ConnectionPool::Lease session = m_connection_pool.acquire(m_options.public_endpoint);
+    session->SetUrl(cpr::Url { url });
+    cpr::Response response = session->Get();
+    m_metrics.record_transfer(Endpoint::TICKERS, response.status_code, m_connection_pool.record_transfer(*session));
+    if (response.status_code != 200)
+        return {};
+
+    const uint64_t parse_start = metrics_clock();
+    std::vector<TickerUpdate> tickers;
+    tickers.reserve(symbols.empty() ? symbol_count() : symbols.size());
+    const DecodeError error = decode_tickers(response.text, tickers);
+    m_metrics.record(Endpoint::TICKERS, Phase::PARSE, metrics_clock() - parse_start);
+    if (error != DecodeError::NONE) {
+        m_metrics.count_error(Endpoint::TICKERS, ErrorKind::DECODE);
+        return {};
+    }
+
+    const auto now = std::chrono::steady_clock::now();
+    std::lock_guard lock(m_mutex);
+    for (TickerUpdate const& ticker : tickers) {
+        Entry& entry = m_entries[ticker.symbol];
+        // A live update is never older than a fetched one
+        if (entry.live && is_fresh(entry, now))
+            continue;
+        entry = Entry { .ticker = ticker, .updated = now, .present = true, .live = false };
+    }
+    return tickers;
+}
+
+std::vector<std::optional<TickerUpdate>> TickerService::get(std::span<SymbolId const> symbols)
+{
+    std::vector<std::optional<TickerUpdate>> tickers(symbols.size());
+    // Positions in symbols of the tickers to fetch
+    std::vector<size_t> missing;
+    {
+        const auto now = std::chrono::steady_clock::now();
+        std::lock_guard lock(m_mutex);
+        for (size_t i = 0; i < symbols.size(); i++) {
+            Entry const* entry = m_entries.find(symbols[i]);
+            if (entry && is_fresh(*entry, now))
+                tickers[i] = entry->ticker;
+            else
+                missing.push_back(i);
+        }
+    }
+    if (missing.empty())
+        return tickers;
+
+    std::vector<SymbolId> to_fetch;
+    to_fetch.reserve(missing.size());
+    for (size_t i : missing)
+        to_fetch.push_back(symbols[i]);
+    if (!fetch(to_fetch).has_value())
+        return tickers;
+
+    const auto now = std::chrono::steady_clock::now();
+    std::lock_guard lock(m_mutex);
+    for (size_t i : missing) {
+        Entry const* entry = m_entries.find(symbols[i]);
+        if (entry && is_fresh(*entry, now))
+            tickers[i] = entry->ticker;
+    }
+    return tickers;
+}
+
+std::optional<TickerUpdate> TickerService::get(SymbolId symbol)
+{
+    return get(std::span<SymbolId const>(&symbol, 1)).front();
+}
+
+void TickerService::attach(FeedHandler& feed)
+{
+    m_feed = &feed;
+    feed.on_ticker([this](TickerUpdate const& ticker) {
+        const auto now = std::chrono::steady_clock::now();
+        std::lock_guard lock(m_mutex);
+        m_entries[ticker.symbol] = Entry { .ticker = ticker, .updated = now, .present = true, .live = true };
+    });
+}
+
+bool TickerService::is_fresh(Entry const& entry, std::chrono::steady_clock::time_point now) const
+{
+    if (!entry.present)
+        return false;
+    // Live entries stop updating while the feed reconnects, they age like fetched ones meanwhile
+    if (entry.live && m_feed && m_feed->connected())
+        return true;
+    return now - entry.updated < m_options.ttl;
+}
+
+}
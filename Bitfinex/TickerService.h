@@ -0,0 +1,70 @@
+#pragma once
+
+#include <Bitfinex/Client.h>
+#include <Bitfinex/ConnectionPool.h>
+#include <Bitfinex/FeedHandler.h>
+#include <Bitfinex/Metrics.h>
+#include <Bitfinex/ResponseDecoder.h>
+#include <Bitfinex/Symbols.h>
+#include <chrono>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Bitfinex {
+
+struct TickerServiceOptions {
+    std::string public_endpoint { Client::DEFAULT_PUBLIC_ENDPOINT };
+    // How long a fetched ticker is served from the cache before it is fetched again
+    std::chrono::milliseconds ttl { 2000 };
+};
+
+// Decodes a /v2/tickers response, funding tickers are skipped without being interned
+DecodeError decode_tickers(std::string_view body, std::vector<TickerUpdate>&);
+
+// Tickers of many symbols fetched in a single /v2/tickers request and kept in a flat per symbol
+// cache. Symbols a feed is subscribed to are served from its updates instead, for as long as the
+// feed is connected. Safe to use from several threads.
+class TickerService {
+public:
+    explicit TickerService(TickerServiceOptions options = {});
+    TickerService(TickerService const&) = delete;
+    TickerService& operator=(TickerService const&) = delete;
+
+    // Fetches the symbols in one request, every trading pair when symbols is empty, and caches them.
+    // Nothing when the request failed, symbols the exchange does not list are left out.
+    std::optional<std::vector<TickerUpdate>> fetch(std::span<SymbolId const> symbols = {});
+    // One entry per symbol: the cached ticker when it is live or younger than the TTL, the others
+    // are fetched together in one request. Empty for symbols that could not be had.
+    std::vector<std::optional<TickerUpdate>> get(std::span<SymbolId const> symbols);
+    std::optional<TickerUpdate> get(SymbolId);
+
+    // Keeps the tickers of the feed's subscriptions live, call before the feed starts. The feed
+    // must outlive the service.
+    void attach(FeedHandler&);
+
+    [[nodiscard]] ClientMetrics const& metrics() const { return m_metrics; }
+
+private:
+    struct Entry {
+        TickerUpdate ticker {};
+        std::chrono::steady_clock::time_point updated {};
+        bool present { false };
+        // Written by the feed rather than fetched
+        bool live { false };
+    };
+
+    bool is_fresh(Entry const&, std::chrono::steady_clock::time_point now) const;
+
+    TickerServiceOptions const m_options;
+    ClientMetrics m_metrics;
+    ConnectionPool m_connection_pool;
+    FeedHandler const* m_feed { nullptr };
+    mutable std::mutex m_mutex;
+    PerSymbol<Entry> m_entries;
+};
+
+}
@@ -0,0 +1,409 @@
+#include <Bitfinex/TradingSession.h>
+#include <Bitfinex/OrderMessages.h>
+#include <algorithm>
+#include <format>
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
+namespace Bitfinex {
+
+static constexpr int INFO_RECONNECT = 20051;
+
+static char const* operation_name(uint8_t kind)
+{
+    static constexpr char const* names[] = { "on", "ou", "oc" };
+    return names[kind];
+}
+
+static int64_t microseconds_since_epoch()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+TradingSession::TradingSession(Config const& config, TradingSessionOptions options)
+    : m_config(config)
+    , m_signer(m_config.SECRET_KEY)
+    , m_nonces(m_config.API_KEY)
+    , m_request_timeout(options.request_timeout)
+    , m_socket(WebSocketOptions { .url = options.url, .idle_timeout = options.idle_timeout },
+          WebSocket::Handlers {
+              .on_open = [this] { handle_open(); },
+              .on_message = [this](std::string_view message) { handle_message(message); },
+              .on_close = [this] { handle_close(); },
+              // Requests would otherwise wait for as long as the endpoint cannot be reached
+              .on_connect_failed = [this] { handle_close(); },
+          })
+    // Client order ids only have to be unique within a day, start from the time of day so
+    // that a restarted process does not reuse the ids of the previous one
+    , m_last_client_order_id(microseconds_since_epoch() % (int64_t(86400) * 1000 * 1000))
+{
+}
+
+TradingSession::~TradingSession()
+{
+    stop();
+}
+
+void TradingSession::start()
+{
+    m_socket.start();
+}
+
+void TradingSession::stop()
+{
+    m_socket.stop();
+    handle_close();
+}
+
+bool TradingSession::wait_until_authenticated(std::chrono::milliseconds timeout)
+{
+    std::unique_lock lock(m_mutex);
+    m_authenticated_changed.wait_for(lock, timeout, [this] { return authenticated() || m_auth_error.has_value(); });
+    return authenticated();
+}
+
+std::string TradingSession::auth_error() const
+{
+    std::lock_guard lock(m_mutex);
+    return m_auth_error.value_or("");
+}
+
+int64_t TradingSession::next_client_order_id()
+{
+    return m_last_client_order_id.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+std::string TradingSession::auth_message()
+{
+    // From the same source as the client's nonces, a REST burst may have taken them past the clock
+    const std::string nonce = std::to_string(m_nonces.next());
+    const Signature signature = m_signer.sign({ "AUTH", nonce });
+    return std::format(R"({{ "event": "auth", "apiKey": "{}", "authSig": "{}", "authNonce": {}, "authPayload": "AUTH{}", "filter": ["trading"] }})",
+        m_config.API_KEY, signature.view(), nonce, nonce);
+}
+
+void TradingSession::send_operations(std::vector<Operation> operations, std::vector<OrderCallback> callbacks)
+{
+    std::string message;
+    if (operations.size() == 1) {
+        message = std::format(R"([0, "{}", null, {}])", operation_name(operations[0].kind), operations[0].body);
+    } else {
+        message = R"([0, "ox_multi", null, [)";
+        for (size_t i = 0; i < operations.size(); i++) {
+            if (i != 0)
+                message += ", ";
+            message += std::format(R"(["{}", {}])", operation_name(operations[i].kind), operations[i].body);
+        }
+        message += "]]";
+    }
+
+    OrderResponse refused {};
+    {
+        std::lock_guard lock(m_mutex);
+        if (m_auth_error.has_value()) {
+            refused.message = m_auth_error.value();
+        } else {
+            for (size_t i = 0; i < operations.size(); i++)
+                m_pending[operations[i].kind].push_back(PendingRequest { .key = operations[i].key, .callback = std::move(callbacks[i]) });
+            if (authenticated())
+                m_socket.send(std::move(message));
+            else
+                m_unsent.push_back(std::move(message));
+            return;
+        }
+    }
+    // Queued, they would wait for an authentication that is not coming
+    for (OrderCallback& callback : callbacks)
+        callback(refused);
+}
+
+static OrderResponse called_from_callback()
+{
+    OrderResponse order_response;
+    order_response.http_status = 0;
+    order_response.message = Client::CALLED_FROM_CALLBACK;
+    return order_response;
+}
+
+static OrderResponse wait_for_answer(std::future<OrderResponse>& future, std::chrono::steady_clock::time_point deadline)
+{
+    if (future.wait_until(deadline) == std::future_status::ready)
+        return future.get();
+    // The request stays pending, nobody reads its answer when it comes
+    OrderResponse order_response;
+    order_response.http_status = 0;
+    order_response.message = TradingSession::TIMEOUT;
+    return order_response;
+}
+
+std::vector<OrderResponse> TradingSession::send_operations_and_wait(std::vector<Operation> operations)
+{
+    if (m_socket.on_socket_thread())
+        return std::vector<OrderResponse>(operations.size(), called_from_callback());
+    std::vector<std::future<OrderResponse>> futures;
+    futures.reserve(operations.size());
+    for (size_t begin = 0; begin < operations.size(); begin += MAX_OPERATIONS_PER_MULTI_REQUEST) {
+        const size_t end = std::min(begin + MAX_OPERATIONS_PER_MULTI_REQUEST, operations.size());
+        std::vector<Operation> chunk;
+        std::vector<OrderCallback> callbacks;
+        for (size_t i = begin; i < end; i++) {
+            auto promise = std::make_shared<std::promise<OrderResponse>>();
+            futures.push_back(promise->get_future());
+            callbacks.push_back([promise](OrderResponse order_response) { promise->set_value(std::move(order_response)); });
+            chunk.push_back(std::move(operations[i]));
+        }
+        send_operations(std::move(chunk), std::move(callbacks));
+    }
+
+    const auto deadline = std::chrono::steady_clock::now() + m_request_timeout;
+    std::vector<OrderResponse> order_responses;
+    order_responses.reserve(futures.size());
+    for (auto& future : futures)
+        order_responses.push_back(wait_for_answer(future, deadline));
+    return order_responses;
+}
+
+void TradingSession::submit_order_async(Order const& order, OrderCallback callback)
+{
+    const int64_t client_order_id = next_client_order_id();
+    std::vector<Operation> operations;
+    operations.push_back(Operation { .kind = NEW, .key = client_order_id, .body = submit_order_body(order, client_order_id) });
+    std::vector<OrderCallback> callbacks;
+    callbacks.push_back(std::move(callback));
+    send_operations(std::move(operations), std::move(callbacks));
+}
+
+void TradingSession::update_order_async(uint64_t order_id, Decimal price, OrderCallback callback)
+{
+    std::vector<Operation> operations;
+    operations.push_back(Operation { .kind = UPDATE, .key = static_cast<int64_t>(order_id), .body = update_order_body(order_id, price) });
+    std::vector<OrderCallback> callbacks;
+    callbacks.push_back(std::move(callback));
+    send_operations(std::move(operations), std::move(callbacks));
+}
+
+void TradingSession::cancel_order_async(uint64_t order_id, OrderCallback callback)
+{
+    std::vector<Operation> operations;
+    operations.push_back(Operation { .kind = CANCEL, .key = static_cast<int64_t>(order_id), .body = cancel_order_body(order_id) });
+    std::vector<OrderCallback> callbacks;
+    callbacks.push_back(std::move(callback));
+    send_operations(std::move(operations), std::move(callbacks));
+}
+
+std::future<OrderResponse> TradingSession::submit_order_async(Order const& order)
+{
+    auto promise = std::make_shared<std::promise<OrderResponse>>();
+    std::future<OrderResponse> future = promise->get_future();
+    submit_order_async(order, [promise](OrderResponse order_response) { promise->set_value(std::move(order_response)); });
+    return future;
+}
+
+std::future<OrderResponse> TradingSession::update_order_async(uint64_t order_id, Decimal price)
+{
+    auto promise = std::make_shared<std::promise<OrderResponse>>();
+    std::future<OrderResponse> future = promise->get_future();
+    update_order_async(order_id, price, [promise](OrderResponse order_response) { promise->set_value(std::move(order_response)); });
+    return future;
+}
+
+std::future<OrderResponse> TradingSession::cancel_order_async(uint64_t order_id)
+{
+    auto promise = std::make_shared<std::promise<OrderResponse>>();
+    std::future<OrderResponse> future = promise->get_future();
+    cancel_order_async(order_id, [promise](OrderResponse order_response) { promise->set_value(std::move(order_response)); });
+    return future;
+}
+
+OrderResponse TradingSession::submit_order(Order const& order)
+{
+    if (m_socket.on_socket_thread())
+        return called_from_callback();
+    std::future<OrderResponse> future = submit_order_async(order);
+    return wait_for_answer(future, std::chrono::steady_clock::now() + m_request_timeout);
+}
+
+OrderResponse TradingSession::update_order(uint64_t order_id, Decimal price)
+{
+    if (m_socket.on_socket_thread())
+        return called_from_callback();
+    std::future<OrderResponse> future = update_order_async(order_id, price);
+    return wait_for_answer(future, std::chrono::steady_clock::now() + m_request_timeout);
+}
+
+OrderResponse TradingSession::cancel_order(uint64_t order_id)
+{
+    if (m_socket.on_socket_thread())
+        return called_from_callback();
+    std::future<OrderResponse> future = cancel_order_async(order_id);
+    return wait_for_answer(future, std::chrono::steady_clock::now() + m_request_timeout);
+}
+
+std::vector<OrderResponse> TradingSession::submit_orders(std::span<Order const> orders)
+{
+    std::vector<Operation> operations;
+    operations.reserve(orders.size());
+    for (Order const& order : orders) {
+        const int64_t client_order_id = next_client_order_id();
+        operations.push_back(Operation { .kind = NEW, .key = client_order_id, .body = submit_order_body(order, client_order_id) });
+    }
+    return send_operations_and_wait(std::move(operations));
+}
+
+std::vector<OrderResponse> TradingSession::update_orders(std::span<OrderPriceUpdate const> updates)
+{
+    std::vector<Operation> operations;
+    operations.reserve(updates.size());
+    for (OrderPriceUpdate const& update : updates)
+        operations.push_back(Operation { .kind = UPDATE, .key = static_cast<int64_t>(update.order_id), .body = update_order_body(update.order_id, update.price) });
+    return send_operations_and_wait(std::move(operations));
+}
+
+std::vector<OrderResponse> TradingSession::cancel_orders(std::span<uint64_t const> order_ids)
+{
+    std::vector<Operation> operations;
+    operations.reserve(order_ids.size());
+    for (uint64_t order_id : order_ids)
+        operations.push_back(Operation { .kind = CANCEL, .key = static_cast<int64_t>(order_id), .body = cancel_order_body(order_id) });
+    return send_operations_and_wait(std::move(operations));
+}
+
+void TradingSession::handle_open()
+{
+    m_socket.send(auth_message());
+}
+
+void TradingSession::handle_close()
+{
+    fail_pending(OrderResponse {});
+}
+
+void TradingSession::fail_pending(OrderResponse const& order_response)
+{
+    std::vector<OrderCallback> failed;
+    {
+        std::lock_guard lock(m_mutex);
+        m_authenticated.store(false, std::memory_order_release);
+        for (auto& pending : m_pending) {
+            for (PendingRequest& request : pending)
+                failed.push_back(std::move(request.callback));
+            pending.clear();
+        }
+        m_unsent.clear();
+    }
+    m_authenticated_changed.notify_all();
+    for (OrderCallback& callback : failed)
+        callback(order_response);
+}
+
+void TradingSession::complete(RequestKind kind, std::optional<int64_t> key, OrderResponse order_response)
+{
+    OrderCallback callback;
+    {
+        std::lock_guard lock(m_mutex);
+        auto& pending = m_pending[kind];
+        // Without a key, requests of one kind are acknowledged in the order they were sent
+        auto request = pending.begin();
+        if (key.has_value()) {
+            request = std::find_if(pending.begin(), pending.end(), [&key](PendingRequest const& pending_request) {
+                return pending_request.key == key.value();
+            });
+        }
+        // Not ours, or already failed by a disconnection: completing another request with it
+        // would hand that request someone else's outcome
+        if (request == pending.end()) {
+            m_unmatched_acks.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        callback = std::move(request->callback);
+        pending.erase(request);
+    }
+    callback(std::move(order_response));
+}
+
+void TradingSession::handle_message(std::string_view frame)
+{
+    // Valid JSON of an unexpected shape is dropped like invalid JSON
+    try {
+        decode_message(frame);
+    } catch (json::exception const&) {
+    }
+}
+
+void TradingSession::decode_message(std::string_view frame)
+{
+    json message = json::parse(frame.begin(), frame.end(), nullptr, false);
+    if (message.is_discarded())
+        return;
+
+    if (message.is_object()) {
+        const std::string event = message.value("event", "");
+        if (event == "auth") {
+            if (message.value("status", "") == "OK") {
+                {
+                    std::lock_guard lock(m_mutex);
+                    m_auth_error.reset();
+                    m_authenticated.store(true, std::memory_order_release);
+                    for (std::string& unsent : m_unsent)
+                        m_socket.send(std::move(unsent));
+                    m_unsent.clear();
+                }
+                m_authenticated_changed.notify_all();
+            } else {
+                // Retrying with the same key would be refused the same way: requests fail from
+                // now on, until a later connection authenticates
+                OrderResponse refused {};
+                refused.message = "auth: " + message.value("msg", std::string("refused"));
+                {
+                    std::lock_guard lock(m_mutex);
+                    m_auth_error = refused.message;
+                }
+                fail_pending(refused);
+            }
+        } else if (event == "info" && message.value("code", 0) == INFO_RECONNECT) {
+            m_socket.reconnect();
+        }
+        return;
+    }
+
+    // [0, "n", [MTS, TYPE, MESSAGE_ID, null, ORDER, CODE, STATUS, TEXT]]
+    if (!message.is_array() || message.size() < 3 || message[0] != 0 || message[1] != "n")
+        return;
+    json const& notification = message[2];
+    if (!notification.is_array() || notification.size() < 7 || !notification[1].is_string())
+        return;
+    const std::string type = notification[1];
+    RequestKind kind;
+    if (type == "on-req")
+        kind = NEW;
+    else if (type == "ou-req")
+        kind = UPDATE;
+    else if (type == "oc-req")
+        kind = CANCEL;
+    else
+        return;
+
+    OrderResponse order_response {};
+    order_response.http_status = 200;
+    order_response.message = notification[6].is_string() ? notification[6].get<std::string>() : "ERROR";
+
+    std::optional<int64_t> key;
+    json const& payload = notification[4];
+    json const& order = (payload.is_array() && !payload.empty() && payload[0].is_array()) ? payload[0] : payload;
+    if (order.is_array() && order.size() > 2) {
+        json const& id = (kind == NEW) ? order[2] : order[0];
+        if (id.is_number_integer())
+            key = id.get<int64_t>();
+        if (order_response.message == "SUCCESS") {
+            try {
+                read_order(order, order_response);
+            } catch (std::exception const& error) {
+                order_response.message = error.what();
+            }
+        }
+    }
+    complete(kind, key, std::move(order_response));
+}
+
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <Bitfinex/Client.h>
+#include <Bitfinex/Signer.h>
+#include <Bitfinex/WebSocket.h>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace Bitfinex {
+
+struct TradingSessionOptions {
+    std::string url { "wss://api.bitfinex.com/ws/2" };
+    std::chrono::milliseconds idle_timeout { 30000 };
+    // How long a blocking call waits for its acknowledgement
+    std::chrono::milliseconds request_timeout { 10000 };
+};
+
+// Authenticated websocket order entry. It offers the same order calls as Client, so callers can
+// switch transports. A request is acknowledged by the exchange's "n" notification for it: the
+// response then has http_status 200 and the notification status (SUCCESS, ERROR...) as message.
+// Requests that are not acknowledged when the connection drops, or still waiting to be sent when a
+// connection attempt fails, complete with http_status 0. When the exchange refuses the
+// authentication, pending requests and those made until an authentication succeeds complete at
+// once with http_status 0 and the exchange's reason.
+class TradingSession {
+public:
+    using OrderCallback = Client::OrderCallback;
+
+    // Answer of a blocking call that was not acknowledged within request_timeout, with http status 0.
+    // The exchange may still act on the request.
+    static constexpr char TIMEOUT[] = "TIMEOUT";
+
+    explicit TradingSession(Config const& config, TradingSessionOptions options = {});
+    TradingSession(TradingSession const&) = delete;
+    TradingSession& operator=(TradingSession const&) = delete;
+    ~TradingSession();
+
+    void start();
+    void stop();
+    // Returns early, with false, when the authentication is refused
+    bool wait_until_authenticated(std::chrono::milliseconds timeout);
+    [[nodiscard]] bool authenticated() const { return m_authenticated.load(std::memory_order_acquire); }
+    // The exchange's reason when it refused the last authentication, empty otherwise
+    [[nodiscard]] std::string auth_error() const;
+    // Acknowledgements that carried an id no pending request had, they are dropped
+    [[nodiscard]] uint64_t unmatched_acks() const { return m_unmatched_acks.load(std::memory_order_relaxed); }
+
+    // Blocking calls made from a callback fail at once with http status 0 and
+    // Client::CALLED_FROM_CALLBACK, the socket thread cannot wait for itself
+    OrderResponse submit_order(Order const&);
+    OrderResponse update_order(uint64_t order_id, Decimal price);
+    OrderResponse cancel_order(uint64_t order_id);
+
+    // Callbacks run on the session's socket thread
+    void submit_order_async(Order const&, OrderCallback);
+    void update_order_async(uint64_t order_id, Decimal price, OrderCallback);
+    void cancel_order_async(uint64_t order_id, OrderCallback);
+    std::future<OrderResponse> submit_order_async(Order const&);
+    std::future<OrderResponse> update_order_async(uint64_t order_id, Decimal price);
+    std::future<OrderResponse> cancel_order_async(uint64_t order_id);
+
+    // Batches through ox_multi messages, responses are returned in input order
+    static constexpr size_t MAX_OPERATIONS_PER_MULTI_REQUEST = 75;
+    std::vector<OrderResponse> submit_orders(std::span<Order const>);
+    std::vector<OrderResponse> update_orders(std::span<OrderPriceUpdate const>);
+    std::vector<OrderResponse> cancel_orders(std::span<uint64_t const> order_ids);
+
+private:
+    enum RequestKind : uint8_t {
+        NEW,
+        UPDATE,
+        CANCEL
+    };
+
+    struct PendingRequest {
+        int64_t key; // Client order id for new orders, order id otherwise
+        OrderCallback callback;
+    };
+
+    struct Operation {
+        RequestKind kind;
+        int64_t key;
+        std::string body;
+    };
+
+    int64_t next_client_order_id();
+    void send_operations(std::vector<Operation> operations, std::vector<OrderCallback> callbacks);
+    std::vector<OrderResponse> send_operations_and_wait(std::vector<Operation> operations);
+
+    std::string auth_message();
+    void handle_open();
+    void handle_message(std::string_view);
+    void decode_message(std::string_view);
+    void handle_close();
+    void fail_pending(OrderResponse const&);
+    void complete(RequestKind, std::optional<int64_t> key, OrderResponse);
+
+    const Config m_config;
+    const Signer m_signer;
+    NonceSource m_nonces;
+    const std::chrono::milliseconds m_request_timeout;
+    WebSocket m_socket;
+
+    std::atomic<int64_t> m_last_client_order_id;
+    std::atomic<bool> m_authenticated { false };
+    std::atomic<uint64_t> m_unmatched_acks { 0 };
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_authenticated_changed;
+    // Messages waiting for the session to be authenticated
+    std::vector<std::string> m_unsent;
+    // Set while the exchange refuses to authenticate the session, requests fail instead of waiting
+    std::optional<std::string> m_auth_error;
+    std::array<std::deque<PendingRequest>, 3> m_pending;
+};
+
+}
@@ -0,0 +1,230 @@
+#include <Bitfinex/WebSocket.h>
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/detached.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/redirect_error.hpp>
+#include <boost/asio/ssl.hpp>
+#include <boost/asio/use_awaitable.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/ssl.hpp>
+#include <boost/beast/websocket.hpp>
+#include <boost/beast/websocket/ssl.hpp>
+#include <exception>
+#include <stdexcept>
+
+namespace asio = boost::asio;
+namespace beast = boost::beast;
+namespace websocket = boost::beast::websocket;
+
+namespace Bitfinex {
+
+using PlainStream = websocket::stream<beast::tcp_stream>;
+using TlsStream = websocket::stream<beast::ssl_stream<beast::tcp_stream>>;
+
+WebSocket::Url WebSocket::parse_url(std::string const& url)
+{
+    Url parsed;
+    std::string_view rest = url;
+    if (rest.starts_with("wss://")) {
+        parsed.tls = true;
+        rest.remove_prefix(6);
+    } else if (rest.starts_with("ws://")) {
+        parsed.tls = false;
+        rest.remove_prefix(5);
+    } else
+        throw std::invalid_argument("Unsupported websocket url: " + url);
+
+    size_t path_start = rest.find('/');
+    std::string_view authority = rest.substr(0, path_start);
+    parsed.target = (path_start == std::string_view::npos) ? "/" : std::string(rest.substr(path_start));
+    size_t port_start = authority.find(':');
+    parsed.host = std::string(authority.substr(0, port_start));
+    if (port_start != std::string_view::npos)
+        parsed.port = std::string(authority.substr(port_start + 1));
+    else
+        parsed.port = parsed.tls ? "443" : "80";
+    return parsed;
+}
+
+WebSocket::WebSocket(WebSocketOptions options, Handlers handlers)
+    : m_options(std::move(options))
+    , m_url(parse_url(m_options.url))
+    , m_handlers(std::move(handlers))
+    , m_write_signal(m_io)
+{
+}
+
+WebSocket::~WebSocket()
+{
+    stop();
+}
+
+void WebSocket::start()
+{
+    if (m_thread.joinable())
+        return;
+    asio::co_spawn(m_io, run(), asio::detached);
+    m_thread = std::thread([this] { m_io.run(); });
+}
+
+void WebSocket::stop()
+{
+    m_stopping.store(true, std::memory_order_release);
+    m_io.stop();
+    if (m_thread.joinable())
+        m_thread.join();
+    m_connected.store(false, std::memory_order_release);
+}
+
+void WebSocket::send(std::string message)
+{
+    asio::post(m_io, [this, message = std::move(message)]() mutable {
+        m_outbox.push_back(std::move(message));
+        m_write_signal.cancel_one();
+    });
+}
+
+void WebSocket::reconnect()
+{
+    asio::post(m_io, [this] {
+        if (m_close_session)
+            m_close_session();
+    });
+}
+
+asio::awaitable<void> WebSocket::run()
+{
+    asio::steady_timer backoff_timer(m_io);
+    std::chrono::milliseconds delay = m_options.reconnect_delay;
+    while (!m_stopping.load(std::memory_order_acquire)) {
+        const uint64_t connections_before = connection_count();
+        try {
+            if (m_url.tls) {
+                asio::ssl::context ssl_context(asio::ssl::context::tls_client);
+                ssl_context.set_default_verify_paths();
+                ssl_context.set_verify_mode(asio::ssl::verify_peer);
+                TlsStream stream(m_io, ssl_context);
+                co_await run_session(stream);
+            } else {
+                PlainStream stream(m_io);
+                co_await run_session(stream);
+            }
+        } catch (std::exception const&) {
+            // Any failure ends up in a reconnect
+        }
+        const bool was_connected = connection_count() != connections_before;
+        m_close_session = nullptr;
+        if (m_connected.exchange(false, std::memory_order_acq_rel) && m_handlers.on_close)
+            m_handlers.on_close();
+        if (m_stopping.load(std::memory_order_acquire))
+            break;
+        if (!was_connected && m_handlers.on_connect_failed)
+            m_handlers.on_connect_failed();
+
+        // Back off exponentially while the endpoint cannot be reached at all
+        if (was_connected)
+            delay = m_options.reconnect_delay;
+        backoff_timer.expires_after(delay);
+        boost::system::error_code ignored;
+        co_await backoff_timer.async_wait(asio::redirect_error(asio::use_awaitable, ignored));
+        delay = std::min(delay * 2, m_options.max_reconnect_delay);
+    }
+}
+
+template<typename Stream>
+asio::awaitable<void> WebSocket::run_session(Stream& stream)
+{
+    asio::ip::tcp::resolver resolver(m_io);
+    auto endpoints = co_await resolver.async_resolve(m_url.host, m_url.port, asio::use_awaitable);
+    beast::get_lowest_layer(stream).expires_after(std::chrono::seconds(10));
+    co_await beast::get_lowest_layer(stream).async_connect(endpoints, asio::use_awaitable);
+    beast::get_lowest_layer(stream).socket().set_option(asio::ip::tcp::no_delay(true));
+
+    if constexpr (std::is_same_v<Stream, TlsStream>) {
+        if (!SSL_set_tlsext_host_name(stream.next_layer().native_handle(), m_url.host.c_str()))
+            throw std::runtime_error("Failed to set SNI host name");
+        co_await stream.next_layer().async_handshake(asio::ssl::stream_base::client, asio::use_awaitable);
+    }
+
+    // The websocket layer takes over the timeouts from here
+    beast::get_lowest_layer(stream).expires_never();
+    websocket::stream_base::timeout timeout {};
+    timeout.handshake_timeout = std::chrono::seconds(10);
+    timeout.idle_timeout = m_options.idle_timeout;
+    timeout.keep_alive_pings = true;
+    stream.set_option(timeout);
+    co_await stream.async_handshake(m_url.host, m_url.target, asio::use_awaitable);
+
+    m_outbox.clear();
+    auto writer = std::make_shared<WriterState>();
+    m_close_session = [&stream] {
+        beast::get_lowest_layer(stream).cancel();
+    };
+    m_write_signal.expires_at(asio::steady_timer::time_point::max());
+    asio::co_spawn(m_io, write_loop(stream, writer), asio::detached);
+
+    m_connection_count.fetch_add(1, std::memory_order_relaxed);
+    m_connected.store(true, std::memory_order_release);
+
+    // Nothing may leave this block before the writer below is stopped, it references the stream
+    std::exception_ptr failure;
+    try {
+        if (m_handlers.on_open) {
+            try {
+                m_handlers.on_open();
+            } catch (...) {
+                // A failing handler is the handler's problem, the session goes on
+            }
+        }
+
+        beast::flat_buffer buffer;
+        boost::system::error_code error;
+        while (!error) {
+            co_await stream.async_read(buffer, asio::redirect_error(asio::use_awaitable, error));
+            if (error)
+                break;
+            auto data = buffer.cdata();
+            if (m_handlers.on_message) {
+                try {
+                    m_handlers.on_message(std::string_view(static_cast<char const*>(data.data()), data.size()));
+                } catch (...) {
+                    // Only this message is lost
+                }
+            }
+            buffer.consume(buffer.size());
+        }
+    } catch (...) {
+        failure = std::current_exception();
+    }
+
+    // The writer still references the stream, wait for it to notice the session is over
+    writer->alive = false;
+    beast::get_lowest_layer(stream).cancel();
+    m_write_signal.cancel();
+    while (!writer->done)
+        co_await asio::post(m_io, asio::use_awaitable);
+    if (failure)
+        std::rethrow_exception(failure);
+}
+
+template<typename Stream>
+asio::awaitable<void> WebSocket::write_loop(Stream& stream, std::shared_ptr<WriterState> writer)
+{
+    while (writer->alive) {
+        if (m_outbox.empty()) {
+            boost::system::error_code ignored;
+            co_await m_write_signal.async_wait(asio::redirect_error(asio::use_awaitable, ignored));
+            continue;
+        }
+        std::string message = std::move(m_outbox.front());
+        m_outbox.pop_front();
+        boost::system::error_code error;
+        stream.text(true);
+        co_await stream.async_write(asio::buffer(message), asio::redirect_error(asio::use_awaitable, error));
+        if (error)
+            break;
+    }
+    writer->done = true;
+}
+
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+// Older Boost.Asio uses std::exchange in awaitable.hpp without including <utility>
+#include <utility>
+
+#include <atomic>
+#include <boost/asio/awaitable.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+
+namespace Bitfinex {
+
+struct WebSocketOptions {
+    std::string url; // ws://host:port/path or wss://host/path
+    // Closes and reconnects when nothing was received for this long, pings are sent in between
+    std::chrono::milliseconds idle_timeout { 30000 };
+    std::chrono::milliseconds reconnect_delay { 500 };
+    std::chrono::milliseconds max_reconnect_delay { 30000 };
+};
+
+// Client side websocket that keeps itself connected. All handlers run on the socket's own thread.
+class WebSocket {
+public:
+    struct Handlers {
+        std::function<void()> on_open;
+        // The view is only valid for the duration of the call
+        std::function<void(std::string_view)> on_message;
+        std::function<void()> on_close;
+        // A connection attempt failed before the websocket opened, called at every failed retry
+        std::function<void()> on_connect_failed;
+    };
+
+    WebSocket(WebSocketOptions options, Handlers handlers);
+    WebSocket(WebSocket const&) = delete;
+    WebSocket& operator=(WebSocket const&) = delete;
+    ~WebSocket();
+
+    void start();
+    void stop();
+
+    // Thread safe, messages queued while disconnected are dropped on the next connect
+    void send(std::string message);
+    // Thread safe, drops the current connection and connects again
+    void reconnect();
+
+    [[nodiscard]] bool connected() const { return m_connected.load(std::memory_order_acquire); }
+    [[nodiscard]] uint64_t connection_count() const { return m_connection_count.load(std::memory_order_relaxed); }
+    // Whether the caller is a handler, which must not wait for the socket
+    [[nodiscard]] bool on_socket_thread() const { return std::this_thread::get_id() == m_thread.get_id(); }
+
+private:
+    struct Url {
+        bool tls;
+        std::string host;
+        std::string port;
+        std::string target;
+    };
+    static Url parse_url(std::string const&);
+
+    struct WriterState {
+        bool alive { true };
+        bool done { false };
+    };
+
+    boost::asio::awaitable<void> run();
+    template<typename Stream>
+    boost::asio::awaitable<void> run_session(Stream& stream);
+    template<typename Stream>
+    boost::asio::awaitable<void> write_loop(Stream& stream, std::shared_ptr<WriterState> writer);
+
+    WebSocketOptions const m_options;
+    Url const m_url;
+    Handlers m_handlers;
+
+    boost::asio::io_context m_io;
+    boost::asio::steady_timer m_write_signal;
+    std::deque<std::string> m_outbox;
+    std::function<void()> m_close_session;
+
+    std::atomic<bool> m_connected { false };
+    std::atomic<bool> m_stopping { false };
+    std::atomic<uint64_t> m_connection_count { 0 };
+    std::thread m_thread;
+};
+
+}
@@ -0,0 +1,158 @@
+#include <BacktestExchange.h>
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+namespace Backtest {
+
+using Bitfinex::OrderResponse;
+using Bitfinex::OrderSide;
+using Bitfinex::OrderType;
+
+static constexpr int64_t NEVER = std::numeric_limits<int64_t>::max();
+
+// As the client reads an error notification, the exchange's text is not kept
+static OrderResponse rejection()
+{
+    OrderResponse response {};
+    response.http_status = 200;
+    response.message = "ERROR";
+    return response;
+}
+
+static bool is_market(OrderType type)
+{
+    return type == OrderType::MARKET || type == OrderType::EXCHANGE_MARKET;
+}
+
+BacktestExchange::BacktestExchange(SymbolId symbol, FillModelOptions const& options, std::pmr::memory_resource* memory)
+    : m_symbol(symbol)
+    , m_options(options)
+    , m_orders(memory)
+    , m_fills(memory)
+{
+}
+
+OrderResponse BacktestExchange::answer(LiveOrder const& order, Decimal price) const
+{
+    OrderResponse response;
+    response.type = Bitfinex::order_type_to_string(order.type);
+    response.http_status = 200;
+    response.order_id = order.id;
+    response.message = "SUCCESS";
+    response.symbol = m_symbol;
+    response.side = order.side;
+    response.amount = order.amount;
+    response.price = price;
+    return response;
+}
+
+BacktestExchange::LiveOrder* BacktestExchange::find(uint64_t order_id)
+{
+    auto order = std::find_if(m_orders.begin(), m_orders.end(), [order_id](LiveOrder const& live) { return live.id == order_id; });
+    // An order with a cancel on its way is gone as far as later requests go
+    return (order == m_orders.end() || order->cancel_ms != NEVER) ? nullptr : &*order;
+}
+
+OrderResponse BacktestExchange::submit_order(Bitfinex::Order const& order)
+{
+    if (order.symbol != m_symbol)
+        return rejection();
+    if (order.type != OrderType::LIMIT && order.type != OrderType::EXCHANGE_LIMIT && !is_market(order.type))
+        return rejection();
+    if (order.amount <= Decimal {} || (!is_market(order.type) && order.price <= Decimal {}))
+        return rejection();
+
+    m_orders.push_back(LiveOrder { .id = m_next_order_id++, .active_ms = m_now_ms + m_options.latency_ms, .amend_ms = NEVER, .cancel_ms = NEVER,
+        .amount = order.amount, .price = order.price, .amended_price = {}, .side = order.side, .type = order.type, .arriving = true });
+    return answer(m_orders.back(), order.price);
+}
+
+OrderResponse BacktestExchange::update_order(uint64_t order_id, Decimal price)
+{
+    LiveOrder* order = find(order_id);
+    if (!order)
+        return rejection();
+    if (price <= Decimal {} || is_market(order->type))
+        return rejection();
+    // A later amend replaces one that has not reached the exchange yet
+    order->amend_ms = m_now_ms + m_options.latency_ms;
+    order->amended_price = price;
+    return answer(*order, price);
+}
+
+OrderResponse BacktestExchange::cancel_order(uint64_t order_id)
+{
+    LiveOrder* order = find(order_id);
+    if (!order)
+        return rejection();
+    // Trades up to the cancel's arrival can still fill the order
+    order->cancel_ms = m_now_ms + m_options.latency_ms;
+    return answer(*order, order->price);
+}
+
+void BacktestExchange::fill(LiveOrder& order, Decimal amount, Decimal price, bool maker)
+{
+    const Decimal notional = amount * price;
+    const Decimal fee = notional * (maker ? m_options.maker_fee : m_options.taker_fee);
+    const Decimal signed_amount = (order.side == OrderSide::BUY) ? amount : -amount;
+    order.amount -= amount;
+    m_account.position += signed_amount;
+    m_account.cash -= (order.side == OrderSide::BUY) ? notional : -notional;
+    m_account.cash -= fee;
+    m_account.fees += fee;
+    m_account.volume += notional;
+    m_account.fills++;
+    m_fills.push_back(Fill { .order_id = order.id, .timestamp_ms = m_now_ms, .amount = signed_amount, .price = price, .fee = fee, .maker = maker });
+}
+
+void BacktestExchange::on_trade(int64_t timestamp_ms, Decimal amount, Decimal price)
+{
+    m_now_ms = timestamp_ms;
+    m_fills.clear();
+    // Each trade fills our orders for at most its own amount
+    Decimal available = amount.abs();
+    bool done = false;
+    for (LiveOrder& order : m_orders) {
+        if (order.cancel_ms <= timestamp_ms) {
+            order.amount = {};
+            done = true;
+            continue;
+        }
+        if (order.amend_ms <= timestamp_ms) {
+            order.price = order.amended_price;
+            order.amend_ms = NEVER;
+            // An amend that crosses the market takes liquidity like a new order
+            order.arriving = true;
+        }
+        if (order.active_ms > timestamp_ms || available.is_zero())
+            continue;
+
+        const bool buy = order.side == OrderSide::BUY;
+        const bool arriving = std::exchange(order.arriving, false);
+        if (arriving && (is_market(order.type) || (buy ? price <= order.price : price >= order.price))) {
+            const Decimal filled = std::min(order.amount, available);
+            fill(order, filled, price, false);
+            available -= filled;
+        } else if (buy ? (price < order.price || (m_options.fill_at_touch && price == order.price))
+                       : (price > order.price || (m_options.fill_at_touch && price == order.price))) {
+            const Decimal filled = std::min(order.amount, available);
+            fill(order, filled, order.price, true);
+            available -= filled;
+        }
+        // Market orders do not rest, whatever the trade left of one is dropped like an IOC
+        if (is_market(order.type))
+            order.amount = {};
+        done |= order.amount.is_zero();
+    }
+    if (done)
+        std::erase_if(m_orders, [](LiveOrder const& order) { return order.amount.is_zero(); });
+    m_last_price = price;
+}
+
+Decimal BacktestExchange::profit() const
+{
+    return m_account.cash + m_account.position * m_last_price;
+}
+
+}
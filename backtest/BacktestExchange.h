@@ -0,0 +1,101 @@
+#pragma once
+
+#include <Bitfinex/Client.h>
+#include <cstdint>
+#include <memory_resource>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace Backtest {
+
+using Bitfinex::Decimal;
+using Bitfinex::SymbolId;
+
+struct FillModelOptions {
+    // From a request to the exchange acting on it, an order cannot fill on the trades before
+    int64_t latency_ms { 20 };
+    // Fractions of the notional, the exchange's base maker and taker fees by default
+    Decimal maker_fee { Decimal::from_units(100000) };
+    Decimal taker_fee { Decimal::from_units(200000) };
+    // A resting order also fills on trades at its price, not only on trades through it. Without
+    // the queue ahead of the order in the history this is the optimistic end.
+    bool fill_at_touch { false };
+};
+
+struct Fill {
+    uint64_t order_id;
+    int64_t timestamp_ms;
+    Decimal amount; // Positive for buys
+    Decimal price;
+    Decimal fee;
+    bool maker;
+};
+
+// What the fills of a run added up to, in the quote currency
+struct Account {
+    Decimal position;
+    Decimal cash;
+    Decimal fees;
+    Decimal volume;
+    uint64_t fills { 0 };
+};
+
+// Local stand-in of the exchange for one symbol, driven by the trades of the history. Answers the
+// same requests as Bitfinex::Client with the same OrderResponse, so a strategy written against the
+// client runs here unchanged. Requests take effect latency_ms after the trade they were sent on,
+// a live order fills on the later trades that print through its limit price, at most for the
+// amount of each trade, and an order that is marketable when it arrives fills at the trade price
+// as a taker. Nothing it does depends on the wall clock, the same trades give the same fills.
+class BacktestExchange {
+public:
+    // Order state lives in the memory resource, e.g. the arena of the thread running the backtest
+    BacktestExchange(SymbolId, FillModelOptions const&, std::pmr::memory_resource*);
+
+    Bitfinex::OrderResponse submit_order(Bitfinex::Order const&);
+    Bitfinex::OrderResponse update_order(uint64_t order_id, Decimal price);
+    Bitfinex::OrderResponse cancel_order(uint64_t order_id);
+
+    // Advances the clock to the trade and matches the live orders against it, amount is negative
+    // for sells as in the history
+    void on_trade(int64_t timestamp_ms, Decimal amount, Decimal price);
+    // Fills of the last trade
+    [[nodiscard]] std::span<Fill const> fills() const { return m_fills; }
+
+    [[nodiscard]] Account const& account() const { return m_account; }
+    [[nodiscard]] int64_t now_ms() const { return m_now_ms; }
+    [[nodiscard]] Decimal last_price() const { return m_last_price; }
+    // Position valued at the last price, plus the cash the fills and their fees moved
+    [[nodiscard]] Decimal profit() const;
+
+private:
+    struct LiveOrder {
+        uint64_t id;
+        // The order, an amend or a cancel reaches the exchange at these times
+        int64_t active_ms;
+        int64_t amend_ms;
+        int64_t cancel_ms;
+        Decimal amount; // Left to fill
+        Decimal price;
+        Decimal amended_price;
+        Bitfinex::OrderSide side;
+        Bitfinex::OrderType type;
+        // Not yet matched against a trade, it takes liquidity if it crosses the first one
+        bool arriving;
+    };
+
+    Bitfinex::OrderResponse answer(LiveOrder const&, Decimal price) const;
+    LiveOrder* find(uint64_t order_id);
+    void fill(LiveOrder&, Decimal amount, Decimal price, bool maker);
+
+    const SymbolId m_symbol;
+    const FillModelOptions m_options;
+    std::pmr::vector<LiveOrder> m_orders;
+    std::pmr::vector<Fill> m_fills;
+    Account m_account;
+    uint64_t m_next_order_id { 1 };
+    int64_t m_now_ms { 0 };
+    Decimal m_last_price;
+};
+
+}
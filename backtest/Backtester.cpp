@@ -0,0 +1,123 @@
+#include <Backtester.h>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+namespace Backtest {
+
+Backtester::Arena::Arena(size_t bytes)
+    : buffer(new std::byte[bytes])
+    , resource(buffer.get(), bytes)
+{
+}
+
+static unsigned thread_count(unsigned threads)
+{
+    return threads ? threads : std::max(1u, std::thread::hardware_concurrency());
+}
+
+Backtester::Backtester(BacktestOptions const& options, std::span<SymbolId const> symbols)
+    : m_options(options)
+    , m_pool(thread_count(options.threads))
+{
+    for (SymbolId symbol : symbols) {
+        std::vector<Bitfinex::HistoryFile>& days = m_days[symbol];
+        if (!days.empty())
+            continue;
+        for (int64_t day = m_options.from_ms - m_options.from_ms % Bitfinex::MILLISECONDS_PER_DAY; day < m_options.to_ms; day += Bitfinex::MILLISECONDS_PER_DAY) {
+            std::optional<Bitfinex::HistoryFile> file = Bitfinex::HistoryFile::open(
+                Bitfinex::history_path(m_options.directory, Bitfinex::symbol_name(symbol), Bitfinex::HistoryKind::TRADES, {}, day));
+            if (file.has_value() && file->kind() == Bitfinex::HistoryKind::TRADES)
+                days.push_back(std::move(file.value()));
+        }
+    }
+    for (unsigned i = 0; i < m_pool.size(); i++)
+        m_arenas.push_back(std::make_unique<Arena>(m_options.arena_bytes));
+}
+
+size_t Backtester::days(SymbolId symbol) const
+{
+    std::vector<Bitfinex::HistoryFile> const* days = m_days.find(symbol);
+    return days ? days->size() : 0;
+}
+
+BacktestReport Backtester::run(std::span<BacktestJob const> jobs)
+{
+    BacktestReport report;
+    report.results.resize(jobs.size());
+    report.threads = m_pool.size();
+    const uint64_t steals = m_pool.steals();
+
+    const auto start = std::chrono::steady_clock::now();
+    m_pool.run(jobs.size(), [&](size_t index, unsigned worker) {
+        Arena& arena = *m_arenas[worker];
+        report.results[index] = run_job(jobs[index], &arena.resource);
+        arena.resource.release();
+    });
+    report.elapsed_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    report.steals = m_pool.steals() - steals;
+    for (BacktestResult const& result : report.results)
+        report.events += result.events;
+    return report;
+}
+
+BacktestResult Backtester::run_job(BacktestJob const& job, std::pmr::memory_resource* memory) const
+{
+    BacktestResult result;
+    std::vector<Bitfinex::HistoryFile> const* days = m_days.find(job.symbol);
+    if (!days)
+        return result;
+
+    size_t largest = 0;
+    for (Bitfinex::HistoryFile const& day : *days)
+        largest = std::max(largest, day.size());
+    std::pmr::vector<int64_t> timestamps(largest, memory);
+    std::pmr::vector<int64_t> amounts(largest, memory);
+    std::pmr::vector<int64_t> prices(largest, memory);
+
+    BacktestExchange exchange(job.symbol, m_options.fill_model, memory);
+    RepricingStrategy strategy(job.symbol, job.parameters);
+    for (Bitfinex::HistoryFile const& day : *days) {
+        const size_t count = day.size();
+        if (!day.read_column(Bitfinex::TRADE_TIMESTAMP_COLUMN, std::span(timestamps).first(count))
+            || !day.read_column(Bitfinex::TRADE_AMOUNT_COLUMN, std::span(amounts).first(count))
+            || !day.read_column(Bitfinex::TRADE_PRICE_COLUMN, std::span(prices).first(count))) {
+            result.bad_days++;
+            continue;
+        }
+        for (size_t i = 0; i < count; i++) {
+            exchange.on_trade(timestamps[i], Decimal::from_units(amounts[i]), Decimal::from_units(prices[i]));
+            for (Fill const& fill : exchange.fills())
+                strategy.on_fill(fill);
+            strategy.on_trade(exchange);
+        }
+        result.events += count;
+        result.days++;
+    }
+    result.strategy = strategy.stats();
+    result.account = exchange.account();
+    result.profit = exchange.profit();
+    return result;
+}
+
+uint64_t checksum(std::span<BacktestResult const> results)
+{
+    // FNV-1a over the fields, padding left out
+    uint64_t hash = 14695981039346656037ull;
+    auto add = [&hash](int64_t value) {
+        for (int byte = 0; byte < 8; byte++) {
+            hash ^= static_cast<uint64_t>(value >> (byte * 8)) & 0xff;
+            hash *= 1099511628211ull;
+        }
+    };
+    for (BacktestResult const& result : results) {
+        for (uint64_t value : { result.events, static_cast<uint64_t>(result.days), static_cast<uint64_t>(result.bad_days), result.strategy.orders,
+                 result.strategy.amends, result.strategy.cancels, result.strategy.rejections, result.account.fills })
+            add(static_cast<int64_t>(value));
+        for (Decimal value : { result.account.position, result.account.cash, result.account.fees, result.account.volume, result.profit })
+            add(value.units());
+    }
+    return hash;
+}
+
+}
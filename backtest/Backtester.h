@@ -0,0 +1,90 @@
+#pragma once
+
+#include <BacktestExchange.h>
+#include <RepricingStrategy.h>
+#include <WorkStealingPool.h>
+#include <Bitfinex/HistoryStore.h>
+#include <Bitfinex/Symbols.h>
+#include <memory>
+#include <memory_resource>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace Backtest {
+
+// One strategy run over every stored day of one symbol
+struct BacktestJob {
+    SymbolId symbol;
+    StrategyParameters parameters;
+};
+
+struct BacktestResult {
+    // Trades replayed
+    uint64_t events { 0 };
+    size_t days { 0 };
+    // Stored days that could not be decoded, left out of the run
+    size_t bad_days { 0 };
+    StrategyStats strategy;
+    Account account;
+    Decimal profit;
+};
+
+struct BacktestOptions {
+    std::string directory { "history" };
+    // Days starting in [from_ms, to_ms) are replayed
+    int64_t from_ms { 0 };
+    int64_t to_ms { 0 };
+    FillModelOptions fill_model;
+    // Hardware threads when 0
+    unsigned threads { 0 };
+    // Each thread's arena starts with this much memory and grows past it for a larger job, enough
+    // for the columns of a busy day keeps a job away from the global allocator
+    size_t arena_bytes { 64 << 20 };
+};
+
+struct BacktestReport {
+    // In the order of the jobs, the same for any number of threads
+    std::vector<BacktestResult> results;
+    uint64_t events { 0 };
+    double elapsed_seconds { 0 };
+    unsigned threads { 0 };
+    uint64_t steals { 0 };
+};
+
+// Replays the trades history of the store through a BacktestExchange and a RepricingStrategy per
+// job. Jobs run on a work stealing pool, each one alone on a thread with memory from that
+// thread's arena, which is released in one go when the job ends. A job only reads the shared,
+// read only mappings of the days and writes its own result, so the results do not depend on
+// which thread ran what or when.
+class Backtester {
+public:
+    // Maps the stored trade days of the symbols
+    Backtester(BacktestOptions const&, std::span<SymbolId const> symbols);
+
+    // Days found for the symbol
+    [[nodiscard]] size_t days(SymbolId) const;
+    [[nodiscard]] unsigned threads() const { return m_pool.size(); }
+
+    BacktestReport run(std::span<BacktestJob const>);
+
+private:
+    struct Arena {
+        explicit Arena(size_t bytes);
+
+        std::unique_ptr<std::byte[]> buffer;
+        std::pmr::monotonic_buffer_resource resource;
+    };
+
+    BacktestResult run_job(BacktestJob const&, std::pmr::memory_resource*) const;
+
+    const BacktestOptions m_options;
+    Bitfinex::PerSymbol<std::vector<Bitfinex::HistoryFile>> m_days;
+    WorkStealingPool m_pool;
+    std::vector<std::unique_ptr<Arena>> m_arenas;
+};
+
+// Hash of every field of the results, equal checksums mean identical runs
+uint64_t checksum(std::span<BacktestResult const>);
+
+}
@@ -0,0 +1,89 @@
+#include <RepricingStrategy.h>
+
+namespace Backtest {
+
+using Bitfinex::OrderResponse;
+using Bitfinex::OrderSide;
+
+// The exchange keeps five significant digits of a price
+static constexpr int PRICE_SIGNIFICANT_DIGITS = 5;
+
+static bool is_success(OrderResponse const& response)
+{
+    return response.http_status == 200 && response.message == "SUCCESS";
+}
+
+RepricingStrategy::RepricingStrategy(SymbolId symbol, StrategyParameters const& parameters)
+    : m_symbol(symbol)
+    , m_parameters(parameters)
+    , m_buy_factor(Decimal::from_integer(1) - parameters.offset)
+    , m_sell_factor(Decimal::from_integer(1) + parameters.offset)
+{
+}
+
+Decimal RepricingStrategy::target_price(OrderSide side, Decimal last_price) const
+{
+    return (last_price * (side == OrderSide::BUY ? m_buy_factor : m_sell_factor)).round_to_significant(PRICE_SIGNIFICANT_DIGITS);
+}
+
+void RepricingStrategy::on_fill(Fill const& fill)
+{
+    if (fill.order_id != m_order_id)
+        return;
+    m_order_left -= fill.amount.abs();
+    if (m_order_left <= Decimal {})
+        m_order_id = 0;
+}
+
+void RepricingStrategy::on_trade(BacktestExchange& exchange)
+{
+    const Decimal last_price = exchange.last_price();
+    if (m_order_id == 0) {
+        const Decimal position = exchange.account().position;
+        const OrderSide side = (position > Decimal {}) ? OrderSide::SELL : OrderSide::BUY;
+        const Bitfinex::Order order { .order_id = 0, .creation_time_ms = exchange.now_ms(), .amount = (side == OrderSide::SELL) ? position : m_parameters.amount,
+            .price = target_price(side, last_price), .symbol = m_symbol, .side = side, .type = Bitfinex::OrderType::EXCHANGE_LIMIT };
+        OrderResponse response = exchange.submit_order(order);
+        if (!is_success(response)) {
+            m_stats.rejections++;
+            return;
+        }
+        m_stats.orders++;
+        m_order_id = response.order_id;
+        m_order_price = response.price;
+        m_reprice_distance = response.price * m_parameters.reprice_threshold;
+        m_order_left = response.amount;
+        m_order_side = side;
+        m_target_for = last_price;
+        m_target = order.price;
+        m_placed_ms = exchange.now_ms();
+        return;
+    }
+
+    if (exchange.now_ms() - m_placed_ms >= m_parameters.max_age_ms) {
+        if (is_success(exchange.cancel_order(m_order_id)))
+            m_stats.cancels++;
+        // A rejected cancel means the order is gone already, its fills have been seen
+        m_order_id = 0;
+        return;
+    }
+
+    // Most trades print at the price of the one before
+    if (last_price != m_target_for) {
+        m_target_for = last_price;
+        m_target = target_price(m_order_side, last_price);
+    }
+    const Decimal target = m_target;
+    if ((target - m_order_price).abs() > m_reprice_distance) {
+        OrderResponse response = exchange.update_order(m_order_id, target);
+        if (is_success(response)) {
+            m_stats.amends++;
+            m_order_price = target;
+            m_reprice_distance = target * m_parameters.reprice_threshold;
+        } else {
+            m_stats.rejections++;
+        }
+    }
+}
+
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <BacktestExchange.h>
+#include <cstdint>
+
+namespace Backtest {
+
+struct StrategyParameters {
+    Decimal amount;
+    // Distance of the order from the last trade price, as a fraction of it (0.001 is 10 bps)
+    Decimal offset;
+    // The order is repriced once the price it would be placed at moved this fraction away from it
+    Decimal reprice_threshold;
+    // Unfilled orders are canceled after this long
+    int64_t max_age_ms;
+};
+
+struct StrategyStats {
+    uint64_t orders { 0 };
+    uint64_t amends { 0 };
+    uint64_t cancels { 0 };
+    uint64_t rejections { 0 };
+};
+
+// The order flow of `trader --order`: place a limit order away from the last trade, change its
+// price as the market moves and cancel it when it has not filled in time. It buys while flat or
+// short and sells the position back once long, so a run is a string of round trips whose profit
+// is that of the offsets net of the fees and of the moves it got caught in.
+class RepricingStrategy {
+public:
+    RepricingStrategy(SymbolId, StrategyParameters const&);
+
+    // After the exchange matched the trade
+    void on_fill(Fill const&);
+    void on_trade(BacktestExchange&);
+
+    [[nodiscard]] StrategyStats const& stats() const { return m_stats; }
+
+private:
+    [[nodiscard]] Decimal target_price(Bitfinex::OrderSide, Decimal last_price) const;
+
+    const SymbolId m_symbol;
+    const StrategyParameters m_parameters;
+    const Decimal m_buy_factor;
+    const Decimal m_sell_factor;
+    StrategyStats m_stats;
+    // Live order, id 0 while there is none
+    uint64_t m_order_id { 0 };
+    Decimal m_order_price;
+    Decimal m_reprice_distance;
+    Decimal m_order_left;
+    Bitfinex::OrderSide m_order_side { Bitfinex::OrderSide::BUY };
+    int64_t m_placed_ms { 0 };
+    // Price of the live order's side for the last price it was computed for
+    Decimal m_target_for;
+    Decimal m_target;
+};
+
+}
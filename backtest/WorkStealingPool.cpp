@@ -0,0 +1,99 @@
+#include <WorkStealingPool.h>
+#include <algorithm>
+
+namespace Backtest {
+
+WorkStealingPool::WorkStealingPool(unsigned threads)
+{
+    threads = std::max(1u, threads);
+    for (unsigned i = 0; i < threads; i++)
+        m_queues.push_back(std::make_unique<Queue>());
+    // Started last, the threads find every queue in place
+    for (unsigned i = 0; i < threads; i++)
+        m_threads.emplace_back([this, i] { work(i); });
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+    {
+        std::lock_guard lock(m_mutex);
+        m_stopping = true;
+    }
+    m_started.notify_all();
+    m_threads.clear();
+}
+
+void WorkStealingPool::run(size_t count, Task const& task)
+{
+    if (count == 0)
+        return;
+    std::unique_lock lock(m_mutex);
+    const size_t workers = m_queues.size();
+    m_batch++;
+    for (size_t worker = 0; worker < workers; worker++) {
+        std::lock_guard queue_lock(m_queues[worker]->mutex);
+        for (size_t index = count * worker / workers; index < count * (worker + 1) / workers; index++)
+            m_queues[worker]->tasks.push_back(Entry { .batch = m_batch, .index = index });
+    }
+    m_task = &task;
+    m_remaining.store(count, std::memory_order_relaxed);
+    m_started.notify_all();
+    m_finished.wait(lock, [this] { return m_remaining.load(std::memory_order_acquire) == 0; });
+    m_task = nullptr;
+}
+
+void WorkStealingPool::work(unsigned worker)
+{
+    uint64_t batch = 0;
+    for (;;) {
+        Task const* task;
+        {
+            std::unique_lock lock(m_mutex);
+            m_started.wait(lock, [&] { return m_stopping || m_batch != batch; });
+            if (m_stopping)
+                return;
+            batch = m_batch;
+            task = m_task;
+        }
+        while (std::optional<Entry> entry = take(worker)) {
+            if (entry->batch != batch) {
+                // A task of the next batch, found before this thread went back to waiting
+                std::lock_guard lock(m_mutex);
+                batch = m_batch;
+                task = m_task;
+            }
+            (*task)(entry->index, worker);
+            if (m_remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                // Taken so that run() is either before its wait or inside it
+                std::lock_guard lock(m_mutex);
+                m_finished.notify_all();
+            }
+        }
+    }
+}
+
+std::optional<WorkStealingPool::Entry> WorkStealingPool::take(unsigned worker)
+{
+    {
+        Queue& own = *m_queues[worker];
+        std::lock_guard lock(own.mutex);
+        if (!own.tasks.empty()) {
+            const Entry entry = own.tasks.front();
+            own.tasks.pop_front();
+            return entry;
+        }
+    }
+    for (size_t offset = 1; offset < m_queues.size(); offset++) {
+        Queue& victim = *m_queues[(worker + offset) % m_queues.size()];
+        std::lock_guard lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            const Entry entry = victim.tasks.back();
+            victim.tasks.pop_back();
+            m_steals.fetch_add(1, std::memory_order_relaxed);
+            return entry;
+        }
+    }
+    return {};
+}
+
+}
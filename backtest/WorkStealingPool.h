@@ -0,0 +1,63 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+namespace Backtest {
+
+// Fixed set of threads that run batches of indexed tasks. Each worker starts on its own
+// contiguous share of the batch, taken from the front of its queue, and once that is done takes
+// tasks from the back of the other queues, so uneven tasks (a busy symbol, a short sweep point)
+// do not leave cores idle at the end of a batch.
+class WorkStealingPool {
+public:
+    // task(index, worker), worker is below size() and identifies the thread for per thread state
+    using Task = std::function<void(size_t index, unsigned worker)>;
+
+    explicit WorkStealingPool(unsigned threads);
+    WorkStealingPool(WorkStealingPool const&) = delete;
+    WorkStealingPool& operator=(WorkStealingPool const&) = delete;
+    ~WorkStealingPool();
+
+    [[nodiscard]] unsigned size() const { return static_cast<unsigned>(m_threads.size()); }
+    // Tasks taken from another worker's queue since the pool started
+    [[nodiscard]] uint64_t steals() const { return m_steals.load(std::memory_order_relaxed); }
+
+    // Runs task for every index below count and returns once all of them ran
+    void run(size_t count, Task const& task);
+
+private:
+    struct Entry {
+        uint64_t batch;
+        size_t index;
+    };
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Entry> tasks;
+    };
+
+    void work(unsigned worker);
+    std::optional<Entry> take(unsigned worker);
+
+    std::vector<std::unique_ptr<Queue>> m_queues;
+    std::mutex m_mutex;
+    std::condition_variable m_started;
+    std::condition_variable m_finished;
+    Task const* m_task { nullptr };
+    uint64_t m_batch { 0 };
+    bool m_stopping { false };
+    std::atomic<size_t> m_remaining { 0 };
+    std::atomic<uint64_t> m_steals { 0 };
+    std::vector<std::jthread> m_threads;
+};
+
+}
@@ -0,0 +1,194 @@
+// Replays the trades stored by trader-history through a local fill model and runs the order flow
+// of `trader --order` over every combination of the given parameters and symbols in parallel.
+
+#include <Backtester.h>
+#include <boost/algorithm/string.hpp>
+#include <boost/program_options.hpp>
+#include <algorithm>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <nlohmann/json.hpp>
+#include <numeric>
+#include <ranges>
+
+static std::vector<std::string> split_list(std::string const& text)
+{
+    std::vector<std::string> items;
+    boost::split(items, text, boost::is_any_of(","), boost::token_compress_on);
+    std::erase(items, "");
+    return items;
+}
+
+// "0.0005,0.001", every value must be a non negative decimal
+static std::vector<Bitfinex::Decimal> parse_decimals(std::string const& text, char const* option)
+{
+    std::vector<Bitfinex::Decimal> values;
+    for (std::string const& item : split_list(text)) {
+        std::optional<Bitfinex::Decimal> value = Bitfinex::Decimal::parse(item);
+        if (!value.has_value() || value->is_negative())
+            throw boost::program_options::validation_error(boost::program_options::validation_error::invalid_option_value, option);
+        values.push_back(value.value());
+    }
+    if (values.empty())
+        throw boost::program_options::validation_error(boost::program_options::validation_error::invalid_option_value, option);
+    return values;
+}
+
+static int64_t parse_day_option(std::string const& text, char const* option)
+{
+    std::optional<int64_t> day = Bitfinex::parse_day(text);
+    if (!day.has_value())
+        throw boost::program_options::validation_error(boost::program_options::validation_error::invalid_option_value, option);
+    return day.value();
+}
+
+static nlohmann::json result_to_json(Backtest::BacktestJob const& job, Backtest::BacktestResult const& result)
+{
+    return {
+        { "symbol", Bitfinex::symbol_name(job.symbol) },
+        { "amount", job.parameters.amount.to_string() },
+        { "offset", job.parameters.offset.to_string() },
+        { "reprice_threshold", job.parameters.reprice_threshold.to_string() },
+        { "max_age_ms", job.parameters.max_age_ms },
+        { "days", result.days },
+        { "events", result.events },
+        { "orders", result.strategy.orders },
+        { "amends", result.strategy.amends },
+        { "cancels", result.strategy.cancels },
+        { "rejections", result.strategy.rejections },
+        { "fills", result.account.fills },
+        { "volume", result.account.volume.to_string() },
+        { "fees", result.account.fees.to_string() },
+        { "position", result.account.position.to_string() },
+        { "profit", result.profit.to_string() },
+    };
+}
+
+int main(int argc, char** argv)
+{
+    boost::program_options::options_description options("Supported options");
+    options.add_options()("help", "print help message");
+    options.add_options()("symbols", boost::program_options::value<std::string>(), "Comma separated trading pairs to replay, e.g. tBTCUSD,tETHUSD");
+    options.add_options()("from", boost::program_options::value<std::string>(), "First day to replay, YYYY-MM-DD (UTC)");
+    options.add_options()("to", boost::program_options::value<std::string>(), "Last day to replay, YYYY-MM-DD (UTC), the first day when not given");
+    options.add_options()("dir", boost::program_options::value<std::string>()->default_value("history"), "Root directory of the store written by trader-history");
+    options.add_options()("amount", boost::program_options::value<std::string>()->default_value("0.01"), "Comma separated order amounts to sweep");
+    options.add_options()("offset", boost::program_options::value<std::string>()->default_value("0.0005,0.001,0.002"),
+        "Comma separated distances of the order from the last trade, as fractions of its price");
+    options.add_options()("reprice", boost::program_options::value<std::string>()->default_value("0.0005,0.001"),
+        "Comma separated moves of the target price, as fractions of the order price, that get the order repriced");
+    options.add_options()("max-age-ms", boost::program_options::value<std::string>()->default_value("5000,30000"),
+        "Comma separated times after which an unfilled order is canceled");
+    options.add_options()("latency-ms", boost::program_options::value<int64_t>()->default_value(20), "Time from a request to the exchange acting on it");
+    options.add_options()("maker-fee", boost::program_options::value<std::string>()->default_value("0.001"), "Maker fee, as a fraction of the notional");
+    options.add_options()("taker-fee", boost::program_options::value<std::string>()->default_value("0.002"), "Taker fee, as a fraction of the notional");
+    options.add_options()("fill-at-touch", "Fill resting orders on trades at their price too, not only on trades through it");
+    options.add_options()("threads", boost::program_options::value<unsigned>()->default_value(0), "Worker threads, all hardware threads when 0");
+    options.add_options()("top", boost::program_options::value<size_t>()->default_value(20), "Runs printed, by profit");
+    options.add_options()("json", boost::program_options::value<std::string>(), "Write every result as JSON to this file, - for stdout");
+    options.add_options()("check-determinism", "Run the jobs again on one thread and compare the results");
+
+    try {
+        boost::program_options::variables_map variables_map;
+        boost::program_options::store(boost::program_options::parse_command_line(argc, argv, options), variables_map);
+        boost::program_options::notify(variables_map);
+        if (variables_map.count("help") || !variables_map.count("symbols") || !variables_map.count("from")) {
+            std::cout << options << std::endl;
+            return 0;
+        }
+
+        Backtest::BacktestOptions backtest_options;
+        backtest_options.directory = variables_map["dir"].as<std::string>();
+        backtest_options.from_ms = parse_day_option(variables_map["from"].as<std::string>(), "from");
+        backtest_options.to_ms = (variables_map.count("to") ? parse_day_option(variables_map["to"].as<std::string>(), "to") : backtest_options.from_ms)
+            + Bitfinex::MILLISECONDS_PER_DAY;
+        backtest_options.threads = variables_map["threads"].as<unsigned>();
+        backtest_options.fill_model = Backtest::FillModelOptions { .latency_ms = std::max<int64_t>(0, variables_map["latency-ms"].as<int64_t>()),
+            .maker_fee = parse_decimals(variables_map["maker-fee"].as<std::string>(), "maker-fee").front(),
+            .taker_fee = parse_decimals(variables_map["taker-fee"].as<std::string>(), "taker-fee").front(),
+            .fill_at_touch = variables_map.count("fill-at-touch") > 0 };
+
+        std::vector<Bitfinex::SymbolId> symbols;
+        for (std::string const& name : split_list(variables_map["symbols"].as<std::string>()))
+            symbols.push_back(Bitfinex::intern_symbol(name));
+        std::vector<int64_t> max_ages;
+        for (std::string const& item : split_list(variables_map["max-age-ms"].as<std::string>()))
+            max_ages.push_back(std::stoll(item));
+
+        // Symbols outermost, a symbol's runs share the mapped days and sit next to each other in the output
+        std::vector<Backtest::BacktestJob> jobs;
+        for (Bitfinex::SymbolId symbol : symbols) {
+            for (Bitfinex::Decimal amount : parse_decimals(variables_map["amount"].as<std::string>(), "amount")) {
+                for (Bitfinex::Decimal offset : parse_decimals(variables_map["offset"].as<std::string>(), "offset")) {
+                    for (Bitfinex::Decimal reprice : parse_decimals(variables_map["reprice"].as<std::string>(), "reprice")) {
+                        for (int64_t max_age : max_ages)
+                            jobs.push_back(Backtest::BacktestJob { .symbol = symbol,
+                                .parameters = { .amount = amount, .offset = offset, .reprice_threshold = reprice, .max_age_ms = max_age } });
+                    }
+                }
+            }
+        }
+
+        Backtest::Backtester backtester(backtest_options, symbols);
+        for (Bitfinex::SymbolId symbol : symbols) {
+            if (backtester.days(symbol) == 0)
+                std::cerr << "No stored trades of " << Bitfinex::symbol_name(symbol) << " in " << backtest_options.directory << " for these days" << std::endl;
+        }
+        Backtest::BacktestReport report = backtester.run(jobs);
+
+        // Best first, ties in job order so that the table is as deterministic as the results
+        std::vector<size_t> order(jobs.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return report.results[a].profit > report.results[b].profit; });
+        std::cout << std::format("{:<16} {:>10} {:>8} {:>8} {:>8} {:>6} {:>8} {:>8} {:>14} {:>12} {:>12} {:>14}", "SYMBOL", "AMOUNT", "OFFSET", "REPRICE",
+            "MAX_AGE", "DAYS", "ORDERS", "FILLS", "VOLUME", "FEES", "POSITION", "PROFIT")
+                  << std::endl;
+        for (size_t index : order | std::views::take(variables_map["top"].as<size_t>())) {
+            Backtest::BacktestJob const& job = jobs[index];
+            Backtest::BacktestResult const& result = report.results[index];
+            std::cout << std::format("{:<16} {:>10} {:>8} {:>8} {:>8} {:>6} {:>8} {:>8} {:>14} {:>12} {:>12} {:>14}", Bitfinex::symbol_name(job.symbol),
+                job.parameters.amount, job.parameters.offset, job.parameters.reprice_threshold, job.parameters.max_age_ms, result.days,
+                result.strategy.orders, result.account.fills, result.account.volume, result.account.fees, result.account.position, result.profit)
+                      << std::endl;
+        }
+
+        const uint64_t sum = Backtest::checksum(report.results);
+        std::cout << std::format("{} runs, {} events in {:.3f} s on {} threads ({} steals): {:.2f}M events/s, {:.2f}M events/s per core, checksum {:016x}",
+            jobs.size(), report.events, report.elapsed_seconds, report.threads, report.steals, static_cast<double>(report.events) / report.elapsed_seconds / 1e6,
+            static_cast<double>(report.events) / report.elapsed_seconds / report.threads / 1e6, sum)
+                  << std::endl;
+
+        if (variables_map.count("json")) {
+            nlohmann::json results = nlohmann::json::array();
+            for (size_t i = 0; i < jobs.size(); i++)
+                results.push_back(result_to_json(jobs[i], report.results[i]));
+            nlohmann::json document = { { "results", results }, { "events", report.events }, { "elapsed_seconds", report.elapsed_seconds },
+                { "threads", report.threads }, { "events_per_second_per_core", static_cast<double>(report.events) / report.elapsed_seconds / report.threads },
+                { "checksum", std::format("{:016x}", sum) } };
+            std::string const& path = variables_map["json"].as<std::string>();
+            if (path == "-") {
+                std::cout << document.dump(2) << std::endl;
+            } else {
+                std::ofstream file(path);
+                file << document.dump(2) << std::endl;
+            }
+        }
+
+        if (variables_map.count("check-determinism")) {
+            backtest_options.threads = 1;
+            Backtest::Backtester single(backtest_options, symbols);
+            Backtest::BacktestReport reference = single.run(jobs);
+            const uint64_t reference_sum = Backtest::checksum(reference.results);
+            std::cout << std::format("1 thread: {:.3f} s, {:.2f}M events/s, checksum {:016x} {}", reference.elapsed_seconds,
+                static_cast<double>(reference.events) / reference.elapsed_seconds / 1e6, reference_sum, reference_sum == sum ? "(same)" : "(DIFFERENT)")
+                      << std::endl;
+            if (reference_sum != sum)
+                return 2;
+        }
+        return 0;
+    } catch (const std::exception& err) {
+        std::cerr << err.what() << std::endl;
+        return 1;
+    }
+}
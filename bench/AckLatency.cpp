@@ -0,0 +1,75 @@
+#include <Benchmarks.h>
+#include <Bitfinex/TradingSession.h>
+#include <Percentiles.h>
+#include <chrono>
+#include <iostream>
+
+namespace Bench {
+
+struct AckSamples {
+    std::vector<uint64_t> new_order_ns;
+    std::vector<uint64_t> cancel_ns;
+    // Requests that were not acknowledged with SUCCESS, they are not in the samples
+    size_t failures { 0 };
+};
+
+static uint64_t elapsed_ns(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Places an order that rests in the book then cancels it, requests times over. Both acks go through
+// the whole order entry path of the exchange and the account ends up as it started.
+template<typename Transport>
+static AckSamples measure_acks(Transport& transport, Bitfinex::Order const& order, size_t requests)
+{
+    AckSamples samples;
+    samples.new_order_ns.reserve(requests);
+    samples.cancel_ns.reserve(requests);
+    for (size_t i = 0; i < requests; i++) {
+        auto start = std::chrono::steady_clock::now();
+        Bitfinex::OrderResponse submitted = transport.submit_order(order);
+        const uint64_t new_order_ns = elapsed_ns(start);
+        if (submitted.http_status != 200 || submitted.message != "SUCCESS") {
+            samples.failures++;
+            continue;
+        }
+        samples.new_order_ns.push_back(new_order_ns);
+
+        start = std::chrono::steady_clock::now();
+        Bitfinex::OrderResponse cancelled = transport.cancel_order(submitted.order_id);
+        const uint64_t cancel_ns = elapsed_ns(start);
+        if (cancelled.http_status != 200 || cancelled.message != "SUCCESS") {
+            samples.failures++;
+            continue;
+        }
+        samples.cancel_ns.push_back(cancel_ns);
+    }
+    return samples;
+}
+
+static void print_acks(char const* transport, AckSamples& samples)
+{
+    std::cout << transport << ", " << samples.failures << " requests not acknowledged" << std::endl;
+    print_latency_percentiles(std::cout, "  new order ack", samples.new_order_ns);
+    print_latency_percentiles(std::cout, "  cancel ack", samples.cancel_ns);
+}
+
+void ack_latency(Bitfinex::Config const& config, std::string const& websocket_url, Bitfinex::Order const& order, size_t requests)
+{
+    // Measures the transport, not the rate limiter
+    Bitfinex::Client client(config, {}, Bitfinex::RequestSchedulerOptions::unlimited());
+    AckSamples rest_samples = measure_acks(client, order, requests);
+    print_acks(("REST " + config.BASE_ENDPOINT).c_str(), rest_samples);
+
+    Bitfinex::TradingSession session(config, { .url = websocket_url });
+    session.start();
+    if (!session.wait_until_authenticated(std::chrono::seconds(10))) {
+        std::cerr << "Could not authenticate on " << websocket_url << " " << session.auth_error() << std::endl;
+        return;
+    }
+    AckSamples websocket_samples = measure_acks(session, order, requests);
+    print_acks(("websocket " + websocket_url).c_str(), websocket_samples);
+}
+
+}
@@ -0,0 +1,90 @@
+#include <Benchmarks.h>
+#include <chrono>
+#include <future>
+#include <iostream>
+#include <vector>
+
+namespace Bench {
+
+using Clock = std::chrono::steady_clock;
+
+static bool is_success(Bitfinex::OrderResponse const& response)
+{
+    return response.http_status == 200 && response.message == "SUCCESS";
+}
+
+static double milliseconds(Clock::duration duration)
+{
+    return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+// Acknowledged counts SUCCESS answers only, operations/s counts every request sent
+static void print_throughput(char const* name, size_t requests, size_t acknowledged, Clock::duration elapsed)
+{
+    std::cout << name << ": " << requests << " requests (" << acknowledged << " acknowledged) in " << milliseconds(elapsed) << " ms, "
+              << requests / std::chrono::duration<double>(elapsed).count() << " requests/s" << std::endl;
+}
+
+void async_throughput(Bitfinex::Config const& config, Bitfinex::Order const& order, size_t orders)
+{
+    // Measures the transport, not the rate limiter
+    Bitfinex::Client client(config, {}, Bitfinex::RequestSchedulerOptions::unlimited());
+    client.warm_up();
+    // Orders whose cancel was not acknowledged, cancelled in bulk at the end
+    std::vector<uint64_t> leftover_orders;
+
+    // Places the orders one at a time, then cancels them one at a time
+    size_t acknowledged = 0;
+    std::vector<uint64_t> order_ids;
+    auto start = Clock::now();
+    for (size_t i = 0; i < orders; i++) {
+        Bitfinex::OrderResponse submitted = client.submit_order(order);
+        if (is_success(submitted)) {
+            acknowledged++;
+            order_ids.push_back(submitted.order_id);
+        }
+    }
+    for (const uint64_t order_id : order_ids) {
+        if (is_success(client.cancel_order(order_id)))
+            acknowledged++;
+        else
+            leftover_orders.push_back(order_id);
+    }
+    print_throughput("blocking", orders + order_ids.size(), acknowledged, Clock::now() - start);
+
+    // Queues every order without waiting, then every cancel
+    acknowledged = 0;
+    order_ids.clear();
+    start = Clock::now();
+    std::vector<std::future<Bitfinex::OrderResponse>> responses;
+    responses.reserve(orders);
+    for (size_t i = 0; i < orders; i++)
+        responses.push_back(client.submit_order_async(order));
+    const Clock::duration submits_queued = Clock::now() - start;
+    for (auto& response : responses) {
+        Bitfinex::OrderResponse submitted = response.get();
+        if (is_success(submitted)) {
+            acknowledged++;
+            order_ids.push_back(submitted.order_id);
+        }
+    }
+    responses.clear();
+    for (const uint64_t order_id : order_ids)
+        responses.push_back(client.cancel_order_async(order_id));
+    for (size_t i = 0; i < responses.size(); i++) {
+        if (is_success(responses[i].get()))
+            acknowledged++;
+        else
+            leftover_orders.push_back(order_ids[i]);
+    }
+    print_throughput("async", orders + order_ids.size(), acknowledged, Clock::now() - start);
+    std::cout << "async: the calling thread queued " << orders << " orders in " << milliseconds(submits_queued) << " ms" << std::endl;
+
+    Bitfinex::ConnectionStats stats = client.connection_stats();
+    std::cout << "connections opened: " << stats.new_connections << ", reused: " << stats.reused_connections << std::endl;
+
+    if (!leftover_orders.empty())
+        client.cancel_orders(leftover_orders);
+}
+
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <Bitfinex/Client.h>
+#include <cstddef>
+#include <string>
+
+namespace Bench {
+
+// Places orders that rest in the book and cancels them, through the blocking and then the async API.
+// A client sends one signed request at a time to keep its nonces in order, so the async API frees the
+// calling thread but does not put more requests in flight.
+void async_throughput(Bitfinex::Config const& config, Bitfinex::Order const& order, size_t orders);
+
+// Time to acknowledgement percentiles of new orders and of their cancellations, REST against
+// websocket order entry. The orders are placed and cancelled one at a time and must rest in the book.
+void ack_latency(Bitfinex::Config const& config, std::string const& websocket_url, Bitfinex::Order const& order, size_t requests);
+
+// Nanoseconds per request signature, one-shot hex_hmac_sha384 against a reused Signer
+void signing(size_t iterations);
+
+// Updates per second of a MarketBook at depths 25, 100 and 250, with and without checksum validation
+void market_book(size_t iterations);
+
+// Latency from publish to read of top of book records fanned out through the shared memory ring to
+// subscriber processes, and records they lost to overruns. rate is in records per second, 0 for as
+// fast as possible.
+void market_data(size_t updates, unsigned subscribers, double rate);
+
+// Replays synthetic raw book events through a RawBook holding about live_orders orders
+void raw_book(size_t events, size_t live_orders);
+
+// Orders and positions responses decoded by the streaming decoder and by the nlohmann DOM, synthetic
+// bodies of the given number of records unless recorded responses are given
+void decoding(size_t records, std::string const& orders_file, std::string const& positions_file);
+
+// Bytes per trade and scan speed of a day of trades stored as the columnar history format against
+// the raw /v2/trades JSON
+void history(size_t trades);
+
+// Client hot paths on the recorded responses of data_directory, names containing filter only,
+// results written as JSON to json_path unless it is empty
+void micro(std::string const& data_directory, size_t iterations, std::string const& filter, std::string const& json_path);
+
+}
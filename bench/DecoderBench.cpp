@@ -0,0 +1,172 @@
+#include <Benchmarks.h>
+#include <Bitfinex/OrderMessages.h>
+#include <Bitfinex/Positions.h>
+#include <Bitfinex/ResponseDecoder.h>
+#include <algorithm>
+#include <chrono>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <nlohmann/json.hpp>
+#include <sstream>
+
+namespace Bench {
+
+using json = nlohmann::json;
+
+// Chunk size of a typical TLS record, the way the body arrives from the network
+static constexpr size_t NETWORK_CHUNK = 16 * 1024;
+static constexpr int ROUNDS = 5;
+
+// Full 32 field order arrays as /v2/auth/r/orders sends them, meta object included
+static std::string make_orders_body(size_t records)
+{
+    std::string body = "[";
+    for (size_t i = 0; i < records; i++) {
+        const int64_t created = 1718000000000 + static_cast<int64_t>(i) * 37;
+        body += std::format("{}[{},null,{},\"{}\",{},{},{}{}.{},{}0.5,\"EXCHANGE LIMIT\",null,null,null,0,\"ACTIVE\",null,null,{}.{},0,0,0,"
+                            "null,null,null,0,0,null,null,null,\"API>BFX\",null,null,{{\"aff_code\":\"x{}\"}}]",
+            i == 0 ? "" : ",", 150000000000 + i, created, (i % 3 == 0) ? "tETHUSD" : "tBTCUSD", created, created + 5, (i % 2) ? "-" : "",
+            i % 5, 1 + i % 97, (i % 2) ? "-" : "", 60000 + i % 1000, i % 10, i % 7);
+    }
+    return body + "]";
+}
+
+static std::string make_positions_body(size_t records)
+{
+    std::string body = "[";
+    for (size_t i = 0; i < records; i++) {
+        body += std::format("{}[\"{}\",\"ACTIVE\",{}.{},{}.{},0,0,-12.5,-0.04,40000.2,1.5,null,{},1718000000000,1718000000000,null,0,null,3000,1500,"
+                            "{{\"reason\":\"TRADE\",\"order_id\":{},\"liq_stage\":null,\"trade_price\":\"60000.1\",\"trade_amount\":\"0.5\"}}]",
+            i == 0 ? "" : ",", (i % 3 == 0) ? "tETHUSD" : "tBTCUSD", i % 4, 1 + i % 89, 60000 + i % 1000, i % 10, 140000 + i, 150000000000 + i);
+    }
+    return body + "]";
+}
+
+static std::string read_file(std::string const& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        throw std::runtime_error("Could not open " + path);
+    std::stringstream content;
+    content << file.rdbuf();
+    return content.str();
+}
+
+// The DOM path the client used before the streaming decoder
+static Bitfinex::OrderBook dom_orders(std::string const& body)
+{
+    json json_response = json::parse(body);
+    Bitfinex::OrderBook order_book;
+    order_book.reserve(json_response.size());
+    for (json const& order_element : json_response) {
+        const Bitfinex::Decimal order_amount = Bitfinex::read_decimal(order_element[6]).value();
+        order_book.emplace_order(Bitfinex::Order { .order_id = order_element[0], .creation_time_ms = order_element[4], .amount = order_amount.abs(),
+            .price = Bitfinex::read_decimal(order_element[16]).value(), .symbol = Bitfinex::intern_symbol(order_element[3].get_ref<std::string const&>()),
+            .side = order_amount.is_negative() ? Bitfinex::OrderSide::SELL : Bitfinex::OrderSide::BUY,
+            .type = Bitfinex::order_type_from_string(order_element[8]) });
+    }
+    return order_book;
+}
+
+static Bitfinex::Positions dom_positions(std::string const& body)
+{
+    json json_response = json::parse(body);
+    Bitfinex::Positions positions;
+    positions.reserve(json_response.size());
+    for (json const& json_position : json_response) {
+        positions.emplace_position(Bitfinex::Position { .amount = Bitfinex::read_decimal(json_position[2]).value(), .base_price = Bitfinex::read_decimal(json_position[3]).value(),
+            .symbol = Bitfinex::intern_symbol(json_position[0].get_ref<std::string const&>()),
+            .status = Bitfinex::position_status_from_string(json_position[1]) });
+    }
+    return positions;
+}
+
+template<typename Decoder>
+static Bitfinex::DecodeError stream(std::string const& body, Decoder decoder, size_t chunk)
+{
+    for (size_t offset = 0; offset < body.size(); offset += chunk)
+        decoder.feed(std::string_view(body).substr(offset, chunk));
+    return decoder.finish();
+}
+
+// Best of a few rounds, in seconds
+template<typename Function>
+static double best_time(Function function)
+{
+    double best = 1e30;
+    for (int round = 0; round < ROUNDS; round++) {
+        auto start = std::chrono::steady_clock::now();
+        function();
+        best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+    return best;
+}
+
+static void report(std::string_view name, std::string const& body, size_t records, double seconds)
+{
+    std::cout << std::format("  {:<22} {:>8.1f} MB/s {:>10.0f} records/s {:>8.1f} ns/record", name, static_cast<double>(body.size()) / seconds / 1e6,
+        static_cast<double>(records) / seconds, seconds * 1e9 / static_cast<double>(records))
+              << std::endl;
+}
+
+static bool same_orders(Bitfinex::OrderBook const& left, Bitfinex::OrderBook const& right)
+{
+    return std::equal(left.order_book().begin(), left.order_book().end(), right.order_book().begin(), right.order_book().end(),
+        [](Bitfinex::Order const& a, Bitfinex::Order const& b) {
+            return a.order_id == b.order_id && a.creation_time_ms == b.creation_time_ms && a.amount == b.amount && a.price == b.price
+                && a.symbol == b.symbol && a.side == b.side && a.type == b.type;
+        });
+}
+
+static bool same_positions(Bitfinex::Positions const& left, Bitfinex::Positions const& right)
+{
+    return std::equal(left.positions().begin(), left.positions().end(), right.positions().begin(), right.positions().end(),
+        [](Bitfinex::Position const& a, Bitfinex::Position const& b) {
+            return a.amount == b.amount && a.base_price == b.base_price && a.symbol == b.symbol && a.status == b.status;
+        });
+}
+
+void decoding(size_t records, std::string const& orders_file, std::string const& positions_file)
+{
+    const std::string orders_body = orders_file.empty() ? make_orders_body(records) : read_file(orders_file);
+    const std::string positions_body = positions_file.empty() ? make_positions_body(records) : read_file(positions_file);
+
+    Bitfinex::OrderBook reference = dom_orders(orders_body);
+    Bitfinex::OrderBook decoded;
+    Bitfinex::DecodeError error = stream(orders_body, Bitfinex::orders_decoder(decoded), NETWORK_CHUNK);
+    if (error != Bitfinex::DecodeError::NONE || !same_orders(reference, decoded))
+        std::cerr << "orders decode differently: " << Bitfinex::decode_error_to_string(error) << std::endl;
+    const size_t order_count = reference.order_book().size();
+
+    std::cout << "/v2/auth/r/orders, " << order_count << " orders, " << orders_body.size() << " bytes" << std::endl;
+    report("nlohmann DOM", orders_body, order_count, best_time([&] { return dom_orders(orders_body); }));
+    report("decoder, whole body", orders_body, order_count, best_time([&] {
+        Bitfinex::OrderBook order_book;
+        return Bitfinex::decode_orders(orders_body, order_book);
+    }));
+    report("decoder, 16 KiB chunks", orders_body, order_count, best_time([&] {
+        Bitfinex::OrderBook order_book;
+        return stream(orders_body, Bitfinex::orders_decoder(order_book), NETWORK_CHUNK);
+    }));
+
+    Bitfinex::Positions reference_positions = dom_positions(positions_body);
+    Bitfinex::Positions decoded_positions;
+    error = stream(positions_body, Bitfinex::positions_decoder(decoded_positions), NETWORK_CHUNK);
+    if (error != Bitfinex::DecodeError::NONE || !same_positions(reference_positions, decoded_positions))
+        std::cerr << "positions decode differently: " << Bitfinex::decode_error_to_string(error) << std::endl;
+    const size_t position_count = reference_positions.positions().size();
+
+    std::cout << "/v2/auth/r/positions, " << position_count << " positions, " << positions_body.size() << " bytes" << std::endl;
+    report("nlohmann DOM", positions_body, position_count, best_time([&] { return dom_positions(positions_body); }));
+    report("decoder, whole body", positions_body, position_count, best_time([&] {
+        Bitfinex::Positions positions;
+        return Bitfinex::decode_positions(positions_body, positions);
+    }));
+    report("decoder, 16 KiB chunks", positions_body, position_count, best_time([&] {
+        Bitfinex::Positions positions;
+        return stream(positions_body, Bitfinex::positions_decoder(positions), NETWORK_CHUNK);
+    }));
+}
+
+}
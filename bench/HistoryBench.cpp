@@ -0,0 +1,151 @@
+#include <Benchmarks.h>
+#include <Bitfinex/HistoryStore.h>
+#include <Bitfinex/ResponseDecoder.h>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <nlohmann/json.hpp>
+#include <random>
+#include <sstream>
+#include <unistd.h>
+
+namespace Bench {
+
+static constexpr int ROUNDS = 5;
+
+// A busy day of one pair: prices on a 1 USD tick around 60000, 8 decimal amounts, a trade every
+// few milliseconds with bursts sharing one
+static std::vector<Bitfinex::HistoryTrade> make_trades(size_t count)
+{
+    std::mt19937_64 random(42);
+    std::vector<Bitfinex::HistoryTrade> trades;
+    trades.reserve(count);
+    uint64_t trade_id = 1600000000;
+    int64_t timestamp_ms = 1718000000000;
+    int64_t price = 60000;
+    for (size_t i = 0; i < count; i++) {
+        trade_id += 1 + random() % 3;
+        timestamp_ms += (random() % 4 == 0) ? 0 : static_cast<int64_t>(random() % 150);
+        price += static_cast<int64_t>(random() % 5) - 2;
+        const int64_t amount_units = 1 + static_cast<int64_t>(random() % 50000000);
+        trades.push_back(Bitfinex::HistoryTrade { .trade_id = trade_id, .timestamp_ms = timestamp_ms,
+            .amount = Bitfinex::Decimal::from_units((random() % 2) ? amount_units : -amount_units), .price = Bitfinex::Decimal::from_integer(price) });
+    }
+    return trades;
+}
+
+// The way /v2/trades/SYMBOL/hist answers
+static std::string trades_json(std::vector<Bitfinex::HistoryTrade> const& trades)
+{
+    std::string body = "[";
+    for (Bitfinex::HistoryTrade const& trade : trades)
+        body += std::format("{}[{},{},{},{}]", body.size() > 1 ? "," : "", trade.trade_id, trade.timestamp_ms, trade.amount, trade.price);
+    return body + "]";
+}
+
+static std::string read_file(std::string const& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    std::stringstream content;
+    content << file.rdbuf();
+    return content.str();
+}
+
+// Best of a few rounds, in seconds
+template<typename Function>
+static double best_time(Function function)
+{
+    double best = 1e30;
+    for (int round = 0; round < ROUNDS; round++) {
+        auto start = std::chrono::steady_clock::now();
+        function();
+        best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+    return best;
+}
+
+struct Vwap {
+    double notional { 0 };
+    double volume { 0 };
+
+    void add(double price, double amount)
+    {
+        notional += price * std::abs(amount);
+        volume += std::abs(amount);
+    }
+    [[nodiscard]] double value() const { return notional / volume; }
+};
+
+void history(size_t count)
+{
+    const std::vector<Bitfinex::HistoryTrade> trades = make_trades(count);
+    const std::filesystem::path directory = std::filesystem::temp_directory_path() / std::format("trader-bench-history-{}", ::getpid());
+    std::filesystem::create_directories(directory);
+    const std::string json_path = (directory / "trades.json").string();
+    const std::string store_path = (directory / "trades.bfxh").string();
+
+    const std::string body = trades_json(trades);
+    std::ofstream(json_path, std::ios::binary) << body;
+    Bitfinex::write_history_file(store_path, Bitfinex::encode_trades(trades, 0, true));
+    const size_t store_size = std::filesystem::file_size(store_path);
+    std::cout << std::format("{} trades: JSON {:.1f} bytes/trade, columnar {:.2f} bytes/trade ({:.1f}x smaller)", count,
+        static_cast<double>(body.size()) / static_cast<double>(count), static_cast<double>(store_size) / static_cast<double>(count),
+        static_cast<double>(body.size()) / static_cast<double>(store_size))
+              << std::endl;
+
+    // Every scan reads the file and computes the VWAP of the day
+    std::vector<std::pair<std::string, double>> results;
+    auto run = [&](std::string name, size_t file_size, auto scan) {
+        double vwap = 0;
+        const double seconds = best_time([&] { vwap = scan(); });
+        results.emplace_back(name, vwap);
+        std::cout << std::format("  {:<28} {:>8.1f} MB/s {:>12.0f} trades/s {:>8.1f} ns/trade", name, static_cast<double>(file_size) / seconds / 1e6,
+            static_cast<double>(count) / seconds, seconds * 1e9 / static_cast<double>(count))
+                  << std::endl;
+    };
+
+    run("JSON, nlohmann DOM", body.size(), [&] {
+        Vwap vwap;
+        for (nlohmann::json const& trade : nlohmann::json::parse(read_file(json_path)))
+            vwap.add(trade[3].get<double>(), trade[2].get<double>());
+        return vwap.value();
+    });
+    run("JSON, streaming decoder", body.size(), [&] {
+        std::vector<Bitfinex::HistoryTrade> decoded;
+        decoded.reserve(count);
+        Bitfinex::decode_trades(read_file(json_path), decoded);
+        Vwap vwap;
+        for (Bitfinex::HistoryTrade const& trade : decoded)
+            vwap.add(trade.price.to_double(), trade.amount.to_double());
+        return vwap.value();
+    });
+    run("columnar, all columns", store_size, [&] {
+        std::vector<Bitfinex::HistoryTrade> decoded;
+        Bitfinex::HistoryFile::open(store_path)->read_trades(decoded);
+        Vwap vwap;
+        for (Bitfinex::HistoryTrade const& trade : decoded)
+            vwap.add(trade.price.to_double(), trade.amount.to_double());
+        return vwap.value();
+    });
+    run("columnar, amount and price", store_size, [&] {
+        std::optional<Bitfinex::HistoryFile> file = Bitfinex::HistoryFile::open(store_path);
+        std::vector<int64_t> amounts(file->size()), prices(file->size());
+        file->read_column(Bitfinex::TRADE_AMOUNT_COLUMN, amounts);
+        file->read_column(Bitfinex::TRADE_PRICE_COLUMN, prices);
+        Vwap vwap;
+        for (size_t i = 0; i < amounts.size(); i++)
+            vwap.add(static_cast<double>(prices[i]) / Bitfinex::Decimal::SCALE, static_cast<double>(amounts[i]) / Bitfinex::Decimal::SCALE);
+        return vwap.value();
+    });
+
+    for (auto const& [name, vwap] : results) {
+        if (std::abs(vwap - results.front().second) > 1e-6 * std::abs(results.front().second))
+            std::cout << "  " << name << " disagrees: VWAP " << vwap << " instead of " << results.front().second << std::endl;
+    }
+    std::filesystem::remove_all(directory);
+}
+
+}
@@ -0,0 +1,75 @@
+#include <Benchmarks.h>
+#include <Bitfinex/MarketBook.h>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace Bench {
+
+// A book of the given depth around 30000 with 0.1 ticks, and a stream of updates that mostly
+// touch the top levels: amount changes, removals and the re-insertion of removed levels
+static std::vector<Bitfinex::BookLevel> make_levels(size_t depth)
+{
+    std::vector<Bitfinex::BookLevel> levels;
+    for (size_t i = 0; i < depth; i++) {
+        levels.push_back(Bitfinex::BookLevel { .price = 30000.0 - 0.1 * static_cast<double>(i + 1), .count = 2, .amount = 0.25 + 0.01 * static_cast<double>(i) });
+        levels.push_back(Bitfinex::BookLevel { .price = 30000.0 + 0.1 * static_cast<double>(i), .count = 3, .amount = -0.5 - 0.01 * static_cast<double>(i) });
+    }
+    return levels;
+}
+
+static std::vector<Bitfinex::BookLevel> make_updates(size_t depth, size_t count)
+{
+    std::mt19937_64 random(42);
+    std::geometric_distribution<size_t> distance(0.2);
+    std::uniform_int_distribution<int> action(0, 9);
+    std::vector<Bitfinex::BookLevel> updates;
+    updates.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        const size_t level = std::min(distance(random), depth - 1);
+        const bool bid = i % 2 == 0;
+        const double price = bid ? 30000.0 - 0.1 * static_cast<double>(level + 1) : 30000.0 + 0.1 * static_cast<double>(level);
+        const double amount = 0.01 * static_cast<double>(1 + random() % 500);
+        // Removals come back on the next update of the same price, keeping the depth stable
+        if (action(random) == 0)
+            updates.push_back(Bitfinex::BookLevel { .price = price, .count = 0, .amount = bid ? 1.0 : -1.0 });
+        else
+            updates.push_back(Bitfinex::BookLevel { .price = price, .count = 1 + static_cast<uint32_t>(random() % 8), .amount = bid ? amount : -amount });
+    }
+    return updates;
+}
+
+void market_book(size_t iterations)
+{
+    for (size_t depth : { 25, 100, 250 }) {
+        const std::vector<Bitfinex::BookLevel> levels = make_levels(depth);
+        const std::vector<Bitfinex::BookLevel> updates = make_updates(depth, iterations);
+
+        Bitfinex::MarketBook book;
+        book.apply_snapshot(levels);
+        auto start = std::chrono::steady_clock::now();
+        for (Bitfinex::BookLevel const& update : updates)
+            book.apply_update(update);
+        const double update_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        // Every update followed by a checksum, the way the exchange sends them
+        book.apply_snapshot(levels);
+        int64_t sink = 0;
+        start = std::chrono::steady_clock::now();
+        for (Bitfinex::BookLevel const& update : updates) {
+            book.apply_update(update);
+            sink += book.checksum();
+        }
+        const double checked_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (sink == 0)
+            std::cout << "";
+
+        const double updates_count = static_cast<double>(updates.size());
+        std::cout << "depth " << depth << ": " << static_cast<uint64_t>(updates_count / update_seconds) << " updates/s, "
+                  << static_cast<uint64_t>(updates_count / checked_seconds) << " updates/s with checksums, "
+                  << (checked_seconds - update_seconds) * 1e9 / updates_count << " ns/checksum" << std::endl;
+    }
+}
+
+}
@@ -0,0 +1,133 @@
+#include <Benchmarks.h>
+#include <Percentiles.h>
+#include <Bitfinex/MarketData.h>
+#include <chrono>
+#include <format>
+#include <iostream>
+#include <sstream>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace Bench {
+
+static int64_t steady_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Reads the ring until the publisher is gone, then prints how late the records were read and how
+// many were lost. Runs in a child process, as a separate reader would.
+static int subscribe(std::string const& name, unsigned index, size_t updates, bool yield, int ready_fd)
+{
+    std::unique_ptr<Bitfinex::MarketDataSubscriber> subscriber = Bitfinex::MarketDataSubscriber::open(name);
+    if (!subscriber)
+        return 1;
+    std::vector<uint64_t> latencies_ns;
+    latencies_ns.reserve(updates);
+    // The subscriber starts at the head, the publisher waits for every one of them
+    const char ready = 1;
+    if (write(ready_fd, &ready, 1) != 1)
+        return 1;
+    close(ready_fd);
+
+    Bitfinex::MarketDataRecord record;
+    for (;;) {
+        const Bitfinex::MarketDataStatus status = subscriber->poll(record);
+        if (status == Bitfinex::MarketDataStatus::RECORD)
+            latencies_ns.push_back(static_cast<uint64_t>(steady_ns() - record.published_ns));
+        else if (status == Bitfinex::MarketDataStatus::CLOSED)
+            break;
+        else if (status == Bitfinex::MarketDataStatus::EMPTY && yield)
+            std::this_thread::yield();
+    }
+
+    // One write per subscriber so that their lines do not interleave
+    std::ostringstream out;
+    out << std::format("subscriber {}: {} read, {} lost, latency p50 {} ns, p99 {} ns, p99.9 {} ns, max {} ns", index, latencies_ns.size(),
+        subscriber->lost(), percentile(latencies_ns, 50), percentile(latencies_ns, 99), percentile(latencies_ns, 99.9), percentile(latencies_ns, 100))
+        << std::endl;
+    const std::string line = out.str();
+    return write(STDOUT_FILENO, line.data(), line.size()) == static_cast<ssize_t>(line.size()) ? 0 : 1;
+}
+
+void market_data(size_t updates, unsigned subscribers, double rate)
+{
+    const std::string name = std::format("/trader-bench-market-data-{}", getpid());
+    std::unique_ptr<Bitfinex::MarketDataPublisher> publisher = Bitfinex::MarketDataPublisher::create({ .name = name });
+    if (!publisher) {
+        std::cerr << "Could not create the shared memory ring " << name << std::endl;
+        return;
+    }
+
+    // Spinning readers only measure the ring when each of them and the publisher have a core,
+    // otherwise they measure the scheduler and had better give the core back
+    const bool yield = std::thread::hardware_concurrency() <= subscribers;
+    if (yield)
+        std::cout << std::format("{} cores for {} subscribers and the publisher, subscribers yield when the ring is empty",
+            std::thread::hardware_concurrency(), subscribers)
+                  << std::endl;
+
+    int ready[2];
+    if (pipe(ready) != 0) {
+        std::cerr << "Could not create a pipe" << std::endl;
+        return;
+    }
+    std::cout.flush();
+    std::vector<pid_t> children;
+    for (unsigned i = 0; i < subscribers; i++) {
+        const pid_t pid = fork();
+        if (pid == 0) {
+            close(ready[0]);
+            _exit(subscribe(name, i, updates, yield, ready[1]));
+        }
+        if (pid > 0)
+            children.push_back(pid);
+    }
+    close(ready[1]);
+    char byte;
+    size_t subscribed = 0;
+    while (subscribed < children.size() && read(ready[0], &byte, 1) == 1)
+        subscribed++;
+    close(ready[0]);
+    if (subscribed < children.size())
+        std::cerr << children.size() - subscribed << " subscribers could not open the ring" << std::endl;
+
+    // The same symbol throughout, a top of book that moves by a tick every update
+    const Bitfinex::SymbolId symbol = Bitfinex::intern_symbol("tBTCUSD");
+    const int64_t interval_ns = rate > 0 ? static_cast<int64_t>(1e9 / rate) : 0;
+    std::vector<uint64_t> publish_ns;
+    publish_ns.reserve(updates);
+    const int64_t start_ns = steady_ns();
+    for (size_t i = 0; i < updates; i++) {
+        if (interval_ns > 0) {
+            const int64_t due_ns = start_ns + static_cast<int64_t>(i) * interval_ns;
+            while (steady_ns() < due_ns) {
+                if (yield)
+                    std::this_thread::yield();
+            }
+        }
+        const double tick = 0.1 * static_cast<double>(i % 100);
+        const Bitfinex::TopOfBook top { .bid = 30000 + tick, .bid_size = 0.5, .ask = 30000.1 + tick, .ask_size = 0.75 };
+        const int64_t before_ns = steady_ns();
+        publisher->publish(symbol, top);
+        publish_ns.push_back(static_cast<uint64_t>(steady_ns() - before_ns));
+    }
+    const double seconds = static_cast<double>(steady_ns() - start_ns) / 1e9;
+
+    std::cout << std::format("published {} top of book records to {} subscribers in {:.3f} s ({:.0f} records/s)", updates, subscribed, seconds,
+        static_cast<double>(updates) / seconds)
+              << std::endl;
+    std::cout << std::format("publish: p50 {} ns, p99 {} ns, p99.9 {} ns, max {} ns (clock reads included)", percentile(publish_ns, 50),
+        percentile(publish_ns, 99), percentile(publish_ns, 99.9), percentile(publish_ns, 100))
+              << std::endl;
+    std::cout.flush();
+
+    // Closes the ring, the subscribers drain it and report
+    publisher.reset();
+    for (pid_t child : children)
+        waitpid(child, nullptr, 0);
+}
+
+}
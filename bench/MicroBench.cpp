@@ -0,0 +1,157 @@
+#include <Benchmarks.h>
+#include <Bitfinex/Metrics.h>
+#include <Bitfinex/OrderMessages.h>
+#include <Bitfinex/Positions.h>
+#include <Bitfinex/ResponseDecoder.h>
+#include <algorithm>
+#include <chrono>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <nlohmann/json.hpp>
+#include <sstream>
+
+namespace Bench {
+
+using json = nlohmann::json;
+
+static constexpr int ROUNDS = 5;
+
+struct MicroResult {
+    std::string name;
+    size_t iterations;
+    double nanoseconds; // Per operation, best round
+    size_t items; // Records handled per operation, 0 when not meaningful
+};
+
+// Keeps a result alive without the cost of a volatile store per call
+static size_t g_sink = 0;
+
+template<typename Function>
+static double best_nanoseconds_per_call(size_t iterations, Function function)
+{
+    double best = 1e30;
+    for (int round = 0; round < ROUNDS; round++) {
+        size_t checksum = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < iterations; i++)
+            checksum += function(i);
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        g_sink += checksum;
+        best = std::min(best, std::chrono::duration<double, std::nano>(elapsed).count() / static_cast<double>(iterations));
+    }
+    return best;
+}
+
+static std::string read_input(std::string const& data_directory, char const* name)
+{
+    const std::string path = data_directory + "/" + name;
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        throw std::runtime_error("Could not open " + path + ", see --data-dir");
+    std::stringstream content;
+    content << file.rdbuf();
+    return content.str();
+}
+
+// The ticker fields get_ticker reads, through the same nlohmann DOM
+static double decode_ticker(std::string const& body)
+{
+    json json_response = json::parse(body);
+    const double bid = json_response[0];
+    const double last_price = json_response[6];
+    const double volume = json_response[7];
+    return bid + last_price + volume;
+}
+
+void micro(std::string const& data_directory, size_t iterations, std::string const& filter, std::string const& json_path)
+{
+    const std::string orders_body = read_input(data_directory, "orders.json");
+    const std::string positions_body = read_input(data_directory, "positions.json");
+    const std::string ticker_body = read_input(data_directory, "ticker.json");
+
+    Bitfinex::OrderBook recorded_orders;
+    Bitfinex::Positions recorded_positions;
+    if (Bitfinex::decode_orders(orders_body, recorded_orders) != Bitfinex::DecodeError::NONE
+        || Bitfinex::decode_positions(positions_body, recorded_positions) != Bitfinex::DecodeError::NONE || recorded_orders.order_book().empty()
+        || recorded_positions.positions().empty())
+        throw std::runtime_error("The recorded responses in " + data_directory + " do not decode");
+    std::vector<Bitfinex::Order> const& orders = recorded_orders.order_book();
+    std::vector<Bitfinex::Position> const& positions = recorded_positions.positions();
+
+    const std::string key = "0123456789abcdef0123456789abcdef0123456789a";
+    const std::string payload = "/api/v2/auth/w/order/submit1718000000000000" + Bitfinex::submit_order_body(orders[0]);
+    std::ostringstream out;
+    std::vector<MicroResult> results;
+    auto run = [&](std::string name, size_t items, auto function) {
+        if (!filter.empty() && name.find(filter) == std::string::npos)
+            return;
+        // Whole responses take as long as their records, run them as many times as the records
+        const size_t count = std::max<size_t>(1, iterations / std::max<size_t>(items, 1));
+        results.push_back(MicroResult { .name = std::move(name), .iterations = count, .nanoseconds = best_nanoseconds_per_call(count, function), .items = items });
+    };
+
+    run("hex_hmac_sha384", 0, [&](size_t) { return Bitfinex::hex_hmac_sha384(key, payload).size(); });
+    run("get_current_timestamp_as_string", 0, [](size_t) { return Bitfinex::get_current_timestamp_as_string().size(); });
+    run("unix_to_iso_utc", 0, [](size_t i) { return Bitfinex::unix_to_iso_utc(1718000000000 + static_cast<long long>(i) * 997).size(); });
+    run("submit_order_body", 0, [&](size_t i) { return Bitfinex::submit_order_body(orders[i % orders.size()]).size(); });
+    run("decode_orders", orders.size(), [&](size_t) {
+        Bitfinex::OrderBook order_book;
+        Bitfinex::decode_orders(orders_body, order_book);
+        return order_book.order_book().size();
+    });
+    run("decode_positions", positions.size(), [&](size_t) {
+        Bitfinex::Positions decoded;
+        Bitfinex::decode_positions(positions_body, decoded);
+        return decoded.positions().size();
+    });
+    run("decode_ticker", 0, [&](size_t) { return static_cast<size_t>(decode_ticker(ticker_body)); });
+    run("OrderBook::append_order", 0, [&, order_book = Bitfinex::OrderBook()](size_t i) mutable {
+        // Starts over every few thousand orders so the book stays in cache like a real response would
+        if (i % 4096 == 0)
+            order_book = Bitfinex::OrderBook();
+        order_book.append_order(orders[i % orders.size()]);
+        return order_book.order_book().size();
+    });
+    run("ClientMetrics::record", 0, [&, metrics = std::make_shared<Bitfinex::ClientMetrics>()](size_t i) {
+        metrics->record(Bitfinex::Endpoint::SUBMIT_ORDER, Bitfinex::Phase::FIRST_BYTE, 20000 + (i & 1023) * 97);
+        return i;
+    });
+    run("operator<<(Order)", 0, [&](size_t i) {
+        out.str({});
+        out << orders[i % orders.size()];
+        return static_cast<size_t>(out.tellp());
+    });
+    run("operator<<(Position)", 0, [&](size_t i) {
+        out.str({});
+        out << positions[i % positions.size()];
+        return static_cast<size_t>(out.tellp());
+    });
+    run("operator<<(OrderBook)", orders.size(), [&](size_t) {
+        out.str({});
+        out << recorded_orders;
+        return static_cast<size_t>(out.tellp());
+    });
+
+    json report = { { "rounds", ROUNDS }, { "results", json::array() } };
+    for (MicroResult const& result : results) {
+        std::cout << std::format("{:<34} {:>12.1f} ns/op {:>14.0f} ops/s", result.name, result.nanoseconds, 1e9 / result.nanoseconds);
+        if (result.items != 0)
+            std::cout << std::format(" {:>10.1f} ns/record", result.nanoseconds / static_cast<double>(result.items));
+        std::cout << std::endl;
+        json entry = { { "name", result.name }, { "iterations", result.iterations }, { "ns_per_op", result.nanoseconds }, { "ops_per_s", 1e9 / result.nanoseconds } };
+        if (result.items != 0)
+            entry["ns_per_record"] = result.nanoseconds / static_cast<double>(result.items);
+        report["results"].push_back(std::move(entry));
+    }
+    if (g_sink == 0)
+        std::cout << "";
+
+    if (json_path.empty())
+        return;
+    std::ofstream file(json_path);
+    if (!(file << report.dump(2) << std::endl))
+        throw std::runtime_error("Could not write " + json_path);
+}
+
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <Bitfinex/LatencyHistogram.h>
+#include <algorithm>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+namespace Bench {
+
+// Nearest rank percentile of the samples, the same rank as the client's metrics. Sorts them in place.
+inline uint64_t percentile(std::vector<uint64_t>& samples, double percentile)
+{
+    if (samples.empty())
+        return 0;
+    std::sort(samples.begin(), samples.end());
+    return samples[Bitfinex::percentile_rank(percentile, samples.size()) - 1];
+}
+
+inline void print_latency_percentiles(std::ostream& out, char const* name, std::vector<uint64_t>& samples_ns)
+{
+    out << name << ": " << samples_ns.size() << " samples, p50 " << percentile(samples_ns, 50) / 1000 << " us, p99 "
+        << percentile(samples_ns, 99) / 1000 << " us, p99.9 " << percentile(samples_ns, 99.9) / 1000 << " us" << std::endl;
+}
+
+}
@@ -0,0 +1,108 @@
+#include <Benchmarks.h>
+#include <Bitfinex/RawBook.h>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace Bench {
+
+// Resident set size of the process, from /proc/self/statm
+static size_t resident_bytes()
+{
+    std::ifstream statm("/proc/self/statm");
+    size_t pages = 0;
+    size_t resident_pages = 0;
+    statm >> pages >> resident_pages;
+    return resident_pages * 4096;
+}
+
+// A raw book feed around 30000 with 0.1 ticks: adds, cancels and amendments keeping about
+// live_orders orders in the book, most of them close to the top
+class RawBookFeed {
+public:
+    explicit RawBookFeed(size_t live_orders)
+        : m_live_orders(live_orders)
+    {
+    }
+
+    Bitfinex::RawBookEntry snapshot_entry()
+    {
+        return add();
+    }
+
+    Bitfinex::RawBookEntry next()
+    {
+        const int action = m_action(m_random);
+        if (m_live.empty() || (m_live.size() < m_live_orders * 3 / 2 && action < 4))
+            return add();
+        const size_t index = m_random() % m_live.size();
+        const uint64_t order_id = m_live[index];
+        if (action < 8) {
+            m_live[index] = m_live.back();
+            m_live.pop_back();
+            return Bitfinex::RawBookEntry { .order_id = order_id, .price = 0, .amount = (order_id % 2) ? 1.0 : -1.0 };
+        }
+        return entry(order_id);
+    }
+
+private:
+    Bitfinex::RawBookEntry add()
+    {
+        const uint64_t order_id = m_next_order_id++;
+        m_live.push_back(order_id);
+        return entry(order_id);
+    }
+
+    Bitfinex::RawBookEntry entry(uint64_t order_id)
+    {
+        // Odd ids are bids, even ids asks
+        const bool bid = order_id % 2;
+        const double ticks = static_cast<double>(std::min<size_t>(m_distance(m_random), 500));
+        const double amount = 0.001 * static_cast<double>(1 + m_random() % 5000);
+        return Bitfinex::RawBookEntry { .order_id = order_id, .price = bid ? 30000.0 - 0.1 * (ticks + 1) : 30000.0 + 0.1 * ticks,
+            .amount = bid ? amount : -amount };
+    }
+
+    size_t m_live_orders;
+    std::mt19937_64 m_random { 42 };
+    std::uniform_int_distribution<int> m_action { 0, 9 };
+    std::geometric_distribution<size_t> m_distance { 0.02 };
+    std::vector<uint64_t> m_live;
+    uint64_t m_next_order_id { 1000000000 };
+};
+
+void raw_book(size_t events, size_t live_orders)
+{
+    RawBookFeed feed(live_orders);
+    std::vector<Bitfinex::RawBookEntry> snapshot;
+    for (size_t i = 0; i < live_orders; i++)
+        snapshot.push_back(feed.snapshot_entry());
+    std::vector<Bitfinex::RawBookEntry> updates;
+    updates.reserve(events);
+    for (size_t i = 0; i < events; i++)
+        updates.push_back(feed.next());
+
+    const size_t resident_before = resident_bytes();
+    Bitfinex::RawBook book(live_orders * 2);
+    book.apply_snapshot(snapshot);
+    const size_t resident_after = resident_bytes();
+    const size_t orders = book.order_count();
+    const size_t reserved = book.memory_usage();
+
+    auto start = std::chrono::steady_clock::now();
+    for (Bitfinex::RawBookEntry const& update : updates)
+        book.apply_update(update);
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "replayed " << events << " events in " << seconds << " s: " << static_cast<uint64_t>(static_cast<double>(events) / seconds)
+              << " events/s, " << seconds * 1e9 / static_cast<double>(events) << " ns/event" << std::endl;
+    std::cout << orders << " live orders after the snapshot: " << (resident_after - resident_before) / orders << " resident bytes/order, "
+              << reserved / orders << " reserved bytes/order" << std::endl;
+    std::cout << book.order_count() << " live orders at the end over " << book.depth(Bitfinex::BUY) << " bid and "
+              << book.depth(Bitfinex::SELL) << " ask levels, the book " << (book.memory_usage() == reserved ? "did not grow" : "grew")
+              << " during the replay" << std::endl;
+}
+
+}
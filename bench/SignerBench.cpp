@@ -0,0 +1,45 @@
+#include <Benchmarks.h>
+#include <Bitfinex/Signer.h>
+#include <chrono>
+#include <iostream>
+
+namespace Bench {
+
+template<typename Function>
+static double nanoseconds_per_call(size_t iterations, Function function)
+{
+    size_t checksum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; i++)
+        checksum += function();
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    // Keeps the calls from being optimized out
+    if (checksum == 0)
+        std::cout << "";
+    return std::chrono::duration<double, std::nano>(elapsed).count() / static_cast<double>(iterations);
+}
+
+void signing(size_t iterations)
+{
+    const std::string key = "0123456789abcdef0123456789abcdef0123456789a";
+    const std::string endpoint = "/v2/auth/w/order/submit";
+    const std::string nonce = "1718000000000000";
+    const std::string body = R"({ "symbol": "tTESTBTC:TESTUSD", "type": "EXCHANGE LIMIT", "amount": "0.1", "price": "8000" })";
+
+    double one_shot = nanoseconds_per_call(iterations, [&] {
+        return Bitfinex::hex_hmac_sha384(key, "/api" + endpoint + nonce + body).size();
+    });
+
+    Bitfinex::Signer signer(key);
+    double reused = nanoseconds_per_call(iterations, [&] {
+        return signer.sign({ "/api", endpoint, nonce, body }).view().size();
+    });
+
+    if (Bitfinex::hex_hmac_sha384(key, "/api" + endpoint + nonce + body) != signer.sign({ "/api", endpoint, nonce, body }).view())
+        std::cerr << "signatures differ !" << std::endl;
+
+    std::cout << "hex_hmac_sha384: " << one_shot << " ns/signature" << std::endl;
+    std::cout << "Signer::sign: " << reused << " ns/signature" << std::endl;
+}
+
+}
@@ -0,0 +1,103 @@
+#include <Benchmarks.h>
+#include <boost/program_options.hpp>
+#include <dotenv/dotenv.h>
+#include <iostream>
+#include <optional>
+
+// BASE_ENDPOINT of the .env file is not used, benchmarks only go where --base-url says
+static std::optional<Bitfinex::Config> load_config(std::string const& base_endpoint)
+{
+    dotenv::init(".env");
+    Bitfinex::Config config { .BASE_ENDPOINT = base_endpoint, .API_KEY = dotenv::getenv("API_KEY"), .SECRET_KEY = dotenv::getenv("SECRET_KEY") };
+    if (config.API_KEY.empty() || config.SECRET_KEY.empty()) {
+        std::cerr << "Please set API_KEY and SECRET_KEY in the .env file" << std::endl;
+        return {};
+    }
+    std::optional<std::vector<Bitfinex::ApiKey>> extra_keys = Bitfinex::parse_api_keys(dotenv::getenv("EXTRA_KEYS"));
+    if (!extra_keys.has_value()) {
+        std::cerr << "EXTRA_KEYS of the .env file must be KEY:SECRET pairs separated by commas" << std::endl;
+        return {};
+    }
+    config.EXTRA_KEYS = std::move(extra_keys.value());
+    return config;
+}
+
+int main(int argc, char** argv)
+{
+    boost::program_options::options_description options("Supported benchmarks");
+    options.add_options()("help", "print help message");
+    options.add_options()("async-throughput", "Compare blocking and async new order and cancel round trips against --base-url, a local trader-simulator by "
+                                              "default. One signed request is in flight at a time per API key, async or not, add EXTRA_KEYS to the .env file for more");
+    options.add_options()("ack-latency", "Compare REST and websocket new order and cancel acks against --base-url and --ws-url, a local trader-simulator by default");
+    options.add_options()("base-url", boost::program_options::value<std::string>()->default_value("http://127.0.0.1:8766"), "REST endpoint of --async-throughput and --ack-latency");
+    options.add_options()("ws-url", boost::program_options::value<std::string>()->default_value("ws://127.0.0.1:8766/ws/2"), "Authenticated websocket endpoint of --ack-latency");
+    options.add_options()("symbol", boost::program_options::value<std::string>()->default_value("tTESTBTC:TESTUSD"), "Symbol of the orders placed by --async-throughput and --ack-latency");
+    options.add_options()("price", boost::program_options::value<std::string>()->default_value("30000"), "Buy price of the orders placed by --async-throughput and --ack-latency, away from the market so that they rest");
+    options.add_options()("amount", boost::program_options::value<std::string>()->default_value("0.001"), "Amount of the orders placed by --async-throughput and --ack-latency");
+    options.add_options()("signing", "Compare one-shot and reused HMAC-SHA384 request signing");
+    options.add_options()("market-book", "Measure price level book updates and checksum validation");
+    options.add_options()("market-data", "Fan top of book records out to subscriber processes through shared memory");
+    options.add_options()("subscribers", boost::program_options::value<unsigned>()->default_value(4), "Number of subscriber processes");
+    options.add_options()("updates", boost::program_options::value<size_t>()->default_value(1000000), "Number of published records");
+    options.add_options()("publish-rate", boost::program_options::value<double>()->default_value(100000), "Records published per second, 0 for as fast as possible");
+    options.add_options()("raw-book", "Replay raw (R0) book events and measure memory per live order");
+    options.add_options()("events", boost::program_options::value<size_t>()->default_value(5000000), "Number of replayed book events");
+    options.add_options()("live-orders", boost::program_options::value<size_t>()->default_value(100000), "Number of orders kept in the replayed book");
+    options.add_options()("decode", "Compare the streaming response decoder with the nlohmann DOM");
+    options.add_options()("records", boost::program_options::value<size_t>()->default_value(100000), "Number of records in the synthetic responses");
+    options.add_options()("orders-file", boost::program_options::value<std::string>()->default_value(""), "Recorded /v2/auth/r/orders response");
+    options.add_options()("positions-file", boost::program_options::value<std::string>()->default_value(""), "Recorded /v2/auth/r/positions response");
+    options.add_options()("history", "Compare the columnar history store with raw JSON in size and scan speed");
+    options.add_options()("trades", boost::program_options::value<size_t>()->default_value(1000000), "Number of trades of the day stored by --history");
+    options.add_options()("micro", "Run the microbenchmarks of the client hot paths");
+    options.add_options()("data-dir", boost::program_options::value<std::string>()->default_value(BENCH_DATA_DIR), "Recorded responses used by --micro");
+    options.add_options()("filter", boost::program_options::value<std::string>()->default_value(""), "Only run the microbenchmarks whose name contains this");
+    options.add_options()("json", boost::program_options::value<std::string>()->default_value(""), "Also write the --micro results as JSON to this file");
+    options.add_options()("iterations", boost::program_options::value<size_t>()->default_value(200000), "Number of iterations per microbenchmark");
+    options.add_options()("requests", boost::program_options::value<size_t>()->default_value(500), "Number of requests per run");
+
+    try {
+        boost::program_options::variables_map variables_map;
+        boost::program_options::store(boost::program_options::parse_command_line(argc, argv, options), variables_map);
+        boost::program_options::notify(variables_map);
+
+        const size_t requests = variables_map["requests"].as<size_t>();
+        if (variables_map.count("async-throughput") || variables_map.count("ack-latency")) {
+            std::optional<Bitfinex::Config> config = load_config(variables_map["base-url"].as<std::string>());
+            if (!config.has_value())
+                return 1;
+            std::optional<Bitfinex::Decimal> price = Bitfinex::Decimal::parse(variables_map["price"].as<std::string>());
+            std::optional<Bitfinex::Decimal> amount = Bitfinex::Decimal::parse(variables_map["amount"].as<std::string>());
+            if (!price.has_value() || !amount.has_value())
+                throw boost::program_options::validation_error(boost::program_options::validation_error::invalid_option_value, price.has_value() ? "amount" : "price");
+            const Bitfinex::Order order { .order_id = 0, .creation_time_ms = 0, .amount = amount.value(), .price = price.value(),
+                .symbol = Bitfinex::intern_symbol(variables_map["symbol"].as<std::string>()), .side = Bitfinex::OrderSide::BUY,
+                .type = Bitfinex::OrderType::EXCHANGE_LIMIT };
+            if (variables_map.count("async-throughput"))
+                Bench::async_throughput(config.value(), order, requests);
+            else
+                Bench::ack_latency(config.value(), variables_map["ws-url"].as<std::string>(), order, requests);
+        } else if (variables_map.count("signing")) {
+            Bench::signing(variables_map["iterations"].as<size_t>());
+        } else if (variables_map.count("market-book")) {
+            Bench::market_book(variables_map["iterations"].as<size_t>());
+        } else if (variables_map.count("market-data")) {
+            Bench::market_data(variables_map["updates"].as<size_t>(), variables_map["subscribers"].as<unsigned>(), variables_map["publish-rate"].as<double>());
+        } else if (variables_map.count("raw-book")) {
+            Bench::raw_book(variables_map["events"].as<size_t>(), variables_map["live-orders"].as<size_t>());
+        } else if (variables_map.count("decode")) {
+            Bench::decoding(variables_map["records"].as<size_t>(), variables_map["orders-file"].as<std::string>(),
+                variables_map["positions-file"].as<std::string>());
+        } else if (variables_map.count("history")) {
+            Bench::history(variables_map["trades"].as<size_t>());
+        } else if (variables_map.count("micro")) {
+            Bench::micro(variables_map["data-dir"].as<std::string>(), variables_map["iterations"].as<size_t>(), variables_map["filter"].as<std::string>(),
+                variables_map["json"].as<std::string>());
+        } else
+            std::cout << options << std::endl;
+    } catch (const std::exception& err) {
+        std::cerr << err.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
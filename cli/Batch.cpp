@@ -0,0 +1,131 @@
+#include <Batch.h>
+#include <boost/algorithm/string/classification.hpp>
+#include <boost/algorithm/string/split.hpp>
+#include <boost/algorithm/string/trim.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/thread_pool.hpp>
+#include <chrono>
+#include <condition_variable>
+#include <istream>
+#include <map>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+
+namespace Cli {
+
+std::vector<std::string> batch_line_arguments(std::string_view line)
+{
+    std::vector<std::string> words;
+    boost::split(words, line, boost::is_space(), boost::token_compress_on);
+    std::erase(words, "");
+    if (words.empty())
+        throw std::invalid_argument("empty command");
+
+    std::string const& command = words[0];
+    auto expect = [&words](size_t count, char const* usage) {
+        if (words.size() != count + 1)
+            throw std::invalid_argument(std::string("expected: ") + usage);
+    };
+    if (command == "order") {
+        expect(5, "order SIDE SYMBOL TYPE AMOUNT PRICE");
+        return { "--order", "--side=" + words[1], "--symbol=" + words[2], "--type=" + words[3], "--amount=" + words[4], "--price=" + words[5] };
+    }
+    if (command == "cancel") {
+        expect(1, "cancel ORDER_ID");
+        return { "--cancel-order=" + words[1] };
+    }
+    if (command == "ticker") {
+        expect(1, "ticker SYMBOL");
+        return { "--ticker=" + words[1] };
+    }
+    if (command == "tickers") {
+        if (words.size() > 2)
+            throw std::invalid_argument("expected: tickers [SYMBOL,SYMBOL,...]");
+        return { "--tickers=" + (words.size() == 2 ? words[1] : std::string("ALL")) };
+    }
+    if (command == "order-book") {
+        expect(1, "order-book SYMBOL");
+        return { "--order-book=" + words[1] };
+    }
+    if (command == "positions") {
+        expect(0, "positions");
+        return { "--retrieve-positions" };
+    }
+    if (command == "increase-position") {
+        expect(3, "increase-position SIDE SYMBOL AMOUNT");
+        return { "--increase-position", "--position-side=" + words[1], "--position-symbol=" + words[2], "--position-amount=" + words[3] };
+    }
+    throw std::invalid_argument("unknown command " + command);
+}
+
+static std::string result_line(size_t line_number, std::string const& command, int exit_code, double milliseconds, nlohmann::json result, std::string error)
+{
+    nlohmann::json entry = { { "line", line_number }, { "command", command }, { "exit_code", exit_code }, { "latency_ms", milliseconds },
+        { "result", std::move(result) } };
+    boost::trim_right(error);
+    if (!error.empty())
+        entry["error"] = std::move(error);
+    return entry.dump();
+}
+
+int run_batch(std::istream& in, std::ostream& out, Dispatcher& dispatcher, BatchOptions const& options)
+{
+    std::mutex mutex;
+    std::condition_variable finished_signal;
+    size_t started = 0;
+    size_t finished = 0;
+    size_t next_to_write = 0;
+    // Results waiting for the ones of earlier lines, by input position
+    std::map<size_t, std::string> pending;
+    int highest_exit_code = 0;
+
+    auto finish = [&](size_t position, std::string line, int exit_code) {
+        std::lock_guard lock(mutex);
+        highest_exit_code = std::max(highest_exit_code, exit_code);
+        if (options.completion_order) {
+            out << line << std::endl;
+        } else {
+            pending.emplace(position, std::move(line));
+            for (auto next = pending.begin(); next != pending.end() && next->first == next_to_write; next = pending.erase(next), next_to_write++)
+                out << next->second << '\n';
+            out.flush();
+        }
+        finished++;
+        finished_signal.notify_all();
+    };
+
+    boost::asio::thread_pool workers(std::max(1u, options.concurrency));
+    std::string line;
+    for (size_t line_number = 1; std::getline(in, line); line_number++) {
+        boost::trim(line);
+        if (line.empty() || line[0] == '#')
+            continue;
+        if (line == "wait") {
+            std::unique_lock lock(mutex);
+            finished_signal.wait(lock, [&] { return finished == started; });
+            continue;
+        }
+
+        const size_t position = started++;
+        std::vector<std::string> arguments;
+        try {
+            arguments = batch_line_arguments(line);
+        } catch (const std::invalid_argument& error) {
+            finish(position, result_line(line_number, line, 1, 0, nlohmann::json::object(), error.what()), 1);
+            continue;
+        }
+        boost::asio::post(workers, [&dispatcher, &finish, position, line_number, line, arguments = std::move(arguments)] {
+            const auto start = std::chrono::steady_clock::now();
+            std::ostringstream text, errors;
+            CommandOutput output { .out = text, .err = errors };
+            const int exit_code = dispatcher.run(arguments, output);
+            const double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            finish(position, result_line(line_number, line, exit_code, milliseconds, std::move(output.result), std::move(errors).str()), exit_code);
+        });
+    }
+    workers.join();
+    return highest_exit_code;
+}
+
+}
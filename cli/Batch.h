@@ -0,0 +1,34 @@
+#pragma once
+
+#include <Commands.h>
+#include <iosfwd>
+#include <string_view>
+#include <vector>
+
+namespace Cli {
+
+struct BatchOptions {
+    // Commands in flight at once
+    unsigned concurrency { 8 };
+    // Results in the order of the input lines, or as soon as each command is done
+    bool completion_order { false };
+};
+
+// The command line options of one batch line, throws std::invalid_argument for a line that is
+// not one of:
+//   order SIDE SYMBOL TYPE AMOUNT PRICE
+//   cancel ORDER_ID
+//   ticker SYMBOL
+//   tickers [SYMBOL,SYMBOL,...]
+//   order-book SYMBOL
+//   positions
+//   increase-position SIDE SYMBOL AMOUNT
+std::vector<std::string> batch_line_arguments(std::string_view line);
+
+// Runs the commands read from in, one per line, and writes one JSON object per command to out.
+// Commands run concurrently, a line reading "wait" holds the next ones back until every command
+// before it is done. Blank lines and lines starting with # are skipped. Returns the highest exit
+// code of the commands.
+int run_batch(std::istream& in, std::ostream& out, Dispatcher&, BatchOptions const&);
+
+}
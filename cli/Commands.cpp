@@ -0,0 +1,779 @@
+#include <Commands.h>
+#include <Bitfinex/ENUMS.h>
+#include <Bitfinex/FeedHandler.h>
+#include <Bitfinex/MarketData.h>
+#include <Bitfinex/OrderMessages.h>
+#include <Bitfinex/Positions.h>
+#include <boost/algorithm/string/classification.hpp>
+#include <boost/algorithm/string/split.hpp>
+#include <boost/algorithm/string/trim.hpp>
+#include <cmath>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+namespace Cli {
+
+class SideValue : public boost::program_options::typed_value<std::string>
+{
+public:
+    SideValue(std::string* store_to) : boost::program_options::typed_value<std::string>(store_to) {}
+
+    virtual void xparse(boost::any& v, const std::vector<std::string>& values) const override
+    {
+        boost::program_options::validators::check_first_occurrence(v);
+        const std::string& side = boost::program_options::validators::get_single_string(values);
+        if (!Bitfinex::is_valid_order_side(side))
+            throw boost::program_options::validation_error(boost::program_options::validation_error::invalid_option_value, "side");
+
+        v = boost::any(Bitfinex::order_side_from_string(side));
+    }
+};
+
+class TypeValue : public boost::program_options::typed_value<std::string>
+{
+public:
+    TypeValue(std::string* store_to) : boost::program_options::typed_value<std::string>(store_to) {}
+
+    virtual void xparse(boost::any& v, const std::vector<std::string>& values) const override
+    {
+        boost::program_options::validators::check_first_occurrence(v);
+        const std::string& type = boost::program_options::validators::get_single_string(values);
+        if (!Bitfinex::is_valid_order_type(type))
+            throw boost::program_options::validation_error(boost::program_options::validation_error::invalid_option_value, "type");
+        // An error rather than an exit, the daemon parses the options of its clients
+        if (type != "exchange_limit")
+            throw boost::program_options::error("oops ! Only exchange limit orders are supported at this time");
+        v = boost::any(Bitfinex::order_type_from_string(type));
+    }
+};
+
+class PositionSide : public boost::program_options::typed_value<std::string>
+{
+public:
+    PositionSide(std::string* store_to) : boost::program_options::typed_value<std::string>(store_to) {}
+
+    virtual void xparse(boost::any& v, const std::vector<std::string>& values) const override
+    {
+        boost::program_options::validators::check_first_occurrence(v);
+        const std::string& side = boost::program_options::validators::get_single_string(values);
+        if (!Bitfinex::is_valid_position_side(side))
+            throw boost::program_options::validation_error(boost::program_options::validation_error::invalid_option_value, "position-side");
+
+        v = boost::any(Bitfinex::position_side_from_string(side));
+    }
+};
+
+// Names typed by the user are only registered until the exchange's symbol list is loaded. After
+// that an unknown name is a typo or an unlisted pair, and would hold a slot of the symbol table
+// for the rest of the process.
+static std::optional<Bitfinex::SymbolId> user_symbol(std::string_view name)
+{
+    if (std::optional<Bitfinex::SymbolId> id = Bitfinex::find_symbol(name))
+        return id;
+    if (name.empty() || Bitfinex::symbols_loaded())
+        return {};
+    return Bitfinex::intern_symbol(name);
+}
+
+class SymbolValue : public boost::program_options::typed_value<std::string>
+{
+public:
+    SymbolValue(std::string* store_to) : boost::program_options::typed_value<std::string>(store_to) {}
+
+    virtual void xparse(boost::any& v, const std::vector<std::string>& values) const override
+    {
+        boost::program_options::validators::check_first_occurrence(v);
+        std::optional<Bitfinex::SymbolId> symbol = user_symbol(boost::program_options::validators::get_single_string(values));
+        if (!symbol.has_value())
+            throw boost::program_options::validation_error(boost::program_options::validation_error::invalid_option_value, "symbol");
+
+        v = boost::any(symbol.value());
+    }
+};
+
+// Order ids are read here, the client only takes them as numbers
+class OrderIdValue : public boost::program_options::typed_value<std::string>
+{
+public:
+    OrderIdValue(std::string* store_to) : boost::program_options::typed_value<std::string>(store_to) {}
+
+    virtual void xparse(boost::any& v, const std::vector<std::string>& values) const override
+    {
+        boost::program_options::validators::check_first_occurrence(v);
+        std::optional<uint64_t> order_id = Bitfinex::parse_order_id(boost::program_options::validators::get_single_string(values));
+        if (!order_id.has_value())
+            throw boost::program_options::validation_error(boost::program_options::validation_error::invalid_option_value, "cancel-order");
+
+        v = boost::any(order_id.value());
+    }
+};
+
+class PositiveDecimalValue : public boost::program_options::typed_value<std::string>
+{
+public:
+    PositiveDecimalValue(std::string* store_to, char const* option_name) : boost::program_options::typed_value<std::string>(store_to), m_option_name(option_name) {}
+
+    virtual void xparse(boost::any& v, const std::vector<std::string>& values) const override
+    {
+        boost::program_options::validators::check_first_occurrence(v);
+        std::optional<Bitfinex::Decimal> value = Bitfinex::Decimal::parse(boost::program_options::validators::get_single_string(values));
+        if (!value.has_value() || value.value() <= Bitfinex::Decimal {})
+            throw boost::program_options::validation_error(boost::program_options::validation_error::invalid_option_value, m_option_name);
+
+        v = boost::any(value.value());
+    }
+
+private:
+    char const* m_option_name;
+};
+
+boost::program_options::options_description command_options()
+{
+    boost::program_options::options_description general_options("Supported general options");
+    general_options.add_options()("help", "print help message");
+    general_options.add_options()("order", "Place a new order");
+    general_options.add_options()("order-file", boost::program_options::value<std::string>(), "Place every order listed in the given file (one \"side symbol type amount price\" per line) in bulk");
+    general_options.add_options()("ticker", new SymbolValue(nullptr), "Print information about the given ticker");
+    general_options.add_options()("tickers", boost::program_options::value<std::string>()->implicit_value("ALL"),
+        "Print a table of the tickers of the given comma separated symbols, of every trading pair without any, fetched in a single request");
+    general_options.add_options()("cancel-order", new OrderIdValue(nullptr), "Cancel order with the given order id");
+    general_options.add_options()("order-book", new SymbolValue(nullptr), "Retrieve order book for given symbol");
+    general_options.add_options()("increase-position", "Create a new position using the funds in your margin wallet");
+    general_options.add_options()("retrieve-positions", "Get active positions");
+    general_options.add_options()("stream", boost::program_options::value<std::string>(), "Stream live tickers and trades for the given comma separated symbols");
+    general_options.add_options()("symbols-file", boost::program_options::value<std::string>(), "Preload trading pairs and their order size limits from a saved /v2/conf/pub:info:pair response");
+
+    boost::program_options::options_description stream_options("Supported stream options");
+    stream_options.add_options()("feed-url", boost::program_options::value<std::string>()->default_value("wss://api-pub.bitfinex.com/ws/2"), "Websocket endpoint of the public feed");
+    stream_options.add_options()("duration", boost::program_options::value<unsigned>()->default_value(30), "How long to stream for, in seconds");
+    stream_options.add_options()("record", boost::program_options::value<std::string>(), "Write every received frame to the given file, one per line");
+    stream_options.add_options()("publish", boost::program_options::value<std::string>()->implicit_value("/trader-market-data"),
+        "Also publish top of book, trades and tickers to local processes through this shared memory ring");
+
+    boost::program_options::options_description order_options("Supported order options");
+    order_options.add_options()("side", new SideValue(nullptr), "Order side [BUY, SELL]");
+    order_options.add_options()("symbol", new SymbolValue(nullptr), "The trading pair symbol to submit the order on.");
+    order_options.add_options()("amount", new PositiveDecimalValue(nullptr, "amount"), "Amount of order");
+    order_options.add_options()("type", new TypeValue(nullptr), "The type of the order");
+    order_options.add_options()("price", new PositiveDecimalValue(nullptr, "price"), "Price of the order");
+
+    boost::program_options::options_description increase_position_options("Supported increase position options");
+    increase_position_options.add_options()("position-side", new PositionSide(nullptr), "Position side (short,long)");
+    increase_position_options.add_options()("position-symbol", new SymbolValue(nullptr), "Trading pair on which you wish to open a position");
+    increase_position_options.add_options()("position-amount", new PositiveDecimalValue(nullptr, "position-amount"), "Amount of the position");
+
+    boost::program_options::options_description all_options("all options");
+    all_options.add(general_options).add(order_options).add(increase_position_options).add(stream_options);
+    return all_options;
+}
+
+bool has_command(boost::program_options::variables_map const& variables_map)
+{
+    for (char const* command : { "stream", "retrieve-positions", "increase-position", "order-book", "cancel-order", "ticker", "tickers", "order-file", "order" }) {
+        if (variables_map.count(command))
+            return true;
+    }
+    return false;
+}
+
+static Bitfinex::Decimal read_positive_decimal_from_cli()
+{
+    std::string user_input;
+    while (true) {
+        std::getline(std::cin, user_input);
+        std::optional<Bitfinex::Decimal> value = Bitfinex::Decimal::parse(user_input);
+        if (!value.has_value() || value.value() <= Bitfinex::Decimal {})
+            std::cerr << "Please enter a positive number:" << std::endl;
+        else
+            return value.value();
+    }
+}
+
+static std::string read_string_from_cli(std::vector<std::string> const &allowed_values)
+{
+    std::string user_input;
+    while (true) {
+        std::getline(std::cin, user_input);
+        boost::trim(user_input);
+        if (std::count(allowed_values.begin(), allowed_values.end(), user_input) > 0)
+            break;
+    }
+    return user_input;
+}
+
+bool load_symbols_file(std::string const& path, std::ostream& err)
+{
+    std::ifstream file(path);
+    std::stringstream pair_info;
+    pair_info << file.rdbuf();
+    if (!file || !Bitfinex::load_symbols(pair_info.str()).has_value()) {
+        err << "Could not load symbols from " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// PUBLIC_ENDPOINT in the .env file points the public endpoints somewhere else, e.g. at trader-simulator
+static std::string public_endpoint()
+{
+    return dotenv::getenv("PUBLIC_ENDPOINT", Bitfinex::Client::DEFAULT_PUBLIC_ENDPOINT);
+}
+
+bool load_exchange_symbols(std::ostream& err)
+{
+    if (!Bitfinex::Client::load_symbols(public_endpoint()).has_value()) {
+        err << "Could not load the trading pairs from " << public_endpoint() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// The exchange only keeps a few significant digits of a price
+static Bitfinex::Decimal round_price_for_exchange(Bitfinex::SymbolId symbol, Bitfinex::Decimal price, std::ostream& out)
+{
+    Bitfinex::Decimal rounded = Bitfinex::round_price(symbol, price);
+    if (rounded != price)
+        out << "Rounded price " << price << " to " << rounded << " for pair " << Bitfinex::symbol_name(symbol) << std::endl;
+    return rounded;
+}
+
+// Size limits are only known for symbols preloaded with --symbols-file
+static bool is_valid_order_size(Bitfinex::Order const& order, std::ostream& err)
+{
+    Bitfinex::SymbolInfo info = Bitfinex::symbol_info(order.symbol);
+    if (!info.minimum_order_size.is_zero() && order.amount < info.minimum_order_size) {
+        err << "The minimum order size for pair " << info.name << " is " << info.minimum_order_size << std::endl;
+        return false;
+    }
+    if (!info.maximum_order_size.is_zero() && order.amount > info.maximum_order_size) {
+        err << "The maximum order size for pair " << info.name << " is " << info.maximum_order_size << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// One order per line: side symbol type amount price, e.g. "buy tTESTBTC:TESTUSD exchange_limit 0.1 8000"
+static std::optional<std::vector<Bitfinex::Order>> read_orders_from_file(std::string const& path, std::ostream& out, std::ostream& err)
+{
+    std::ifstream file(path);
+    if (!file) {
+        err << "Could not open " << path << std::endl;
+        return {};
+    }
+    std::vector<Bitfinex::Order> orders;
+    std::string line;
+    for (size_t line_number = 1; std::getline(file, line); line_number++) {
+        boost::trim(line);
+        if (line.empty() || line[0] == '#')
+            continue;
+        std::istringstream fields(line);
+        std::string side, symbol, type, amount_text, price_text;
+        std::optional<Bitfinex::Decimal> amount, price;
+        std::optional<Bitfinex::SymbolId> symbol_id;
+        if (fields >> side >> symbol >> type >> amount_text >> price_text) {
+            amount = Bitfinex::Decimal::parse(amount_text);
+            price = Bitfinex::Decimal::parse(price_text);
+        }
+        if (!amount.has_value() || !price.has_value() || !Bitfinex::is_valid_order_side(side) || !Bitfinex::is_valid_order_type(type)
+            || amount.value() <= Bitfinex::Decimal {} || price.value() <= Bitfinex::Decimal {}) {
+            err << path << ":" << line_number << ": invalid order, expected: side symbol type amount price" << std::endl;
+            return {};
+        }
+        if (type != "exchange_limit") {
+            err << path << ":" << line_number << ": only exchange limit orders are supported at this time" << std::endl;
+            return {};
+        }
+        symbol_id = user_symbol(symbol);
+        if (!symbol_id.has_value()) {
+            err << path << ":" << line_number << ": unknown symbol " << symbol << std::endl;
+            return {};
+        }
+        orders.push_back(Bitfinex::Order { .order_id = 0, .creation_time_ms = 0, .amount = amount.value(), .price = price.value(), .symbol = symbol_id.value(),
+                                .side = Bitfinex::order_side_from_string(side), .type = Bitfinex::order_type_from_string(type) });
+        if (!is_valid_order_size(orders.back(), err)) {
+            err << path << ":" << line_number << ": invalid order size" << std::endl;
+            return {};
+        }
+        orders.back().price = round_price_for_exchange(orders.back().symbol, orders.back().price, out);
+    }
+    return orders;
+}
+
+static nlohmann::json order_response_to_json(Bitfinex::OrderResponse const& response)
+{
+    nlohmann::json result = { { "http_status", response.http_status }, { "status", response.message } };
+    if (response.http_status != 200 || response.message != "SUCCESS")
+        return result;
+    result["order_id"] = response.order_id;
+    result["symbol"] = std::string(Bitfinex::symbol_name(response.symbol));
+    result["side"] = order_side_to_string(response.side);
+    result["type"] = response.type;
+    result["amount"] = response.amount.to_string();
+    result["price"] = response.price.to_string();
+    return result;
+}
+
+static nlohmann::json order_to_json(Bitfinex::Order const& order)
+{
+    return { { "order_id", order.order_id }, { "creation_time_ms", order.creation_time_ms }, { "symbol", std::string(Bitfinex::symbol_name(order.symbol)) },
+        { "side", order_side_to_string(order.side) }, { "type", order_type_to_string(order.type) }, { "amount", order.amount.to_string() },
+        { "price", order.price.to_string() } };
+}
+
+static nlohmann::json ticker_to_json(Bitfinex::TickerUpdate const& ticker)
+{
+    return { { "symbol", std::string(Bitfinex::symbol_name(ticker.symbol)) }, { "bid", ticker.bid }, { "bid_size", ticker.bid_size }, { "ask", ticker.ask },
+        { "ask_size", ticker.ask_size }, { "daily_change", ticker.daily_change }, { "daily_change_relative", ticker.daily_change_relative },
+        { "last_price", ticker.last_price }, { "volume", ticker.volume }, { "high", ticker.high }, { "low", ticker.low } };
+}
+
+static nlohmann::json position_to_json(Bitfinex::Position const& position)
+{
+    return { { "symbol", std::string(Bitfinex::symbol_name(position.symbol)) }, { "status", position_status_to_string(position.status) },
+        { "amount", position.amount.to_string() }, { "base_price", position.base_price.to_string() } };
+}
+
+// Reads the .env file first, the ticker service is configured from it
+static Bitfinex::TickerServiceOptions ticker_service_options()
+{
+    dotenv::init(".env");
+    return { .public_endpoint = public_endpoint() };
+}
+
+Dispatcher::Dispatcher(bool interactive, Bitfinex::Journal* journal)
+    : m_interactive(interactive)
+    , m_journal(journal)
+    , m_options(command_options())
+    , m_tickers(ticker_service_options())
+{
+}
+
+bool Dispatcher::configure(std::ostream& err)
+{
+    return client(err) != nullptr;
+}
+
+bool Dispatcher::warm_up(std::ostream& err)
+{
+    Bitfinex::Client* configured = client(err);
+    if (!configured)
+        return false;
+    configured->warm_up();
+    return true;
+}
+
+Bitfinex::Client* Dispatcher::client(std::ostream& err)
+{
+    std::lock_guard lock(m_mutex);
+    if (m_client)
+        return m_client.get();
+
+    if (dotenv::getenv("BASE_ENDPOINT").empty()) {
+        err << "Please set BASE_ENDPOINT in the .env file" << std::endl;
+        return nullptr;
+    }
+    if (dotenv::getenv("API_KEY").empty()) {
+        err << "Please set API_KEY in the .env file" << std::endl;
+        return nullptr;
+    }
+    if (dotenv::getenv("SECRET_KEY").empty()) {
+        err << "Please set SECRET_KEY in the .env file" << std::endl;
+        return nullptr;
+    }
+
+    std::optional<std::vector<Bitfinex::ApiKey>> extra_keys = Bitfinex::parse_api_keys(dotenv::getenv("EXTRA_KEYS"));
+    if (!extra_keys.has_value()) {
+        err << "EXTRA_KEYS of the .env file must be KEY:SECRET pairs separated by commas" << std::endl;
+        return nullptr;
+    }
+
+    Bitfinex::Config config { .BASE_ENDPOINT = dotenv::getenv("BASE_ENDPOINT"), .API_KEY = dotenv::getenv("API_KEY"),
+        .SECRET_KEY = dotenv::getenv("SECRET_KEY"), .EXTRA_KEYS = std::move(extra_keys.value()) };
+    m_client = std::make_unique<Bitfinex::Client>(config);
+    m_client->set_journal(m_journal);
+    return m_client.get();
+}
+
+int Dispatcher::run(boost::program_options::variables_map const& variables_map, CommandOutput& output)
+{
+    if (variables_map.count("symbols-file") && !load_symbols_file(variables_map["symbols-file"].as<std::string>(), output.err))
+        return 1;
+
+    if (variables_map.count("stream"))
+        return stream(variables_map, output);
+    if (variables_map.count("retrieve-positions"))
+        return retrieve_positions(output);
+    if (variables_map.count("increase-position"))
+        return increase_position(variables_map, output);
+    if (variables_map.count("order-book"))
+        return retrieve_orders(variables_map["order-book"].as<Bitfinex::SymbolId>(), output);
+    if (variables_map.count("cancel-order"))
+        return cancel_order(variables_map["cancel-order"].as<uint64_t>(), output);
+    if (variables_map.count("ticker"))
+        return get_ticker_info(variables_map["ticker"].as<Bitfinex::SymbolId>(), output);
+    if (variables_map.count("tickers"))
+        return print_tickers(variables_map["tickers"].as<std::string>(), output);
+    if (variables_map.count("order-file"))
+        return place_orders_from_file(variables_map["order-file"].as<std::string>(), output);
+    if (variables_map.count("order"))
+        return place_order(variables_map, output);
+    output.out << command_options() << std::endl;
+    return 0;
+}
+
+int Dispatcher::run(std::vector<std::string> const& arguments, CommandOutput& output)
+{
+    try {
+        boost::program_options::variables_map variables_map;
+        boost::program_options::store(boost::program_options::command_line_parser(arguments).options(m_options).run(), variables_map);
+        boost::program_options::notify(variables_map);
+        return run(variables_map, output);
+    } catch (const std::exception& exception) {
+        output.err << exception.what() << std::endl;
+        return 1;
+    }
+}
+
+int Dispatcher::place_order(boost::program_options::variables_map const& variables_map, CommandOutput& output)
+{
+    if (variables_map.count("side") == 0)
+        throw boost::program_options::required_option("side");
+    if (variables_map.count("symbol") == 0)
+        throw boost::program_options::required_option("symbol");
+    if (variables_map.count("amount") == 0)
+        throw boost::program_options::required_option("amount");
+    if (variables_map.count("type") == 0)
+        throw boost::program_options::required_option("type");
+    if (variables_map.count("price") == 0)
+        throw boost::program_options::required_option("price");
+
+    Bitfinex::Client* client = this->client(output.err);
+    if (!client)
+        return 1;
+
+    Bitfinex::Order order { .order_id = 0, .creation_time_ms = 0, .amount = variables_map["amount"].as<Bitfinex::Decimal>(), .price = variables_map["price"].as<Bitfinex::Decimal>(),
+                                .symbol = variables_map["symbol"].as<Bitfinex::SymbolId>(),
+                                    .side = variables_map["side"].as<Bitfinex::OrderSide>(), .type = variables_map["type"].as<Bitfinex::OrderType>() };
+    if (!is_valid_order_size(order, output.err))
+        return 1;
+    order.price = round_price_for_exchange(order.symbol, order.price, output.out);
+
+    Bitfinex::OrderResponse order_response = client->submit_order(order);
+    output.result = order_response_to_json(order_response);
+    if (order_response.http_status != 200) {
+        output.err << "An error occurred, please try again later" << std::endl;
+        return 1;
+    }
+    if (order_response.message != "SUCCESS") {
+        output.err << "Oops ! order didn't go through" << std::endl;
+        return 2;
+    }
+
+    output.out << std::format(R"(Placed a {} {} order for pair {} for the price of {} for {} amount, order id: ({}))", order_response.type, order_side_to_string(order_response.side), Bitfinex::symbol_name(order_response.symbol)
+                                , order_response.price, order_response.amount, order_response.order_id) << std::endl;
+    // The daemon has no terminal to ask on, its clients change or cancel the order with further commands
+    if (!m_interactive)
+        return 0;
+
+    output.out << "Would you like to change the order price ? (y,n) " << std::endl;
+    if (read_string_from_cli({"yes", "y", "no", "n"})[0] == 'y') {
+        std::optional<Bitfinex::TickerUpdate> ticker = m_tickers.get(order_response.symbol);
+        if (ticker.has_value()) {
+            double suggested_price = ticker->last_price * order.amount.to_double();
+            output.out << "last trade price for pair " << Bitfinex::symbol_name(order.symbol) << " for the amount " << order.amount << " is " << suggested_price
+                      << " to make sure the order does not fill offer a much higher/lower price" << std::endl;
+        }
+        output.out << "Please enter the new order price:" << std::endl;
+        Bitfinex::Decimal new_price = round_price_for_exchange(order.symbol, read_positive_decimal_from_cli(), output.out);
+        order_response = client->update_order(order_response.order_id, new_price);
+
+        if (order_response.http_status != 200) {
+            output.err << "An error occurred, please try again later" << std::endl;
+            return 1;
+        }
+        if (order_response.message != "SUCCESS")
+            output.err << "Oops ! could not update the price" << std::endl;
+        else
+            output.out << "Successfully changed order price to " << order_response.price << std::endl;
+    }
+
+    output.out << "Would you like to cancel the order (" << order_response.order_id << ") ? (y,n)" << std::endl;
+    if (read_string_from_cli({"yes", "y", "no", "n"})[0] == 'y') {
+        order_response = client->cancel_order(order_response.order_id);
+
+        if (order_response.http_status != 200) {
+            output.err << "An error occurred, please try again later" << std::endl;
+            return 1;
+        }
+        if (order_response.message != "SUCCESS") {
+            output.err << "Oops ! could not cancel order" << std::endl;
+            return 2;
+        }
+
+        output.out << "Successfully submitted order (" << order_response.order_id << ") for cancellation" << std::endl;
+    }
+    return 0;
+}
+
+int Dispatcher::place_orders_from_file(std::string const& path, CommandOutput& output)
+{
+    Bitfinex::Client* client = this->client(output.err);
+    if (!client)
+        return 1;
+
+    std::optional<std::vector<Bitfinex::Order>> orders = read_orders_from_file(path, output.out, output.err);
+    if (!orders.has_value())
+        return 1;
+    if (orders.value().empty()) {
+        output.out << "No orders found in " << path << std::endl;
+        return 0;
+    }
+
+    std::vector<Bitfinex::OrderResponse> order_responses = client->submit_orders(orders.value());
+    size_t placed = 0;
+    output.result["orders"] = nlohmann::json::array();
+    for (size_t i = 0; i < order_responses.size(); i++) {
+        Bitfinex::OrderResponse const& order_response = order_responses[i];
+        Bitfinex::Order const& order = orders.value()[i];
+        output.result["orders"].push_back(order_response_to_json(order_response));
+        if (order_response.http_status != 200)
+            output.err << "An error occurred while placing order #" << i + 1 << " on pair " << Bitfinex::symbol_name(order.symbol) << std::endl;
+        else if (order_response.message != "SUCCESS")
+            output.err << "Oops ! order #" << i + 1 << " on pair " << Bitfinex::symbol_name(order.symbol) << " didn't go through: " << order_response.message << std::endl;
+        else {
+            placed++;
+            output.out << std::format(R"(Placed a {} {} order for pair {} for the price of {} for {} amount, order id: ({}))", order_response.type, order_side_to_string(order_response.side), Bitfinex::symbol_name(order_response.symbol)
+                                        , order_response.price, order_response.amount, order_response.order_id) << std::endl;
+        }
+    }
+    output.out << "Placed " << placed << " out of " << order_responses.size() << " orders" << std::endl;
+    output.result["placed"] = placed;
+    return placed == order_responses.size() ? 0 : 2;
+}
+
+int Dispatcher::get_ticker_info(Bitfinex::SymbolId symbol, CommandOutput& output)
+{
+    std::optional<Bitfinex::TickerUpdate> ticker = m_tickers.get(symbol);
+    if (!ticker.has_value()) {
+        output.err << "An error occurred, please try again later" << std::endl;
+        return 1;
+    }
+    output.out << "Price of the last trade: " << ticker->last_price << std::endl;
+    output.out << "Price of last highest bid: " << ticker->bid << std::endl;
+    output.out << "Daily volume: " << ticker->volume << std::endl;
+    output.result = ticker_to_json(ticker.value());
+    return 0;
+}
+
+int Dispatcher::print_tickers(std::string const& symbols_option, CommandOutput& output)
+{
+    std::vector<std::string> names;
+    boost::split(names, symbols_option, boost::is_any_of(","), boost::token_compress_on);
+    std::erase(names, "");
+    if (names.empty())
+        throw boost::program_options::validation_error(boost::program_options::validation_error::invalid_option_value, "tickers");
+
+    std::vector<Bitfinex::TickerUpdate> tickers;
+    if (names.size() == 1 && names[0] == "ALL") {
+        std::optional<std::vector<Bitfinex::TickerUpdate>> fetched = m_tickers.fetch();
+        if (fetched.has_value())
+            tickers = std::move(fetched.value());
+    } else {
+        std::vector<Bitfinex::SymbolId> symbols;
+        for (std::string const& name : names) {
+            if (std::optional<Bitfinex::SymbolId> symbol = user_symbol(name))
+                symbols.push_back(symbol.value());
+            else
+                output.err << "Unknown symbol " << name << std::endl;
+        }
+        std::vector<std::optional<Bitfinex::TickerUpdate>> cached = m_tickers.get(symbols);
+        for (size_t i = 0; i < cached.size(); i++) {
+            if (cached[i].has_value())
+                tickers.push_back(cached[i].value());
+            else
+                output.err << "No ticker for " << Bitfinex::symbol_name(symbols[i]) << std::endl;
+        }
+    }
+    if (tickers.empty()) {
+        output.err << "An error occurred, please try again later" << std::endl;
+        return 1;
+    }
+
+    size_t symbol_width = std::string_view("SYMBOL").size();
+    for (Bitfinex::TickerUpdate const& ticker : tickers)
+        symbol_width = std::max(symbol_width, Bitfinex::symbol_name(ticker.symbol).size());
+    output.out << std::format("{:<{}} {:>14} {:>14} {:>14} {:>9} {:>16} {:>14} {:>14}\n", "SYMBOL", symbol_width, "BID", "ASK", "LAST", "CHANGE%", "VOLUME",
+        "HIGH", "LOW");
+    output.result["tickers"] = nlohmann::json::array();
+    for (Bitfinex::TickerUpdate const& ticker : tickers) {
+        output.out << std::format("{:<{}} {:>14.8g} {:>14.8g} {:>14.8g} {:>9.2f} {:>16.8g} {:>14.8g} {:>14.8g}\n", Bitfinex::symbol_name(ticker.symbol),
+            symbol_width, ticker.bid, ticker.ask, ticker.last_price, ticker.daily_change_relative * 100, ticker.volume, ticker.high, ticker.low);
+        output.result["tickers"].push_back(ticker_to_json(ticker));
+    }
+    output.out << std::flush;
+    return 0;
+}
+
+int Dispatcher::stream(boost::program_options::variables_map const& variables_map, CommandOutput& output)
+{
+    // Its output is only worth anything live
+    if (!m_interactive) {
+        output.err << "--stream only runs in the calling process" << std::endl;
+        return 1;
+    }
+
+    std::vector<std::string> symbols;
+    boost::split(symbols, variables_map["stream"].as<std::string>(), boost::is_any_of(","), boost::token_compress_on);
+    std::erase(symbols, "");
+    if (symbols.empty())
+        throw boost::program_options::validation_error(boost::program_options::validation_error::invalid_option_value, "stream");
+
+    Bitfinex::FeedHandler feed({ .url = variables_map["feed-url"].as<std::string>() });
+    if (m_journal)
+        m_journal->attach(feed);
+    std::ofstream record_file;
+    if (variables_map.count("record")) {
+        record_file.open(variables_map["record"].as<std::string>());
+        if (!record_file) {
+            output.err << "Could not open " << variables_map["record"].as<std::string>() << std::endl;
+            return 1;
+        }
+        feed.on_raw_frame([&record_file](std::string_view frame) {
+            record_file << frame << '\n';
+        });
+    }
+    std::unique_ptr<Bitfinex::MarketDataPublisher> publisher;
+    if (variables_map.count("publish")) {
+        publisher = Bitfinex::MarketDataPublisher::create({ .name = variables_map["publish"].as<std::string>() });
+        if (!publisher) {
+            output.err << "Could not create the shared memory ring " << variables_map["publish"].as<std::string>() << std::endl;
+            return 1;
+        }
+        publisher->attach(feed);
+    }
+    feed.on_ticker([&output](Bitfinex::TickerUpdate const& ticker) {
+        output.out << Bitfinex::symbol_name(ticker.symbol) << " ticker: last " << ticker.last_price << ", bid " << ticker.bid << ", ask " << ticker.ask
+                  << ", volume " << ticker.volume << std::endl;
+    });
+    feed.on_trade([&output](Bitfinex::TradeUpdate const& update) {
+        output.out << Bitfinex::symbol_name(update.symbol) << " trade: " << ((update.trade.amount < 0) ? "sell " : "buy ") << std::abs(update.trade.amount)
+                  << " at " << update.trade.price << std::endl;
+    });
+    for (std::string const& symbol : symbols) {
+        feed.subscribe_ticker(symbol);
+        feed.subscribe_trades(symbol);
+        // The top of book comes from the price level book
+        if (publisher)
+            feed.subscribe_book(symbol);
+    }
+
+    feed.start();
+    std::this_thread::sleep_for(std::chrono::seconds(variables_map["duration"].as<unsigned>()));
+    feed.stop();
+
+    Bitfinex::DecodeStats stats = feed.decode_stats();
+    output.out << "Decoded " << stats.messages << " messages (" << stats.heartbeats << " heartbeats, " << stats.errors << " errors)";
+    if (stats.messages > 0)
+        output.out << ", decode latency avg " << stats.total_ns / stats.messages << " ns, p50 < " << stats.percentile_ns(50)
+                  << " ns, p99 < " << stats.percentile_ns(99) << " ns, max " << stats.max_ns << " ns";
+    output.out << std::endl;
+    if (publisher)
+        output.out << "Published " << publisher->published() << " records to " << publisher->name() << std::endl;
+    return 0;
+}
+
+int Dispatcher::cancel_order(uint64_t order_id, CommandOutput& output)
+{
+    Bitfinex::Client* client = this->client(output.err);
+    if (!client)
+        return 1;
+
+    Bitfinex::OrderResponse order_response = client->cancel_order(order_id);
+    output.result = order_response_to_json(order_response);
+
+    if (order_response.http_status != 200) {
+        output.err << "An error occurred, please try again later" << std::endl;
+        return 1;
+    }
+    if (order_response.message != "SUCCESS") {
+        output.err << "Oops ! could not cancel order" << std::endl;
+        return 2;
+    }
+
+    output.out << "Successfully submitted order (" << order_response.order_id << ") for cancellation" << std::endl;
+    return 0;
+}
+
+int Dispatcher::retrieve_orders(Bitfinex::SymbolId symbol, CommandOutput& output)
+{
+    Bitfinex::Client* client = this->client(output.err);
+    if (!client)
+        return 1;
+
+    std::optional<Bitfinex::OrderBook> order_book = client->retrieve_orders(symbol);
+    if (!order_book.has_value()) {
+        output.err << "An error occurred, please try again later" << std::endl;
+        return 1;
+    }
+    output.result["orders"] = nlohmann::json::array();
+    for (Bitfinex::Order const& order : order_book.value().order_book())
+        output.result["orders"].push_back(order_to_json(order));
+    if (order_book.value().empty())
+        output.out << "Order book is empty" << std::endl;
+    else
+        output.out << order_book.value();
+    return 0;
+}
+
+int Dispatcher::increase_position(boost::program_options::variables_map const& variables_map, CommandOutput& output)
+{
+    if (variables_map.count("position-side") == 0)
+        throw boost::program_options::required_option("position-side");
+    if (variables_map.count("position-symbol") == 0)
+        throw boost::program_options::required_option("position-symbol");
+    if (variables_map.count("position-amount") == 0)
+        throw boost::program_options::required_option("position-amount");
+
+    Bitfinex::Client* client = this->client(output.err);
+    if (!client)
+        return 1;
+
+    Bitfinex::IncreasePositionResponse response = client->increase_position(variables_map["position-side"].as<Bitfinex::PositionSide>(), variables_map["position-symbol"].as<Bitfinex::SymbolId>(), variables_map["position-amount"].as<Bitfinex::Decimal>());
+    output.result = { { "http_status", response.http_status }, { "status", response.message } };
+    if (response.http_status != 200) {
+        output.err << "An error occurred, please try again later" << std::endl;
+        return 1;
+    }
+    if (response.message != "SUCCESS") {
+        output.err << "Oops ! Could not submit position increase" << std::endl;
+        return 1;
+    }
+    output.out << "Successfully submitted position increase" << std::endl;
+    return 0;
+}
+
+int Dispatcher::retrieve_positions(CommandOutput& output)
+{
+    Bitfinex::Client* client = this->client(output.err);
+    if (!client)
+        return 1;
+
+    std::optional<Bitfinex::Positions> positions = client->retrieve_positions();
+    if (!positions.has_value()) {
+        output.err << "An error occurred, please try again later" << std::endl;
+        return 1;
+    }
+    output.result["positions"] = nlohmann::json::array();
+    for (Bitfinex::Position const& position : positions.value().positions())
+        output.result["positions"].push_back(position_to_json(position));
+    if (positions.value().empty())
+        output.out << "You don't have any open positions" << std::endl;
+    else
+        output.out << positions.value();
+    return 0;
+}
+
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <Bitfinex/Client.h>
+#include <Bitfinex/TickerService.h>
+#include <boost/program_options.hpp>
+#include <iosfwd>
+#include <memory>
+#include <mutex>
+#include <nlohmann/json.hpp>
+
+namespace Cli {
+
+// The command options of trader, shared by the command line and the daemon
+boost::program_options::options_description command_options();
+// Whether the options select a command, the usage is printed otherwise
+bool has_command(boost::program_options::variables_map const&);
+// Loads the trading pairs of a saved /v2/conf/pub:info:pair response into the symbol table
+bool load_symbols_file(std::string const& path, std::ostream& err);
+// Loads the trading pairs of the exchange, or of PUBLIC_ENDPOINT, into the symbol table
+bool load_exchange_symbols(std::ostream& err);
+
+// Where a command reports to: text for a person on out and err, and its outcome as fields in
+// result for --batch
+struct CommandOutput {
+    std::ostream& out;
+    std::ostream& err;
+    nlohmann::json result = nlohmann::json::object();
+};
+
+// Runs the commands of trader against one Client, created on the first command that needs it
+// and kept for the next ones along with its connections, and one TickerService. Safe to call
+// from several threads.
+class Dispatcher {
+public:
+    // When interactive, --order asks on stdin whether to change the price and cancel the order.
+    // Requests, responses and streamed frames go to the journal when there is one.
+    explicit Dispatcher(bool interactive, Bitfinex::Journal* journal = nullptr);
+
+    // Reads the .env file and creates the client now instead of on the first command, false
+    // (with the reason on err) when the configuration is incomplete
+    bool configure(std::ostream& err);
+    // Configures and connects to the exchange ahead of the first command, for a daemon or a batch
+    // that keeps its connections. A single command would only pay an extra round trip.
+    bool warm_up(std::ostream& err);
+
+    // Runs the command the options select, returns the exit code of the process
+    int run(boost::program_options::variables_map const&, CommandOutput&);
+    // Parses the options first, an invalid one is reported on err with exit code 1
+    int run(std::vector<std::string> const& arguments, CommandOutput&);
+
+    // Serves --ticker, --tickers and the repricing prompt of --order, a feed attached to it keeps them live
+    Bitfinex::TickerService& tickers() { return m_tickers; }
+
+private:
+    // nullptr, with the reason on err, when the .env file lacks a setting
+    Bitfinex::Client* client(std::ostream& err);
+
+    int place_order(boost::program_options::variables_map const&, CommandOutput&);
+    int place_orders_from_file(std::string const& path, CommandOutput&);
+    int get_ticker_info(Bitfinex::SymbolId, CommandOutput&);
+    int print_tickers(std::string const& symbols, CommandOutput&);
+    int stream(boost::program_options::variables_map const&, CommandOutput&);
+    int cancel_order(uint64_t order_id, CommandOutput&);
+    int retrieve_orders(Bitfinex::SymbolId, CommandOutput&);
+    int increase_position(boost::program_options::variables_map const&, CommandOutput&);
+    int retrieve_positions(CommandOutput&);
+
+    const bool m_interactive;
+    Bitfinex::Journal* const m_journal;
+    const boost::program_options::options_description m_options;
+    Bitfinex::TickerService m_tickers;
+    std::mutex m_mutex;
+    std::unique_ptr<Bitfinex::Client> m_client;
+};
+
+}
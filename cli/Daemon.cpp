@@ -0,0 +1,243 @@
+#include <Daemon.h>
+#include <boost/algorithm/string/join.hpp>
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/detached.hpp>
+#include <boost/asio/read.hpp>
+#include <boost/asio/redirect_error.hpp>
+#include <boost/asio/use_awaitable.hpp>
+#include <boost/asio/write.hpp>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace Cli {
+
+namespace asio = boost::asio;
+using local = asio::local::stream_protocol;
+
+template<typename T>
+static void append(std::string& out, T value)
+{
+    out.append(reinterpret_cast<char const*>(&value), sizeof(value));
+}
+
+template<typename T>
+static bool consume(std::string_view& in, T& value)
+{
+    if (in.size() < sizeof(value))
+        return false;
+    std::memcpy(&value, in.data(), sizeof(value));
+    in.remove_prefix(sizeof(value));
+    return true;
+}
+
+static std::string frame(std::string const& payload)
+{
+    std::string out;
+    out.reserve(sizeof(uint32_t) + payload.size());
+    append(out, static_cast<uint32_t>(payload.size()));
+    out += payload;
+    return out;
+}
+
+std::string encode_request(std::vector<std::string> const& arguments)
+{
+    std::string payload;
+    for (std::string const& argument : arguments) {
+        payload += argument;
+        payload += '\0';
+    }
+    return payload;
+}
+
+std::vector<std::string> decode_request(std::string_view payload)
+{
+    std::vector<std::string> arguments;
+    while (!payload.empty()) {
+        const size_t end = std::min(payload.find('\0'), payload.size());
+        arguments.emplace_back(payload.substr(0, end));
+        payload.remove_prefix(std::min(end + 1, payload.size()));
+    }
+    return arguments;
+}
+
+std::string encode_reply(DaemonReply const& reply)
+{
+    std::string payload;
+    payload.reserve(13 + reply.out.size() + reply.err.size());
+    append(payload, static_cast<uint8_t>(reply.exit_code));
+    append(payload, static_cast<uint64_t>(reply.command_time.count()));
+    append(payload, static_cast<uint32_t>(reply.out.size()));
+    payload += reply.out;
+    payload += reply.err;
+    return payload;
+}
+
+std::optional<DaemonReply> decode_reply(std::string_view payload)
+{
+    uint8_t exit_code;
+    uint64_t nanoseconds;
+    uint32_t out_size;
+    if (!consume(payload, exit_code) || !consume(payload, nanoseconds) || !consume(payload, out_size) || payload.size() < out_size)
+        return {};
+    return DaemonReply { .exit_code = exit_code, .command_time = std::chrono::nanoseconds(nanoseconds), .out = std::string(payload.substr(0, out_size)),
+        .err = std::string(payload.substr(out_size)) };
+}
+
+std::string default_socket_path()
+{
+    if (char const* path = std::getenv("TRADER_SOCKET"); path && *path)
+        return path;
+    if (char const* runtime_directory = std::getenv("XDG_RUNTIME_DIR"); runtime_directory && *runtime_directory)
+        return std::string(runtime_directory) + "/trader.sock";
+    return std::format("/tmp/trader-{}/trader.sock", getuid());
+}
+
+// Only the user may create, replace or remove entries in the directory of the socket. The one of
+// the default path is created, and a name other users could have taken first is refused.
+static void check_socket_directory(std::string const& path)
+{
+    std::string directory = std::filesystem::path(path).parent_path().string();
+    if (directory.empty())
+        directory = ".";
+    if (::mkdir(directory.c_str(), 0700) != 0 && errno != EEXIST)
+        throw std::runtime_error(std::format("Cannot create {}: {}", directory, std::strerror(errno)));
+    struct stat status;
+    if (::lstat(directory.c_str(), &status) != 0 || !S_ISDIR(status.st_mode) || status.st_uid != getuid() || (status.st_mode & (S_IWGRP | S_IWOTH)))
+        throw std::runtime_error(directory + " is not a directory only this user can write to, the socket cannot be made private");
+}
+
+static local::acceptor bind_socket(asio::io_context& io, std::string const& path)
+{
+    check_socket_directory(path);
+    boost::system::error_code error;
+    local::socket probe(io);
+    probe.connect(local::endpoint(path), error);
+    if (!error)
+        throw std::runtime_error("A daemon already listens on " + path);
+    // A socket of ours that is left belongs to a daemon that went away, anything else stays
+    struct stat status;
+    if (::lstat(path.c_str(), &status) == 0) {
+        if (!S_ISSOCK(status.st_mode) || status.st_uid != getuid())
+            throw std::runtime_error(path + " exists and is not a socket of this user");
+        std::filesystem::remove(path);
+    }
+    local::acceptor acceptor(io, local::endpoint(path));
+    if (::chmod(path.c_str(), 0600) != 0)
+        throw std::runtime_error(std::format("Cannot restrict the permissions of {}: {}", path, std::strerror(errno)));
+    return acceptor;
+}
+
+// Whether the process at the other end runs as the same user as this one
+static bool same_user(local::socket& socket)
+{
+    struct ucred credentials {};
+    socklen_t size = sizeof(credentials);
+    if (::getsockopt(socket.native_handle(), SOL_SOCKET, SO_PEERCRED, &credentials, &size) != 0)
+        return false;
+    return credentials.uid == getuid();
+}
+
+Daemon::Daemon(asio::io_context& io, Dispatcher& dispatcher, std::string socket_path, unsigned threads, bool verbose)
+    : m_dispatcher(dispatcher)
+    , m_socket_path(std::move(socket_path))
+    , m_acceptor(bind_socket(io, m_socket_path))
+    , m_workers(std::max(1u, threads))
+    , m_verbose(verbose)
+{
+}
+
+Daemon::~Daemon()
+{
+    boost::system::error_code error;
+    m_acceptor.close(error);
+    m_workers.join();
+    std::error_code remove_error;
+    std::filesystem::remove(m_socket_path, remove_error);
+}
+
+void Daemon::start()
+{
+    asio::co_spawn(m_acceptor.get_executor(), listen(), asio::detached);
+}
+
+asio::awaitable<void> Daemon::listen()
+{
+    while (m_acceptor.is_open()) {
+        boost::system::error_code error;
+        local::socket socket = co_await m_acceptor.async_accept(asio::redirect_error(asio::use_awaitable, error));
+        // The socket is private already, a process of another user is turned away all the same
+        if (error || !same_user(socket))
+            continue;
+        asio::co_spawn(m_acceptor.get_executor(), serve(std::move(socket)), asio::detached);
+    }
+}
+
+asio::awaitable<void> Daemon::serve(local::socket socket)
+{
+    boost::system::error_code error;
+    std::string payload;
+    while (true) {
+        uint32_t size;
+        co_await asio::async_read(socket, asio::buffer(&size, sizeof(size)), asio::redirect_error(asio::use_awaitable, error));
+        if (error || size > MAX_FRAME_SIZE)
+            co_return;
+        payload.resize(size);
+        co_await asio::async_read(socket, asio::buffer(payload), asio::redirect_error(asio::use_awaitable, error));
+        if (error)
+            co_return;
+
+        // Commands block on the exchange, they run on the workers while this thread keeps serving
+        DaemonReply reply = co_await asio::co_spawn(m_workers, execute(decode_request(payload)), asio::use_awaitable);
+        co_await asio::async_write(socket, asio::buffer(frame(encode_reply(reply))), asio::redirect_error(asio::use_awaitable, error));
+        if (error)
+            co_return;
+    }
+}
+
+asio::awaitable<DaemonReply> Daemon::execute(std::vector<std::string> arguments)
+{
+    const auto start = std::chrono::steady_clock::now();
+    std::ostringstream out, err;
+    CommandOutput output { .out = out, .err = err };
+    const int exit_code = m_dispatcher.run(arguments, output);
+    const auto command_time = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+    if (m_verbose) {
+        std::lock_guard lock(m_log_mutex);
+        std::cout << std::format("{} exited with {} in {:.3f} ms\n", boost::algorithm::join(arguments, " "), exit_code, command_time.count() / 1e6) << std::flush;
+    }
+    co_return DaemonReply { .exit_code = exit_code, .command_time = command_time, .out = std::move(out).str(), .err = std::move(err).str() };
+}
+
+DaemonClient::DaemonClient(std::string const& socket_path)
+    : m_socket(m_io)
+{
+    m_socket.connect(local::endpoint(socket_path));
+    // Commands carry orders, they are not sent to a daemon someone else started
+    if (!same_user(m_socket))
+        throw std::runtime_error("The daemon on " + socket_path + " runs as another user");
+}
+
+DaemonReply DaemonClient::send(std::vector<std::string> const& arguments)
+{
+    asio::write(m_socket, asio::buffer(frame(encode_request(arguments))));
+    uint32_t size;
+    asio::read(m_socket, asio::buffer(&size, sizeof(size)));
+    if (size > MAX_FRAME_SIZE)
+        throw std::runtime_error("The daemon sent an oversized reply");
+    std::string payload(size, '\0');
+    asio::read(m_socket, asio::buffer(payload));
+    std::optional<DaemonReply> reply = decode_reply(payload);
+    if (!reply.has_value())
+        throw std::runtime_error("The daemon sent a malformed reply");
+    return std::move(reply.value());
+}
+
+}
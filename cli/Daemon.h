@@ -0,0 +1,86 @@
+#pragma once
+
+// Older Boost.Asio uses std::exchange in awaitable.hpp without including <utility>
+#include <utility>
+
+#include <Commands.h>
+#include <boost/asio/awaitable.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/local/stream_protocol.hpp>
+#include <boost/asio/thread_pool.hpp>
+#include <chrono>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Frames in both directions are a 4 byte payload length followed by the payload, integers in the
+// host's byte order since both ends are on the same machine. A request is the command's options,
+// each followed by a NUL byte. Its reply is the exit code (1 byte), the time the daemon spent on
+// the command in nanoseconds (8 bytes), the length of the command's stdout (4 bytes), its stdout
+// and then its stderr. A connection can carry any number of requests, one at a time.
+namespace Cli {
+
+static constexpr size_t MAX_FRAME_SIZE = 16 * 1024 * 1024;
+
+struct DaemonReply {
+    int exit_code { 0 };
+    std::chrono::nanoseconds command_time { 0 };
+    std::string out;
+    std::string err;
+};
+
+std::string encode_request(std::vector<std::string> const& arguments);
+std::vector<std::string> decode_request(std::string_view payload);
+std::string encode_reply(DaemonReply const&);
+std::optional<DaemonReply> decode_reply(std::string_view payload);
+
+// $TRADER_SOCKET, else trader.sock in $XDG_RUNTIME_DIR, else /tmp/trader-<uid>/trader.sock
+std::string default_socket_path();
+
+// Runs the commands it receives on a Dispatcher, with as many commands at once as it has threads
+class Daemon {
+public:
+    // Throws when another daemon answers on the path or the socket cannot be bound. The socket is
+    // only open to its user (mode 0600, in a directory only the user can write to, created when
+    // missing) and connections of other users are closed. A socket of the same user left behind by
+    // a daemon that died is replaced, anything else at the path is left alone. When verbose, every
+    // command is printed on stdout with its exit code and time, orders included.
+    Daemon(boost::asio::io_context&, Dispatcher&, std::string socket_path, unsigned threads, bool verbose = false);
+    Daemon(Daemon const&) = delete;
+    Daemon& operator=(Daemon const&) = delete;
+    // Waits for the commands still running and removes the socket file
+    ~Daemon();
+
+    void start();
+
+private:
+    boost::asio::awaitable<void> listen();
+    boost::asio::awaitable<void> serve(boost::asio::local::stream_protocol::socket);
+    // A coroutine only to be spawned on the workers
+    boost::asio::awaitable<DaemonReply> execute(std::vector<std::string> arguments);
+
+    Dispatcher& m_dispatcher;
+    const std::string m_socket_path;
+    boost::asio::local::stream_protocol::acceptor m_acceptor;
+    boost::asio::thread_pool m_workers;
+    const bool m_verbose;
+    // Lines of the workers are not interleaved
+    std::mutex m_log_mutex;
+};
+
+// One connection to a daemon, for the command line acting as its thin client
+class DaemonClient {
+public:
+    // Throws when no daemon listens on the path or it runs as another user
+    explicit DaemonClient(std::string const& socket_path);
+
+    DaemonReply send(std::vector<std::string> const& arguments);
+
+private:
+    boost::asio::io_context m_io;
+    boost::asio::local::stream_protocol::socket m_socket;
+};
+
+}
@@ -0,0 +1,228 @@
+#include <LoadGenerator.h>
+#include <condition_variable>
+#include <format>
+#include <memory>
+#include <mutex>
+#include <nlohmann/json.hpp>
+#include <random>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace LoadGen {
+
+using Clock = std::chrono::steady_clock;
+
+// How long the run waits for the answers of the last operations
+static constexpr std::chrono::seconds DRAIN_TIMEOUT { 10 };
+
+char const* operation_name(Operation operation)
+{
+    static constexpr char const* names[] = { "submit", "amend", "cancel" };
+    return names[static_cast<size_t>(operation)];
+}
+
+struct OpenOperation {
+    Operation operation;
+    Clock::time_point scheduled;
+};
+
+// Shared by the sending thread and the client's event loop thread, where the answers arrive
+struct RunState {
+    std::mutex mutex;
+    std::condition_variable answered;
+    std::vector<uint64_t> live_orders;
+    // Out of live_orders while their cancel is on the way, back in when it is not a success
+    std::unordered_set<uint64_t> cancelling;
+    size_t outstanding { 0 };
+    // Measured operations waiting for their answer, by a ticket counting them in scheduling order
+    std::unordered_map<uint64_t, OpenOperation> open;
+    LoadReport report;
+};
+
+static bool is_success(Bitfinex::OrderResponse const& response)
+{
+    return response.http_status == 200 && response.message == "SUCCESS";
+}
+
+static uint64_t nanoseconds(Clock::duration duration)
+{
+    return static_cast<uint64_t>(std::max<int64_t>(0, std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count()));
+}
+
+LoadReport run_load(Bitfinex::Client& client, LoadOptions const& options)
+{
+    // Answers that come in after the run gave up on them still find their state
+    auto state = std::make_shared<RunState>();
+    std::mt19937_64 random(options.random_seed);
+    std::discrete_distribution<int> mix(options.mix.begin(), options.mix.end());
+    std::exponential_distribution<double> gap(options.rate);
+    const auto interval = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / options.rate));
+    const Bitfinex::Decimal price_step = Bitfinex::Decimal::from_units(options.price.units() / 1000);
+    const Bitfinex::Order order { .order_id = 0, .creation_time_ms = 0, .amount = options.amount, .price = options.price, .symbol = options.symbol,
+        .side = Bitfinex::OrderSide::BUY, .type = Bitfinex::OrderType::EXCHANGE_LIMIT };
+
+    const Clock::time_point start = Clock::now();
+    const Clock::time_point measured_from = start + options.warmup;
+    const Clock::time_point end = measured_from + options.duration;
+    uint64_t max_send_lag = 0;
+    uint64_t next_ticket = 0;
+    for (Clock::time_point scheduled = start; scheduled < end;
+         scheduled += options.poisson ? std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(gap(random))) : interval) {
+        std::this_thread::sleep_until(scheduled);
+        const bool measured = scheduled >= measured_from;
+        if (measured)
+            max_send_lag = std::max(max_send_lag, nanoseconds(Clock::now() - scheduled));
+
+        auto operation = static_cast<Operation>(mix(random));
+        uint64_t target = 0;
+        uint64_t order_id = 0;
+        {
+            std::lock_guard lock(state->mutex);
+            std::vector<uint64_t>& live_orders = state->live_orders;
+            if (live_orders.empty())
+                operation = Operation::SUBMIT;
+            else if (operation == Operation::SUBMIT && live_orders.size() >= options.max_live_orders)
+                operation = Operation::CANCEL;
+            if (operation != Operation::SUBMIT) {
+                const size_t index = random() % live_orders.size();
+                target = live_orders[index];
+                order_id = target;
+                if (operation == Operation::CANCEL) {
+                    live_orders[index] = live_orders.back();
+                    live_orders.pop_back();
+                    state->cancelling.insert(target);
+                }
+            }
+            state->outstanding++;
+            if (measured) {
+                state->report.operations[static_cast<size_t>(operation)].sent++;
+                state->open.emplace(next_ticket, OpenOperation { .operation = operation, .scheduled = scheduled });
+            }
+        }
+
+        // Latency counts from the scheduled time, not from when the request actually left
+        auto on_answer = [state, operation, target, scheduled, ticket = next_ticket++](Bitfinex::OrderResponse response) {
+            const Clock::time_point answered = Clock::now();
+            std::lock_guard lock(state->mutex);
+            if (operation == Operation::SUBMIT && is_success(response))
+                state->live_orders.push_back(response.order_id);
+            // Only a successful cancel is known to have removed the order
+            if (operation == Operation::CANCEL && state->cancelling.erase(target) != 0 && !is_success(response))
+                state->live_orders.push_back(target);
+            // Not there when it was not measured, or was already counted as unanswered
+            if (state->open.erase(ticket) != 0) {
+                OperationReport& report = state->report.operations[static_cast<size_t>(operation)];
+                if (response.http_status == 0 && response.message != Bitfinex::RequestScheduler::SUPERSEDED)
+                    report.failed++;
+                else if (!is_success(response))
+                    report.rejected++;
+                else
+                    report.succeeded++;
+                report.latency.record(nanoseconds(answered - scheduled));
+            }
+            state->outstanding--;
+            state->answered.notify_all();
+        };
+        switch (operation) {
+        case Operation::SUBMIT:
+            client.submit_order_async(order, std::move(on_answer));
+            break;
+        case Operation::AMEND:
+            client.update_order_async(order_id, Bitfinex::round_price(options.symbol, options.price - price_step * static_cast<int64_t>(1 + random() % 10)),
+                std::move(on_answer));
+            break;
+        case Operation::CANCEL:
+            client.cancel_order_async(order_id, std::move(on_answer));
+            break;
+        }
+    }
+
+    LoadReport report;
+    std::vector<uint64_t> leftover_orders;
+    {
+        std::unique_lock lock(state->mutex);
+        state->answered.wait_for(lock, DRAIN_TIMEOUT, [&state] { return state->outstanding == 0; });
+        // The operations left took at least until now, they go into the percentiles with that latency
+        const Clock::time_point gave_up = Clock::now();
+        for (auto const& [ticket, open] : state->open) {
+            OperationReport& operation_report = state->report.operations[static_cast<size_t>(open.operation)];
+            operation_report.unanswered++;
+            operation_report.latency.record(nanoseconds(gave_up - open.scheduled));
+        }
+        state->open.clear();
+        report = state->report;
+        report.unanswered = state->outstanding;
+        // Including those whose cancel is still unanswered
+        leftover_orders.assign(state->live_orders.begin(), state->live_orders.end());
+        leftover_orders.insert(leftover_orders.end(), state->cancelling.begin(), state->cancelling.end());
+        state->live_orders.clear();
+        state->cancelling.clear();
+    }
+    report.elapsed_seconds = std::chrono::duration<double>(end - measured_from).count();
+    report.max_send_lag_ns = max_send_lag;
+    report.connections = client.connection_stats();
+
+    // Leave the account as it was, outside of the measurement
+    if (!leftover_orders.empty())
+        client.cancel_orders(leftover_orders);
+    return report;
+}
+
+static double microseconds(uint64_t nanoseconds)
+{
+    return static_cast<double>(nanoseconds) / 1000.0;
+}
+
+nlohmann::json report_to_json(LoadReport const& report, LoadOptions const& options)
+{
+    nlohmann::json operations = nlohmann::json::object();
+    for (size_t i = 0; i < OPERATION_COUNT; i++) {
+        OperationReport const& operation = report.operations[i];
+        operations[operation_name(static_cast<Operation>(i))] = {
+            { "sent", operation.sent },
+            { "succeeded", operation.succeeded },
+            { "rejected", operation.rejected },
+            { "failed", operation.failed },
+            { "unanswered", operation.unanswered },
+            { "throughput", report.elapsed_seconds > 0 ? static_cast<double>(operation.succeeded) / report.elapsed_seconds : 0 },
+            { "latency_us",
+                {
+                    { "p50", microseconds(operation.latency.percentile(50)) },
+                    { "p99", microseconds(operation.latency.percentile(99)) },
+                    { "p99_9", microseconds(operation.latency.percentile(99.9)) },
+                    { "max", microseconds(operation.latency.max()) },
+                    { "mean", operation.latency.mean() / 1000.0 },
+                } },
+        };
+    }
+    return {
+        { "rate", options.rate },
+        { "arrivals", options.poisson ? "poisson" : "uniform" },
+        { "duration_s", options.duration.count() },
+        { "warmup_s", options.warmup.count() },
+        { "elapsed_s", report.elapsed_seconds },
+        { "max_send_lag_us", microseconds(report.max_send_lag_ns) },
+        { "unanswered", report.unanswered },
+        { "connections", { { "opened", report.connections.new_connections }, { "reused", report.connections.reused_connections } } },
+        { "operations", operations },
+    };
+}
+
+void print_report(std::ostream& out, LoadReport const& report)
+{
+    out << std::format("{:<8} {:>8} {:>8} {:>8} {:>8} {:>10} {:>10} {:>10} {:>10} {:>10} {:>10}\n", "", "sent", "ok", "rejected", "failed", "unanswered",
+        "ops/s", "p50 us", "p99 us", "p99.9 us", "max us");
+    for (size_t i = 0; i < OPERATION_COUNT; i++) {
+        OperationReport const& operation = report.operations[i];
+        out << std::format("{:<8} {:>8} {:>8} {:>8} {:>8} {:>10} {:>10.1f} {:>10.0f} {:>10.0f} {:>10.0f} {:>10.0f}\n", operation_name(static_cast<Operation>(i)),
+            operation.sent, operation.succeeded, operation.rejected, operation.failed, operation.unanswered,
+            report.elapsed_seconds > 0 ? static_cast<double>(operation.succeeded) / report.elapsed_seconds : 0, microseconds(operation.latency.percentile(50)),
+            microseconds(operation.latency.percentile(99)), microseconds(operation.latency.percentile(99.9)), microseconds(operation.latency.max()));
+    }
+    out << std::format("sender fell behind schedule by up to {:.0f} us, {} operations unanswered, {} connections opened\n", microseconds(report.max_send_lag_ns),
+        report.unanswered, report.connections.new_connections);
+}
+
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <Bitfinex/Client.h>
+#include <Bitfinex/LatencyHistogram.h>
+#include <array>
+#include <chrono>
+#include <nlohmann/json_fwd.hpp>
+#include <ostream>
+
+namespace LoadGen {
+
+enum class Operation : uint8_t {
+    SUBMIT,
+    AMEND,
+    CANCEL,
+};
+static constexpr size_t OPERATION_COUNT = 3;
+
+char const* operation_name(Operation);
+
+struct LoadOptions {
+    // Operations per second, started on schedule whether or not earlier ones were answered
+    double rate { 100 };
+    std::chrono::seconds duration { 30 };
+    // Operations scheduled during the warmup are sent but not reported
+    std::chrono::seconds warmup { 5 };
+    // Exponential gaps between operations instead of a fixed interval
+    bool poisson { false };
+    // Relative weights, amends and cancels fall back to a submit while no order is live
+    std::array<unsigned, OPERATION_COUNT> mix { 2, 1, 1 };
+    // Submits turn into cancels above this many live orders
+    size_t max_live_orders { 500 };
+    Bitfinex::SymbolId symbol { 0 };
+    Bitfinex::Decimal amount;
+    // Buy price far enough below the market for the orders to rest
+    Bitfinex::Decimal price;
+    uint64_t random_seed { 42 };
+};
+
+struct OperationReport {
+    uint64_t sent { 0 };
+    uint64_t succeeded { 0 };
+    // Answered with an error notification or an error body, or superseded by a later operation
+    uint64_t rejected { 0 };
+    // No HTTP response at all
+    uint64_t failed { 0 };
+    // Still waiting for an answer when the run gave up
+    uint64_t unanswered { 0 };
+    // Nanoseconds from the time the operation was scheduled to its answer, which keeps the
+    // queueing delay of a stalled client in the numbers (coordinated omission). Every operation is
+    // in there whatever its answer, the unanswered ones at the time the run gave up on them:
+    // leaving out the slow failures would flatter the tail as much as leaving out the queueing.
+    Bitfinex::LatencyHistogram latency;
+};
+
+struct LoadReport {
+    std::array<OperationReport, OPERATION_COUNT> operations;
+    // Measured part of the run, warmup excluded
+    double elapsed_seconds { 0 };
+    // How far behind schedule the sender got, a large value means the client is the bottleneck
+    uint64_t max_send_lag_ns { 0 };
+    // Operations still unanswered when the run gave up waiting
+    uint64_t unanswered { 0 };
+    Bitfinex::ConnectionStats connections {};
+};
+
+LoadReport run_load(Bitfinex::Client&, LoadOptions const&);
+
+nlohmann::json report_to_json(LoadReport const&, LoadOptions const&);
+void print_report(std::ostream&, LoadReport const&);
+
+}
@@ -0,0 +1,174 @@
+// Open-loop order traffic against a local trader-simulator by default, another endpoint has to
+// be allowed with --allow-remote. Reports per operation throughput, errors and latency percentiles.
+
+#include <LoadGenerator.h>
+#include <Bitfinex/MetricsExporter.h>
+#include <boost/algorithm/string.hpp>
+#include <boost/program_options.hpp>
+#include <dotenv/dotenv.h>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <nlohmann/json.hpp>
+
+// "2,1,1", weights of submit, amend and cancel
+static std::array<unsigned, LoadGen::OPERATION_COUNT> parse_mix(std::string const& text)
+{
+    std::vector<std::string> weights;
+    boost::split(weights, text, boost::is_any_of(","));
+    if (weights.size() != LoadGen::OPERATION_COUNT)
+        throw std::invalid_argument("--mix expects three weights: submit,amend,cancel");
+    std::array<unsigned, LoadGen::OPERATION_COUNT> mix {};
+    for (size_t i = 0; i < mix.size(); i++)
+        mix[i] = static_cast<unsigned>(std::stoul(weights[i]));
+    if (mix[0] == 0)
+        throw std::invalid_argument("--mix needs a submit weight above 0");
+    return mix;
+}
+
+// "90,90,90", requests per minute of the order write, account read and position write families
+static Bitfinex::RequestSchedulerOptions parse_rate_limits(std::string const& text)
+{
+    std::vector<std::string> limits;
+    boost::split(limits, text, boost::is_any_of(","));
+    if (limits.size() != Bitfinex::RATE_LIMIT_FAMILY_COUNT)
+        throw std::invalid_argument("--rate-limits expects three limits: order_write,account_read,position_write");
+    Bitfinex::RequestSchedulerOptions options;
+    for (size_t i = 0; i < limits.size(); i++)
+        options.limits[i] = Bitfinex::RateLimit::per_minute(static_cast<unsigned>(std::stoul(limits[i])));
+    return options;
+}
+
+static constexpr char LOCAL_ENDPOINT[] = "http://127.0.0.1:8766";
+
+// Loopback addresses only, anything else may be the exchange
+static bool is_local_endpoint(std::string const& endpoint)
+{
+    const size_t scheme_end = endpoint.find("://");
+    std::string_view authority(endpoint);
+    if (scheme_end != std::string::npos)
+        authority.remove_prefix(scheme_end + 3);
+    authority = authority.substr(0, authority.find('/'));
+    // [::1]:8766 or 127.0.0.1:8766
+    const std::string_view host = authority.starts_with('[') ? authority.substr(0, authority.find(']') + 1) : authority.substr(0, authority.find(':'));
+    return host == "localhost" || host == "[::1]" || host.starts_with("127.");
+}
+
+static Bitfinex::Decimal parse_decimal(std::string const& text, char const* option)
+{
+    std::optional<Bitfinex::Decimal> value = Bitfinex::Decimal::parse(text);
+    if (!value.has_value() || value.value() <= Bitfinex::Decimal {})
+        throw std::invalid_argument(std::string("--") + option + " expects a positive number");
+    return value.value();
+}
+
+int main(int argc, char** argv)
+{
+    boost::program_options::options_description options("Supported options");
+    options.add_options()("help", "print help message");
+    options.add_options()("rate", boost::program_options::value<double>()->default_value(100), "Operations per second");
+    options.add_options()("duration", boost::program_options::value<unsigned>()->default_value(30), "Measured seconds");
+    options.add_options()("warmup", boost::program_options::value<unsigned>()->default_value(5), "Seconds of traffic before the measurement starts");
+    options.add_options()("poisson", "Exponentially distributed gaps between operations instead of a fixed interval");
+    options.add_options()("mix", boost::program_options::value<std::string>()->default_value("2,1,1"), "Relative weights of submit, amend and cancel");
+    options.add_options()("max-live", boost::program_options::value<size_t>()->default_value(500), "Live orders above which submits become cancels");
+    options.add_options()("symbol", boost::program_options::value<std::string>()->default_value("tTESTBTC:TESTUSD"), "Symbol of the orders");
+    options.add_options()("amount", boost::program_options::value<std::string>()->default_value("0.001"), "Amount of each order");
+    options.add_options()("price", boost::program_options::value<std::string>(), "Buy price, 10% under the last bid by default");
+    options.add_options()("endpoint", boost::program_options::value<std::string>()->default_value(LOCAL_ENDPOINT),
+        "REST endpoint the orders go to, also asked for the ticker when there is no --price. BASE_ENDPOINT of the .env file is not used");
+    options.add_options()("allow-remote", "Allow an --endpoint that is not on this machine, such as the exchange");
+    options.add_options()("json", boost::program_options::value<std::string>(), "Write the report as JSON to this file, - for stdout");
+    options.add_options()("rate-limits", boost::program_options::value<std::string>()->implicit_value(
+        std::format("{},{},{}", Bitfinex::EXCHANGE_RATE_LIMITS[0], Bitfinex::EXCHANGE_RATE_LIMITS[1], Bitfinex::EXCHANGE_RATE_LIMITS[2])),
+        "Queue requests within these per minute limits (order write, account read, position write), the exchange's when given without a value. "
+        "Requests go out unthrottled by default");
+    options.add_options()("metrics-file", boost::program_options::value<std::string>(), "Keep the client's metrics in this file, JSON if it ends in .json, Prometheus text otherwise");
+    options.add_options()("metrics-port", boost::program_options::value<unsigned short>(), "Serve the client's metrics on 127.0.0.1 at /metrics and /metrics.json");
+    options.add_options()("seed", boost::program_options::value<uint64_t>()->default_value(42), "Seed of the operation mix");
+
+    try {
+        boost::program_options::variables_map variables_map;
+        boost::program_options::store(boost::program_options::parse_command_line(argc, argv, options), variables_map);
+        boost::program_options::notify(variables_map);
+        if (variables_map.count("help")) {
+            std::cout << options << std::endl;
+            return 0;
+        }
+
+        dotenv::init(".env");
+        Bitfinex::Config config { .BASE_ENDPOINT = variables_map["endpoint"].as<std::string>(), .API_KEY = dotenv::getenv("API_KEY"),
+            .SECRET_KEY = dotenv::getenv("SECRET_KEY") };
+        if (config.API_KEY.empty() || config.SECRET_KEY.empty()) {
+            std::cerr << "Please set API_KEY and SECRET_KEY in the .env file" << std::endl;
+            return 1;
+        }
+        std::optional<std::vector<Bitfinex::ApiKey>> extra_keys = Bitfinex::parse_api_keys(dotenv::getenv("EXTRA_KEYS"));
+        if (!extra_keys.has_value()) {
+            std::cerr << "EXTRA_KEYS of the .env file must be KEY:SECRET pairs separated by commas" << std::endl;
+            return 1;
+        }
+        config.EXTRA_KEYS = std::move(extra_keys.value());
+        if (!is_local_endpoint(config.BASE_ENDPOINT) && !variables_map.count("allow-remote")) {
+            std::cerr << config.BASE_ENDPOINT << " is not a local endpoint, pass --allow-remote to send load to it" << std::endl;
+            return 1;
+        }
+        if (variables_map["rate"].as<double>() <= 0) {
+            std::cerr << "--rate must be above 0" << std::endl;
+            return 1;
+        }
+
+        LoadGen::LoadOptions load_options {
+            .rate = variables_map["rate"].as<double>(),
+            .duration = std::chrono::seconds(variables_map["duration"].as<unsigned>()),
+            .warmup = std::chrono::seconds(variables_map["warmup"].as<unsigned>()),
+            .poisson = variables_map.count("poisson") > 0,
+            .mix = parse_mix(variables_map["mix"].as<std::string>()),
+            .max_live_orders = variables_map["max-live"].as<size_t>(),
+            .symbol = Bitfinex::intern_symbol(variables_map["symbol"].as<std::string>()),
+            .amount = parse_decimal(variables_map["amount"].as<std::string>(), "amount"),
+            .price = {},
+            .random_seed = variables_map["seed"].as<uint64_t>(),
+        };
+        if (variables_map.count("price")) {
+            load_options.price = parse_decimal(variables_map["price"].as<std::string>(), "price");
+        } else {
+            Bitfinex::TickerResponse ticker = Bitfinex::Client::get_ticker(load_options.symbol, config.BASE_ENDPOINT);
+            if (ticker.http_status != 200 || ticker.bid <= 0) {
+                std::cerr << "Could not get the ticker of " << Bitfinex::symbol_name(load_options.symbol) << ", please pass --price" << std::endl;
+                return 1;
+            }
+            load_options.price = Bitfinex::Decimal::from_double(ticker.bid * 0.9);
+        }
+        load_options.price = Bitfinex::round_price(load_options.symbol, load_options.price);
+
+        Bitfinex::Client client(config, {},
+            variables_map.count("rate-limits") ? parse_rate_limits(variables_map["rate-limits"].as<std::string>()) : Bitfinex::RequestSchedulerOptions::unlimited());
+        Bitfinex::MetricsExporter metrics_exporter(client.metrics(),
+            Bitfinex::MetricsExporterOptions { .file = variables_map.count("metrics-file") ? variables_map["metrics-file"].as<std::string>() : "",
+                .interval = std::chrono::seconds(1),
+                .port = variables_map.count("metrics-port") ? variables_map["metrics-port"].as<unsigned short>() : static_cast<unsigned short>(0) });
+        std::cerr << "sending " << load_options.rate << " operations/s for " << load_options.warmup.count() << " + " << load_options.duration.count()
+                  << " s to " << config.BASE_ENDPOINT << std::endl;
+        LoadGen::LoadReport report = LoadGen::run_load(client, load_options);
+
+        if (variables_map.count("json")) {
+            const std::string path = variables_map["json"].as<std::string>();
+            const std::string json_report = LoadGen::report_to_json(report, load_options).dump(2);
+            if (path == "-") {
+                std::cout << json_report << std::endl;
+                return 0;
+            }
+            std::ofstream file(path);
+            if (!(file << json_report << std::endl)) {
+                std::cerr << "Could not write " << path << std::endl;
+                return 1;
+            }
+        }
+        LoadGen::print_report(std::cout, report);
+    } catch (const std::exception& err) {
+        std::cerr << err.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
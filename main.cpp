@@ -1,387 +1,215 @@
-#include <Bitfinex/Client.h>
-#include <Bitfinex/ENUMS.h>
-#include <Bitfinex/Positions.h>
-#include <boost/algorithm/string/trim.hpp>
-#include <boost/program_options.hpp>
+#include <Batch.h>
+#include <Commands.h>
+#include <Daemon.h>
+#include <Bitfinex/FeedHandler.h>
+#include <boost/algorithm/string/classification.hpp>
+#include <boost/algorithm/string/split.hpp>
+#include <boost/asio/signal_set.hpp>
+#include <chrono>
+#include <csignal>
+#include <filesystem>
 #include <format>
+#include <fstream>
 #include <iostream>
+#include <memory>
+#include <sstream>
 
-class SideValue : public boost::program_options::typed_value<std::string>
-{
-public:
-    SideValue(std::string* store_to) : boost::program_options::typed_value<std::string>(store_to) {}
-
-    virtual void xparse(boost::any& v, const std::vector<std::string>& values) const override
-    {
-        boost::program_options::validators::check_first_occurrence(v);
-        const std::string& side = boost::program_options::validators::get_single_string(values);
-        if (!Bitfinex::is_valid_order_side(side))
-            throw boost::program_options::validation_error(boost::program_options::validation_error::invalid_option_value, "side");
-
-        v = boost::any(Bitfinex::order_side_from_string(side));
-    }
-};
-
-class TypeValue : public boost::program_options::typed_value<std::string>
-{
-public:
-    TypeValue(std::string* store_to) : boost::program_options::typed_value<std::string>(store_to) {}
-
-    virtual void xparse(boost::any& v, const std::vector<std::string>& values) const override
-    {
-        boost::program_options::validators::check_first_occurrence(v);
-        const std::string& type = boost::program_options::validators::get_single_string(values);
-        if (!Bitfinex::is_valid_order_type(type))
-            throw boost::program_options::validation_error(boost::program_options::validation_error::invalid_option_value, "type");
-        if (type != "exchange_limit") {
-            std::cout << "oops ! Only exchange limit orders are supported at this time" << std::endl;
-            std::exit(0);
-        }
-        v = boost::any(Bitfinex::order_type_from_string(type));
-    }
-};
-
-class PositionSide : public boost::program_options::typed_value<std::string>
-{
-public:
-    PositionSide(std::string* store_to) : boost::program_options::typed_value<std::string>(store_to) {}
+using Clock = std::chrono::steady_clock;
 
-    virtual void xparse(boost::any& v, const std::vector<std::string>& values) const override
-    {
-        boost::program_options::validators::check_first_occurrence(v);
-        const std::string& side = boost::program_options::validators::get_single_string(values);
-        if (!Bitfinex::is_valid_position_side(side))
-            throw boost::program_options::validation_error(boost::program_options::validation_error::invalid_option_value, "position-side");
-
-        v = boost::any(Bitfinex::position_side_from_string(side));
-    }
-};
-
-double read_positive_double_from_cli()
+static double milliseconds_between(Clock::time_point start, Clock::time_point end)
 {
-    std::string user_input;
-    while (true) {
-        std::getline(std::cin, user_input);
-        try {
-            auto value = boost::lexical_cast<double>(user_input);
-            if (value <= 0)
-                std::cerr << "Please enter a positive number:" << std::endl;
-            else
-                return value;
-        } catch (const std::exception &ignore) {
-            std::cerr << "Please enter a positive number:" << std::endl;
-        }
-    }
+    return std::chrono::duration<double, std::milli>(end - start).count();
 }
 
-std::string read_string_from_cli(std::vector<std::string> const &allowed_values)
+// The command's options as the daemon should see them: without the options of this process
+// and with the files made absolute, the daemon does not share our working directory
+static std::vector<std::string> daemon_arguments(boost::program_options::parsed_options const& parsed)
 {
-    std::string user_input;
-    while (true) {
-        std::getline(std::cin, user_input);
-        boost::trim(user_input);
-        if (std::count(allowed_values.begin(), allowed_values.end(), user_input) > 0)
-            break;
-    }
-    return user_input;
-}
-
-void execute_place_order_command(boost::program_options::variables_map const& variables_map)
-{
-    dotenv::init(".env");
-
-    if (dotenv::getenv("BASE_ENDPOINT").empty()) {
-        std::cerr << "Please set BASE_ENDPOINT in the .env file" << std::endl;
-        return;
-    }
-    if (dotenv::getenv("API_KEY").empty()) {
-        std::cerr << "Please set API_KEY in the .env file" << std::endl;
-        return;
-    }
-    if (dotenv::getenv("SECRET_KEY").empty()) {
-        std::cerr << "Please set SECRET_KEY in the .env file" << std::endl;
-        return;
-    }
-
-    if (variables_map.count("side") == 0)
-        throw boost::program_options::required_option("side");
-    if (variables_map.count("symbol") == 0)
-        throw boost::program_options::required_option("symbol");
-    if (variables_map.count("amount") == 0)
-        throw boost::program_options::required_option("amount");
-    if (variables_map.count("type") == 0)
-        throw boost::program_options::required_option("type");
-    if (variables_map.count("price") == 0)
-        throw boost::program_options::required_option("price");
-
-    Bitfinex::Config config { .BASE_ENDPOINT = dotenv::getenv("BASE_ENDPOINT"), .API_KEY = dotenv::getenv("API_KEY"),
-            .SECRET_KEY = dotenv::getenv("SECRET_KEY") };
-
-    Bitfinex::Order order { .side = variables_map["side"].as<Bitfinex::OrderSide>(), .symbol = variables_map["symbol"].as<std::string>(),
-                                .amount = variables_map["amount"].as<double>(), .type = variables_map["type"].as<Bitfinex::OrderType>(),
-                                    .price = variables_map["price"].as<double>()};
-
-    Bitfinex::Client client(config);
-    Bitfinex::OrderResponse order_response = client.submit_order(order);
-    if (order_response.http_status != 200) {
-        std::cerr << "An error occurred, please try again later" << std::endl;
-        exit(1);
-    }
-    if (order_response.message != "SUCCESS") {
-        std::cerr << "Oops ! order didn't go through" << std::endl;
-        exit(2);
-    }
-
-    std::cout << std::format(R"(Placed a {} {} order for pair {} for the price of {} for {} amount, order id: ({}))", order_response.type, order_side_to_string(order_response.side), order_response.symbol
-                                , order_response.price, order_response.amount, order_response.order_id) << std::endl;
-
-    std::cout << "Would you like to change the order price ? (y,n) " << std::endl;
-    if (read_string_from_cli({"yes", "y", "no", "n"})[0] == 'y') {
-        Bitfinex::TickerResponse ticker = Bitfinex::Client::get_ticker(order_response.symbol);
-        if (ticker.http_status == 200) {
-            double suggested_price = ticker.last_price * order.amount;
-            std::cout << "last trade price for pair " << order.symbol << " for the amount " << order.amount << " is " << suggested_price
-                      << " to make sure the order does not fill offer a much higher/lower price" << std::endl;
+    std::vector<std::string> arguments;
+    for (boost::program_options::option const& option : parsed.options) {
+        if (option.string_key == "daemon" || option.string_key == "socket" || option.string_key == "daemon-threads" || option.string_key == "daemon-verbose" || option.string_key == "live-tickers"
+            || option.string_key == "timing" || option.string_key == "journal" || option.string_key == "journal-file-size")
+            continue;
+        std::string argument = "--" + option.string_key;
+        if (!option.value.empty()) {
+            const bool is_path = option.string_key == "order-file" || option.string_key == "symbols-file";
+            argument += "=" + (is_path ? std::filesystem::absolute(option.value[0]).string() : option.value[0]);
         }
-        std::cout << "Please enter the new order price:" << std::endl;
-        double new_price = read_positive_double_from_cli();
-        order_response = client.update_order(std::to_string(order_response.order_id), new_price);
-
-        if (order_response.http_status != 200) {
-            std::cerr << "An error occurred, please try again later" << std::endl;
-            exit(1);
-        }
-        if (order_response.message != "SUCCESS")
-            std::cerr << "Oops ! could not update the price" << std::endl;
-        else
-            std::cout << "Successfully changed order price to " << order_response.price << std::endl;
-    }
-
-    std::cout << "Would you like to cancel the order (" << order_response.order_id << ") ? (y,n)" << std::endl;
-    if (read_string_from_cli({"yes", "y", "no", "n"})[0] == 'y') {
-        order_response = client.cancel_order(std::to_string(order_response.order_id));
-
-        if (order_response.http_status != 200) {
-            std::cerr << "An error occurred, please try again later" << std::endl;
-            exit(1);
-        }
-        if (order_response.message != "SUCCESS") {
-            std::cerr << "Oops ! could not cancel order" << std::endl;
-            exit(2);
-        }
-
-        std::cout << "Successfully submitted order (" << order_response.order_id << ") for cancellation" << std::endl;
+        arguments.push_back(std::move(argument));
     }
+    return arguments;
 }
 
-void execute_get_ticker_info_command(std::string const& symbol)
+// Leaves journal empty without --journal, false when the journal cannot be opened
+static bool open_journal(boost::program_options::variables_map const& variables_map, std::unique_ptr<Bitfinex::Journal>& journal)
 {
-    Bitfinex::TickerResponse ticker_response = Bitfinex::Client::get_ticker(symbol);
-    if (ticker_response.http_status != 200) {
-        std::cerr << "An error occurred, please try again later" << std::endl;
-        exit(1);
-    }
-    std::cout << "Price of the last trade: " << ticker_response.last_price << std::endl;
-    std::cout << "Price of last highest bid: " << ticker_response.bid << std::endl;
-    std::cout << "Daily volume: " << ticker_response.volume << std::endl;
+    if (!variables_map.count("journal"))
+        return true;
+    std::string const& directory = variables_map["journal"].as<std::string>();
+    journal = Bitfinex::Journal::open({ .directory = directory, .file_size = variables_map["journal-file-size"].as<size_t>() << 20 });
+    if (!journal) {
+        std::cerr << "Could not open a journal in " << directory << std::endl;
+        return false;
+    }
+    return true;
 }
 
-void execute_cancel_order_command(std::string const& order_id)
+static int run_daemon(boost::program_options::variables_map const& variables_map, Clock::time_point started)
 {
-    dotenv::init(".env");
-
-    if (dotenv::getenv("BASE_ENDPOINT").empty()) {
-        std::cerr << "Please set BASE_ENDPOINT in the .env file" << std::endl;
-        return;
-    }
-    if (dotenv::getenv("API_KEY").empty()) {
-        std::cerr << "Please set API_KEY in the .env file" << std::endl;
-        return;
-    }
-    if (dotenv::getenv("SECRET_KEY").empty()) {
-        std::cerr << "Please set SECRET_KEY in the .env file" << std::endl;
-        return;
-    }
-
-    Bitfinex::Config config { .BASE_ENDPOINT = dotenv::getenv("BASE_ENDPOINT"), .API_KEY = dotenv::getenv("API_KEY"),
-        .SECRET_KEY = dotenv::getenv("SECRET_KEY") };
-
-    Bitfinex::Client client(config);
-    Bitfinex::OrderResponse order_response = client.cancel_order(order_id);
-
-    if (order_response.http_status != 200) {
-        std::cerr << "An error occurred, please try again later" << std::endl;
-        exit(1);
-    }
-    if (order_response.message != "SUCCESS") {
-        std::cerr << "Oops ! could not cancel order" << std::endl;
-        exit(2);
-    }
-
-    std::cout << "Successfully submitted order (" << order_response.order_id << ") for cancellation" << std::endl;
-}
-
-void execute_retrieve_orders(std::string const& symbol)
-{
-    dotenv::init(".env");
-
-    if (dotenv::getenv("BASE_ENDPOINT").empty()) {
-        std::cerr << "Please set BASE_ENDPOINT in the .env file" << std::endl;
-        return;
-    }
-    if (dotenv::getenv("API_KEY").empty()) {
-        std::cerr << "Please set API_KEY in the .env file" << std::endl;
-        return;
-    }
-    if (dotenv::getenv("SECRET_KEY").empty()) {
-        std::cerr << "Please set SECRET_KEY in the .env file" << std::endl;
-        return;
-    }
-
-    Bitfinex::Config config { .BASE_ENDPOINT = dotenv::getenv("BASE_ENDPOINT"), .API_KEY = dotenv::getenv("API_KEY"),
-        .SECRET_KEY = dotenv::getenv("SECRET_KEY") };
+    std::unique_ptr<Bitfinex::Journal> journal;
+    if (!open_journal(variables_map, journal))
+        return 1;
+    Cli::Dispatcher dispatcher(false, journal.get());
+    if (!dispatcher.warm_up(std::cerr))
+        return 1;
+    // Commands may then only name listed pairs, a mistyped symbol cannot fill the symbol table
+    const bool symbols_loaded = variables_map.count("symbols-file") ? Cli::load_symbols_file(variables_map["symbols-file"].as<std::string>(), std::cerr)
+                                                                    : Cli::load_exchange_symbols(std::cerr);
+    if (!symbols_loaded)
+        return 1;
 
-    Bitfinex::Client client(config);
-    std::optional<Bitfinex::OrderBook> order_book = client.retrieve_orders(symbol);
-    if (!order_book.has_value())
-        std::cerr << "An error occurred, please try again later" << std::endl;
-    else if (order_book.value().empty())
-        std::cout << "Order book is empty" << std::endl;
-    else
-        std::cout << order_book.value();
+    // Tickers of these symbols are served from the feed instead of being fetched
+    std::unique_ptr<Bitfinex::FeedHandler> feed;
+    if (variables_map.count("live-tickers")) {
+        std::vector<std::string> symbols;
+        boost::split(symbols, variables_map["live-tickers"].as<std::string>(), boost::is_any_of(","), boost::token_compress_on);
+        std::erase(symbols, "");
+        feed = std::make_unique<Bitfinex::FeedHandler>(Bitfinex::FeedOptions { .url = variables_map["feed-url"].as<std::string>() });
+        dispatcher.tickers().attach(*feed);
+        if (journal)
+            journal->attach(*feed);
+        for (std::string const& symbol : symbols)
+            feed->subscribe_ticker(symbol);
+        feed->start();
+    }
+
+    const std::string socket_path = variables_map.count("socket") ? variables_map["socket"].as<std::string>() : Cli::default_socket_path();
+    boost::asio::io_context io;
+    Cli::Daemon daemon(io, dispatcher, socket_path, variables_map["daemon-threads"].as<unsigned>(), variables_map.count("daemon-verbose") != 0);
+    boost::asio::signal_set signals(io, SIGINT, SIGTERM);
+    signals.async_wait([&io](boost::system::error_code const&, int) { io.stop(); });
+    daemon.start();
+    std::cout << std::format("Listening on {}, ready {:.3f} ms after start", socket_path, milliseconds_between(started, Clock::now())) << std::endl;
+    io.run();
+    if (feed)
+        feed->stop();
+    return 0;
 }
 
-void execute_increase_position_command(boost::program_options::variables_map const& variables_map)
+static int run_batch(boost::program_options::variables_map const& variables_map, bool timing, Clock::time_point started)
 {
-    dotenv::init(".env");
-
-    if (dotenv::getenv("BASE_ENDPOINT").empty()) {
-        std::cerr << "Please set BASE_ENDPOINT in the .env file" << std::endl;
-        return;
-    }
-    if (dotenv::getenv("API_KEY").empty()) {
-        std::cerr << "Please set API_KEY in the .env file" << std::endl;
-        return;
-    }
-    if (dotenv::getenv("SECRET_KEY").empty()) {
-        std::cerr << "Please set SECRET_KEY in the .env file" << std::endl;
-        return;
+    std::string const& path = variables_map["batch"].as<std::string>();
+    std::ifstream file;
+    if (path != "-") {
+        file.open(path);
+        if (!file) {
+            std::cerr << "Could not open " << path << std::endl;
+            return 1;
+        }
     }
+    if (variables_map.count("symbols-file") && !Cli::load_symbols_file(variables_map["symbols-file"].as<std::string>(), std::cerr))
+        return 1;
+    std::string const& order = variables_map["batch-order"].as<std::string>();
+    if (order != "input" && order != "completion")
+        throw boost::program_options::validation_error(boost::program_options::validation_error::invalid_option_value, "batch-order");
 
-    if (variables_map.count("position-side") == 0)
-        throw boost::program_options::required_option("position-side");
-    if (variables_map.count("position-symbol") == 0)
-        throw boost::program_options::required_option("position-symbol");
-    if (variables_map.count("position-amount") == 0)
-        throw boost::program_options::required_option("position-amount");
-
-    Bitfinex::Config config { .BASE_ENDPOINT = dotenv::getenv("BASE_ENDPOINT"), .API_KEY = dotenv::getenv("API_KEY"),
-        .SECRET_KEY = dotenv::getenv("SECRET_KEY") };
-
-    Bitfinex::Client client(config);
-    Bitfinex::IncreasePositionResponse response = client.increase_position(variables_map["position-side"].as<Bitfinex::PositionSide>(), variables_map["position-symbol"].as<std::string>(), variables_map["position-amount"].as<double>());
-    if (response.http_status != 200) {
-        std::cerr << "An error occurred, please try again later" << std::endl;
-        exit(1);
-    }
-    if (response.message != "SUCCESS") {
-        std::cerr << "Oops ! Could not submit position increase" << std::endl;
-        exit(1);
-    }
-    std::cout << "Successfully submitted position increase" << std::endl;
+    std::unique_ptr<Bitfinex::Journal> journal;
+    if (!open_journal(variables_map, journal))
+        return 1;
+    Cli::Dispatcher dispatcher(false, journal.get());
+    // Commands that need no credentials, like ticker, still run without them
+    std::ostringstream warm_up_errors;
+    dispatcher.warm_up(warm_up_errors);
+    const Clock::time_point ready = Clock::now();
+    const int exit_code = Cli::run_batch(path == "-" ? std::cin : file, std::cout, dispatcher,
+        { .concurrency = variables_map["batch-concurrency"].as<unsigned>(), .completion_order = order == "completion" });
+    if (timing)
+        std::cerr << std::format("startup {:.3f} ms, batch {:.3f} ms", milliseconds_between(started, ready), milliseconds_between(ready, Clock::now())) << std::endl;
+    return exit_code;
 }
 
-void execute_retrieve_positions_command()
+static int run_in_daemon(std::string const& socket_path, std::vector<std::string> const& arguments, bool timing, Clock::time_point started)
 {
-    dotenv::init(".env");
-
-    if (dotenv::getenv("BASE_ENDPOINT").empty()) {
-        std::cerr << "Please set BASE_ENDPOINT in the .env file" << std::endl;
-        return;
-    }
-    if (dotenv::getenv("API_KEY").empty()) {
-        std::cerr << "Please set API_KEY in the .env file" << std::endl;
-        return;
-    }
-    if (dotenv::getenv("SECRET_KEY").empty()) {
-        std::cerr << "Please set SECRET_KEY in the .env file" << std::endl;
-        return;
-    }
-
-    Bitfinex::Config config { .BASE_ENDPOINT = dotenv::getenv("BASE_ENDPOINT"), .API_KEY = dotenv::getenv("API_KEY"),
-        .SECRET_KEY = dotenv::getenv("SECRET_KEY") };
-
-    Bitfinex::Client client(config);
-    std::optional<Bitfinex::Positions> positions = client.retrieve_positions();
-    if (!positions.has_value()) {
-        std::cerr << "An error occurred, please try again later" << std::endl;
-        exit(1);
-    } else if (positions.value().empty()) {
-        std::cout << "You don't have any open positions" << std::endl;
-    } else
-        std::cout << positions.value();
+    Cli::DaemonClient client(socket_path);
+    const Clock::time_point connected = Clock::now();
+    Cli::DaemonReply reply = client.send(arguments);
+    const Clock::time_point done = Clock::now();
+    std::cout << reply.out << std::flush;
+    std::cerr << reply.err << std::flush;
+    if (timing)
+        std::cerr << std::format("startup {:.3f} ms, command {:.3f} ms ({:.3f} ms in the daemon)", milliseconds_between(started, connected),
+            milliseconds_between(connected, done), std::chrono::duration<double, std::milli>(reply.command_time).count()) << std::endl;
+    return reply.exit_code;
 }
 
 int main(int argc, char **argv)
 {
-    boost::program_options::options_description general_options("Supported general options");
-    general_options.add_options()("help", "print help message");
-    general_options.add_options()("order", "Place a new order");
-    general_options.add_options()("ticker", boost::program_options::value<std::string>(), "Print information about the given ticker");
-    general_options.add_options()("cancel-order", boost::program_options::value<std::string>(), "Cancel order with the given order id");
-    general_options.add_options()("order-book", boost::program_options::value<std::string>(), "Retrieve order book for given symbol");
-    general_options.add_options()("increase-position", "Create a new position using the funds in your margin wallet");
-    general_options.add_options()("retrieve-positions", "Get active positions");
-
-    boost::program_options::options_description order_options("Supported order options");
-    order_options.add_options()("side", new SideValue(nullptr), "Order side [BUY, SELL]");
-    order_options.add_options()("symbol", boost::program_options::value<std::string>(), "The trading pair symbol to submit the order on.");
-    order_options.add_options()("amount", boost::program_options::value<double>()->notifier([](double value) {
-        if (value <= 0)
-            throw boost::program_options::validation_error(boost::program_options::validation_error::invalid_option_value, "amount");
-    }), "Amount of order");
-    order_options.add_options()("type", new TypeValue(nullptr), "The type of the order");
-    order_options.add_options()("price", boost::program_options::value<double>()->notifier([](double value) {
-        if (value <= 0)
-            throw boost::program_options::validation_error(boost::program_options::validation_error::invalid_option_value, "price");
-    }), "Price of the order");
-
-    boost::program_options::options_description increase_position_options("Supported increase position options");
-    increase_position_options.add_options()("position-side", new PositionSide(nullptr), "Position side (short,long)");
-    increase_position_options.add_options()("position-symbol", boost::program_options::value<std::string>(), "Trading pair on which you wish to open a position");
-    increase_position_options.add_options()("position-amount", boost::program_options::value<double>()->notifier([](double value) {
-        if (value <= 0)
-            throw boost::program_options::validation_error(boost::program_options::validation_error::invalid_option_value, "position-amount");
-    }), "Amount of the position");
-
-    boost::program_options::options_description all_options("all options");
-    all_options.add(general_options).add(order_options).add(increase_position_options);
+    const Clock::time_point started = Clock::now();
+
+    boost::program_options::options_description daemon_options("Supported daemon options");
+    daemon_options.add_options()("daemon", "Keep a client and its connections open and run the commands sent to the socket");
+    daemon_options.add_options()("socket", boost::program_options::value<std::string>()->implicit_value(Cli::default_socket_path()),
+        "Socket of the daemon. Without --daemon the command is sent to the daemon instead of run here, which TRADER_SOCKET also does");
+    daemon_options.add_options()("daemon-threads", boost::program_options::value<unsigned>()->default_value(8), "Commands the daemon runs at once");
+    daemon_options.add_options()("daemon-verbose", "Print every command the daemon runs, with its exit code and time, on its stdout");
+    daemon_options.add_options()("live-tickers", boost::program_options::value<std::string>(),
+        "Keep the tickers of the given comma separated symbols up to date from the websocket feed (--feed-url) instead of fetching them");
+    daemon_options.add_options()("timing", "Print how long startup and the command took on stderr");
+
+    boost::program_options::options_description batch_options("Supported batch options");
+    batch_options.add_options()("batch", boost::program_options::value<std::string>(),
+        "Run the commands of the given file, - for stdin, one per line, and print one JSON result per command. Lines are: order SIDE SYMBOL TYPE AMOUNT PRICE, "
+        "cancel ORDER_ID, ticker SYMBOL, tickers [SYMBOL,SYMBOL,...], order-book SYMBOL, positions, increase-position SIDE SYMBOL AMOUNT or wait (for the commands before it)");
+    batch_options.add_options()("batch-concurrency", boost::program_options::value<unsigned>()->default_value(8), "Commands of the batch run at once");
+    batch_options.add_options()("batch-order", boost::program_options::value<std::string>()->default_value("input"), "Order of the results: input or completion");
+
+    boost::program_options::options_description journal_options("Supported journal options");
+    journal_options.add_options()("journal", boost::program_options::value<std::string>()->implicit_value("journal"),
+        "Record every signed request, every response and every streamed frame with its time in the given directory, read it back with trader-journal");
+    journal_options.add_options()("journal-file-size", boost::program_options::value<size_t>()->default_value(64), "Megabytes of each journal file");
+
+    boost::program_options::options_description all_options = Cli::command_options();
+    all_options.add(daemon_options).add(batch_options).add(journal_options);
 
     try {
+        boost::program_options::parsed_options parsed = boost::program_options::parse_command_line(argc, argv, all_options);
         boost::program_options::variables_map variables_map;
-        boost::program_options::store(boost::program_options::parse_command_line(argc, argv, all_options), variables_map);
+        boost::program_options::store(parsed, variables_map);
         boost::program_options::notify(variables_map);
 
-        if (variables_map.count("retrieve-positions")) {
-            execute_retrieve_positions_command();
-        } else if (variables_map.count("increase-position")) {
-            execute_increase_position_command(variables_map);
-        } else if (variables_map.count("order-book")) {
-            std::string symbol = variables_map["order-book"].as<std::string>();
-            execute_retrieve_orders(symbol);
-        } else if (variables_map.count("cancel-order")) {
-            std::string order_id = variables_map["cancel-order"].as<std::string>();
-            execute_cancel_order_command(order_id);
-        } else if (variables_map.count("ticker")) {
-            std::string symbol = variables_map["ticker"].as<std::string>();
-            execute_get_ticker_info_command(symbol);
-        } else if (variables_map.count("order")) {
-            execute_place_order_command(variables_map);
-        } else
+        if (variables_map.count("daemon"))
+            return run_daemon(variables_map, started);
+        if (variables_map.count("batch"))
+            return run_batch(variables_map, variables_map.count("timing") != 0, started);
+        if (!Cli::has_command(variables_map)) {
             std::cout << all_options << std::endl;
+            return 0;
+        }
+
+        const bool timing = variables_map.count("timing") != 0;
+        char const* socket_variable = std::getenv("TRADER_SOCKET");
+        const bool use_daemon = variables_map.count("socket") || (socket_variable && *socket_variable);
+        // A stream is only worth anything live, it always runs here
+        if (use_daemon && !variables_map.count("stream"))
+            return run_in_daemon(variables_map.count("socket") ? variables_map["socket"].as<std::string>() : Cli::default_socket_path(), daemon_arguments(parsed),
+                timing, started);
+
+        std::unique_ptr<Bitfinex::Journal> journal;
+        if (!open_journal(variables_map, journal))
+            return 1;
+        Cli::Dispatcher dispatcher(true, journal.get());
+        // The command opens the connection itself, a warm-up would only add a round trip
+        const bool authenticated = !variables_map.count("ticker") && !variables_map.count("tickers") && !variables_map.count("stream");
+        if (authenticated && !dispatcher.configure(std::cerr))
+            return 1;
+        const Clock::time_point ready = Clock::now();
+        Cli::CommandOutput output { .out = std::cout, .err = std::cerr };
+        const int exit_code = dispatcher.run(variables_map, output);
+        if (timing)
+            std::cerr << std::format("startup {:.3f} ms, command {:.3f} ms", milliseconds_between(started, ready), milliseconds_between(ready, Clock::now())) << std::endl;
+        return exit_code;
     } catch (const std::exception& err) {
         std::cerr << err.what() << std::endl;
         return 1;
     }
-    return 0;
 }
@@ -0,0 +1,376 @@
+#include <ReplayEngine.h>
+#include <Bitfinex/Client.h>
+#include <Bitfinex/HistoryStore.h>
+#include <Bitfinex/OrderMessages.h>
+#include <Bitfinex/ResponseDecoder.h>
+#include <Bitfinex/TickerService.h>
+#include <bit>
+#include <cstdlib>
+#include <nlohmann/json.hpp>
+#include <thread>
+
+using json = nlohmann::json;
+
+namespace Replay {
+
+static constexpr int64_t NANOSECONDS_PER_HOUR = 3600'000'000'000;
+// Closer to its time than this a record is waited for by spinning, sleeps overshoot by about as much
+static constexpr std::chrono::microseconds SPIN_THRESHOLD { 200 };
+
+ReplayEngine::ReplayEngine(ReplayOptions const& options)
+    : m_options(options)
+{
+    m_stats.digest = 14695981039346656037ull;
+}
+
+ReplayEngine::~ReplayEngine() = default;
+
+// FNV-1a, byte by byte so that the digest does not depend on how values are laid out
+void ReplayEngine::add(int64_t value)
+{
+    for (int byte = 0; byte < 8; byte++) {
+        m_stats.digest ^= static_cast<uint64_t>(value >> (byte * 8)) & 0xff;
+        m_stats.digest *= 1099511628211ull;
+    }
+}
+
+void ReplayEngine::add_text(std::string_view text)
+{
+    for (char character : text) {
+        m_stats.digest ^= static_cast<uint8_t>(character);
+        m_stats.digest *= 1099511628211ull;
+    }
+}
+
+ReplayEngine::Feed& ReplayEngine::feed(uint64_t sequence)
+{
+    auto existing = m_feeds.find(sequence);
+    if (existing != m_feeds.end())
+        return existing->second;
+
+    // Never started, frames only come in through process_frame
+    Feed& feed = m_feeds[sequence];
+    feed.handler = std::make_unique<Bitfinex::FeedHandler>();
+    feed.books = std::make_unique<Bitfinex::MarketBooks>(*feed.handler);
+    Bitfinex::FeedHandler& handler = *feed.handler;
+    auto add_double = [this](double value) { add(std::bit_cast<int64_t>(value)); };
+    handler.on_ticker([this, add_double](Bitfinex::TickerUpdate const& update) {
+        add(update.symbol);
+        for (double value : { update.bid, update.bid_size, update.ask, update.ask_size, update.last_price, update.volume })
+            add_double(value);
+    });
+    auto add_trade = [this, add_double](Bitfinex::Trade const& trade) {
+        add(static_cast<int64_t>(trade.trade_id));
+        add(trade.timestamp_ms);
+        add_double(trade.amount);
+        add_double(trade.price);
+    };
+    handler.on_trade([this, add_trade](Bitfinex::TradeUpdate const& update) {
+        add(update.symbol);
+        add_trade(update.trade);
+    });
+    handler.on_trades_snapshot([this, add_trade](Bitfinex::TradesSnapshot const& snapshot) {
+        add(snapshot.symbol);
+        for (Bitfinex::Trade const& trade : snapshot.trades)
+            add_trade(trade);
+    });
+    handler.on_book([this, add_double](Bitfinex::BookUpdate const& update) {
+        add(update.symbol);
+        add_double(update.level.price);
+        add(update.level.count);
+        add_double(update.level.amount);
+    });
+    handler.on_book_snapshot([this](Bitfinex::BookSnapshot const& snapshot) {
+        add(snapshot.symbol);
+        add(static_cast<int64_t>(snapshot.levels.size()));
+    });
+    handler.on_raw_book([this, add_double](Bitfinex::RawBookUpdate const& update) {
+        std::optional<Bitfinex::RawBook>& book = m_raw_books[update.symbol];
+        if (book.has_value())
+            book->apply_update(update.entry);
+        add(update.symbol);
+        add(static_cast<int64_t>(update.entry.order_id));
+        add_double(update.entry.price);
+        add_double(update.entry.amount);
+    });
+    handler.on_raw_book_snapshot([this](Bitfinex::RawBookSnapshot const& snapshot) {
+        std::optional<Bitfinex::RawBook>& book = m_raw_books[snapshot.symbol];
+        if (!book.has_value())
+            book.emplace();
+        book->apply_snapshot(snapshot.entries);
+        add(snapshot.symbol);
+        add(static_cast<int64_t>(snapshot.entries.size()));
+    });
+    return feed;
+}
+
+void ReplayEngine::process_frame(Feed& feed, std::string_view frame)
+{
+    m_stats.frames++;
+    try {
+        // The live handler only takes the channels it asked for, subscribe the replayed one to every
+        // channel the recorded one was given
+        if (frame.starts_with('{') && frame.find("\"subscribed\"") != std::string_view::npos) {
+            json message = json::parse(frame.begin(), frame.end(), nullptr, false);
+            if (!message.is_discarded() && message.value("event", "") == "subscribed") {
+                const std::string channel = message.value("channel", "");
+                const std::string symbol = message.value("symbol", "");
+                const std::string precision = message.value("prec", "");
+                const json length = message.value("len", json {});
+                const unsigned depth = length.is_string() ? static_cast<unsigned>(std::atoi(length.get_ref<std::string const&>().c_str()))
+                                                          : length.is_number_unsigned() ? length.get<unsigned>() : 25;
+                if (feed.subscriptions.insert(channel + ' ' + symbol + ' ' + precision).second) {
+                    if (channel == "ticker")
+                        feed.handler->subscribe_ticker(symbol);
+                    else if (channel == "trades")
+                        feed.handler->subscribe_trades(symbol);
+                    else if (channel == "book" && precision == "R0")
+                        feed.handler->subscribe_raw_book(symbol, depth);
+                    else if (channel == "book")
+                        feed.handler->subscribe_book(symbol, precision, depth);
+                }
+            }
+        }
+        feed.handler->process_frame(frame);
+    } catch (std::exception const&) {
+        // A recorded frame of an unexpected shape, only this frame is lost
+        m_stats.decode_errors++;
+    }
+}
+
+void ReplayEngine::process_request(Bitfinex::JournalRecord const& record)
+{
+    m_stats.requests++;
+    if (record.endpoint != Bitfinex::Endpoint::ORDER_MULTI)
+        return;
+    // The response only lists results, how many there should be is in the request
+    json request = json::parse(record.body.begin(), record.body.end(), nullptr, false);
+    if (!request.is_discarded() && request.contains("ops") && request["ops"].is_array())
+        m_multi_operations[record.sequence] = request["ops"].size();
+}
+
+void ReplayEngine::process_response(Bitfinex::JournalRecord const& record)
+{
+    m_stats.responses++;
+    auto add_order = [this](Bitfinex::OrderResponse const& response) {
+        add(response.http_status);
+        add(static_cast<int64_t>(response.order_id));
+        add_text(response.message);
+        add(response.symbol);
+        add(response.amount.units());
+        add(response.price.units());
+    };
+    auto decoded = [this](Bitfinex::DecodeError error) {
+        add(static_cast<int64_t>(error));
+        if (error != Bitfinex::DecodeError::NONE)
+            m_stats.decode_errors++;
+    };
+
+    // The same decoding, and the same failures, as the client's handling of each endpoint
+    try {
+        switch (record.endpoint) {
+        case Bitfinex::Endpoint::SUBMIT_ORDER:
+            add_order(Bitfinex::read_submit_order_response(record.status, record.body));
+            break;
+        case Bitfinex::Endpoint::UPDATE_ORDER:
+            add_order(Bitfinex::read_update_order_response(record.status, record.body));
+            break;
+        case Bitfinex::Endpoint::CANCEL_ORDER:
+            add_order(Bitfinex::read_cancel_order_response(record.status, record.body));
+            break;
+        case Bitfinex::Endpoint::ORDER_MULTI: {
+            auto operations = m_multi_operations.find(record.sequence);
+            std::vector<Bitfinex::OrderResponse> responses(operations != m_multi_operations.end() ? operations->second : 0);
+            if (operations != m_multi_operations.end())
+                m_multi_operations.erase(operations);
+            m_stats.decode_errors += Bitfinex::read_multi_order_response(record.status, record.body, responses);
+            for (Bitfinex::OrderResponse const& response : responses)
+                add_order(response);
+            break;
+        }
+        case Bitfinex::Endpoint::ORDERS: {
+            if (record.status != 200)
+                break;
+            Bitfinex::OrderBook orders;
+            decoded(Bitfinex::decode_orders(record.body, orders));
+            for (Bitfinex::Order const& order : orders.order_book()) {
+                add(static_cast<int64_t>(order.order_id));
+                add(order.amount.units());
+                add(order.price.units());
+            }
+            break;
+        }
+        case Bitfinex::Endpoint::POSITIONS: {
+            if (record.status != 200)
+                break;
+            Bitfinex::Positions positions;
+            decoded(Bitfinex::decode_positions(record.body, positions));
+            for (Bitfinex::Position const& position : positions.positions()) {
+                add(position.symbol);
+                add(position.amount.units());
+                add(position.base_price.units());
+            }
+            break;
+        }
+        case Bitfinex::Endpoint::INCREASE_POSITION: {
+            if (record.status != 200)
+                break;
+            json response = json::parse(record.body);
+            add_text(response[6].get_ref<std::string const&>());
+            break;
+        }
+        case Bitfinex::Endpoint::TICKERS: {
+            if (record.status != 200)
+                break;
+            std::vector<Bitfinex::TickerUpdate> tickers;
+            decoded(Bitfinex::decode_tickers(record.body, tickers));
+            for (Bitfinex::TickerUpdate const& ticker : tickers) {
+                add(ticker.symbol);
+                add(std::bit_cast<int64_t>(ticker.last_price));
+            }
+            break;
+        }
+        case Bitfinex::Endpoint::TRADES_HISTORY: {
+            if (record.status != 200)
+                break;
+            std::vector<Bitfinex::HistoryTrade> trades;
+            decoded(Bitfinex::decode_trades(record.body, trades));
+            for (Bitfinex::HistoryTrade const& trade : trades) {
+                add(static_cast<int64_t>(trade.trade_id));
+                add(trade.price.units());
+            }
+            break;
+        }
+        case Bitfinex::Endpoint::CANDLES_HISTORY: {
+            if (record.status != 200)
+                break;
+            std::vector<Bitfinex::Candle> candles;
+            decoded(Bitfinex::decode_candles(record.body, candles));
+            for (Bitfinex::Candle const& candle : candles) {
+                add(candle.timestamp_ms);
+                add(candle.close.units());
+            }
+            break;
+        }
+        case Bitfinex::Endpoint::TICKER:
+        case Bitfinex::Endpoint::PAIR_INFO:
+        default:
+            m_stats.skipped++;
+            break;
+        }
+    } catch (std::exception const&) {
+        // What the client reports as a decode error
+        m_stats.decode_errors++;
+        add(-1);
+    }
+}
+
+void ReplayEngine::pace(int64_t timestamp_ns)
+{
+    if (!m_first_ns.has_value())
+        m_first_ns = timestamp_ns;
+    m_last_ns = std::max(m_last_ns, timestamp_ns);
+    if (m_options.speed <= 0)
+        return;
+
+    const auto offset = std::chrono::nanoseconds(static_cast<int64_t>(static_cast<double>(timestamp_ns - m_first_ns.value()) / m_options.speed));
+    const std::chrono::steady_clock::time_point due = m_started + offset;
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if (now >= due) {
+        m_stats.max_lag_ns = std::max<int64_t>(m_stats.max_lag_ns, std::chrono::duration_cast<std::chrono::nanoseconds>(now - due).count());
+        return;
+    }
+    if (due - now > SPIN_THRESHOLD)
+        std::this_thread::sleep_until(due - SPIN_THRESHOLD);
+    while (std::chrono::steady_clock::now() < due)
+        ;
+}
+
+void ReplayEngine::process(Bitfinex::JournalRecord const& record)
+{
+    pace(record.timestamp_ns);
+
+    const auto start = std::chrono::steady_clock::now();
+    switch (record.kind) {
+    case Bitfinex::JournalRecordKind::FRAME:
+        process_frame(feed(record.sequence), record.body);
+        break;
+    case Bitfinex::JournalRecordKind::REQUEST:
+        process_request(record);
+        break;
+    case Bitfinex::JournalRecordKind::RESPONSE:
+        process_response(record);
+        break;
+    default:
+        return;
+    }
+    const auto busy_ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+    m_stats.busy_ns += busy_ns;
+    m_stats.bytes += record.topic.size() + record.body.size();
+
+    const auto hour = static_cast<size_t>(std::max<int64_t>(0, record.timestamp_ns - m_first_ns.value()) / NANOSECONDS_PER_HOUR);
+    if (hour >= m_stats.windows.size()) {
+        for (size_t i = m_stats.windows.size(); i <= hour; i++)
+            m_stats.windows.push_back(ReplayWindow { .start_ns = m_first_ns.value() + static_cast<int64_t>(i) * NANOSECONDS_PER_HOUR });
+    }
+    m_stats.windows[hour].messages++;
+    m_stats.windows[hour].busy_ns += busy_ns;
+}
+
+void ReplayEngine::replay(std::span<Bitfinex::JournalFile const> files)
+{
+    m_started = std::chrono::steady_clock::now();
+    for (Bitfinex::JournalFile const& file : files) {
+        Bitfinex::JournalRecord record;
+        for (size_t offset = 0; file.next(offset, record);)
+            process(record);
+    }
+    m_stats.elapsed_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - m_started).count();
+}
+
+void ReplayEngine::replay_frames(std::span<std::string const> frames)
+{
+    m_started = std::chrono::steady_clock::now();
+    // Untimed, on a feed of its own after the journal's ones
+    const uint64_t sequence = m_feeds.empty() ? 1 : m_feeds.rbegin()->first + 1;
+    for (std::string const& frame : frames)
+        process(Bitfinex::JournalRecord { .kind = Bitfinex::JournalRecordKind::FRAME, .endpoint = {}, .status = 0, .timestamp_ns = m_last_ns,
+            .sequence = sequence, .topic = {}, .body = frame });
+    m_stats.elapsed_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - m_started).count();
+}
+
+ReplayStats ReplayEngine::stats() const
+{
+    ReplayStats stats = m_stats;
+    stats.recorded_ns = m_first_ns.has_value() ? m_last_ns - m_first_ns.value() : 0;
+    for (auto const& [sequence, feed] : m_feeds) {
+        stats.book_checksum_failures += feed.books->checksum_failures();
+        const Bitfinex::DecodeStats decode = feed.handler->decode_stats();
+        stats.decode_errors += decode.errors;
+        stats.feed_decode.messages += decode.messages;
+        stats.feed_decode.heartbeats += decode.heartbeats;
+        stats.feed_decode.errors += decode.errors;
+        stats.feed_decode.total_ns += decode.total_ns;
+        stats.feed_decode.max_ns = std::max(stats.feed_decode.max_ns, decode.max_ns);
+        for (size_t i = 0; i < decode.buckets.size(); i++)
+            stats.feed_decode.buckets[i] += decode.buckets[i];
+    }
+    return stats;
+}
+
+Bitfinex::MarketBook const* ReplayEngine::book(Bitfinex::SymbolId symbol) const
+{
+    for (auto const& [sequence, feed] : m_feeds) {
+        if (Bitfinex::MarketBook const* book = feed.books->book(symbol))
+            return book;
+    }
+    return nullptr;
+}
+
+Bitfinex::RawBook const* ReplayEngine::raw_book(Bitfinex::SymbolId symbol) const
+{
+    std::optional<Bitfinex::RawBook> const* book = m_raw_books.find(symbol);
+    return (book != nullptr && book->has_value()) ? &book->value() : nullptr;
+}
+
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <Bitfinex/FeedHandler.h>
+#include <Bitfinex/Journal.h>
+#include <Bitfinex/MarketBook.h>
+#include <Bitfinex/RawBook.h>
+#include <Bitfinex/Symbols.h>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace Replay {
+
+struct ReplayOptions {
+    // Multiple of the recorded pace, 0 replays as fast as possible
+    double speed { 0 };
+};
+
+// Messages and time spent on them over one hour of the recorded timeline
+struct ReplayWindow {
+    int64_t start_ns { 0 };
+    uint64_t messages { 0 };
+    uint64_t busy_ns { 0 };
+};
+
+struct ReplayStats {
+    uint64_t frames { 0 };
+    uint64_t requests { 0 };
+    uint64_t responses { 0 };
+    uint64_t bytes { 0 };
+    // Frames the feed could not parse plus responses the client would have failed to decode
+    uint64_t decode_errors { 0 };
+    // Responses of endpoints the replay has no decoder for
+    uint64_t skipped { 0 };
+    uint64_t book_checksum_failures { 0 };
+    // Time spent in the decoders and the books, the rest of the elapsed time is pacing
+    uint64_t busy_ns { 0 };
+    double elapsed_seconds { 0 };
+    // From the first to the last record
+    int64_t recorded_ns { 0 };
+    // Furthest behind the recorded pace a record was handled, when paced
+    int64_t max_lag_ns { 0 };
+    // Of everything that was decoded, the same for any speed
+    uint64_t digest { 0 };
+    std::vector<ReplayWindow> windows;
+    Bitfinex::DecodeStats feed_decode {};
+};
+
+// Feeds recorded traffic back through the code that decoded it live: frames go through a
+// FeedHandler per recorded feed, with MarketBooks and RawBooks attached, responses through the
+// decoders the Client uses for their endpoint. Records are handled one at a time in the order they
+// were journaled on the calling thread, optionally at the recorded pace, so the decoded state and
+// the digest only depend on the input.
+class ReplayEngine {
+public:
+    explicit ReplayEngine(ReplayOptions const&);
+    ReplayEngine(ReplayEngine const&) = delete;
+    ReplayEngine& operator=(ReplayEngine const&) = delete;
+    ~ReplayEngine();
+
+    // Every record of the files, which must be in the order they were written
+    void replay(std::span<Bitfinex::JournalFile const>);
+    // Frames recorded by trader --stream --record, as one feed and as fast as possible
+    void replay_frames(std::span<std::string const>);
+
+    [[nodiscard]] ReplayStats stats() const;
+    [[nodiscard]] Bitfinex::MarketBook const* book(Bitfinex::SymbolId) const;
+    [[nodiscard]] Bitfinex::RawBook const* raw_book(Bitfinex::SymbolId) const;
+
+private:
+    struct Feed {
+        std::unique_ptr<Bitfinex::FeedHandler> handler;
+        std::unique_ptr<Bitfinex::MarketBooks> books;
+        // Channels of the recorded subscriptions, each one is subscribed to once
+        std::unordered_set<std::string> subscriptions;
+    };
+
+    Feed& feed(uint64_t sequence);
+    void process(Bitfinex::JournalRecord const&);
+    void process_frame(Feed&, std::string_view frame);
+    void process_request(Bitfinex::JournalRecord const&);
+    void process_response(Bitfinex::JournalRecord const&);
+    void pace(int64_t timestamp_ns);
+    void add(int64_t value);
+    void add_text(std::string_view);
+
+    const ReplayOptions m_options;
+    // By the sequence the journal gave them, in order so that the summaries are too
+    std::map<uint64_t, Feed> m_feeds;
+    // Raw books of every feed, like MarketBooks keeps the aggregated ones
+    Bitfinex::PerSymbol<std::optional<Bitfinex::RawBook>> m_raw_books;
+    // Operations of the multi order requests still waiting for their response
+    std::unordered_map<uint64_t, size_t> m_multi_operations;
+
+    std::chrono::steady_clock::time_point m_started;
+    std::optional<int64_t> m_first_ns;
+    int64_t m_last_ns { 0 };
+    ReplayStats m_stats;
+};
+
+}
@@ -0,0 +1,169 @@
+// Replays a journal written by `trader --journal`, or frames recorded by `trader --stream --record`,
+// through the decoders and books of the client, at the recorded pace, a multiple of it or as fast
+// as possible, and reports how fast the decode and book stack went.
+
+#include <ReplayEngine.h>
+#include <Bitfinex/Client.h>
+#include <boost/algorithm/string.hpp>
+#include <boost/program_options.hpp>
+#include <algorithm>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <nlohmann/json.hpp>
+
+static constexpr int64_t NANOSECONDS_PER_MILLISECOND = 1000000;
+
+static double per_second(uint64_t count, double seconds)
+{
+    return seconds > 0 ? static_cast<double>(count) / seconds : 0;
+}
+
+int main(int argc, char** argv)
+{
+    boost::program_options::options_description options("Supported options");
+    options.add_options()("help", "print help message");
+    options.add_options()("dir", boost::program_options::value<std::string>()->default_value("journal"), "Directory of the journal to replay");
+    options.add_options()("file", boost::program_options::value<std::string>(), "Replay only this journal file");
+    options.add_options()("frames", boost::program_options::value<std::string>(),
+        "Replay frames recorded by trader --stream --record instead, one per line, as fast as possible");
+    options.add_options()("speed", boost::program_options::value<double>()->default_value(0),
+        "Multiple of the recorded pace, e.g. 1 for real time or 100, 0 for as fast as possible");
+    options.add_options()("books", boost::program_options::value<std::string>(), "Comma separated symbols whose top of book is printed at the end");
+    options.add_options()("hours", "Print the messages and replay rate of every recorded hour");
+    options.add_options()("json", boost::program_options::value<std::string>(), "Write the report as JSON to this file, - for stdout");
+
+    try {
+        boost::program_options::variables_map variables_map;
+        boost::program_options::store(boost::program_options::parse_command_line(argc, argv, options), variables_map);
+        boost::program_options::notify(variables_map);
+        if (variables_map.count("help")) {
+            std::cout << options << std::endl;
+            return 0;
+        }
+
+        const double speed = variables_map["speed"].as<double>();
+        if (speed < 0)
+            throw boost::program_options::validation_error(boost::program_options::validation_error::invalid_option_value, "speed");
+        Replay::ReplayEngine engine(Replay::ReplayOptions { .speed = speed });
+
+        if (variables_map.count("frames")) {
+            std::ifstream file(variables_map["frames"].as<std::string>());
+            if (!file) {
+                std::cerr << "Could not open " << variables_map["frames"].as<std::string>() << std::endl;
+                return 1;
+            }
+            std::vector<std::string> frames;
+            for (std::string line; std::getline(file, line);) {
+                if (!line.empty())
+                    frames.push_back(std::move(line));
+            }
+            engine.replay_frames(frames);
+        } else {
+            std::vector<Bitfinex::JournalFile> files;
+            const std::vector<std::string> paths = variables_map.count("file") ? std::vector { variables_map["file"].as<std::string>() }
+                                                                               : Bitfinex::journal_files(variables_map["dir"].as<std::string>());
+            for (std::string const& path : paths) {
+                std::optional<Bitfinex::JournalFile> file = Bitfinex::JournalFile::open(path);
+                if (!file.has_value()) {
+                    std::cerr << path << " is not a journal file" << std::endl;
+                    return 1;
+                }
+                files.push_back(std::move(file.value()));
+            }
+            if (files.empty()) {
+                std::cerr << "No journal files in " << variables_map["dir"].as<std::string>() << std::endl;
+                return 1;
+            }
+            engine.replay(files);
+        }
+
+        const Replay::ReplayStats stats = engine.stats();
+        const uint64_t messages = stats.frames + stats.requests + stats.responses;
+        const double busy_seconds = static_cast<double>(stats.busy_ns) / 1e9;
+        const double recorded_seconds = static_cast<double>(stats.recorded_ns) / 1e9;
+        std::cout << std::format("{} messages ({} frames, {} requests, {} responses, {:.1f} MB) over {:.0f} s of recording, replayed in {:.3f} s",
+            messages, stats.frames, stats.requests, stats.responses, static_cast<double>(stats.bytes) / 1e6, recorded_seconds, stats.elapsed_seconds)
+                  << std::endl;
+        // Recorded frames have no times, only journals can be compared to real time
+        std::cout << std::format("decode and books: {:.3f} s, {:.0f} messages/s, {:.1f} MB/s", busy_seconds, per_second(messages, busy_seconds),
+            per_second(stats.bytes, busy_seconds) / 1e6);
+        if (stats.recorded_ns > 0 && busy_seconds > 0)
+            std::cout << std::format(", {:.0f}x real time", recorded_seconds / busy_seconds);
+        std::cout << std::endl;
+        std::cout << std::format("feed decode per frame: p50 {} ns, p99 {} ns, p99.9 {} ns, max {} ns", stats.feed_decode.percentile_ns(50),
+            stats.feed_decode.percentile_ns(99), stats.feed_decode.percentile_ns(99.9), stats.feed_decode.max_ns)
+                  << std::endl;
+
+        // The speed a whole day can be replayed at without falling behind is set by its busiest
+        // hour, not by its average
+        auto busiest = std::max_element(stats.windows.begin(), stats.windows.end(),
+            [](Replay::ReplayWindow const& a, Replay::ReplayWindow const& b) { return a.busy_ns < b.busy_ns; });
+        if (stats.windows.size() > 1) {
+            const double busiest_seconds = static_cast<double>(busiest->busy_ns) / 1e9;
+            std::cout << std::format("sustained over {} hours: {:.0f}x real time, set by the busiest hour (from {}, {:.0f} messages/s)", stats.windows.size(),
+                busiest_seconds > 0 ? 3600 / busiest_seconds : 0, Bitfinex::unix_to_iso_utc(busiest->start_ns / NANOSECONDS_PER_MILLISECOND),
+                per_second(busiest->messages, busiest_seconds))
+                      << std::endl;
+        }
+        if (speed > 0)
+            std::cout << std::format("at {}x: at most {:.3f} ms behind the recorded pace", speed, static_cast<double>(stats.max_lag_ns) / 1e6) << std::endl;
+        std::cout << std::format("{} decode errors, {} responses without a decoder, {} book checksum failures, digest {:016x}", stats.decode_errors,
+            stats.skipped, stats.book_checksum_failures, stats.digest)
+                  << std::endl;
+
+        if (variables_map.count("hours")) {
+            std::cout << std::format("{:<24} {:>10} {:>10} {:>14} {:>10}", "HOUR", "MESSAGES", "BUSY S", "MESSAGES/S", "SPEED") << std::endl;
+            for (Replay::ReplayWindow const& window : stats.windows) {
+                const double seconds = static_cast<double>(window.busy_ns) / 1e9;
+                std::cout << std::format("{:<24} {:>10} {:>10.3f} {:>14.0f} {:>9.0f}x", Bitfinex::unix_to_iso_utc(window.start_ns / NANOSECONDS_PER_MILLISECOND),
+                    window.messages, seconds, per_second(window.messages, seconds), seconds > 0 ? 3600 / seconds : 0)
+                          << std::endl;
+            }
+        }
+
+        if (variables_map.count("books")) {
+            std::vector<std::string> symbols;
+            boost::split(symbols, variables_map["books"].as<std::string>(), boost::is_any_of(","), boost::token_compress_on);
+            for (std::string const& symbol : symbols) {
+                std::optional<Bitfinex::SymbolId> id = Bitfinex::find_symbol(symbol);
+                Bitfinex::MarketBook const* book = id.has_value() ? engine.book(id.value()) : nullptr;
+                Bitfinex::RawBook const* raw_book = id.has_value() ? engine.raw_book(id.value()) : nullptr;
+                if (book != nullptr && book->best_bid().has_value() && book->best_ask().has_value()) {
+                    std::cout << std::format("{}: {} @ {} / {} @ {}, checksum {}", symbol, book->best_bid()->amount, book->best_bid()->price,
+                        -book->best_ask()->amount, book->best_ask()->price, book->checksum())
+                              << std::endl;
+                } else if (raw_book != nullptr && raw_book->best(Bitfinex::OrderSide::BUY).has_value() && raw_book->best(Bitfinex::OrderSide::SELL).has_value()) {
+                    const Bitfinex::RawBookLevel bid = raw_book->best(Bitfinex::OrderSide::BUY).value();
+                    const Bitfinex::RawBookLevel ask = raw_book->best(Bitfinex::OrderSide::SELL).value();
+                    std::cout << std::format("{}: {} @ {} / {} @ {}, {} orders", symbol, bid.amount, bid.price, -ask.amount, ask.price, raw_book->order_count())
+                              << std::endl;
+                } else {
+                    std::cout << symbol << ": no book" << std::endl;
+                }
+            }
+        }
+
+        if (variables_map.count("json")) {
+            nlohmann::json windows = nlohmann::json::array();
+            for (Replay::ReplayWindow const& window : stats.windows)
+                windows.push_back({ { "start_ns", window.start_ns }, { "messages", window.messages }, { "busy_ns", window.busy_ns } });
+            nlohmann::json document = { { "frames", stats.frames }, { "requests", stats.requests }, { "responses", stats.responses },
+                { "bytes", stats.bytes }, { "recorded_ns", stats.recorded_ns }, { "elapsed_seconds", stats.elapsed_seconds },
+                { "busy_ns", stats.busy_ns }, { "messages_per_second", per_second(messages, busy_seconds) }, { "speed", speed },
+                { "max_lag_ns", stats.max_lag_ns }, { "decode_errors", stats.decode_errors }, { "skipped", stats.skipped },
+                { "book_checksum_failures", stats.book_checksum_failures }, { "digest", std::format("{:016x}", stats.digest) }, { "hours", windows } };
+            std::string const& path = variables_map["json"].as<std::string>();
+            if (path == "-") {
+                std::cout << document.dump(2) << std::endl;
+            } else {
+                std::ofstream file(path);
+                file << document.dump(2) << std::endl;
+            }
+        }
+        return 0;
+    } catch (const std::exception& err) {
+        std::cerr << err.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,1001 @@
+#include <Exchange.h>
+#include <Bitfinex/MarketBook.h>
+#include <Bitfinex/OrderMessages.h>
+#include <algorithm>
+#include <boost/algorithm/string.hpp>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <format>
+#include <nlohmann/json.hpp>
+#include <openssl/crypto.h>
+
+using json = nlohmann::json;
+
+namespace Simulator {
+
+using Bitfinex::OrderSide;
+using Bitfinex::OrderType;
+
+static constexpr AccountId MARKET_MAKER = 0;
+static constexpr int64_t HEARTBEAT_INTERVAL_MS = 15000;
+static constexpr int CONF_FLAG_CHECKSUM = 131072;
+static constexpr size_t DEFAULT_BOOK_LENGTH = 25;
+static constexpr Decimal MINIMUM_ORDER_SIZE = Decimal::from_units(10000);
+static constexpr Decimal MAXIMUM_ORDER_SIZE = Decimal::from_integer(2000);
+
+// https://docs.bitfinex.com/docs/abbreviations-glossary#error-codes
+static constexpr int ERROR_GENERIC = 10001;
+static constexpr int ERROR_REQUEST = 10020;
+static constexpr int ERROR_APIKEY = 10100;
+static constexpr int ERROR_NONCE = 10114;
+static constexpr int ERROR_SUBSCRIBE = 10300;
+static constexpr int ERROR_UNSUBSCRIBE = 10400;
+static constexpr int ERROR_RATE_LIMIT = 11010;
+
+int64_t now_ms()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// JSON string of a text that may come from a client
+static std::string json_string(std::string_view text)
+{
+    return json(std::string(text)).dump();
+}
+
+static HttpReply error_reply(unsigned status, int code, std::string_view message)
+{
+    return HttpReply { .status = status, .body = std::format(R"(["error",{},{}])", code, json_string(message)) };
+}
+
+static std::string error_event(int code, std::string_view message)
+{
+    return std::format(R"({{"event":"error","msg":{},"code":{}}})", json_string(message), code);
+}
+
+static std::optional<Decimal> read_field(json const& object, char const* key)
+{
+    auto value = object.find(key);
+    if (value == object.end())
+        return {};
+    if (value->is_string())
+        return Decimal::parse(value->get_ref<std::string const&>());
+    if (value->is_number())
+        return Bitfinex::read_decimal(*value);
+    return {};
+}
+
+static std::optional<OrderType> read_order_type(std::string const& text)
+{
+    std::string name = boost::algorithm::to_lower_copy(text);
+    std::replace(name.begin(), name.end(), ' ', '_');
+    if (!Bitfinex::is_valid_order_type(name))
+        return {};
+    return Bitfinex::order_type_from_string(name);
+}
+
+// Spelled the way the exchange sends it, "EXCHANGE LIMIT"
+static std::string order_type_name(OrderType type)
+{
+    std::string name = boost::algorithm::to_upper_copy(Bitfinex::order_type_to_string(type));
+    std::replace(name.begin(), name.end(), '_', ' ');
+    return name;
+}
+
+static std::string order_status(SimulatedOrder const& order)
+{
+    const Decimal filled = order.original_amount - order.amount;
+    switch (order.state) {
+    case OrderState::ACTIVE:
+        return "ACTIVE";
+    case OrderState::PARTIALLY_FILLED:
+        return std::format("PARTIALLY FILLED @ {}({})", order.average_price, filled);
+    case OrderState::EXECUTED:
+        return std::format("EXECUTED @ {}({})", order.average_price, filled);
+    case OrderState::CANCELED:
+        if (filled.is_zero())
+            return "CANCELED";
+        return std::format("CANCELED was: PARTIALLY FILLED @ {}({})", order.average_price, filled);
+    }
+    return {};
+}
+
+static std::string_view pair_name(SymbolId symbol)
+{
+    std::string_view name = Bitfinex::symbol_name(symbol);
+    return name.starts_with('t') ? name.substr(1) : name;
+}
+
+static std::optional<uint64_t> read_nonce(std::string_view text)
+{
+    uint64_t nonce = 0;
+    auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), nonce);
+    if (error != std::errc {} || end != text.data() + text.size())
+        return {};
+    return nonce;
+}
+
+// Ten thousandth of the price rounded down to a power of ten, 1 for 60000 and 0.1 for 3000
+static Decimal price_tick(Decimal reference_price)
+{
+    const double magnitude = std::floor(std::log10(std::max(reference_price.to_double(), 1e-8)));
+    return std::max(Decimal::from_double(std::pow(10.0, magnitude - 4)), Decimal::from_units(1));
+}
+
+Exchange::Exchange(ExchangeOptions options)
+    : m_options(std::move(options))
+    , m_random(m_options.random_seed)
+{
+    auto account_key = [](ApiKey const& api_key) {
+        return AccountKey { .api_key = api_key.key, .signer = std::make_unique<Bitfinex::Signer>(api_key.secret), .last_nonce = 0 };
+    };
+    m_accounts.emplace_back();
+    for (ApiKey const& api_key : m_options.api_keys) {
+        m_accounts.emplace_back();
+        m_accounts.back().keys.push_back(account_key(api_key));
+    }
+    if (m_accounts.size() > 1) {
+        for (ApiKey const& api_key : m_options.extra_keys)
+            m_accounts[1].keys.push_back(account_key(api_key));
+    }
+    for (ListedSymbol const& listed : m_options.symbols) {
+        Bitfinex::set_symbol_limits(listed.symbol, Bitfinex::DEFAULT_PRICE_PRECISION, MINIMUM_ORDER_SIZE, MAXIMUM_ORDER_SIZE);
+        m_engine.list_symbol(listed.symbol);
+        m_markets[listed.symbol] = Market { .reference_price = listed.reference_price, .tick = price_tick(listed.reference_price), .ticker_changed = false };
+        seed(listed.symbol);
+    }
+}
+
+Decimal Exchange::random_amount(Decimal minimum, Decimal maximum)
+{
+    // Multiples of 1e-4, the smallest order size
+    const int64_t step = MINIMUM_ORDER_SIZE.units();
+    const int64_t steps = std::max<int64_t>((maximum - minimum).units() / step, 1);
+    return minimum + Decimal::from_units(static_cast<int64_t>(m_random() % static_cast<uint64_t>(steps)) * step);
+}
+
+void Exchange::seed(SymbolId symbol)
+{
+    Market const& market = m_markets[symbol];
+    const int64_t now = now_ms();
+    for (size_t i = 1; i <= m_options.seed_depth; i++) {
+        for (const int64_t direction : { -1, 1 }) {
+            const Decimal price = Bitfinex::round_price(symbol, market.reference_price + market.tick * static_cast<int64_t>(i) * direction);
+            const Decimal amount = random_amount(Decimal::from_double(0.1), Decimal::from_integer(2));
+            m_events.clear();
+            m_engine.submit(NewOrder { .account = MARKET_MAKER, .client_order_id = 0, .symbol = symbol, .type = OrderType::EXCHANGE_LIMIT,
+                                .amount = (direction < 0) ? amount : -amount, .price = price },
+                now, m_events);
+        }
+    }
+    m_events.clear();
+}
+
+bool Exchange::inject_error()
+{
+    return m_options.error_rate > 0 && std::uniform_real_distribution<double>(0, 1)(m_random) < m_options.error_rate;
+}
+
+Exchange::AccountKey* Exchange::find_key(std::string_view api_key, AccountId& account)
+{
+    for (AccountId id = 1; id < m_accounts.size(); id++) {
+        for (AccountKey& key : m_accounts[id].keys) {
+            if (key.api_key == api_key) {
+                account = id;
+                return &key;
+            }
+        }
+    }
+    return nullptr;
+}
+
+std::optional<AccountId> Exchange::authenticate(std::string_view path, RequestAuth const& auth, std::string_view body, HttpReply& rejection)
+{
+    AccountId id = MARKET_MAKER;
+    AccountKey* key = find_key(auth.api_key, id);
+    if (!key) {
+        rejection = error_reply(500, ERROR_APIKEY, "apikey: invalid");
+        return {};
+    }
+    std::optional<uint64_t> nonce = read_nonce(auth.nonce);
+    if (!nonce.has_value()) {
+        rejection = error_reply(500, ERROR_NONCE, "nonce: invalid");
+        return {};
+    }
+    const Bitfinex::Signature expected = key->signer->sign({ "/api", path, auth.nonce, body });
+    if (expected.view().size() != auth.signature.size() || CRYPTO_memcmp(expected.view().data(), auth.signature.data(), auth.signature.size()) != 0) {
+        rejection = error_reply(500, ERROR_APIKEY, "apikey: digest invalid");
+        return {};
+    }
+    if (m_options.check_nonces && nonce.value() <= key->last_nonce) {
+        rejection = error_reply(500, ERROR_NONCE, "nonce: small");
+        return {};
+    }
+    key->last_nonce = std::max(key->last_nonce, nonce.value());
+    return id;
+}
+
+HttpReply Exchange::get(std::string_view target)
+{
+    const std::string_view path = target.substr(0, target.find('?'));
+    if (inject_error())
+        return error_reply(500, ERROR_GENERIC, "simulated failure");
+
+    if (path.starts_with("/v2/ticker/")) {
+        std::optional<SymbolId> symbol = Bitfinex::find_symbol(path.substr(std::string_view("/v2/ticker/").size()));
+        if (!symbol.has_value() || !m_engine.is_listed(symbol.value()))
+            return error_reply(500, ERROR_REQUEST, "symbol: invalid");
+        return HttpReply { .status = 200, .body = ticker_array(symbol.value()) };
+    }
+    if (path == "/v2/tickers") {
+        // ?symbols=tBTCUSD,tETHUSD or ?symbols=ALL, symbols that are not listed are left out
+        std::string_view query = target.substr(path.size());
+        std::vector<std::string> names;
+        if (size_t start = query.find("symbols="); start != std::string_view::npos) {
+            query = query.substr(start + std::string_view("symbols=").size());
+            boost::split(names, query.substr(0, query.find('&')), boost::is_any_of(","), boost::token_compress_on);
+        }
+        std::vector<SymbolId> symbols;
+        if (names.size() == 1 && names[0] == "ALL") {
+            symbols = m_engine.symbols();
+        } else {
+            for (std::string const& name : names) {
+                std::optional<SymbolId> symbol = Bitfinex::find_symbol(name);
+                if (symbol.has_value() && m_engine.is_listed(symbol.value()))
+                    symbols.push_back(symbol.value());
+            }
+        }
+        std::string body = "[";
+        for (SymbolId symbol : symbols) {
+            if (body.size() > 1)
+                body += ',';
+            // The ticker array with the symbol in front
+            body += std::format(R"(["{}",{})", Bitfinex::symbol_name(symbol), std::string_view(ticker_array(symbol)).substr(1));
+        }
+        return HttpReply { .status = 200, .body = body + "]" };
+    }
+    if (path == "/v2/conf/pub:info:pair") {
+        std::string body = "[[";
+        for (SymbolId symbol : m_engine.symbols()) {
+            if (body.size() > 2)
+                body += ',';
+            body += std::format(R"(["{}",[null,null,null,"{}","{}",null,null,null,0.2,0.1]])", pair_name(symbol), MINIMUM_ORDER_SIZE, MAXIMUM_ORDER_SIZE);
+        }
+        return HttpReply { .status = 200, .body = body + "]]" };
+    }
+    if (path == "/v2/platform/status")
+        return HttpReply { .status = 200, .body = "[1]" };
+    return error_reply(404, ERROR_REQUEST, "request: unknown");
+}
+
+HttpReply Exchange::post(std::string_view target, RequestAuth const& auth, std::string_view body)
+{
+    const std::string_view path = target.substr(0, target.find('?'));
+    HttpReply rejection;
+    std::optional<AccountId> account = authenticate(path, auth, body, rejection);
+    if (!account.has_value())
+        return rejection;
+    if (!within_rate_limit(m_accounts[account.value()], path))
+        return error_reply(429, ERROR_RATE_LIMIT, "ratelimit: error");
+    if (inject_error())
+        return error_reply(500, ERROR_GENERIC, "simulated failure");
+
+    if (path == "/v2/auth/w/order/submit")
+        return order_reply(account.value(), Operation::NEW, body);
+    if (path == "/v2/auth/w/order/update")
+        return order_reply(account.value(), Operation::UPDATE, body);
+    if (path == "/v2/auth/w/order/cancel")
+        return order_reply(account.value(), Operation::CANCEL, body);
+    if (path == "/v2/auth/w/order/multi")
+        return multi(account.value(), body);
+    if (path == "/v2/auth/r/orders")
+        return orders_reply(account.value(), {});
+    if (path.starts_with("/v2/auth/r/orders/")) {
+        std::optional<SymbolId> symbol = Bitfinex::find_symbol(path.substr(std::string_view("/v2/auth/r/orders/").size()));
+        if (!symbol.has_value())
+            return HttpReply { .status = 200, .body = "[]" };
+        return orders_reply(account.value(), symbol);
+    }
+    if (path == "/v2/auth/r/positions")
+        return positions_reply(account.value());
+    if (path == "/v2/auth/w/position/increase")
+        return increase_position(account.value(), body);
+    return error_reply(404, ERROR_REQUEST, "request: unknown");
+}
+
+// Sliding one minute window, requests turned away do not count
+bool Exchange::within_rate_limit(Account& account, std::string_view path)
+{
+    std::optional<Bitfinex::RateLimitFamily> family = Bitfinex::rate_limit_family(path);
+    if (!family.has_value())
+        return true;
+    const unsigned limit = m_options.rate_limits[static_cast<size_t>(family.value())];
+    if (limit == 0)
+        return true;
+    std::deque<int64_t>& recent_requests = account.recent_requests[static_cast<size_t>(family.value())];
+    const int64_t now = now_ms();
+    while (!recent_requests.empty() && recent_requests.front() <= now - 60000)
+        recent_requests.pop_front();
+    if (recent_requests.size() >= limit)
+        return false;
+    recent_requests.push_back(now);
+    return true;
+}
+
+Exchange::OperationResult Exchange::execute(AccountId account, Operation operation, json const& payload, bool injected_failure)
+{
+    OperationResult result { .operation = operation, .order = {}, .rejection = {} };
+    if (!payload.is_object()) {
+        result.rejection = "payload: invalid";
+        return result;
+    }
+    const int64_t now = now_ms();
+    m_events.clear();
+
+    if (operation == Operation::NEW) {
+        std::optional<SymbolId> symbol = Bitfinex::find_symbol(payload.value("symbol", std::string()));
+        std::optional<OrderType> type = read_order_type(payload.value("type", std::string()));
+        const Decimal amount = read_field(payload, "amount").value_or(Decimal {});
+        // Echoed back when the order is rejected so that the client can tell which one it was
+        result.order = SimulatedOrder { .id = 0, .client_order_id = payload.value("cid", int64_t(0)), .created_ms = now, .updated_ms = now,
+            .amount = amount, .original_amount = amount, .price = read_field(payload, "price").value_or(Decimal {}), .average_price = Decimal {},
+            .symbol = symbol.value_or(0), .account = account, .type = type.value_or(OrderType::EXCHANGE_LIMIT), .state = OrderState::CANCELED };
+        if (!symbol.has_value() || !m_engine.is_listed(symbol.value())) {
+            result.rejection = "symbol: invalid";
+        } else if (!type.has_value()) {
+            result.rejection = "type: invalid";
+        } else if (injected_failure) {
+            result.rejection = "simulated failure";
+        } else {
+            EngineResult engine_result = m_engine.submit(NewOrder { .account = account, .client_order_id = result.order->client_order_id,
+                                                             .symbol = symbol.value(), .type = type.value(), .amount = amount, .price = result.order->price },
+                now, m_events);
+            if (engine_result.order.has_value())
+                result.order = engine_result.order;
+            result.rejection = engine_result.rejection;
+        }
+    } else {
+        const uint64_t order_id = payload.value("id", uint64_t(0));
+        if (SimulatedOrder const* existing = m_engine.order(order_id); existing != nullptr && existing->account == account) {
+            result.order = *existing;
+        } else {
+            result.order = SimulatedOrder { .id = order_id, .client_order_id = 0, .created_ms = now, .updated_ms = now, .amount = Decimal {},
+                .original_amount = Decimal {}, .price = Decimal {}, .average_price = Decimal {}, .symbol = 0, .account = account,
+                .type = OrderType::EXCHANGE_LIMIT, .state = OrderState::CANCELED };
+        }
+        EngineResult engine_result;
+        if (injected_failure) {
+            engine_result.rejection = "simulated failure";
+        } else if (operation == Operation::UPDATE) {
+            // The exchange takes a new amount as the signed total, delta is relative to what is left
+            std::optional<Decimal> amount = read_field(payload, "amount");
+            if (std::optional<Decimal> delta = read_field(payload, "delta"); delta.has_value() && !amount.has_value())
+                amount = result.order->amount + delta.value();
+            engine_result = m_engine.update(account, order_id, read_field(payload, "price"), amount, now, m_events);
+        } else {
+            engine_result = m_engine.cancel(account, order_id, now, m_events);
+        }
+        if (engine_result.order.has_value())
+            result.order = engine_result.order;
+        result.rejection = engine_result.rejection;
+    }
+
+    if (result.rejection.empty())
+        report(account, operation, result.order.value());
+    return result;
+}
+
+void Exchange::report(AccountId account, Operation operation, SimulatedOrder const& order)
+{
+    const int64_t now = now_ms();
+    publish(m_events);
+
+    const bool closed = order.state == OrderState::EXECUTED || order.state == OrderState::CANCELED;
+    switch (operation) {
+    case Operation::NEW:
+        notify_account(account, std::format(R"([0,"on",{}])", order_array(order)));
+        if (closed)
+            notify_account(account, std::format(R"([0,"oc",{}])", order_array(order)));
+        break;
+    case Operation::UPDATE:
+        notify_account(account, std::format(R"([0,"{}",{}])", closed ? "oc" : "ou", order_array(order)));
+        break;
+    case Operation::CANCEL:
+        notify_account(account, std::format(R"([0,"oc",{}])", order_array(order)));
+        break;
+    }
+    for (SimulatedOrder const& maker : m_events.makers)
+        notify_account(maker.account, std::format(R"([0,"{}",{}])", (maker.state == OrderState::EXECUTED) ? "oc" : "ou", order_array(maker)));
+
+    for (Execution const& execution : m_events.executions) {
+        // [ID, SYMBOL, MTS, ORDER_ID, EXEC_AMOUNT, EXEC_PRICE, ORDER_TYPE, ORDER_PRICE, MAKER, FEE, FEE_CURRENCY, CID]
+        notify_account(execution.taker_account, std::format(R"([0,"te",[{},"{}",{},{},{},{},null,null,-1,null,null,null]])", execution.trade_id,
+                                                     Bitfinex::symbol_name(execution.symbol), execution.timestamp_ms, execution.taker_order_id,
+                                                     execution.amount, execution.price));
+        notify_account(execution.maker_account, std::format(R"([0,"te",[{},"{}",{},{},{},{},null,null,1,null,null,null]])", execution.trade_id,
+                                                     Bitfinex::symbol_name(execution.symbol), execution.timestamp_ms, execution.maker_order_id,
+                                                     -execution.amount, execution.price));
+        if (execution.taker_margin)
+            move_position(execution.taker_account, execution.symbol, execution.amount, execution.price, now);
+        if (execution.maker_margin)
+            move_position(execution.maker_account, execution.symbol, -execution.amount, execution.price, now);
+    }
+}
+
+void Exchange::move_position(AccountId account_id, SymbolId symbol, Decimal amount, Decimal price, int64_t now)
+{
+    if (account_id == MARKET_MAKER)
+        return;
+    Account& account = m_accounts[account_id];
+    auto [found, created] = account.positions.try_emplace(symbol,
+        SimulatedPosition { .id = ++m_last_position_id, .created_ms = now, .updated_ms = now, .amount = Decimal {}, .base_price = Decimal {} });
+    SimulatedPosition& position = found->second;
+
+    const Decimal total = position.amount + amount;
+    if (position.amount.is_zero() || position.amount.is_negative() == amount.is_negative()) {
+        // Adding to the position averages the entry price
+        const __int128 held = position.amount.abs().units();
+        const __int128 added = amount.abs().units();
+        position.base_price = Decimal::from_units(static_cast<int64_t>((position.base_price.units() * held + price.units() * added) / (held + added)));
+    } else if (!total.is_zero() && total.is_negative() != position.amount.is_negative()) {
+        // Flipped sides, what is left was opened at this price
+        position.base_price = price;
+    }
+    position.amount = total;
+    position.updated_ms = now;
+
+    if (position.amount.is_zero()) {
+        notify_account(account_id, std::format(R"([0,"pc",{}])", position_array(symbol, position)));
+        account.positions.erase(found);
+        return;
+    }
+    notify_account(account_id, std::format(R"([0,"{}",{}])", created ? "pn" : "pu", position_array(symbol, position)));
+}
+
+void Exchange::notify_account(AccountId account, std::string const& frame)
+{
+    if (account == MARKET_MAKER)
+        return;
+    for (auto& [connection, session] : m_sessions) {
+        if (session.account == account)
+            connection->send(frame);
+    }
+}
+
+void Exchange::send(int64_t channel_id, Channel& channel, std::string const& frame)
+{
+    channel.last_sent_ms = now_ms();
+    channel.connection->send(std::format("[{},{}]", channel_id, frame));
+}
+
+// Like the exchange a price level book only carries its best length levels per side: a level
+// leaving them is removed, one moving up into them is sent as if it were new
+void Exchange::send_level_changes(int64_t channel_id, Channel& channel, std::vector<PriceLevel> levels)
+{
+    auto same_level = [](PriceLevel const& level) {
+        return [&level](PriceLevel const& other) { return other.price == level.price && other.amount.is_negative() == level.amount.is_negative(); };
+    };
+    for (PriceLevel const& held : channel.levels) {
+        if (std::none_of(levels.begin(), levels.end(), same_level(held)))
+            send(channel_id, channel, std::format("[{},0,{}]", held.price, held.amount.is_negative() ? -1 : 1));
+    }
+    for (PriceLevel const& level : levels) {
+        auto held = std::find_if(channel.levels.begin(), channel.levels.end(), same_level(level));
+        if (held == channel.levels.end() || held->count != level.count || held->amount != level.amount)
+            send(channel_id, channel, std::format("[{},{},{}]", level.price, level.count, level.amount));
+    }
+    channel.levels = std::move(levels);
+}
+
+void Exchange::publish(EngineEvents const& events)
+{
+    if (events.executions.empty() && events.book.empty())
+        return;
+    const SymbolId symbol = !events.book.empty() ? events.book.front().symbol : events.executions.front().symbol;
+    m_markets[symbol].ticker_changed = true;
+
+    // By feed and depth, channels of the same length share them
+    std::map<std::pair<Feed, size_t>, int32_t> checksums;
+    std::map<size_t, std::vector<PriceLevel>> best_levels;
+    for (const int64_t channel_id : m_symbol_channels[symbol]) {
+        Channel& channel = m_channels.at(channel_id);
+        switch (channel.feed) {
+        case Feed::TICKER:
+            break;
+        case Feed::TRADES:
+            for (Execution const& execution : events.executions)
+                send(channel_id, channel, std::format(R"("te",[{},{},{},{}])", execution.trade_id, execution.timestamp_ms, execution.amount, execution.price));
+            break;
+        case Feed::BOOK: {
+            if (events.book.empty())
+                break;
+            auto [levels, added] = best_levels.try_emplace(channel.length);
+            if (added)
+                levels->second = m_engine.levels(symbol, channel.length);
+            send_level_changes(channel_id, channel, levels->second);
+            break;
+        }
+        case Feed::RAW_BOOK:
+            for (BookChange const& change : events.book) {
+                if (change.amount.is_zero())
+                    send(channel_id, channel, std::format("[{},0,{}]", change.order_id, (change.side == OrderSide::BUY) ? 1 : -1));
+                else
+                    send(channel_id, channel, std::format("[{},{},{}]", change.order_id, change.price, change.amount));
+            }
+            break;
+        }
+
+        if (events.book.empty() || (channel.feed != Feed::BOOK && channel.feed != Feed::RAW_BOOK) || !m_sessions[channel.connection].checksums)
+            continue;
+        // A raw book subscriber is sent every order, its checksum is the exchange's
+        const size_t depth = (channel.feed == Feed::BOOK) ? std::min(channel.length, Bitfinex::MarketBook::CHECKSUM_DEPTH) : Bitfinex::MarketBook::CHECKSUM_DEPTH;
+        auto [checksum, added] = checksums.try_emplace({ channel.feed, depth });
+        if (added)
+            checksum->second = book_checksum(channel.feed, symbol, depth);
+        send(channel_id, channel, std::format(R"("cs",{})", checksum->second));
+    }
+}
+
+std::string Exchange::order_array(SimulatedOrder const& order) const
+{
+    // [ID, GID, CID, SYMBOL, MTS_CREATE, MTS_UPDATE, AMOUNT, AMOUNT_ORIG, TYPE, TYPE_PREV, MTS_TIF, _, FLAGS, STATUS, _, _, PRICE, PRICE_AVG, ...]
+    return std::format(R"([{},null,{},{},{},{},{},{},"{}",null,null,null,0,{},null,null,{},{},0,0,null,null,null,0,0,null,null,null,"API>BFX",null,null,null])",
+        order.id, order.client_order_id, json_string(Bitfinex::symbol_name(order.symbol)), order.created_ms, order.updated_ms, order.amount, order.original_amount,
+        order_type_name(order.type), json_string(order_status(order)), order.price, order.average_price);
+}
+
+std::string Exchange::position_array(SymbolId symbol, SimulatedPosition const& position) const
+{
+    const Decimal last_price = m_engine.stats(symbol).last_price;
+    const Decimal profit = (last_price - position.base_price) * position.amount;
+    const double percentage = position.base_price.is_zero() ? 0 : (last_price.to_double() / position.base_price.to_double() - 1) * 100;
+    // [SYMBOL, STATUS, AMOUNT, BASE_PRICE, FUNDING, FUNDING_TYPE, PL, PL_PERC, PRICE_LIQ, LEVERAGE, _, POSITION_ID, MTS_CREATE, MTS_UPDATE, ...]
+    return std::format(R"(["{}","{}",{},{},0,0,{},{:.4f},null,1,null,{},{},{},null,0,null,0,0,null])", Bitfinex::symbol_name(symbol),
+        position.amount.is_zero() ? "CLOSED" : "ACTIVE", position.amount, position.base_price, profit,
+        position.amount.is_negative() ? -percentage : percentage, position.id, position.created_ms, position.updated_ms);
+}
+
+std::string Exchange::ticker_array(SymbolId symbol) const
+{
+    const MarketStats stats = m_engine.stats(symbol);
+    const Decimal change = stats.open.is_zero() ? Decimal {} : stats.last_price - stats.open;
+    const double relative = stats.open.is_zero() ? 0 : change.to_double() / stats.open.to_double();
+    // [BID, BID_SIZE, ASK, ASK_SIZE, DAILY_CHANGE, DAILY_CHANGE_RELATIVE, LAST_PRICE, VOLUME, HIGH, LOW]
+    return std::format("[{},{},{},{},{},{:.6f},{},{},{},{}]", stats.bid, stats.bid_size, stats.ask, stats.ask_size, change, relative, stats.last_price,
+        stats.volume, stats.high, stats.low);
+}
+
+std::string Exchange::book_snapshot(Feed feed, SymbolId symbol, size_t length) const
+{
+    std::string snapshot = "[";
+    if (feed == Feed::BOOK) {
+        for (PriceLevel const& level : m_engine.levels(symbol, length)) {
+            if (snapshot.size() > 1)
+                snapshot += ',';
+            snapshot += std::format("[{},{},{}]", level.price, level.count, level.amount);
+        }
+    } else {
+        for (SimulatedOrder const& order : m_engine.resting_orders(symbol, length)) {
+            if (snapshot.size() > 1)
+                snapshot += ',';
+            snapshot += std::format("[{},{},{}]", order.id, order.price, order.amount);
+        }
+    }
+    return snapshot + "]";
+}
+
+int32_t Exchange::book_checksum(Feed feed, SymbolId symbol, size_t depth) const
+{
+    // "key:amount" of the best entries per side, bid and ask interleaved, key being the price of a
+    // level or the id of an order
+    depth = std::min(depth, Bitfinex::MarketBook::CHECKSUM_DEPTH);
+    std::vector<std::pair<double, double>> bids;
+    std::vector<std::pair<double, double>> asks;
+    if (feed == Feed::BOOK) {
+        for (PriceLevel const& level : m_engine.levels(symbol, depth))
+            (level.amount.is_negative() ? asks : bids).emplace_back(level.price.to_double(), level.amount.to_double());
+    } else {
+        for (SimulatedOrder const& order : m_engine.resting_orders(symbol, depth)) {
+            auto& side = order.amount.is_negative() ? asks : bids;
+            if (side.size() < depth)
+                side.emplace_back(static_cast<double>(order.id), order.amount.to_double());
+        }
+    }
+
+    uint32_t crc = 0;
+    bool first = true;
+    char number[32];
+    auto add = [&](std::pair<double, double> const& entry) {
+        if (!first)
+            crc = Bitfinex::crc32_update(crc, ":");
+        first = false;
+        crc = Bitfinex::crc32_update(crc, std::string_view(number, Bitfinex::format_js_number(entry.first, number)));
+        crc = Bitfinex::crc32_update(crc, ":");
+        crc = Bitfinex::crc32_update(crc, std::string_view(number, Bitfinex::format_js_number(entry.second, number)));
+    };
+    for (size_t i = 0; i < depth; i++) {
+        if (i < bids.size())
+            add(bids[i]);
+        if (i < asks.size())
+            add(asks[i]);
+    }
+    return static_cast<int32_t>(crc);
+}
+
+std::string Exchange::notification(std::string_view type, OperationResult const& result, bool wrap_new_orders) const
+{
+    std::string payload = "null";
+    if (result.order.has_value()) {
+        payload = order_array(result.order.value());
+        if (wrap_new_orders && result.operation == Operation::NEW)
+            payload = "[" + payload + "]";
+    }
+    std::string_view text = result.rejection;
+    if (text.empty()) {
+        static constexpr std::string_view texts[] = { "Submitting 1 orders.", "Submitting update to exchange limit order.", "Submitted for cancellation; waiting for confirmation." };
+        text = texts[static_cast<size_t>(result.operation)];
+    }
+    return std::format(R"([{},"{}",null,null,{},null,"{}",{}])", now_ms(), type, payload, result.rejection.empty() ? "SUCCESS" : "ERROR", json_string(text));
+}
+
+HttpReply Exchange::order_reply(AccountId account, Operation operation, std::string_view body)
+{
+    static constexpr std::string_view types[] = { "on-req", "ou-req", "oc-req" };
+    const json payload = json::parse(body, nullptr, false);
+    if (payload.is_discarded())
+        return error_reply(500, ERROR_REQUEST, "body: invalid");
+    return HttpReply { .status = 200, .body = notification(types[static_cast<size_t>(operation)], execute(account, operation, payload, false), true) };
+}
+
+HttpReply Exchange::multi(AccountId account, std::string_view body)
+{
+    const json request = json::parse(body, nullptr, false);
+    if (request.is_discarded() || !request.contains("ops") || !request["ops"].is_array())
+        return error_reply(500, ERROR_REQUEST, "ops: invalid");
+
+    std::string notifications;
+    for (json const& op : request["ops"]) {
+        if (!notifications.empty())
+            notifications += ',';
+        const std::string type = (op.is_array() && op.size() == 2 && op[0].is_string()) ? op[0].get<std::string>() : std::string();
+        if (type == "on")
+            notifications += notification("on-req", execute(account, Operation::NEW, op[1], false), true);
+        else if (type == "ou")
+            notifications += notification("ou-req", execute(account, Operation::UPDATE, op[1], false), true);
+        else if (type == "oc")
+            notifications += notification("oc-req", execute(account, Operation::CANCEL, op[1], false), true);
+        else
+            notifications += notification("n", OperationResult { .operation = Operation::NEW, .order = {}, .rejection = "op: invalid" }, true);
+    }
+    return HttpReply { .status = 200,
+        .body = std::format(R"([{},"ox_multi-req",null,null,[{}],null,"SUCCESS","Submitting {} order operations."])", now_ms(), notifications,
+            request["ops"].size()) };
+}
+
+HttpReply Exchange::orders_reply(AccountId account, std::optional<SymbolId> symbol)
+{
+    std::string body = "[";
+    m_engine.for_each_order(account, [&](SimulatedOrder const& order) {
+        if (symbol.has_value() && order.symbol != symbol.value())
+            return;
+        if (body.size() > 1)
+            body += ',';
+        body += order_array(order);
+    });
+    return HttpReply { .status = 200, .body = body + "]" };
+}
+
+HttpReply Exchange::positions_reply(AccountId account)
+{
+    std::string body = "[";
+    for (auto const& [symbol, position] : m_accounts[account].positions) {
+        if (body.size() > 1)
+            body += ',';
+        body += position_array(symbol, position);
+    }
+    return HttpReply { .status = 200, .body = body + "]" };
+}
+
+HttpReply Exchange::increase_position(AccountId account, std::string_view body)
+{
+    json request = json::parse(body, nullptr, false);
+    if (request.is_discarded() || !request.is_object())
+        return error_reply(500, ERROR_REQUEST, "body: invalid");
+    // A margin market order for the amount
+    request["type"] = "MARKET";
+    OperationResult result = execute(account, Operation::NEW, request, false);
+    if (!result.rejection.empty())
+        return error_reply(500, ERROR_GENERIC, result.rejection);
+    if (result.order->amount == result.order->original_amount)
+        return error_reply(500, ERROR_GENERIC, "Invalid order: not enough liquidity");
+
+    std::string payload = "null";
+    auto position = m_accounts[account].positions.find(result.order->symbol);
+    if (position != m_accounts[account].positions.end())
+        payload = "[" + position_array(position->first, position->second) + "]";
+    return HttpReply { .status = 200, .body = std::format(R"([{},"pos_inc_req",null,null,{},null,"SUCCESS","Increasing position."])", now_ms(), payload) };
+}
+
+void Exchange::open(Connection& connection)
+{
+    m_sessions[&connection];
+    connection.send(R"({"event":"info","version":2,"serverId":"simulator","platform":{"status":1}})");
+}
+
+void Exchange::close(Connection& connection)
+{
+    auto found = m_sessions.find(&connection);
+    if (found == m_sessions.end())
+        return;
+    for (const int64_t channel_id : found->second.channels) {
+        auto channel = m_channels.find(channel_id);
+        if (channel == m_channels.end())
+            continue;
+        std::erase(m_symbol_channels[channel->second.symbol], channel_id);
+        m_channels.erase(channel);
+    }
+    m_sessions.erase(found);
+}
+
+void Exchange::receive(Connection& connection, std::string_view frame)
+{
+    Session& session = m_sessions[&connection];
+    const json message = json::parse(frame, nullptr, false);
+    if (message.is_discarded()) {
+        connection.send(error_event(ERROR_REQUEST, "message: invalid"));
+        return;
+    }
+
+    if (message.is_object()) {
+        const std::string event = message.value("event", std::string());
+        if (event == "subscribe") {
+            subscribe(connection, session, message);
+        } else if (event == "unsubscribe") {
+            unsubscribe(connection, session, message.value("chanId", int64_t(0)));
+        } else if (event == "conf") {
+            const int flags = message.value("flags", 0);
+            session.checksums = (flags & CONF_FLAG_CHECKSUM) != 0;
+            connection.send(std::format(R"({{"event":"conf","status":"OK","flags":{}}})", flags));
+        } else if (event == "auth") {
+            authenticate_session(connection, session, message);
+        } else if (event == "ping") {
+            connection.send(std::format(R"({{"event":"pong","ts":{},"cid":{}}})", now_ms(), message.value("cid", int64_t(0))));
+        } else {
+            connection.send(error_event(ERROR_REQUEST, "event: invalid"));
+        }
+        return;
+    }
+
+    // [0, TYPE, null, PAYLOAD]
+    if (!message.is_array() || message.size() != 4 || !message[1].is_string())
+        return;
+    if (!session.account.has_value()) {
+        connection.send(error_event(ERROR_APIKEY, "auth: required"));
+        return;
+    }
+    const std::string type = message[1].get<std::string>();
+    if (type != "ox_multi") {
+        order_operation(connection, session, type, message[3]);
+        return;
+    }
+    if (!message[3].is_array())
+        return;
+    for (json const& op : message[3]) {
+        if (op.is_array() && op.size() == 2 && op[0].is_string())
+            order_operation(connection, session, op[0].get<std::string>(), op[1]);
+    }
+}
+
+void Exchange::order_operation(Connection& connection, Session& session, std::string_view type, json const& payload)
+{
+    std::optional<Operation> operation;
+    if (type == "on")
+        operation = Operation::NEW;
+    else if (type == "ou")
+        operation = Operation::UPDATE;
+    else if (type == "oc")
+        operation = Operation::CANCEL;
+    if (!operation.has_value()) {
+        connection.send(error_event(ERROR_REQUEST, "op: invalid"));
+        return;
+    }
+    const OperationResult result = execute(session.account.value(), operation.value(), payload, inject_error());
+    // Only the connection that sent the request gets its notification, the order and trade
+    // updates went to every session of the account
+    connection.send(std::format(R"([0,"n",{}])", notification(std::string(type) + "-req", result, false)));
+}
+
+void Exchange::authenticate_session(Connection& connection, Session& session, json const& request)
+{
+    const std::string api_key = request.value("apiKey", std::string());
+    const std::string signature = request.value("authSig", std::string());
+    const std::string payload = request.value("authPayload", std::string());
+    std::string nonce;
+    if (auto field = request.find("authNonce"); field != request.end())
+        nonce = field->is_string() ? field->get<std::string>() : field->dump();
+
+    auto fail = [&connection](int code, std::string_view message) {
+        connection.send(std::format(R"({{"event":"auth","status":"FAILED","chanId":0,"code":{},"msg":{}}})", code, json_string(message)));
+    };
+    AccountId id = MARKET_MAKER;
+    AccountKey* key = find_key(api_key, id);
+    if (!key)
+        return fail(ERROR_APIKEY, "apikey: invalid");
+    const Bitfinex::Signature expected = key->signer->sign({ payload });
+    if (expected.view() != signature || payload != "AUTH" + nonce)
+        return fail(ERROR_APIKEY, "apikey: digest invalid");
+    std::optional<uint64_t> nonce_value = read_nonce(nonce);
+    if (!nonce_value.has_value() || (m_options.check_nonces && nonce_value.value() <= key->last_nonce))
+        return fail(ERROR_NONCE, "nonce: small");
+    key->last_nonce = nonce_value.value();
+
+    session.account = id;
+    connection.send(std::format(R"({{"event":"auth","status":"OK","chanId":0,"userId":{},"auth_id":"simulator-{}","caps":{{"orders":{{"read":1,"write":1}}}}}})",
+        id, id));
+
+    std::string orders;
+    m_engine.for_each_order(id, [&orders, this](SimulatedOrder const& order) {
+        if (!orders.empty())
+            orders += ',';
+        orders += order_array(order);
+    });
+    connection.send(std::format(R"([0,"os",[{}]])", orders));
+    std::string positions;
+    for (auto const& [symbol, position] : m_accounts[id].positions) {
+        if (!positions.empty())
+            positions += ',';
+        positions += position_array(symbol, position);
+    }
+    connection.send(std::format(R"([0,"ps",[{}]])", positions));
+    connection.send(R"([0,"ws",[]])");
+}
+
+void Exchange::subscribe(Connection& connection, Session& session, json const& request)
+{
+    const std::string channel_name = request.value("channel", std::string());
+    const std::string symbol_text = request.value("symbol", std::string());
+    const std::string precision = request.value("prec", std::string("P0"));
+    size_t length = DEFAULT_BOOK_LENGTH;
+    if (auto field = request.find("len"); field != request.end()) {
+        if (field->is_number_unsigned())
+            length = field->get<size_t>();
+        else if (field->is_string())
+            length = std::strtoul(field->get_ref<std::string const&>().c_str(), nullptr, 10);
+    }
+    auto fail = [&](std::string_view message) {
+        connection.send(std::format(R"({{"event":"error","msg":{},"code":{},"channel":{},"symbol":{}}})", json_string(message), ERROR_SUBSCRIBE,
+            json_string(channel_name), json_string(symbol_text)));
+    };
+
+    std::optional<SymbolId> symbol = Bitfinex::find_symbol(symbol_text);
+    if (!symbol.has_value() || !m_engine.is_listed(symbol.value()))
+        return fail("symbol: invalid");
+    Feed feed;
+    std::string details;
+    if (channel_name == "ticker") {
+        feed = Feed::TICKER;
+    } else if (channel_name == "trades") {
+        feed = Feed::TRADES;
+    } else if (channel_name == "book" && (precision == "P0" || precision == "R0") && length > 0) {
+        feed = (precision == "R0") ? Feed::RAW_BOOK : Feed::BOOK;
+        details = std::format(R"(,"prec":"{}","freq":"F0","len":"{}")", precision, length);
+    } else {
+        return fail("subscribe: invalid");
+    }
+
+    const int64_t channel_id = ++m_last_channel_id;
+    Channel& channel = m_channels.emplace(channel_id, Channel { .connection = &connection, .feed = feed, .symbol = symbol.value(), .length = length,
+                                                          .last_sent_ms = now_ms() })
+                           .first->second;
+    m_symbol_channels[symbol.value()].push_back(channel_id);
+    session.channels.push_back(channel_id);
+    connection.send(std::format(R"({{"event":"subscribed","channel":"{}","chanId":{},"symbol":"{}"{},"pair":"{}"}})", channel_name, channel_id,
+        Bitfinex::symbol_name(symbol.value()), details, pair_name(symbol.value())));
+
+    switch (feed) {
+    case Feed::TICKER:
+        send(channel_id, channel, ticker_array(symbol.value()));
+        break;
+    case Feed::TRADES: {
+        std::string trades = "[";
+        for (Execution const& execution : m_engine.recent_trades(symbol.value())) {
+            if (trades.size() > 1)
+                trades += ',';
+            trades += std::format("[{},{},{},{}]", execution.trade_id, execution.timestamp_ms, execution.amount, execution.price);
+        }
+        send(channel_id, channel, trades + "]");
+        break;
+    }
+    case Feed::BOOK:
+        channel.levels = m_engine.levels(symbol.value(), length);
+        send(channel_id, channel, book_snapshot(feed, symbol.value(), length));
+        break;
+    case Feed::RAW_BOOK:
+        send(channel_id, channel, book_snapshot(feed, symbol.value(), length));
+        break;
+    }
+}
+
+void Exchange::unsubscribe(Connection& connection, Session& session, int64_t channel_id)
+{
+    auto channel = m_channels.find(channel_id);
+    if (channel == m_channels.end() || channel->second.connection != &connection) {
+        connection.send(error_event(ERROR_UNSUBSCRIBE, "unsubscribe: invalid"));
+        return;
+    }
+    std::erase(m_symbol_channels[channel->second.symbol], channel_id);
+    std::erase(session.channels, channel_id);
+    m_channels.erase(channel);
+    connection.send(std::format(R"({{"event":"unsubscribed","status":"OK","chanId":{}}})", channel_id));
+}
+
+void Exchange::tick()
+{
+    const int64_t now = now_ms();
+    for (SymbolId symbol : m_engine.symbols()) {
+        Market& market = m_markets[symbol];
+        const bool ticker_changed = market.ticker_changed;
+        market.ticker_changed = false;
+        for (const int64_t channel_id : m_symbol_channels[symbol]) {
+            Channel& channel = m_channels.at(channel_id);
+            if (channel.feed == Feed::TICKER && ticker_changed)
+                send(channel_id, channel, ticker_array(symbol));
+            else if (now - channel.last_sent_ms >= HEARTBEAT_INTERVAL_MS)
+                send(channel_id, channel, R"("hb")");
+        }
+    }
+}
+
+void Exchange::simulate_flow()
+{
+    std::vector<SymbolId> const& symbols = m_engine.symbols();
+    if (symbols.empty())
+        return;
+    const SymbolId symbol = symbols[m_random() % symbols.size()];
+    Market& market = m_markets[symbol];
+    const int64_t now = now_ms();
+
+    // The reference price walks one tick at a time
+    const int64_t step = static_cast<int64_t>(m_random() % 3) - 1;
+    if (market.reference_price + market.tick * step > market.tick)
+        market.reference_price += market.tick * step;
+
+    const uint64_t action = m_random() % 10;
+    const bool buys = m_random() % 2 == 0;
+    const int64_t direction = buys ? -1 : 1;
+    const size_t depth = std::max<size_t>(m_options.seed_depth, 1);
+    m_events.clear();
+    EngineResult result;
+    Operation operation = Operation::NEW;
+
+    if (action < 5) {
+        // A passive quote, unless the book already holds plenty
+        if (m_engine.levels(symbol, 4 * depth).size() >= 8 * depth)
+            return;
+        const int64_t distance = 1 + static_cast<int64_t>(m_random() % depth);
+        const Decimal price = Bitfinex::round_price(symbol, market.reference_price + market.tick * distance * direction);
+        const Decimal amount = random_amount(Decimal::from_double(0.01), Decimal::from_integer(1));
+        result = m_engine.submit(NewOrder { .account = MARKET_MAKER, .client_order_id = 0, .symbol = symbol, .type = OrderType::EXCHANGE_LIMIT,
+                                     .amount = buys ? amount : -amount, .price = price },
+            now, m_events);
+    } else if (action < 8) {
+        std::vector<SimulatedOrder> orders = m_engine.resting_orders(symbol, 4 * depth);
+        std::erase_if(orders, [](SimulatedOrder const& order) { return order.account != MARKET_MAKER; });
+        if (orders.empty())
+            return;
+        operation = Operation::CANCEL;
+        result = m_engine.cancel(MARKET_MAKER, orders[m_random() % orders.size()].id, now, m_events);
+    } else {
+        // A taker crossing a few levels at most
+        const Decimal amount = random_amount(Decimal::from_double(0.01), Decimal::from_double(0.5));
+        const Decimal limit = Bitfinex::round_price(symbol, market.reference_price - market.tick * static_cast<int64_t>(depth) * direction);
+        result = m_engine.submit(NewOrder { .account = MARKET_MAKER, .client_order_id = 0, .symbol = symbol, .type = OrderType::EXCHANGE_IOC,
+                                     .amount = buys ? amount : -amount, .price = limit },
+            now, m_events);
+    }
+    if (result.order.has_value())
+        report(MARKET_MAKER, operation, result.order.value());
+}
+
+}
@@ -0,0 +1,212 @@
+#pragma once
+
+#include <MatchingEngine.h>
+#include <Bitfinex/RequestScheduler.h>
+#include <Bitfinex/Signer.h>
+#include <deque>
+#include <map>
+#include <memory>
+#include <nlohmann/json_fwd.hpp>
+#include <random>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace Simulator {
+
+struct ApiKey {
+    std::string key;
+    std::string secret;
+};
+
+struct ListedSymbol {
+    SymbolId symbol;
+    Decimal reference_price;
+};
+
+struct ExchangeOptions {
+    // One account each
+    std::vector<ApiKey> api_keys;
+    // More keys of the account of the first api key, as the EXTRA_KEYS of a client
+    std::vector<ApiKey> extra_keys;
+    std::vector<ListedSymbol> symbols;
+    // Resting orders of the simulated market maker on each side of every book at startup
+    size_t seed_depth { 25 };
+    // Share of requests and order operations answered with an error, 0 to 1
+    double error_rate { 0 };
+    // The exchange rejects a nonce that is not above the previous one of the same key
+    bool check_nonces { true };
+    // REST requests per minute and account in each family, 0 for no limit. Requests over the
+    // limit are answered with a 429 like the exchange does.
+    std::array<unsigned, Bitfinex::RATE_LIMIT_FAMILY_COUNT> rate_limits {};
+    uint64_t random_seed { 42 };
+};
+
+// The bfx-* headers of an authenticated request
+struct RequestAuth {
+    std::string_view api_key;
+    std::string_view nonce;
+    std::string_view signature;
+};
+
+struct HttpReply {
+    unsigned status;
+    std::string body;
+};
+
+// A websocket client as seen by the exchange, frames are written in the order they are sent
+class Connection {
+public:
+    virtual ~Connection() = default;
+    virtual void send(std::string frame) = 0;
+};
+
+// The REST and websocket protocols of the exchange on top of a MatchingEngine. Transport
+// agnostic and single threaded: the server calls it from one io thread.
+class Exchange {
+public:
+    explicit Exchange(ExchangeOptions);
+    Exchange(Exchange const&) = delete;
+    Exchange& operator=(Exchange const&) = delete;
+
+    HttpReply get(std::string_view target);
+    HttpReply post(std::string_view target, RequestAuth const&, std::string_view body);
+
+    void open(Connection&);
+    void close(Connection&);
+    void receive(Connection&, std::string_view frame);
+
+    // Heartbeats of idle channels and ticker updates, called about once a second
+    void tick();
+    // One random action of the simulated market maker: a new quote, a cancellation or a trade
+    void simulate_flow();
+
+    [[nodiscard]] MatchingEngine const& engine() const { return m_engine; }
+
+private:
+    enum class Feed : uint8_t {
+        TICKER,
+        TRADES,
+        BOOK,
+        RAW_BOOK,
+    };
+
+    struct SimulatedPosition {
+        uint64_t id;
+        int64_t created_ms;
+        int64_t updated_ms;
+        Decimal amount;
+        Decimal base_price;
+    };
+
+    struct AccountKey {
+        std::string api_key;
+        std::unique_ptr<Bitfinex::Signer> signer;
+        // Nonces only have to increase per key
+        uint64_t last_nonce { 0 };
+    };
+
+    struct Account {
+        // Moved when m_accounts grows, the keys cannot be copied
+        Account() = default;
+        Account(Account&&) = default;
+        Account(Account const&) = delete;
+
+        std::vector<AccountKey> keys;
+        std::map<SymbolId, SimulatedPosition> positions;
+        // Times of the requests of the last minute in each rate limit family
+        std::array<std::deque<int64_t>, Bitfinex::RATE_LIMIT_FAMILY_COUNT> recent_requests;
+    };
+
+    struct Session {
+        std::optional<AccountId> account;
+        bool checksums { false };
+        std::vector<int64_t> channels;
+    };
+
+    struct Channel {
+        Connection* connection;
+        Feed feed;
+        SymbolId symbol;
+        size_t length; // Levels or orders per side of a book snapshot
+        int64_t last_sent_ms;
+        // Of a price level book, the best length levels per side as the subscriber holds them
+        std::vector<PriceLevel> levels;
+    };
+
+    struct Market {
+        Decimal reference_price;
+        Decimal tick;
+        bool ticker_changed { false };
+    };
+
+    enum class Operation : uint8_t {
+        NEW,
+        UPDATE,
+        CANCEL,
+    };
+
+    // The notification of one order operation, [MTS, TYPE, null, null, PAYLOAD, null, STATUS, TEXT]
+    struct OperationResult {
+        Operation operation;
+        std::optional<SimulatedOrder> order;
+        std::string_view rejection;
+    };
+
+    // The key of that name and its account, nothing when no account has it
+    AccountKey* find_key(std::string_view api_key, AccountId&);
+    std::optional<AccountId> authenticate(std::string_view path, RequestAuth const&, std::string_view body, HttpReply& rejection);
+    bool within_rate_limit(Account&, std::string_view path);
+    bool inject_error();
+
+    // A failed operation still carries the order it targeted so the client can match the reply
+    OperationResult execute(AccountId, Operation, nlohmann::json const& payload, bool injected_failure);
+    // Market data and account updates of the request that filled m_events
+    void report(AccountId, Operation, SimulatedOrder const&);
+    void publish(EngineEvents const&);
+    void notify_account(AccountId, std::string const& frame);
+    void move_position(AccountId, SymbolId, Decimal amount, Decimal price, int64_t now);
+
+    std::string notification(std::string_view type, OperationResult const&, bool wrap_new_orders) const;
+    std::string order_array(SimulatedOrder const&) const;
+    std::string position_array(SymbolId, SimulatedPosition const&) const;
+    std::string ticker_array(SymbolId) const;
+    std::string book_snapshot(Feed, SymbolId, size_t length) const;
+    // Of the best depth levels per side, or orders of those levels, at most the 25 the exchange uses
+    int32_t book_checksum(Feed, SymbolId, size_t depth) const;
+
+    void subscribe(Connection&, Session&, nlohmann::json const& request);
+    void unsubscribe(Connection&, Session&, int64_t channel_id);
+    void authenticate_session(Connection&, Session&, nlohmann::json const& request);
+    void order_operation(Connection&, Session&, std::string_view type, nlohmann::json const& payload);
+    void send(int64_t channel_id, Channel&, std::string const& frame);
+    void send_level_changes(int64_t channel_id, Channel&, std::vector<PriceLevel> levels);
+
+    HttpReply order_reply(AccountId, Operation, std::string_view body);
+    HttpReply orders_reply(AccountId, std::optional<SymbolId>);
+    HttpReply positions_reply(AccountId);
+    HttpReply increase_position(AccountId, std::string_view body);
+    HttpReply multi(AccountId, std::string_view body);
+
+    void seed(SymbolId);
+    Decimal random_amount(Decimal minimum, Decimal maximum);
+
+    ExchangeOptions const m_options;
+    MatchingEngine m_engine;
+    EngineEvents m_events;
+    // Account 0 is the simulated market maker, the api keys follow
+    std::vector<Account> m_accounts;
+    PerSymbol<Market> m_markets;
+    std::unordered_map<Connection*, Session> m_sessions;
+    std::unordered_map<int64_t, Channel> m_channels;
+    PerSymbol<std::vector<int64_t>> m_symbol_channels;
+    int64_t m_last_channel_id { 0 };
+    uint64_t m_last_position_id { 140000000 };
+    std::mt19937_64 m_random;
+};
+
+// Milliseconds since the epoch
+int64_t now_ms();
+
+}
@@ -0,0 +1,360 @@
+#include <MatchingEngine.h>
+#include <algorithm>
+
+namespace Simulator {
+
+using Bitfinex::OrderType;
+
+bool is_margin(OrderType type)
+{
+    switch (type) {
+    case OrderType::LIMIT:
+    case OrderType::MARKET:
+    case OrderType::STOP:
+    case OrderType::STOP_LIMIT:
+    case OrderType::TRAILING_STOP:
+    case OrderType::FILL_OR_KILL:
+    case OrderType::IMMEDIATE_OR_CANCEL:
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool is_market(OrderType type)
+{
+    return type == OrderType::MARKET || type == OrderType::EXCHANGE_MARKET;
+}
+
+static bool is_supported(OrderType type)
+{
+    switch (type) {
+    case OrderType::LIMIT:
+    case OrderType::EXCHANGE_LIMIT:
+    case OrderType::MARKET:
+    case OrderType::EXCHANGE_MARKET:
+    case OrderType::FILL_OR_KILL:
+    case OrderType::EXCHANGE_FOK:
+    case OrderType::IMMEDIATE_OR_CANCEL:
+    case OrderType::EXCHANGE_IOC:
+        return true;
+    default:
+        return false;
+    }
+}
+
+static Bitfinex::OrderSide side_of(SimulatedOrder const& order)
+{
+    return order.original_amount.is_negative() ? Bitfinex::OrderSide::SELL : Bitfinex::OrderSide::BUY;
+}
+
+static bool rests(OrderType type)
+{
+    return type == OrderType::LIMIT || type == OrderType::EXCHANGE_LIMIT;
+}
+
+void EngineEvents::clear()
+{
+    executions.clear();
+    makers.clear();
+    book.clear();
+}
+
+void MatchingEngine::list_symbol(SymbolId symbol)
+{
+    if (is_listed(symbol))
+        return;
+    m_books[symbol].emplace();
+    m_listed.push_back(symbol);
+}
+
+bool MatchingEngine::is_listed(SymbolId symbol) const
+{
+    std::optional<Book> const* book = m_books.find(symbol);
+    return book != nullptr && book->has_value();
+}
+
+void MatchingEngine::fill(SimulatedOrder& order, Decimal amount, Decimal price, int64_t now_ms)
+{
+    // Running average over what was filled so far, in units of 1e-8
+    const __int128 filled = (order.original_amount - order.amount).abs().units();
+    const __int128 quantity = amount.abs().units();
+    const __int128 average = (order.average_price.units() * filled + price.units() * quantity) / (filled + quantity);
+    order.average_price = Decimal::from_units(static_cast<int64_t>(average));
+    order.amount -= amount;
+    order.updated_ms = now_ms;
+    order.state = order.amount.is_zero() ? OrderState::EXECUTED : OrderState::PARTIALLY_FILLED;
+}
+
+template<typename Side>
+void MatchingEngine::match(Book& book, Side& opposite, SimulatedOrder& taker, int64_t now_ms, EngineEvents& events)
+{
+    const bool buys = !taker.amount.is_negative();
+    while (!taker.amount.is_zero() && !opposite.empty()) {
+        auto level = opposite.begin();
+        const Decimal price = level->first;
+        if (!is_market(taker.type) && (buys ? price > taker.price : price < taker.price))
+            break;
+
+        std::deque<uint64_t>& queue = level->second.queue;
+        while (!taker.amount.is_zero() && !queue.empty()) {
+            SimulatedOrder& maker = m_orders.at(queue.front());
+            const Decimal quantity = std::min(taker.amount.abs(), maker.amount.abs());
+            const Decimal taker_amount = buys ? quantity : -quantity;
+            fill(taker, taker_amount, price, now_ms);
+            fill(maker, -taker_amount, price, now_ms);
+            level->second.amount += taker_amount;
+
+            const Execution execution { .trade_id = ++m_last_trade_id, .timestamp_ms = now_ms, .symbol = taker.symbol, .amount = taker_amount,
+                .price = price, .maker_order_id = maker.id, .taker_order_id = taker.id, .maker_account = maker.account,
+                .taker_account = taker.account, .maker_margin = is_margin(maker.type), .taker_margin = is_margin(taker.type) };
+            events.executions.push_back(execution);
+            book.recent_trades.push_front(execution);
+            if (book.recent_trades.size() > RECENT_TRADES)
+                book.recent_trades.pop_back();
+            if (book.open.is_zero())
+                book.open = price;
+            book.last_price = price;
+            book.volume += quantity;
+            book.high = std::max(book.high, price);
+            book.low = book.low.is_zero() ? price : std::min(book.low, price);
+
+            events.book.push_back(BookChange { .symbol = maker.symbol, .order_id = maker.id, .price = price, .amount = maker.amount, .side = side_of(maker) });
+            events.makers.push_back(maker);
+            if (maker.amount.is_zero()) {
+                queue.pop_front();
+                m_orders.erase(execution.maker_order_id);
+            }
+        }
+        if (queue.empty())
+            opposite.erase(level);
+    }
+}
+
+Decimal MatchingEngine::available(Book const& book, SimulatedOrder const& taker) const
+{
+    Decimal total;
+    auto add_levels = [&](auto const& opposite, auto crosses) {
+        for (auto const& [price, level] : opposite) {
+            if (!is_market(taker.type) && !crosses(price))
+                break;
+            total += level.amount.abs();
+        }
+    };
+    if (taker.amount.is_negative())
+        add_levels(book.bids, [&taker](Decimal price) { return price >= taker.price; });
+    else
+        add_levels(book.asks, [&taker](Decimal price) { return price <= taker.price; });
+    return total;
+}
+
+void MatchingEngine::rest(Book& book, SimulatedOrder const& order, EngineEvents& events)
+{
+    Level& level = order.amount.is_negative() ? book.asks[order.price] : book.bids[order.price];
+    level.amount += order.amount;
+    level.queue.push_back(order.id);
+    m_orders[order.id] = order;
+    events.book.push_back(BookChange { .symbol = order.symbol, .order_id = order.id, .price = order.price, .amount = order.amount, .side = side_of(order) });
+}
+
+void MatchingEngine::unlink(Book& book, SimulatedOrder const& order)
+{
+    auto remove = [&order](auto& side) {
+        auto level = side.find(order.price);
+        if (level == side.end())
+            return;
+        std::erase(level->second.queue, order.id);
+        level->second.amount -= order.amount;
+        if (level->second.queue.empty())
+            side.erase(level);
+    };
+    if (order.amount.is_negative())
+        remove(book.asks);
+    else
+        remove(book.bids);
+}
+
+EngineResult MatchingEngine::submit(NewOrder const& request, int64_t now_ms, EngineEvents& events)
+{
+    if (!is_listed(request.symbol))
+        return EngineResult { .order = {}, .rejection = "symbol: invalid" };
+    if (!is_supported(request.type))
+        return EngineResult { .order = {}, .rejection = "type: not supported" };
+    if (request.amount.is_zero())
+        return EngineResult { .order = {}, .rejection = "amount: invalid" };
+    if (!is_market(request.type) && request.price <= Decimal {})
+        return EngineResult { .order = {}, .rejection = "price: invalid" };
+    Bitfinex::SymbolInfo info = Bitfinex::symbol_info(request.symbol);
+    const Decimal size = request.amount.abs();
+    if ((!info.minimum_order_size.is_zero() && size < info.minimum_order_size) || (!info.maximum_order_size.is_zero() && size > info.maximum_order_size))
+        return EngineResult { .order = {}, .rejection = "Invalid order: size out of range" };
+
+    SimulatedOrder order { .id = ++m_last_order_id, .client_order_id = request.client_order_id, .created_ms = now_ms, .updated_ms = now_ms,
+        .amount = request.amount, .original_amount = request.amount, .price = is_market(request.type) ? Decimal {} : request.price,
+        .average_price = Decimal {}, .symbol = request.symbol, .account = request.account, .type = request.type, .state = OrderState::ACTIVE };
+    Book& book = m_books[request.symbol].value();
+
+    const bool fill_or_kill = request.type == OrderType::FILL_OR_KILL || request.type == OrderType::EXCHANGE_FOK;
+    if (fill_or_kill && available(book, order) < order.amount.abs()) {
+        order.state = OrderState::CANCELED;
+        return EngineResult { .order = order, .rejection = {} };
+    }
+
+    if (order.amount.is_negative())
+        match(book, book.bids, order, now_ms, events);
+    else
+        match(book, book.asks, order, now_ms, events);
+
+    if (!order.amount.is_zero()) {
+        if (rests(order.type))
+            rest(book, order, events);
+        else
+            order.state = OrderState::CANCELED;
+    }
+    return EngineResult { .order = order, .rejection = {} };
+}
+
+EngineResult MatchingEngine::update(AccountId account, uint64_t order_id, std::optional<Decimal> price, std::optional<Decimal> amount, int64_t now_ms,
+    EngineEvents& events)
+{
+    auto found = m_orders.find(order_id);
+    if (found == m_orders.end() || found->second.account != account)
+        return EngineResult { .order = {}, .rejection = "Order not found." };
+    SimulatedOrder order = found->second;
+    if (price.has_value() && price.value() <= Decimal {})
+        return EngineResult { .order = {}, .rejection = "price: invalid" };
+    if (amount.has_value() && (amount.value().is_zero() || amount.value().is_negative() != order.amount.is_negative()))
+        return EngineResult { .order = {}, .rejection = "amount: invalid" };
+
+    Book& book = m_books[order.symbol].value();
+    const Decimal new_price = price.value_or(order.price);
+    const Decimal new_amount = amount.value_or(order.amount);
+    order.updated_ms = now_ms;
+
+    // A smaller order at the same price keeps its place in the queue
+    if (new_price == order.price && new_amount.abs() <= order.amount.abs()) {
+        Level& level = order.amount.is_negative() ? book.asks.at(order.price) : book.bids.at(order.price);
+        level.amount += new_amount - order.amount;
+        order.original_amount += new_amount - order.amount;
+        order.amount = new_amount;
+        found->second = order;
+        events.book.push_back(BookChange { .symbol = order.symbol, .order_id = order.id, .price = order.price, .amount = order.amount, .side = side_of(order) });
+        return EngineResult { .order = order, .rejection = {} };
+    }
+
+    unlink(book, order);
+    m_orders.erase(found);
+    events.book.push_back(BookChange { .symbol = order.symbol, .order_id = order.id, .price = order.price, .amount = Decimal {}, .side = side_of(order) });
+    order.original_amount += new_amount - order.amount;
+    order.amount = new_amount;
+    order.price = new_price;
+    if (order.amount.is_negative())
+        match(book, book.bids, order, now_ms, events);
+    else
+        match(book, book.asks, order, now_ms, events);
+    if (!order.amount.is_zero())
+        rest(book, order, events);
+    return EngineResult { .order = order, .rejection = {} };
+}
+
+EngineResult MatchingEngine::cancel(AccountId account, uint64_t order_id, int64_t now_ms, EngineEvents& events)
+{
+    auto found = m_orders.find(order_id);
+    if (found == m_orders.end() || found->second.account != account)
+        return EngineResult { .order = {}, .rejection = "Order not found." };
+    SimulatedOrder order = found->second;
+    unlink(m_books[order.symbol].value(), order);
+    m_orders.erase(found);
+    events.book.push_back(BookChange { .symbol = order.symbol, .order_id = order.id, .price = order.price, .amount = Decimal {}, .side = side_of(order) });
+    order.state = OrderState::CANCELED;
+    order.updated_ms = now_ms;
+    return EngineResult { .order = order, .rejection = {} };
+}
+
+SimulatedOrder const* MatchingEngine::order(uint64_t order_id) const
+{
+    auto found = m_orders.find(order_id);
+    return (found != m_orders.end()) ? &found->second : nullptr;
+}
+
+void MatchingEngine::for_each_order(AccountId account, std::function<void(SimulatedOrder const&)> const& function) const
+{
+    std::vector<SimulatedOrder const*> orders;
+    for (auto const& [id, order] : m_orders) {
+        if (order.account == account)
+            orders.push_back(&order);
+    }
+    // Oldest first, like the exchange lists them
+    std::sort(orders.begin(), orders.end(), [](SimulatedOrder const* left, SimulatedOrder const* right) { return left->id < right->id; });
+    for (SimulatedOrder const* order : orders)
+        function(*order);
+}
+
+std::vector<PriceLevel> MatchingEngine::levels(SymbolId symbol, size_t depth) const
+{
+    std::vector<PriceLevel> levels;
+    if (!is_listed(symbol))
+        return levels;
+    Book const& book = m_books.find(symbol)->value();
+    auto add = [&levels, depth](auto const& side) {
+        size_t count = 0;
+        for (auto const& [price, level] : side) {
+            if (count++ == depth)
+                break;
+            levels.push_back(PriceLevel { .price = price, .count = static_cast<uint32_t>(level.queue.size()), .amount = level.amount });
+        }
+    };
+    add(book.bids);
+    add(book.asks);
+    return levels;
+}
+
+std::vector<SimulatedOrder> MatchingEngine::resting_orders(SymbolId symbol, size_t depth) const
+{
+    std::vector<SimulatedOrder> orders;
+    if (!is_listed(symbol))
+        return orders;
+    Book const& book = m_books.find(symbol)->value();
+    auto add = [this, &orders, depth](auto const& side) {
+        size_t count = 0;
+        for (auto const& [price, level] : side) {
+            if (count++ == depth)
+                break;
+            for (uint64_t order_id : level.queue)
+                orders.push_back(m_orders.at(order_id));
+        }
+    };
+    add(book.bids);
+    add(book.asks);
+    return orders;
+}
+
+MarketStats MatchingEngine::stats(SymbolId symbol) const
+{
+    MarketStats stats {};
+    if (!is_listed(symbol))
+        return stats;
+    Book const& book = m_books.find(symbol)->value();
+    if (!book.bids.empty()) {
+        stats.bid = book.bids.begin()->first;
+        stats.bid_size = book.bids.begin()->second.amount;
+    }
+    if (!book.asks.empty()) {
+        stats.ask = book.asks.begin()->first;
+        stats.ask_size = book.asks.begin()->second.amount.abs();
+    }
+    stats.open = book.open;
+    stats.last_price = book.last_price;
+    stats.volume = book.volume;
+    stats.high = book.high;
+    stats.low = book.low;
+    return stats;
+}
+
+std::deque<Execution> const& MatchingEngine::recent_trades(SymbolId symbol) const
+{
+    static std::deque<Execution> const none;
+    return is_listed(symbol) ? m_books.find(symbol)->value().recent_trades : none;
+}
+
+}
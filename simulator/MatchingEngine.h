@@ -0,0 +1,170 @@
+#pragma once
+
+#include <Bitfinex/Decimal.h>
+#include <Bitfinex/ENUMS.h>
+#include <Bitfinex/Symbols.h>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <optional>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace Simulator {
+
+using Bitfinex::Decimal;
+using Bitfinex::PerSymbol;
+using Bitfinex::SymbolId;
+
+using AccountId = uint32_t;
+
+enum class OrderState : uint8_t {
+    ACTIVE,
+    PARTIALLY_FILLED,
+    EXECUTED,
+    CANCELED,
+};
+
+struct SimulatedOrder {
+    uint64_t id;
+    int64_t client_order_id;
+    int64_t created_ms;
+    int64_t updated_ms;
+    Decimal amount; // Left to fill, positive for buys and negative for sells
+    Decimal original_amount;
+    Decimal price;
+    Decimal average_price; // Of the fills so far
+    SymbolId symbol;
+    AccountId account;
+    Bitfinex::OrderType type;
+    OrderState state;
+};
+
+struct Execution {
+    uint64_t trade_id;
+    int64_t timestamp_ms;
+    SymbolId symbol;
+    Decimal amount; // Taker side, positive when the taker bought
+    Decimal price;
+    uint64_t maker_order_id;
+    uint64_t taker_order_id;
+    AccountId maker_account;
+    AccountId taker_account;
+    // Margin fills move the accounts' positions, exchange fills only their balances
+    bool maker_margin;
+    bool taker_margin;
+};
+
+// Resting amount of an order after a change, 0 once it left the book
+struct BookChange {
+    SymbolId symbol;
+    uint64_t order_id;
+    Decimal price;
+    Decimal amount;
+    Bitfinex::OrderSide side;
+};
+
+// What one request changed, filled by the engine and published by the exchange
+struct EngineEvents {
+    std::vector<Execution> executions;
+    // Resting orders touched by the request other than its own, after the change
+    std::vector<SimulatedOrder> makers;
+    std::vector<BookChange> book;
+
+    void clear();
+};
+
+struct EngineResult {
+    std::optional<SimulatedOrder> order; // Empty when rejected
+    std::string_view rejection;
+};
+
+struct PriceLevel {
+    Decimal price;
+    uint32_t count;
+    Decimal amount; // Negative for asks
+};
+
+struct MarketStats {
+    Decimal bid;
+    Decimal bid_size;
+    Decimal ask;
+    Decimal ask_size;
+    Decimal open; // First trade since the engine started
+    Decimal last_price;
+    Decimal volume;
+    Decimal high;
+    Decimal low;
+};
+
+// Types without the EXCHANGE prefix trade on margin
+bool is_margin(Bitfinex::OrderType);
+bool is_market(Bitfinex::OrderType);
+
+struct NewOrder {
+    AccountId account;
+    int64_t client_order_id;
+    SymbolId symbol;
+    Bitfinex::OrderType type;
+    Decimal amount; // Positive to buy, negative to sell
+    Decimal price; // Ignored by market orders
+};
+
+// Price-time priority matching of limit, market, IOC and FOK orders for the listed symbols.
+// Single threaded, the exchange calls it from its io thread.
+class MatchingEngine {
+public:
+    void list_symbol(SymbolId);
+    [[nodiscard]] bool is_listed(SymbolId) const;
+    [[nodiscard]] std::vector<SymbolId> const& symbols() const { return m_listed; }
+
+    EngineResult submit(NewOrder const&, int64_t now_ms, EngineEvents&);
+    // A new price sends the order to the back of its level and may cross the book
+    EngineResult update(AccountId, uint64_t order_id, std::optional<Decimal> price, std::optional<Decimal> amount, int64_t now_ms, EngineEvents&);
+    EngineResult cancel(AccountId, uint64_t order_id, int64_t now_ms, EngineEvents&);
+
+    [[nodiscard]] SimulatedOrder const* order(uint64_t order_id) const;
+    void for_each_order(AccountId, std::function<void(SimulatedOrder const&)> const&) const;
+    // Best first, at most depth levels per side, bids then asks
+    [[nodiscard]] std::vector<PriceLevel> levels(SymbolId, size_t depth) const;
+    // Resting orders of the best depth levels per side, in queue order
+    [[nodiscard]] std::vector<SimulatedOrder> resting_orders(SymbolId, size_t depth) const;
+    [[nodiscard]] MarketStats stats(SymbolId) const;
+    [[nodiscard]] std::deque<Execution> const& recent_trades(SymbolId) const;
+
+    static constexpr size_t RECENT_TRADES = 30;
+
+private:
+    struct Level {
+        Decimal amount;
+        std::deque<uint64_t> queue;
+    };
+    struct Book {
+        std::map<Decimal, Level, std::greater<>> bids;
+        std::map<Decimal, Level> asks;
+        std::deque<Execution> recent_trades;
+        Decimal open;
+        Decimal last_price;
+        Decimal volume;
+        Decimal high;
+        Decimal low;
+    };
+
+    template<typename Side>
+    void match(Book&, Side& opposite, SimulatedOrder& taker, int64_t now_ms, EngineEvents&);
+    [[nodiscard]] Decimal available(Book const&, SimulatedOrder const& taker) const;
+    void rest(Book&, SimulatedOrder const&, EngineEvents&);
+    void unlink(Book&, SimulatedOrder const&);
+    void fill(SimulatedOrder&, Decimal amount, Decimal price, int64_t now_ms);
+
+    PerSymbol<std::optional<Book>> m_books;
+    std::vector<SymbolId> m_listed;
+    // Resting orders only, executed and canceled orders are forgotten once reported
+    std::unordered_map<uint64_t, SimulatedOrder> m_orders;
+    uint64_t m_last_order_id { 100000000000 };
+    uint64_t m_last_trade_id { 1000000000 };
+};
+
+}
@@ -0,0 +1,256 @@
+#include <Server.h>
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/detached.hpp>
+#include <boost/asio/redirect_error.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/use_awaitable.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <boost/beast/websocket.hpp>
+#include <deque>
+#include <iostream>
+#include <memory>
+
+namespace Simulator {
+
+namespace asio = boost::asio;
+namespace beast = boost::beast;
+namespace http = boost::beast::http;
+namespace websocket = boost::beast::websocket;
+
+using Clock = std::chrono::steady_clock;
+
+// Frames in both directions go through a queue so that a delayed message never overtakes an
+// earlier one and the exchange can send from any call without waiting for the socket
+class WebSocketSession final : public Connection, public std::enable_shared_from_this<WebSocketSession> {
+public:
+    WebSocketSession(Server& server, beast::tcp_stream stream)
+        : m_server(server)
+        , m_stream(std::move(stream))
+        , m_inbox_signal(m_stream.get_executor(), Clock::time_point::max())
+        , m_outbox_signal(m_stream.get_executor(), Clock::time_point::max())
+    {
+    }
+
+    asio::awaitable<void> run(http::request<http::string_body> request)
+    {
+        boost::system::error_code error;
+        co_await m_stream.async_accept(request, asio::redirect_error(asio::use_awaitable, error));
+        if (error)
+            co_return;
+        m_stream.text(true);
+        m_server.exchange().open(*this);
+        asio::co_spawn(m_stream.get_executor(), write(shared_from_this()), asio::detached);
+        asio::co_spawn(m_stream.get_executor(), dispatch(shared_from_this()), asio::detached);
+
+        beast::flat_buffer buffer;
+        while (!m_closed) {
+            co_await m_stream.async_read(buffer, asio::redirect_error(asio::use_awaitable, error));
+            if (error)
+                break;
+            // Never before the previous message, jitter must not reorder them
+            const Clock::time_point due = std::max(Clock::now() + m_server.delay(), m_inbox.empty() ? Clock::time_point {} : m_inbox.back().first);
+            m_inbox.emplace_back(due, beast::buffers_to_string(buffer.data()));
+            buffer.consume(buffer.size());
+            m_inbox_signal.cancel();
+        }
+        shut_down();
+    }
+
+    void send(std::string frame) override
+    {
+        if (m_closed)
+            return;
+        m_outbox.push_back(std::move(frame));
+        m_outbox_signal.cancel();
+    }
+
+private:
+    static asio::awaitable<void> dispatch(std::shared_ptr<WebSocketSession> self)
+    {
+        boost::system::error_code error;
+        while (!self->m_closed) {
+            if (self->m_inbox.empty()) {
+                self->m_inbox_signal.expires_at(Clock::time_point::max());
+                co_await self->m_inbox_signal.async_wait(asio::redirect_error(asio::use_awaitable, error));
+                continue;
+            }
+            if (self->m_inbox.front().first > Clock::now()) {
+                self->m_inbox_signal.expires_at(self->m_inbox.front().first);
+                co_await self->m_inbox_signal.async_wait(asio::redirect_error(asio::use_awaitable, error));
+                continue;
+            }
+            std::string frame = std::move(self->m_inbox.front().second);
+            self->m_inbox.pop_front();
+            if (self->m_server.drop()) {
+                self->shut_down();
+                co_return;
+            }
+            self->m_server.exchange().receive(*self, frame);
+        }
+    }
+
+    static asio::awaitable<void> write(std::shared_ptr<WebSocketSession> self)
+    {
+        boost::system::error_code error;
+        while (!self->m_closed) {
+            if (self->m_outbox.empty()) {
+                self->m_outbox_signal.expires_at(Clock::time_point::max());
+                co_await self->m_outbox_signal.async_wait(asio::redirect_error(asio::use_awaitable, error));
+                continue;
+            }
+            co_await self->m_stream.async_write(asio::buffer(self->m_outbox.front()), asio::redirect_error(asio::use_awaitable, error));
+            if (error) {
+                self->shut_down();
+                co_return;
+            }
+            self->m_outbox.pop_front();
+        }
+    }
+
+    void shut_down()
+    {
+        if (m_closed)
+            return;
+        m_closed = true;
+        m_server.exchange().close(*this);
+        m_inbox.clear();
+        m_outbox.clear();
+        m_inbox_signal.cancel();
+        m_outbox_signal.cancel();
+        boost::system::error_code error;
+        beast::get_lowest_layer(m_stream).socket().shutdown(asio::ip::tcp::socket::shutdown_both, error);
+        beast::get_lowest_layer(m_stream).socket().close(error);
+    }
+
+    Server& m_server;
+    websocket::stream<beast::tcp_stream> m_stream;
+    std::deque<std::pair<Clock::time_point, std::string>> m_inbox;
+    std::deque<std::string> m_outbox;
+    asio::steady_timer m_inbox_signal;
+    asio::steady_timer m_outbox_signal;
+    bool m_closed { false };
+};
+
+Server::Server(asio::io_context& io, Exchange& exchange, ServerOptions options, asio::ip::tcp::endpoint const& endpoint)
+    : m_exchange(exchange)
+    , m_options(options)
+    , m_acceptor(io, endpoint)
+    , m_random(options.random_seed)
+{
+}
+
+void Server::start()
+{
+    asio::co_spawn(m_acceptor.get_executor(), listen(), asio::detached);
+    asio::co_spawn(m_acceptor.get_executor(), tick(), asio::detached);
+    if (m_options.flow_rate > 0)
+        asio::co_spawn(m_acceptor.get_executor(), flow(), asio::detached);
+}
+
+Clock::duration Server::delay()
+{
+    if (m_options.jitter.count() <= 0)
+        return m_options.latency;
+    return m_options.latency + std::chrono::microseconds(std::uniform_int_distribution<int64_t>(0, m_options.jitter.count())(m_random));
+}
+
+bool Server::drop()
+{
+    return m_options.drop_rate > 0 && std::uniform_real_distribution<double>(0, 1)(m_random) < m_options.drop_rate;
+}
+
+asio::awaitable<void> Server::listen()
+{
+    while (true) {
+        boost::system::error_code error;
+        asio::ip::tcp::socket socket = co_await m_acceptor.async_accept(asio::redirect_error(asio::use_awaitable, error));
+        if (error) {
+            std::cerr << "accept failed: " << error.message() << std::endl;
+            continue;
+        }
+        socket.set_option(asio::ip::tcp::no_delay(true));
+        asio::co_spawn(m_acceptor.get_executor(), serve(std::move(socket)), asio::detached);
+    }
+}
+
+asio::awaitable<void> Server::serve(asio::ip::tcp::socket socket)
+{
+    beast::tcp_stream stream(std::move(socket));
+    beast::flat_buffer buffer;
+    asio::steady_timer timer(stream.get_executor());
+    boost::system::error_code error;
+    while (true) {
+        http::request<http::string_body> request;
+        co_await http::async_read(stream, buffer, request, asio::redirect_error(asio::use_awaitable, error));
+        if (error)
+            co_return;
+
+        if (websocket::is_upgrade(request)) {
+            if (request.target() != "/ws/2")
+                co_return;
+            auto session = std::make_shared<WebSocketSession>(*this, std::move(stream));
+            co_await session->run(std::move(request));
+            co_return;
+        }
+
+        const Clock::duration latency = delay();
+        if (latency.count() > 0) {
+            timer.expires_after(latency);
+            co_await timer.async_wait(asio::redirect_error(asio::use_awaitable, error));
+        }
+        if (drop())
+            co_return;
+
+        const std::string_view target(request.target().data(), request.target().size());
+        HttpReply reply;
+        if (request.method() == http::verb::get) {
+            reply = m_exchange.get(target);
+        } else if (request.method() == http::verb::post) {
+            auto header = [&request](char const* name) {
+                auto field = request.find(name);
+                return (field == request.end()) ? std::string_view() : std::string_view(field->value().data(), field->value().size());
+            };
+            reply = m_exchange.post(target, RequestAuth { .api_key = header("bfx-apikey"), .nonce = header("bfx-nonce"), .signature = header("bfx-signature") },
+                request.body());
+        } else {
+            reply = HttpReply { .status = 405, .body = R"(["error",10020,"method: invalid"])" };
+        }
+
+        http::response<http::string_body> response(static_cast<http::status>(reply.status), request.version());
+        response.set(http::field::content_type, "application/json; charset=utf-8");
+        response.keep_alive(request.keep_alive());
+        response.body() = std::move(reply.body);
+        response.prepare_payload();
+        // A reply to HEAD announces its body without sending it, the connection stays usable
+        if (request.method() == http::verb::head)
+            response.body().clear();
+        co_await http::async_write(stream, response, asio::redirect_error(asio::use_awaitable, error));
+        if (error || !response.keep_alive())
+            break;
+    }
+    stream.socket().shutdown(asio::ip::tcp::socket::shutdown_send, error);
+}
+
+asio::awaitable<void> Server::tick()
+{
+    asio::steady_timer timer(m_acceptor.get_executor());
+    while (true) {
+        timer.expires_after(std::chrono::seconds(1));
+        co_await timer.async_wait(asio::use_awaitable);
+        m_exchange.tick();
+    }
+}
+
+asio::awaitable<void> Server::flow()
+{
+    asio::steady_timer timer(m_acceptor.get_executor());
+    std::exponential_distribution<double> gap(m_options.flow_rate);
+    while (true) {
+        timer.expires_after(std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(gap(m_random))));
+        co_await timer.async_wait(asio::use_awaitable);
+        m_exchange.simulate_flow();
+    }
+}
+
+}
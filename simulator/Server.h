@@ -0,0 +1,55 @@
+#pragma once
+
+// Older Boost.Asio uses std::exchange in awaitable.hpp without including <utility>
+#include <utility>
+
+#include <Exchange.h>
+#include <boost/asio/awaitable.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <chrono>
+#include <random>
+
+namespace Simulator {
+
+struct ServerOptions {
+    // Added before the exchange sees a request or a websocket message, uniform in [latency, latency + jitter]
+    std::chrono::microseconds latency { 0 };
+    std::chrono::microseconds jitter { 0 };
+    // Share of requests and websocket messages after which the connection is closed without a reply
+    double drop_rate { 0 };
+    // Actions of the simulated market maker per second, 0 for a market that only moves with the clients
+    double flow_rate { 0 };
+    uint64_t random_seed { 42 };
+};
+
+// Serves the REST endpoints and, on /ws/2, the websocket API of an Exchange on a single port.
+// Everything runs on the io_context's one thread, the only thread that touches the exchange.
+class Server {
+public:
+    Server(boost::asio::io_context&, Exchange&, ServerOptions, boost::asio::ip::tcp::endpoint const&);
+    Server(Server const&) = delete;
+    Server& operator=(Server const&) = delete;
+
+    void start();
+    [[nodiscard]] unsigned short port() const { return m_acceptor.local_endpoint().port(); }
+
+    [[nodiscard]] Exchange& exchange() { return m_exchange; }
+    // Injected latency of the next request or message
+    std::chrono::steady_clock::duration delay();
+    // Whether the connection should go away instead of handling the next request or message
+    bool drop();
+
+private:
+    boost::asio::awaitable<void> listen();
+    boost::asio::awaitable<void> serve(boost::asio::ip::tcp::socket);
+    boost::asio::awaitable<void> tick();
+    boost::asio::awaitable<void> flow();
+
+    Exchange& m_exchange;
+    ServerOptions const m_options;
+    boost::asio::ip::tcp::acceptor m_acceptor;
+    std::mt19937_64 m_random;
+};
+
+}
@@ -0,0 +1,135 @@
+// Local stand-in for the Bitfinex REST and websocket APIs with an in-memory matching engine.
+// Point BASE_ENDPOINT and PUBLIC_ENDPOINT at http://127.0.0.1:<port> and the feed and trading
+// sessions at ws://127.0.0.1:<port>/ws/2.
+
+#include <Server.h>
+#include <Bitfinex/Client.h>
+#include <boost/algorithm/string.hpp>
+#include <boost/program_options.hpp>
+#include <dotenv/dotenv.h>
+#include <format>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <vector>
+
+// tBTCUSD=60000,tETHUSD=3000
+static std::vector<Simulator::ListedSymbol> parse_symbols(std::string const& text)
+{
+    std::vector<std::string> entries;
+    boost::split(entries, text, boost::is_any_of(","), boost::token_compress_on);
+    std::vector<Simulator::ListedSymbol> symbols;
+    for (std::string const& entry : entries) {
+        if (entry.empty())
+            continue;
+        const size_t separator = entry.rfind('=');
+        std::optional<Bitfinex::Decimal> price;
+        if (separator != std::string::npos)
+            price = Bitfinex::Decimal::parse(std::string_view(entry).substr(separator + 1));
+        if (!price.has_value() || price.value() <= Bitfinex::Decimal {})
+            throw std::invalid_argument("Invalid symbol " + entry + ", expected SYMBOL=REFERENCE_PRICE");
+        symbols.push_back(Simulator::ListedSymbol { .symbol = Bitfinex::intern_symbol(entry.substr(0, separator)), .reference_price = price.value() });
+    }
+    return symbols;
+}
+
+// "90,90,90", requests per minute of the order write, account read and position write families
+static std::array<unsigned, Bitfinex::RATE_LIMIT_FAMILY_COUNT> parse_rate_limits(std::string const& text)
+{
+    std::vector<std::string> limits;
+    boost::split(limits, text, boost::is_any_of(","));
+    if (limits.size() != Bitfinex::RATE_LIMIT_FAMILY_COUNT)
+        throw std::invalid_argument("--rate-limits expects three limits: order_write,account_read,position_write");
+    std::array<unsigned, Bitfinex::RATE_LIMIT_FAMILY_COUNT> rate_limits {};
+    for (size_t i = 0; i < rate_limits.size(); i++)
+        rate_limits[i] = static_cast<unsigned>(std::stoul(limits[i]));
+    return rate_limits;
+}
+
+static std::vector<Simulator::ApiKey> extra_api_keys(std::vector<Bitfinex::ApiKey> const& keys)
+{
+    std::vector<Simulator::ApiKey> api_keys;
+    for (Bitfinex::ApiKey const& key : keys)
+        api_keys.push_back(Simulator::ApiKey { .key = key.API_KEY, .secret = key.SECRET_KEY });
+    return api_keys;
+}
+
+int main(int argc, char** argv)
+{
+    boost::program_options::options_description options("Supported options");
+    options.add_options()("help", "print help message");
+    options.add_options()("port", boost::program_options::value<unsigned short>()->default_value(8766), "Port to listen on (127.0.0.1), REST and /ws/2");
+    options.add_options()("symbols", boost::program_options::value<std::string>()->default_value("tBTCUSD=60000,tETHUSD=3000,tTESTBTC:TESTUSD=60000"),
+        "Listed symbols with their starting price");
+    options.add_options()("api-key", boost::program_options::value<std::string>(), "Accepted API key, API_KEY of the .env file by default");
+    options.add_options()("secret-key", boost::program_options::value<std::string>(), "Secret of the API key, SECRET_KEY of the .env file by default");
+    options.add_options()("seed-depth", boost::program_options::value<size_t>()->default_value(25), "Market maker orders per side of each book at startup");
+    options.add_options()("flow-rate", boost::program_options::value<double>()->default_value(0), "Market maker quotes, cancels and trades per second");
+    options.add_options()("latency-ms", boost::program_options::value<double>()->default_value(0), "Delay before a request or message is handled");
+    options.add_options()("jitter-ms", boost::program_options::value<double>()->default_value(0), "Random extra delay, up to this much");
+    options.add_options()("error-rate", boost::program_options::value<double>()->default_value(0), "Share of requests and order operations that fail");
+    options.add_options()("drop-rate", boost::program_options::value<double>()->default_value(0), "Share of requests and messages that close the connection");
+    options.add_options()("no-nonce-check", "Accept nonces that are not increasing");
+    options.add_options()("rate-limits", boost::program_options::value<std::string>()->implicit_value(
+        std::format("{},{},{}", Bitfinex::EXCHANGE_RATE_LIMITS[0], Bitfinex::EXCHANGE_RATE_LIMITS[1], Bitfinex::EXCHANGE_RATE_LIMITS[2])),
+        "Requests per minute allowed in the order write, account read and position write families, the exchange's when given without a value");
+    options.add_options()("seed", boost::program_options::value<uint64_t>()->default_value(42), "Seed of the random market and fault injection");
+
+    try {
+        boost::program_options::variables_map variables_map;
+        boost::program_options::store(boost::program_options::parse_command_line(argc, argv, options), variables_map);
+        boost::program_options::notify(variables_map);
+        if (variables_map.count("help")) {
+            std::cout << options << std::endl;
+            return 0;
+        }
+
+        dotenv::init(".env");
+        const std::string api_key = variables_map.count("api-key") ? variables_map["api-key"].as<std::string>() : dotenv::getenv("API_KEY");
+        const std::string secret_key = variables_map.count("secret-key") ? variables_map["secret-key"].as<std::string>() : dotenv::getenv("SECRET_KEY");
+        if (api_key.empty() || secret_key.empty()) {
+            std::cerr << "Please pass --api-key and --secret-key or set API_KEY and SECRET_KEY in the .env file" << std::endl;
+            return 1;
+        }
+        std::optional<std::vector<Bitfinex::ApiKey>> extra_keys = Bitfinex::parse_api_keys(dotenv::getenv("EXTRA_KEYS"));
+        if (!extra_keys.has_value()) {
+            std::cerr << "EXTRA_KEYS of the .env file must be KEY:SECRET pairs separated by commas" << std::endl;
+            return 1;
+        }
+
+        const uint64_t seed = variables_map["seed"].as<uint64_t>();
+        Simulator::Exchange exchange(Simulator::ExchangeOptions {
+            .api_keys = { Simulator::ApiKey { .key = api_key, .secret = secret_key } },
+            .extra_keys = extra_api_keys(extra_keys.value()),
+            .symbols = parse_symbols(variables_map["symbols"].as<std::string>()),
+            .seed_depth = variables_map["seed-depth"].as<size_t>(),
+            .error_rate = variables_map["error-rate"].as<double>(),
+            .check_nonces = variables_map.count("no-nonce-check") == 0,
+            .rate_limits = variables_map.count("rate-limits") ? parse_rate_limits(variables_map["rate-limits"].as<std::string>())
+                                                              : std::array<unsigned, Bitfinex::RATE_LIMIT_FAMILY_COUNT> {},
+            .random_seed = seed,
+        });
+
+        auto milliseconds = [&variables_map](char const* name) {
+            return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::duration<double, std::milli>(variables_map[name].as<double>()));
+        };
+        boost::asio::io_context io;
+        Simulator::Server server(io, exchange,
+            Simulator::ServerOptions {
+                .latency = milliseconds("latency-ms"),
+                .jitter = milliseconds("jitter-ms"),
+                .drop_rate = variables_map["drop-rate"].as<double>(),
+                .flow_rate = variables_map["flow-rate"].as<double>(),
+                .random_seed = seed + 1,
+            },
+            { boost::asio::ip::make_address("127.0.0.1"), variables_map["port"].as<unsigned short>() });
+        server.start();
+        std::cout << "simulating " << exchange.engine().symbols().size() << " symbols on http://127.0.0.1:" << server.port() << " and ws://127.0.0.1:"
+                  << server.port() << "/ws/2" << std::endl;
+        io.run();
+    } catch (const std::exception& err) {
+        std::cerr << err.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,227 @@
+// Table driven checks of Bitfinex::Decimal parsing, writing and rounding. Exits with 1 and lists
+// the failing cases when any fails.
+#include <Bitfinex/Decimal.h>
+#include <cstdint>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <string_view>
+
+using Bitfinex::Decimal;
+
+static int failures = 0;
+
+static std::string describe(std::optional<Decimal> value)
+{
+    return value.has_value() ? value->to_string() + " (" + std::to_string(value->units()) + " units)" : "nothing";
+}
+
+static void expect(bool passed, std::string_view what, std::string const& detail)
+{
+    if (passed)
+        return;
+    failures++;
+    std::cerr << "FAILED " << what << ": " << detail << std::endl;
+}
+
+static void parse_cases()
+{
+    struct Case {
+        std::string_view text;
+        std::optional<int64_t> units;
+    };
+    static constexpr Case cases[] = {
+        { "0", 0 },
+        { "-0", 0 },
+        { "+1", 100000000 },
+        { "8000", 800000000000 },
+        { "-8000", -800000000000 },
+        { "0.1", 10000000 },
+        { ".5", 50000000 },
+        { "5.", 500000000 },
+        { "0.00000001", 1 },
+        { "-0.00000001", -1 },
+        { "1.50000000000000000000", 150000000 },
+        { "000000000000000000000012.5", 1250000000 },
+        // Exponents
+        { "1e3", 100000000000 },
+        { "1E3", 100000000000 },
+        { "1e+3", 100000000000 },
+        { "1.5e-7", 15 },
+        { "1e-8", 1 },
+        { "-2.5e-3", -250000 },
+        { "123456789e-8", 123456789 },
+        { "0e50", 0 },
+        { "1e-101", std::nullopt },
+        { "1e101", std::nullopt },
+        { "1e", std::nullopt },
+        // Finer than 1e-8
+        { "0.000000001", std::nullopt },
+        { "1.000000005", std::nullopt },
+        { "1e-9", std::nullopt },
+        { "0.000000010", 1 },
+        { "1.000000000000000000000001", std::nullopt },
+        // INT64 limits
+        { "92233720368.54775807", INT64_MAX },
+        { "-92233720368.54775807", -INT64_MAX },
+        { "-92233720368.54775808", INT64_MIN },
+        { "92233720368.54775808", std::nullopt },
+        { "-92233720368.54775809", std::nullopt },
+        { "9223372036854775807e-8", INT64_MAX },
+        { "100000000000", std::nullopt },
+        { "18446744073709551616", std::nullopt },
+        // Malformed
+        { "", std::nullopt },
+        { "-", std::nullopt },
+        { ".", std::nullopt },
+        { "1.2.3", std::nullopt },
+        { "1,5", std::nullopt },
+        { " 1", std::nullopt },
+        { "1 ", std::nullopt },
+        { "0x10", std::nullopt },
+        { "nan", std::nullopt },
+    };
+    for (Case const& test : cases) {
+        const std::optional<Decimal> parsed = Decimal::parse(test.text);
+        const std::optional<Decimal> expected = test.units.has_value() ? std::optional(Decimal::from_units(test.units.value())) : std::nullopt;
+        expect(parsed == expected, "parse \"" + std::string(test.text) + "\"", "got " + describe(parsed) + ", expected " + describe(expected));
+    }
+}
+
+static void write_cases()
+{
+    struct Case {
+        int64_t units;
+        std::string_view text;
+    };
+    static constexpr Case cases[] = {
+        { 0, "0" },
+        { 1, "0.00000001" },
+        { -1, "-0.00000001" },
+        { 10000000, "0.1" },
+        { 100000000, "1" },
+        { -150000000, "-1.5" },
+        { 800000000000, "8000" },
+        { 123456789012, "1234.56789012" },
+        { INT64_MAX, "92233720368.54775807" },
+        { INT64_MIN, "-92233720368.54775808" },
+    };
+    for (Case const& test : cases) {
+        const std::string written = Decimal::from_units(test.units).to_string();
+        expect(written == test.text, "write " + std::to_string(test.units) + " units", "got \"" + written + "\", expected \"" + std::string(test.text) + "\"");
+        expect(written.size() <= Decimal::MAX_LENGTH, "write " + std::to_string(test.units) + " units", "longer than MAX_LENGTH");
+    }
+}
+
+static void round_trip_cases()
+{
+    static constexpr int64_t units[] = { 0, 1, -1, 7, 10, 99999999, 100000000, 100000001, -123456789, 500000000000, 314159265358979, INT64_MAX,
+        INT64_MIN, INT64_MAX - 1, INT64_MIN + 1 };
+    for (int64_t value : units) {
+        const Decimal decimal = Decimal::from_units(value);
+        const std::optional<Decimal> parsed = Decimal::parse(decimal.to_string());
+        expect(parsed == decimal, "round trip of " + std::to_string(value) + " units", "read back " + describe(parsed));
+    }
+}
+
+static void tick_cases()
+{
+    struct Case {
+        int64_t units;
+        int64_t tick;
+        int64_t rounded;
+    };
+    static constexpr Case cases[] = {
+        { 1234, 100, 1200 },
+        { 1250, 100, 1300 },
+        { 1249, 100, 1200 },
+        { -1250, 100, -1300 },
+        { -1249, 100, -1200 },
+        { 1500, 1000, 2000 },
+        { 2500, 1000, 3000 },
+        { -2500, 1000, -3000 },
+        { 1234, 0, 1234 },
+        { 1234, 1, 1234 },
+        { 0, 100, 0 },
+        // Rounding away from zero would leave the range, the multiple towards zero is kept
+        { INT64_MAX, 10, INT64_MAX - 7 },
+        { INT64_MIN, 10, INT64_MIN + 8 },
+        { INT64_MAX, 100000000, 9223372036800000000 },
+    };
+    for (Case const& test : cases) {
+        const Decimal rounded = Decimal::from_units(test.units).round_to_tick(Decimal::from_units(test.tick));
+        expect(rounded.units() == test.rounded, "round " + std::to_string(test.units) + " to tick " + std::to_string(test.tick),
+            "got " + std::to_string(rounded.units()) + ", expected " + std::to_string(test.rounded));
+    }
+}
+
+static void significant_cases()
+{
+    struct Case {
+        std::string_view value;
+        int digits;
+        std::string_view rounded;
+    };
+    static constexpr Case cases[] = {
+        { "12345.678", 5, "12346" },
+        { "12344.5", 5, "12345" },
+        { "-12344.5", 5, "-12345" },
+        { "0.00123456", 5, "0.0012346" },
+        { "1.5", 1, "2" },
+        { "2.5", 1, "3" },
+        { "123", 5, "123" },
+        { "0", 5, "0" },
+        { "0.00000001", 1, "0.00000001" },
+        { "99999.5", 5, "100000" },
+        // digits is taken between 1 and 18
+        { "123.45", 0, "100" },
+        { "123.45", -3, "100" },
+        { "123.45", 40, "123.45" },
+        { "92233720368.54775807", 18, "92233720368.547758" },
+        { "-92233720368.54775808", 18, "-92233720368.547758" },
+    };
+    for (Case const& test : cases) {
+        const Decimal rounded = Decimal::parse(test.value).value().round_to_significant(test.digits);
+        expect(rounded.to_string() == test.rounded, "round " + std::string(test.value) + " to " + std::to_string(test.digits) + " digits",
+            "got " + rounded.to_string() + ", expected " + std::string(test.rounded));
+    }
+}
+
+static void from_double_cases()
+{
+    struct Case {
+        double value;
+        int64_t units;
+    };
+    static constexpr Case cases[] = {
+        { 0.1, 10000000 },
+        { 8000.0, 800000000000 },
+        { -0.0001, -10000 },
+        { 1.5e-7, 15 },
+        { 1e-9, 0 },
+        { 6e-9, 1 },
+        { 1e300, INT64_MAX },
+        { -1e300, -INT64_MAX },
+    };
+    for (Case const& test : cases) {
+        const Decimal decimal = Decimal::from_double(test.value);
+        expect(decimal.units() == test.units, "from_double " + std::to_string(test.value),
+            "got " + std::to_string(decimal.units()) + ", expected " + std::to_string(test.units));
+    }
+}
+
+int main()
+{
+    parse_cases();
+    write_cases();
+    round_trip_cases();
+    tick_cases();
+    significant_cases();
+    from_double_cases();
+    if (failures != 0) {
+        std::cerr << failures << " failed" << std::endl;
+        return 1;
+    }
+    std::cout << "all Decimal cases passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,109 @@
+// Stand-in for the public websocket endpoint: every client that connects gets the frames of a
+// recorded session (one frame per line, as written by trader --stream --record) replayed to it.
+// Point the feed handler at ws://127.0.0.1:<port>/ws/2 and subscribe to the recorded channels.
+
+// Older Boost.Asio uses std::exchange in awaitable.hpp without including <utility>
+#include <utility>
+
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/detached.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/redirect_error.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/use_awaitable.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/websocket.hpp>
+#include <boost/program_options.hpp>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace asio = boost::asio;
+namespace beast = boost::beast;
+namespace websocket = boost::beast::websocket;
+
+using WebSocketStream = websocket::stream<beast::tcp_stream>;
+
+static asio::awaitable<void> discard_client_frames(std::shared_ptr<WebSocketStream> stream)
+{
+    beast::flat_buffer buffer;
+    boost::system::error_code error;
+    while (!error) {
+        co_await stream->async_read(buffer, asio::redirect_error(asio::use_awaitable, error));
+        buffer.consume(buffer.size());
+    }
+}
+
+static asio::awaitable<void> replay(asio::ip::tcp::socket socket, std::vector<std::string> const& frames, std::chrono::microseconds interval)
+{
+    auto stream = std::make_shared<WebSocketStream>(std::move(socket));
+    boost::system::error_code error;
+    co_await stream->async_accept(asio::redirect_error(asio::use_awaitable, error));
+    if (error)
+        co_return;
+    asio::co_spawn(stream->get_executor(), discard_client_frames(stream), asio::detached);
+
+    asio::steady_timer timer(stream->get_executor());
+    for (std::string const& frame : frames) {
+        if (interval.count() > 0) {
+            timer.expires_after(interval);
+            co_await timer.async_wait(asio::redirect_error(asio::use_awaitable, error));
+        }
+        stream->text(true);
+        co_await stream->async_write(asio::buffer(frame), asio::redirect_error(asio::use_awaitable, error));
+        if (error)
+            co_return;
+    }
+    std::cout << "replayed " << frames.size() << " frames" << std::endl;
+}
+
+static asio::awaitable<void> listen(asio::ip::tcp::acceptor& acceptor, std::vector<std::string> const& frames, std::chrono::microseconds interval)
+{
+    while (true) {
+        asio::ip::tcp::socket socket = co_await acceptor.async_accept(asio::use_awaitable);
+        asio::co_spawn(acceptor.get_executor(), replay(std::move(socket), frames, interval), asio::detached);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    boost::program_options::options_description options("Supported options");
+    options.add_options()("help", "print help message");
+    options.add_options()("frames", boost::program_options::value<std::string>(), "File with one recorded frame per line");
+    options.add_options()("port", boost::program_options::value<unsigned short>()->default_value(8765), "Port to listen on (127.0.0.1)");
+    options.add_options()("interval-us", boost::program_options::value<long>()->default_value(0), "Delay between two frames in microseconds");
+
+    try {
+        boost::program_options::variables_map variables_map;
+        boost::program_options::store(boost::program_options::parse_command_line(argc, argv, options), variables_map);
+        boost::program_options::notify(variables_map);
+        if (variables_map.count("help") || variables_map.count("frames") == 0) {
+            std::cout << options << std::endl;
+            return 0;
+        }
+
+        std::ifstream file(variables_map["frames"].as<std::string>());
+        if (!file) {
+            std::cerr << "Could not open " << variables_map["frames"].as<std::string>() << std::endl;
+            return 1;
+        }
+        std::vector<std::string> frames;
+        for (std::string line; std::getline(file, line);) {
+            if (!line.empty())
+                frames.push_back(std::move(line));
+        }
+
+        asio::io_context io;
+        asio::ip::tcp::acceptor acceptor(io, { asio::ip::make_address("127.0.0.1"), variables_map["port"].as<unsigned short>() });
+        asio::co_spawn(io, listen(acceptor, frames, std::chrono::microseconds(variables_map["interval-us"].as<long>())), asio::detached);
+        std::cout << "replaying " << frames.size() << " frames on ws://127.0.0.1:" << acceptor.local_endpoint().port() << "/ws/2" << std::endl;
+        io.run();
+    } catch (const std::exception& err) {
+        std::cerr << err.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
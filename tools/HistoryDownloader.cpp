@@ -0,0 +1,133 @@
+// Downloads public trades or candles into the columnar history store, one file per symbol and UTC
+// day, and prints stored days back as CSV. Interrupting a download (Ctrl-C) keeps every finished
+// day, running it again only fetches the days that are missing or were still going on.
+
+#include <Bitfinex/HistoryDownloader.h>
+#include <boost/algorithm/string.hpp>
+#include <boost/program_options.hpp>
+#include <chrono>
+#include <csignal>
+#include <format>
+#include <iostream>
+
+static Bitfinex::HistoryDownloader* running_downloader = nullptr;
+
+static void stop_download(int)
+{
+    if (running_downloader)
+        running_downloader->stop();
+}
+
+static int64_t parse_day_option(std::string const& text, char const* option)
+{
+    std::optional<int64_t> day = Bitfinex::parse_day(text);
+    if (!day.has_value())
+        throw boost::program_options::validation_error(boost::program_options::validation_error::invalid_option_value, option);
+    return day.value();
+}
+
+static int dump(std::string const& path)
+{
+    std::optional<Bitfinex::HistoryFile> file = Bitfinex::HistoryFile::open(path);
+    if (!file.has_value()) {
+        std::cerr << path << " is not a history file" << std::endl;
+        return 1;
+    }
+    if (file->kind() == Bitfinex::HistoryKind::TRADES) {
+        std::vector<Bitfinex::HistoryTrade> trades;
+        if (!file->read_trades(trades))
+            return 1;
+        std::cout << "id,mts,amount,price\n";
+        for (Bitfinex::HistoryTrade const& trade : trades)
+            std::cout << std::format("{},{},{},{}\n", trade.trade_id, trade.timestamp_ms, trade.amount, trade.price);
+    } else {
+        std::vector<Bitfinex::Candle> candles;
+        if (!file->read_candles(candles))
+            return 1;
+        std::cout << "mts,open,close,high,low,volume\n";
+        for (Bitfinex::Candle const& candle : candles)
+            std::cout << std::format("{},{},{},{},{},{}\n", candle.timestamp_ms, candle.open, candle.close, candle.high, candle.low, candle.volume);
+    }
+    std::cerr << std::format("{} {} of {}{}, {} bytes", file->size(), Bitfinex::history_kind_name(file->kind()), Bitfinex::day_name(file->day_start_ms()),
+        file->complete() ? "" : " (partial)", file->file_size())
+              << std::endl;
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    boost::program_options::options_description options("Supported options");
+    options.add_options()("help", "print help message");
+    options.add_options()("symbols", boost::program_options::value<std::string>(), "Comma separated trading pairs to download, e.g. tBTCUSD,tETHUSD");
+    options.add_options()("kind", boost::program_options::value<std::string>()->default_value("trades"), "trades or candles");
+    options.add_options()("timeframe", boost::program_options::value<std::string>()->default_value("1m"), "Candle interval: 1m, 5m, 15m, 30m, 1h, 3h, 6h, 12h, 1D...");
+    options.add_options()("from", boost::program_options::value<std::string>(), "First day to download, YYYY-MM-DD (UTC)");
+    options.add_options()("to", boost::program_options::value<std::string>(), "Last day to download, YYYY-MM-DD (UTC), the first day when not given");
+    options.add_options()("dir", boost::program_options::value<std::string>()->default_value("history"), "Root directory of the store");
+    options.add_options()("concurrency", boost::program_options::value<unsigned>()->default_value(4), "Days downloaded at once");
+    options.add_options()("requests-per-minute", boost::program_options::value<unsigned>(),
+        "Request budget shared by all downloads, the exchange's limit (15 for trades, 30 for candles) by default");
+    options.add_options()("page-size", boost::program_options::value<unsigned>()->default_value(10000), "Records per request");
+    options.add_options()("public-endpoint", boost::program_options::value<std::string>()->default_value(Bitfinex::Client::DEFAULT_PUBLIC_ENDPOINT),
+        "REST endpoint of the public API");
+    options.add_options()("dump", boost::program_options::value<std::string>(), "Print the records of a stored day as CSV instead of downloading");
+
+    try {
+        boost::program_options::variables_map variables_map;
+        boost::program_options::store(boost::program_options::parse_command_line(argc, argv, options), variables_map);
+        boost::program_options::notify(variables_map);
+
+        if (variables_map.count("dump"))
+            return dump(variables_map["dump"].as<std::string>());
+        if (variables_map.count("help") || !variables_map.count("symbols") || !variables_map.count("from")) {
+            std::cout << options << std::endl;
+            return 0;
+        }
+
+        std::string const& kind = variables_map["kind"].as<std::string>();
+        if (kind != "trades" && kind != "candles")
+            throw boost::program_options::validation_error(boost::program_options::validation_error::invalid_option_value, "kind");
+        const int64_t from_ms = parse_day_option(variables_map["from"].as<std::string>(), "from");
+        const int64_t to_ms = (variables_map.count("to") ? parse_day_option(variables_map["to"].as<std::string>(), "to") : from_ms) + Bitfinex::MILLISECONDS_PER_DAY;
+
+        std::vector<std::string> names;
+        boost::split(names, variables_map["symbols"].as<std::string>(), boost::is_any_of(","), boost::token_compress_on);
+        std::erase(names, "");
+        std::vector<Bitfinex::SymbolId> symbols;
+        for (std::string const& name : names)
+            symbols.push_back(Bitfinex::intern_symbol(name));
+
+        Bitfinex::HistoryDownloadOptions download_options { .public_endpoint = variables_map["public-endpoint"].as<std::string>(),
+            .directory = variables_map["dir"].as<std::string>(), .kind = (kind == "trades") ? Bitfinex::HistoryKind::TRADES : Bitfinex::HistoryKind::CANDLES,
+            .timeframe = variables_map["timeframe"].as<std::string>(), .concurrency = variables_map["concurrency"].as<unsigned>(), .rate_limit = {},
+            .page_size = variables_map["page-size"].as<unsigned>(), .attempts = 5 };
+        if (variables_map.count("requests-per-minute"))
+            download_options.rate_limit = Bitfinex::RateLimit::per_minute(variables_map["requests-per-minute"].as<unsigned>());
+
+        Bitfinex::HistoryDownloader downloader(download_options);
+        running_downloader = &downloader;
+        std::signal(SIGINT, stop_download);
+        std::signal(SIGTERM, stop_download);
+
+        const auto start = std::chrono::steady_clock::now();
+        Bitfinex::HistoryDownloadStats stats = downloader.download(symbols, from_ms, to_ms,
+            [](Bitfinex::SymbolId symbol, int64_t day_start_ms, size_t records, Bitfinex::HistoryDayStatus status) {
+                static constexpr char const* outcomes[] = { "written", "already stored", "failed", "stopped", "written incomplete" };
+                // Several download threads report, one line each
+                std::cout << std::format("{} {}: {} records, {}\n", Bitfinex::symbol_name(symbol), Bitfinex::day_name(day_start_ms), records,
+                    outcomes[static_cast<size_t>(status)])
+                          << std::flush;
+            });
+        running_downloader = nullptr;
+
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << std::format("{} days written, {} already stored, {} failed, {} records in {} requests, {:.1f} bytes per record, {:.1f} s", stats.days_written,
+            stats.days_skipped, stats.days_failed, stats.records, stats.requests,
+            stats.records ? static_cast<double>(stats.bytes_written) / static_cast<double>(stats.records) : 0.0, seconds)
+                  << std::endl;
+        return stats.days_failed ? 2 : 0;
+    } catch (const std::exception& err) {
+        std::cerr << err.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,316 @@
+// Prints the records of a journal written by `trader --journal`, optionally only those of a
+// symbol, an order or a time range. A request and its response are kept together: when either one
+// mentions the symbol or the order, both are printed.
+
+#include <Bitfinex/Client.h>
+#include <Bitfinex/HistoryStore.h>
+#include <Bitfinex/Journal.h>
+#include <Bitfinex/LatencyHistogram.h>
+#include <boost/algorithm/string.hpp>
+#include <boost/program_options.hpp>
+#include <array>
+#include <charconv>
+#include <format>
+#include <iostream>
+#include <map>
+#include <nlohmann/json.hpp>
+#include <unordered_map>
+
+using json = nlohmann::json;
+
+static constexpr int64_t NANOSECONDS_PER_MILLISECOND = 1000000;
+
+// YYYY-MM-DD, optionally followed by THH:MM[:SS[.fraction]] and Z, in UTC
+static std::optional<int64_t> parse_time(std::string_view text)
+{
+    if (text.ends_with('Z'))
+        text.remove_suffix(1);
+    std::optional<int64_t> day = Bitfinex::parse_day(text.substr(0, 10));
+    if (!day.has_value())
+        return {};
+    int64_t time_ns = day.value() * NANOSECONDS_PER_MILLISECOND;
+    if (text.size() == 10)
+        return time_ns;
+    if (text[10] != 'T' && text[10] != ' ')
+        return {};
+
+    // Hours, minutes and seconds, then the fraction of a second
+    static constexpr std::array<int64_t, 3> units { 3600'000'000'000, 60'000'000'000, 1'000'000'000 };
+    size_t position = 11;
+    for (size_t field = 0; field < units.size() && position < text.size(); field++) {
+        if (field > 0 && text[position++] != ':')
+            return {};
+        int value = 0;
+        auto [end, error] = std::from_chars(text.data() + position, text.data() + std::min(text.size(), position + 2), value);
+        if (error != std::errc {} || end != text.data() + position + 2)
+            return {};
+        time_ns += value * units[field];
+        position += 2;
+    }
+    if (position < text.size()) {
+        if (text[position++] != '.')
+            return {};
+        int64_t scale = 100'000'000;
+        for (; position < text.size() && scale > 0; position++, scale /= 10) {
+            if (text[position] < '0' || text[position] > '9')
+                return {};
+            time_ns += (text[position] - '0') * scale;
+        }
+        if (position != text.size())
+            return {};
+    }
+    return time_ns;
+}
+
+// 2024-06-10T12:34:56.789123456Z
+static std::string format_time(int64_t time_ns)
+{
+    std::string text = Bitfinex::unix_to_iso_utc(time_ns / NANOSECONDS_PER_MILLISECOND);
+    text.pop_back();
+    return std::format("{}{:06}Z", text, time_ns % NANOSECONDS_PER_MILLISECOND);
+}
+
+static char const* endpoint_label(Bitfinex::Endpoint endpoint)
+{
+    return static_cast<size_t>(endpoint) < Bitfinex::ENDPOINT_COUNT ? Bitfinex::endpoint_name(endpoint) : "unknown";
+}
+
+struct Filter {
+    std::optional<std::string> symbol;
+    std::optional<uint64_t> order_id;
+    std::string order_id_text;
+};
+
+// Which of the symbol and the order a message mentions
+static constexpr unsigned MENTIONS_SYMBOL = 1;
+static constexpr unsigned MENTIONS_ORDER = 2;
+
+static unsigned json_mentions(json const& value, Filter const& filter)
+{
+    unsigned mentions = 0;
+    if (value.is_string()) {
+        std::string const& text = value.get_ref<std::string const&>();
+        if (filter.symbol.has_value() && text == filter.symbol.value())
+            mentions |= MENTIONS_SYMBOL;
+        if (filter.order_id.has_value() && text == filter.order_id_text)
+            mentions |= MENTIONS_ORDER;
+    } else if (value.is_number_integer()) {
+        if (filter.order_id.has_value() && value.get<int64_t>() == static_cast<int64_t>(filter.order_id.value()))
+            mentions |= MENTIONS_ORDER;
+    } else if (value.is_structured()) {
+        for (json const& item : value)
+            mentions |= json_mentions(item, filter);
+    }
+    return mentions;
+}
+
+// Channels of the public feed, per feed of the journal, to tell which symbol a data frame is about
+using Channels = std::map<std::pair<uint64_t, int64_t>, std::string>;
+
+static unsigned mentions(Bitfinex::JournalRecord const& record, Filter const& filter, Channels& channels)
+{
+    unsigned found = 0;
+    if (record.kind == Bitfinex::JournalRecordKind::FRAME && record.body.starts_with('[')) {
+        int64_t channel_id = 0;
+        std::from_chars(record.body.data() + 1, record.body.data() + record.body.size(), channel_id);
+        auto channel = channels.find({ record.sequence, channel_id });
+        if (filter.symbol.has_value() && channel != channels.end() && channel->second == filter.symbol.value())
+            found |= MENTIONS_SYMBOL;
+    }
+    if (filter.symbol.has_value() && record.topic.find(filter.symbol.value()) != std::string_view::npos)
+        found |= MENTIONS_SYMBOL;
+
+    // Most messages are about something else, only those containing the text are parsed
+    const bool maybe_symbol = filter.symbol.has_value() && record.body.find(filter.symbol.value()) != std::string_view::npos;
+    const bool maybe_order = filter.order_id.has_value() && record.body.find(filter.order_id_text) != std::string_view::npos;
+    const bool subscribed = record.kind == Bitfinex::JournalRecordKind::FRAME && record.body.starts_with('{');
+    if (!maybe_symbol && !maybe_order && !subscribed)
+        return found;
+    json message = json::parse(record.body.begin(), record.body.end(), nullptr, false);
+    if (message.is_discarded())
+        return found;
+    if (subscribed && message.value("event", "") == "subscribed" && message["chanId"].is_number_integer())
+        channels[{ record.sequence, message["chanId"].get<int64_t>() }] = message.value("symbol", "");
+    if (maybe_symbol || maybe_order)
+        found |= json_mentions(message, filter);
+    return found;
+}
+
+int main(int argc, char** argv)
+{
+    boost::program_options::options_description options("Supported options");
+    options.add_options()("help", "print help message");
+    options.add_options()("dir", boost::program_options::value<std::string>()->default_value("journal"), "Directory of the journal");
+    options.add_options()("file", boost::program_options::value<std::string>(), "Read only this journal file");
+    options.add_options()("symbol", boost::program_options::value<std::string>(), "Only messages about this symbol, e.g. tBTCUSD");
+    options.add_options()("order-id", boost::program_options::value<uint64_t>(), "Only messages about this order");
+    options.add_options()("from", boost::program_options::value<std::string>(), "Only messages at or after this time, YYYY-MM-DD[THH:MM:SS[.fraction]] (UTC)");
+    options.add_options()("to", boost::program_options::value<std::string>(), "Only messages before this time, YYYY-MM-DD[THH:MM:SS[.fraction]] (UTC)");
+    options.add_options()("kind", boost::program_options::value<std::string>(), "Comma separated kinds to print: request, response, frame");
+    options.add_options()("json", "Print one JSON object per message instead of text");
+    options.add_options()("stats", "Print counts and request to response times per endpoint instead of the messages");
+
+    try {
+        boost::program_options::variables_map variables_map;
+        boost::program_options::store(boost::program_options::parse_command_line(argc, argv, options), variables_map);
+        boost::program_options::notify(variables_map);
+        if (variables_map.count("help")) {
+            std::cout << options << std::endl;
+            return 0;
+        }
+
+        Filter filter;
+        if (variables_map.count("symbol"))
+            filter.symbol = variables_map["symbol"].as<std::string>();
+        if (variables_map.count("order-id")) {
+            filter.order_id = variables_map["order-id"].as<uint64_t>();
+            filter.order_id_text = std::to_string(filter.order_id.value());
+        }
+        int64_t from_ns = INT64_MIN;
+        int64_t to_ns = INT64_MAX;
+        for (auto [option, bound] : { std::pair { "from", &from_ns }, std::pair { "to", &to_ns } }) {
+            if (!variables_map.count(option))
+                continue;
+            std::optional<int64_t> time = parse_time(variables_map[option].as<std::string>());
+            if (!time.has_value())
+                throw boost::program_options::validation_error(boost::program_options::validation_error::invalid_option_value, option);
+            *bound = time.value();
+        }
+        std::array<bool, 5> kinds { false, true, true, true, false };
+        if (variables_map.count("kind")) {
+            kinds.fill(false);
+            std::vector<std::string> names;
+            boost::split(names, variables_map["kind"].as<std::string>(), boost::is_any_of(","), boost::token_compress_on);
+            for (std::string const& name : names) {
+                size_t kind = 1;
+                while (kind < kinds.size() && name != Bitfinex::journal_record_kind_name(static_cast<Bitfinex::JournalRecordKind>(kind)))
+                    kind++;
+                if (kind == kinds.size())
+                    throw boost::program_options::validation_error(boost::program_options::validation_error::invalid_option_value, "kind");
+                kinds[kind] = true;
+            }
+        }
+
+        std::vector<Bitfinex::JournalFile> files;
+        const std::vector<std::string> paths = variables_map.count("file") ? std::vector { variables_map["file"].as<std::string>() }
+                                                                           : Bitfinex::journal_files(variables_map["dir"].as<std::string>());
+        for (std::string const& path : paths) {
+            std::optional<Bitfinex::JournalFile> file = Bitfinex::JournalFile::open(path);
+            if (!file.has_value()) {
+                std::cerr << path << " is not a journal file" << std::endl;
+                return 1;
+            }
+            files.push_back(std::move(file.value()));
+        }
+        if (files.empty()) {
+            std::cerr << "No journal files in " << variables_map["dir"].as<std::string>() << std::endl;
+            return 1;
+        }
+        auto for_each_record = [&files](auto visit) {
+            for (Bitfinex::JournalFile const& file : files) {
+                Bitfinex::JournalRecord record;
+                for (size_t offset = 0; file.next(offset, record);)
+                    visit(record);
+            }
+        };
+
+        // First pass: what each request and response pair mentions, and when each request went out
+        const unsigned wanted = (filter.symbol.has_value() ? MENTIONS_SYMBOL : 0) | (filter.order_id.has_value() ? MENTIONS_ORDER : 0);
+        std::unordered_map<uint64_t, unsigned> exchange_mentions;
+        std::unordered_map<uint64_t, int64_t> request_times;
+        Channels channels;
+        for_each_record([&](Bitfinex::JournalRecord const& record) {
+            if (record.kind == Bitfinex::JournalRecordKind::FRAME)
+                return;
+            if (record.kind == Bitfinex::JournalRecordKind::REQUEST)
+                request_times[record.sequence] = record.timestamp_ns;
+            if (wanted)
+                exchange_mentions[record.sequence] |= mentions(record, filter, channels);
+        });
+
+        struct EndpointStats {
+            uint64_t requests { 0 };
+            uint64_t errors { 0 };
+            Bitfinex::LatencyHistogram latency;
+        };
+        std::map<std::string, EndpointStats> endpoint_stats;
+        uint64_t frames = 0;
+        uint64_t printed = 0;
+        int64_t first_ns = INT64_MAX;
+        int64_t last_ns = INT64_MIN;
+        const bool stats = variables_map.count("stats") > 0;
+        const bool as_json = variables_map.count("json") > 0;
+
+        for_each_record([&](Bitfinex::JournalRecord const& record) {
+            // Frames are matched in order, a data frame needs the subscription before it
+            const unsigned found = (record.kind == Bitfinex::JournalRecordKind::FRAME) ? (wanted ? mentions(record, filter, channels) : 0)
+                                                                                        : exchange_mentions[record.sequence];
+            if ((found & wanted) != wanted || record.timestamp_ns < from_ns || record.timestamp_ns >= to_ns || !kinds[static_cast<size_t>(record.kind)])
+                return;
+            printed++;
+            first_ns = std::min(first_ns, record.timestamp_ns);
+            last_ns = std::max(last_ns, record.timestamp_ns);
+
+            auto request = request_times.find(record.sequence);
+            const bool answered = record.kind == Bitfinex::JournalRecordKind::RESPONSE && request != request_times.end();
+            const int64_t latency_ns = answered ? record.timestamp_ns - request->second : 0;
+            if (stats) {
+                if (record.kind == Bitfinex::JournalRecordKind::FRAME) {
+                    frames++;
+                } else if (record.kind == Bitfinex::JournalRecordKind::REQUEST) {
+                    endpoint_stats[endpoint_label(record.endpoint)].requests++;
+                } else {
+                    EndpointStats& endpoint = endpoint_stats[endpoint_label(record.endpoint)];
+                    endpoint.errors += record.status != 200;
+                    if (answered)
+                        endpoint.latency.record(static_cast<uint64_t>(std::max<int64_t>(0, latency_ns)));
+                }
+                return;
+            }
+
+            if (as_json) {
+                json line = { { "time", format_time(record.timestamp_ns) }, { "time_ns", record.timestamp_ns },
+                    { "kind", Bitfinex::journal_record_kind_name(record.kind) }, { "sequence", record.sequence } };
+                if (record.kind != Bitfinex::JournalRecordKind::FRAME)
+                    line["endpoint"] = endpoint_label(record.endpoint);
+                if (record.kind == Bitfinex::JournalRecordKind::REQUEST)
+                    line["path"] = record.topic;
+                if (record.kind == Bitfinex::JournalRecordKind::RESPONSE)
+                    line["status"] = record.status;
+                if (answered)
+                    line["latency_ns"] = latency_ns;
+                line["body"] = record.body;
+                std::cout << line.dump(-1, ' ', false, json::error_handler_t::replace) << '\n';
+            } else if (record.kind == Bitfinex::JournalRecordKind::REQUEST) {
+                std::cout << std::format("{} request  #{} {} {} {}\n", format_time(record.timestamp_ns), record.sequence, endpoint_label(record.endpoint),
+                    record.topic, record.body);
+            } else if (record.kind == Bitfinex::JournalRecordKind::RESPONSE) {
+                std::cout << std::format("{} response #{} {} {} {} {}\n", format_time(record.timestamp_ns), record.sequence, endpoint_label(record.endpoint),
+                    record.status, answered ? std::format("+{:.3f} ms", static_cast<double>(latency_ns) / 1e6) : "", record.body);
+            } else {
+                std::cout << std::format("{} frame    feed {} {}\n", format_time(record.timestamp_ns), record.sequence, record.body);
+            }
+        });
+
+        if (stats) {
+            if (printed == 0) {
+                std::cout << "No messages" << std::endl;
+                return 0;
+            }
+            std::cout << std::format("{} messages from {} to {}, {} frames", printed, format_time(first_ns), format_time(last_ns), frames) << std::endl;
+            std::cout << std::format("{:<18} {:>9} {:>7} {:>10} {:>10} {:>10} {:>10}", "ENDPOINT", "REQUESTS", "ERRORS", "P50 MS", "P99 MS", "P99.9 MS", "MAX MS")
+                      << std::endl;
+            for (auto const& [name, endpoint] : endpoint_stats) {
+                auto ms = [](uint64_t ns) { return static_cast<double>(ns) / 1e6; };
+                std::cout << std::format("{:<18} {:>9} {:>7} {:>10.3f} {:>10.3f} {:>10.3f} {:>10.3f}", name, endpoint.requests, endpoint.errors,
+                    ms(endpoint.latency.percentile(50)), ms(endpoint.latency.percentile(99)), ms(endpoint.latency.percentile(99.9)), ms(endpoint.latency.max()))
+                          << std::endl;
+            }
+        }
+        std::cout << std::flush;
+        return 0;
+    } catch (const std::exception& err) {
+        std::cerr << err.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,101 @@
+// Follows the market data ring published by `trader --stream --publish` and prints its records,
+// optionally only those of some symbols, with how long after publication each one was read.
+
+#include <Bitfinex/MarketData.h>
+#include <boost/algorithm/string.hpp>
+#include <boost/program_options.hpp>
+#include <chrono>
+#include <cmath>
+#include <format>
+#include <iostream>
+#include <thread>
+#include <unordered_set>
+
+static int64_t steady_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static std::string format_record(Bitfinex::MarketDataRecord const& record)
+{
+    switch (record.kind) {
+    case Bitfinex::MarketDataKind::TOP_OF_BOOK:
+        return std::format("{} top of book: {} @ {} / {} @ {}", Bitfinex::symbol_name(record.symbol), record.top_of_book.bid_size, record.top_of_book.bid,
+            record.top_of_book.ask_size, record.top_of_book.ask);
+    case Bitfinex::MarketDataKind::TRADE:
+        return std::format("{} trade: {} {} at {}", Bitfinex::symbol_name(record.symbol), record.trade.amount < 0 ? "sell" : "buy",
+            std::abs(record.trade.amount), record.trade.price);
+    case Bitfinex::MarketDataKind::TICKER:
+        return std::format("{} ticker: last {}, bid {}, ask {}, volume {}", Bitfinex::symbol_name(record.symbol), record.ticker.last_price,
+            record.ticker.bid, record.ticker.ask, record.ticker.volume);
+    default:
+        return std::format("{} unknown record", Bitfinex::symbol_name(record.symbol));
+    }
+}
+
+int main(int argc, char** argv)
+{
+    boost::program_options::options_description options("Supported options");
+    options.add_options()("help", "print help message");
+    options.add_options()("name", boost::program_options::value<std::string>()->default_value("/trader-market-data"), "Shared memory ring to follow");
+    options.add_options()("symbols", boost::program_options::value<std::string>(), "Only print the records of these comma separated symbols");
+    options.add_options()("quiet", "Print nothing but the summary once the publisher is gone");
+    options.add_options()("spin", "Poll without ever sleeping, for the lowest latency at the cost of a core");
+
+    try {
+        boost::program_options::variables_map variables_map;
+        boost::program_options::store(boost::program_options::parse_command_line(argc, argv, options), variables_map);
+        boost::program_options::notify(variables_map);
+        if (variables_map.count("help")) {
+            std::cout << options << std::endl;
+            return 0;
+        }
+
+        std::string const& name = variables_map["name"].as<std::string>();
+        std::unique_ptr<Bitfinex::MarketDataSubscriber> subscriber = Bitfinex::MarketDataSubscriber::open(name);
+        if (!subscriber) {
+            std::cerr << "No market data ring named " << name << ", is trader --stream --publish running?" << std::endl;
+            return 1;
+        }
+
+        std::unordered_set<Bitfinex::SymbolId> symbols;
+        if (variables_map.count("symbols")) {
+            std::vector<std::string> names;
+            boost::split(names, variables_map["symbols"].as<std::string>(), boost::is_any_of(","), boost::token_compress_on);
+            for (std::string const& symbol : names) {
+                if (!symbol.empty())
+                    symbols.insert(Bitfinex::intern_symbol(symbol));
+            }
+        }
+        const bool quiet = variables_map.count("quiet") > 0;
+        const bool spin = variables_map.count("spin") > 0;
+
+        uint64_t records = 0;
+        Bitfinex::MarketDataRecord record;
+        for (;;) {
+            const Bitfinex::MarketDataStatus status = subscriber->poll(record);
+            if (status == Bitfinex::MarketDataStatus::CLOSED)
+                break;
+            if (status == Bitfinex::MarketDataStatus::EMPTY) {
+                // Up to 50 us later than spinning, but leaves the core to the publisher
+                if (!spin)
+                    std::this_thread::sleep_for(std::chrono::microseconds(50));
+                continue;
+            }
+            if (status == Bitfinex::MarketDataStatus::OVERRUN) {
+                if (!quiet)
+                    std::cerr << "Overrun, " << subscriber->lost() << " records lost so far" << std::endl;
+                continue;
+            }
+            records++;
+            if (quiet || (!symbols.empty() && !symbols.contains(record.symbol)))
+                continue;
+            std::cout << std::format("#{} +{} ns {}", record.sequence, steady_ns() - record.published_ns, format_record(record)) << std::endl;
+        }
+        std::cout << std::format("{} records read, {} lost to overruns, {} corrupt", records, subscriber->lost(), subscriber->corrupt()) << std::endl;
+        return 0;
+    } catch (const std::exception& err) {
+        std::cerr << err.what() << std::endl;
+        return 1;
+    }
+}